@@ -0,0 +1,68 @@
+// benchmarks/csv/bench.c - CSV reader throughput
+//
+// Usage: bench_csv [megabytes]
+// Generates a table of the given size (default 128MB) with ids, prices and
+// quoted free-text notes, then splits every row, and extracts the int and
+// float columns into packed arrays.
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "stdlib/csv.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, size_t bytes, double elapsed, long long result) {
+  printf("%-24s %8.1f ms  %8.2f GB/s  (%lld)\n", name, elapsed * 1000,
+         bytes / elapsed / 1e9, result);
+}
+
+static Value reader_over(ObjString *text) {
+  Value arg = OBJ_VAL(text);
+  return native_csv_reader(1, &arg);
+}
+
+int main(int argc, char *argv[]) {
+  size_t megabytes = argc > 1 ? (size_t)atoi(argv[1]) : 128;
+  size_t length = megabytes * 1024 * 1024;
+  const char *notes[] = {"ok", "\"late, again\"", "\"said \"\"fine\"\"\"",
+                         "\"two\nlines\"", "restocked"};
+  char *text = malloc(length + 128);
+  size_t pos = 0;
+  unsigned seed = 1;
+  for (long long id = 0; pos < length; id++) {
+    seed = seed * 1103515245 + 12345;
+    pos += sprintf(text + pos, "%lld,%u.%02u,%s,warehouse-%u\n", id, (seed >> 16) % 1000,
+                   (seed >> 8) % 100, notes[(seed >> 20) % 5], (seed >> 4) % 16);
+  }
+  ObjString *table = string_take(text, (int)pos);
+  printf("Input: %zu MB\n\n", megabytes);
+
+  double begin = now();
+  CsvReader reader;
+  csv_reader_init(&reader, table, ',');
+  long long fields = 0;
+  while (csv_next_row(&reader)) fields += reader.span_count;
+  csv_reader_free(&reader);
+  report("split rows", pos, now() - begin, fields);
+
+  Value args[2] = {reader_over(table), value_make_int(0)};
+  begin = now();
+  ObjPacked *ids = AS_OBJ_PACKED(native_csv_column_int(2, args));
+  report("column_int", pos, now() - begin, (long long)ids->count);
+
+  args[0] = reader_over(table);
+  args[1] = value_make_int(1);
+  begin = now();
+  ObjPacked *prices = AS_OBJ_PACKED(native_csv_column_float(2, args));
+  report("column_float", pos, now() - begin, (long long)prices->count);
+
+  return 0;
+}
@@ -0,0 +1,128 @@
+// benchmarks/gc/bench.c - Mark and sweep time against thread count
+//
+// Usage: bench_gc [nodes]
+// Marks two synthetic graphs with 1, 2, 4 and 8 workers: a random graph
+// (every node an array of four edges to random nodes and a string), whose
+// breadth lets workers steal from each other, and one long list, which no
+// number of workers can mark faster than one. Then sweeps a heap of
+// garbage on as many threads. Speedup is against one thread; it can only
+// show on a machine with that many cores to spare.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "core/gc.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define EDGES 4
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static ObjArray *random_graph(int count) {
+  ObjArray *nodes = array_make(count);
+  for (int i = 0; i < count; i++) array_push(nodes, OBJ_VAL(array_make(EDGES + 1)));
+  u64 state = 42;
+  for (int i = 0; i < count; i++) {
+    ObjArray *node = AS_OBJ_ARRAY(nodes->items[i]);
+    for (int j = 0; j < EDGES; j++) {
+      state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+      array_push(node, nodes->items[(state >> 33) % count]);
+    }
+    char name[32];
+    int length = snprintf(name, sizeof(name), "node %d", i);
+    array_push(node, OBJ_VAL(string_copy(name, length)));
+  }
+  return nodes;
+}
+
+// Each cell an array of [next cell, string]
+static ObjArray *list(int count) {
+  Value next = value_make_nil();
+  for (int i = 0; i < count; i++) {
+    ObjArray *cell = array_make(2);
+    array_push(cell, next);
+    array_push(cell, OBJ_VAL(string_copy("cell", 4)));
+    next = OBJ_VAL(cell);
+  }
+  ObjArray *head = array_make(1);
+  array_push(head, next);
+  return head;
+}
+
+// Best of three marks with `threads` workers; sweeping after each only
+// clears the marks, since everything is reachable
+static double time_mark(GcHeap *heap, Value root, int threads, size_t *marked) {
+  double best = 1e9;
+  for (int round = 0; round < 3; round++) {
+    double begin = now();
+    *marked = gc_mark(heap, &root, 1, threads);
+    double elapsed = now() - begin;
+    gc_sweep(heap, -1);
+    if (elapsed < best) best = elapsed;
+  }
+  return best;
+}
+
+static void *sweeper(void *arg) {
+  gc_sweep((GcHeap*)arg, -1);
+  return NULL;
+}
+
+// Sweep `count` garbage objects on `threads` threads
+static double time_sweep(GcHeap *heap, int count, int threads, size_t *freed) {
+  for (int i = 0; i < count; i++) string_copy("garbage", 7);
+  gc_mark(heap, NULL, 0, 1);
+  size_t before = heap->freed;
+  pthread_t workers[8];
+  double begin = now();
+  for (int i = 1; i < threads; i++) pthread_create(&workers[i], NULL, sweeper, heap);
+  gc_sweep(heap, -1);
+  for (int i = 1; i < threads; i++) pthread_join(workers[i], NULL);
+  double elapsed = now() - begin;
+  *freed = heap->freed - before;
+  return elapsed;
+}
+
+int main(int argc, char *argv[]) {
+  int count = argc > 1 ? atoi(argv[1]) : 500000;
+  GcHeap heap;
+  gc_init(&heap);
+  gc_attach(&heap);
+
+  printf("Nodes: %d\n\n", count);
+  printf("%-8s %8s %10s %10s %8s\n", "graph", "threads", "objects", "mark ms", "speedup");
+  const char *names[] = {"random", "list"};
+  for (int shape = 0; shape < 2; shape++) {
+    Value root = OBJ_VAL(shape == 0 ? random_graph(count) : list(count));
+    double single = 0;
+    for (int threads = 1; threads <= 8; threads *= 2) {
+      size_t marked;
+      double elapsed = time_mark(&heap, root, threads, &marked);
+      if (threads == 1) single = elapsed;
+      printf("%-8s %8d %10zu %10.2f %7.2fx\n", names[shape], threads, marked, elapsed * 1e3,
+             single / elapsed);
+    }
+    gc_mark(&heap, NULL, 0, 1);
+    gc_sweep(&heap, -1);
+    printf("\n");
+  }
+
+  printf("%-8s %8s %10s %10s %8s\n", "sweep", "threads", "freed", "sweep ms", "speedup");
+  double single = 0;
+  for (int threads = 1; threads <= 8; threads *= 2) {
+    size_t freed;
+    double elapsed = time_sweep(&heap, 2 * count, threads, &freed);
+    if (threads == 1) single = elapsed;
+    printf("%-8s %8d %10zu %10.2f %7.2fx\n", "garbage", threads, freed, elapsed * 1e3,
+           single / elapsed);
+  }
+
+  gc_free(&heap);
+  return 0;
+}
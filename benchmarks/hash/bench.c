@@ -0,0 +1,80 @@
+// benchmarks/hash/bench.c - Hash and checksum throughput
+//
+// Usage: bench_hash [megabytes]
+// Hashes a buffer of the given size (default 256MB) in one shot and
+// streamed in 64KB chunks, then hashes many short keys.
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "stdlib/hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CHUNK (64 * 1024)
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, size_t bytes, double elapsed, u64 result) {
+  printf("%-24s %8.1f ms  %8.2f GB/s  (%016llx)\n", name, elapsed * 1000,
+         bytes / elapsed / 1e9, (unsigned long long)result);
+}
+
+int main(int argc, char *argv[]) {
+  size_t megabytes = argc > 1 ? (size_t)atoi(argv[1]) : 256;
+  size_t length = megabytes * 1024 * 1024;
+  u8 *data = malloc(length);
+  u64 x = 88172645463325252ull;
+  for (size_t i = 0; i < length; i++) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    data[i] = (u8)x;
+  }
+  printf("Input: %zu MB\n\n", megabytes);
+
+  double begin = now();
+  u64 h = hash_xxh3(data, length, 0);
+  report("xxh3", length, now() - begin, h);
+
+  begin = now();
+  Xxh3State state;
+  hash_xxh3_init(&state, 0);
+  for (size_t pos = 0; pos < length; pos += CHUNK) {
+    hash_xxh3_update(&state, data + pos, length - pos < CHUNK ? length - pos : CHUNK);
+  }
+  h = hash_xxh3_digest(&state);
+  report("xxh3 (streamed 64KB)", length, now() - begin, h);
+
+  begin = now();
+  h = hash_wyhash(data, length, 0);
+  report("wyhash", length, now() - begin, h);
+
+  begin = now();
+  h = hash_crc32c(0, data, length);
+  report("crc32c", length, now() - begin, h);
+
+  // Short keys: 16-byte record ids
+  size_t keys = length / 16;
+  begin = now();
+  h = 0;
+  for (size_t i = 0; i < keys; i++) {
+    h ^= hash_wyhash(data + i * 16, 16, 0);
+  }
+  report("wyhash 16B keys", length, now() - begin, h);
+
+  begin = now();
+  h = 0;
+  for (size_t i = 0; i < keys; i++) {
+    h ^= hash_xxh3(data + i * 16, 16, 0);
+  }
+  report("xxh3 16B keys", length, now() - begin, h);
+
+  free(data);
+  return 0;
+}
@@ -0,0 +1,125 @@
+// benchmarks/ipc/bench.c - Shared-memory channel throughput
+//
+// Usage: bench_ipc [messages] [bytes]
+// A forked producer sends the given number of messages (default 5M) of
+// the given size (default 64 bytes) to the parent, first through a pipe
+// with a length prefix per message, then through an SPSC channel, then
+// from four producers through an MPSC channel.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "stdlib/ipc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, long messages, int size, double elapsed) {
+  printf("%-24s %8.1f ms  %8.2f Mmsg/s  %6.2f GB/s\n", name, elapsed * 1000,
+         messages / elapsed / 1e6, (double)messages * size / elapsed / 1e9);
+}
+
+// Buffered pipe I/O, as a pipeline of processes would do it
+static bool read_full(int fd, void *data, size_t length) {
+  u8 *p = data;
+  while (length > 0) {
+    ssize_t n = read(fd, p, length);
+    if (n <= 0) return false;
+    p += n;
+    length -= (size_t)n;
+  }
+  return true;
+}
+
+static double bench_pipe(long messages, int size) {
+  int fds[2];
+  if (pipe(fds) != 0) exit(1);
+  double begin = now();
+  if (fork() == 0) {
+    close(fds[0]);
+    size_t record = sizeof(u32) + (size_t)size;
+    size_t batch = 65536 / record;
+    u8 *buffer = calloc(batch, record);
+    for (long sent = 0; sent < messages;) {
+      size_t n = 0;
+      for (; n < batch && sent < messages; n++, sent++) {
+        u32 length = (u32)size;
+        memcpy(buffer + n * record, &length, sizeof(u32));
+      }
+      const u8 *p = buffer;
+      size_t left = n * record;
+      while (left > 0) {
+        ssize_t written = write(fds[1], p, left);
+        if (written <= 0) _exit(1);
+        p += written;
+        left -= (size_t)written;
+      }
+    }
+    _exit(0);
+  }
+  close(fds[1]);
+  u8 *message = malloc((size_t)size);
+  for (long i = 0; i < messages; i++) {
+    u32 length;
+    if (!read_full(fds[0], &length, sizeof(u32)) || !read_full(fds[0], message, length)) exit(1);
+  }
+  close(fds[0]);
+  wait(NULL);
+  free(message);
+  return now() - begin;
+}
+
+static double bench_channel(const char *name, IpcMode mode, int producers, long messages,
+                            int size) {
+  const char *error = NULL;
+  ipc_remove(name, &error);
+  IpcRing *ring = ipc_create(name, 1 << 20, mode, &error);
+  if (ring == NULL) {
+    fprintf(stderr, "create failed: %s\n", error);
+    exit(1);
+  }
+  double begin = now();
+  for (int p = 0; p < producers; p++) {
+    if (fork() == 0) {
+      IpcRing *producer = ipc_open(name, &error);
+      u8 *message = calloc(1, (size_t)size);
+      for (long i = p; i < messages; i += producers) ipc_send(producer, message, size, -1);
+      _exit(0);
+    }
+  }
+  long checksum = 0;
+  for (long i = 0; i < messages; i++) {
+    const u8 *data;
+    int length;
+    ipc_recv(ring, &data, &length, -1);
+    checksum += length;
+    ipc_release(ring);
+  }
+  for (int p = 0; p < producers; p++) wait(NULL);
+  double elapsed = now() - begin;
+  if (checksum != messages * size) printf("checksum mismatch\n");
+  ipc_close(ring);
+  ipc_remove(name, &error);
+  return elapsed;
+}
+
+int main(int argc, char *argv[]) {
+  long messages = argc > 1 ? atol(argv[1]) : 5000000;
+  int size = argc > 2 ? atoi(argv[2]) : 64;
+  printf("Messages: %ld x %d bytes\n\n", messages, size);
+
+  report("pipe", messages, size, bench_pipe(messages, size));
+  report("ipc spsc", messages, size,
+         bench_channel("bench_ipc_spsc", IPC_SPSC, 1, messages, size));
+  report("ipc mpsc (4 producers)", messages, size,
+         bench_channel("bench_ipc_mpsc", IPC_MPSC, 4, messages, size));
+  return 0;
+}
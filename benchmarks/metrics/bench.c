@@ -0,0 +1,77 @@
+// benchmarks/metrics/bench.c - Metric recording cost
+//
+// Usage: bench_metrics [updates]
+// Times counter increments and histogram observations (default 10M per
+// thread) from one thread and from four, next to a counter all threads
+// add to in one place, which is what the shards are there to avoid.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "stdlib/metrics.h"
+#include "core/memory.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define THREADS 4
+
+static long updates;
+static Metric *counter;
+static Metric *histogram;
+static u64 shared;
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *inc_sharded(void *arg) {
+  (void)arg;
+  for (long i = 0; i < updates; i++) metrics_inc(counter, 1);
+  return NULL;
+}
+
+static void *inc_shared(void *arg) {
+  (void)arg;
+  for (long i = 0; i < updates; i++) __atomic_fetch_add(&shared, 1, __ATOMIC_RELAXED);
+  return NULL;
+}
+
+static void *observe(void *arg) {
+  (void)arg;
+  for (long i = 0; i < updates; i++) metrics_observe(histogram, (f64)(i & 1023) * 1e-4);
+  return NULL;
+}
+
+static void run(const char *name, void *(*body)(void*), int thread_count) {
+  pthread_t threads[THREADS];
+  double begin = now();
+  for (int i = 0; i < thread_count; i++) pthread_create(&threads[i], NULL, body, NULL);
+  for (int i = 0; i < thread_count; i++) pthread_join(threads[i], NULL);
+  double elapsed = now() - begin;
+  printf("%-28s %8.1f ms  %6.2f ns/update\n", name, elapsed * 1000,
+         elapsed * 1e9 / (updates * (double)thread_count));
+}
+
+int main(int argc, char *argv[]) {
+  updates = argc > 1 ? atol(argv[1]) : 10000000;
+  printf("Updates: %ld per thread\n\n", updates);
+  const char *error = NULL;
+  counter = metrics_register(METRIC_COUNTER, "bench_total", "", &error);
+  histogram = metrics_register(METRIC_HISTOGRAM, "bench_seconds", "", &error);
+
+  run("counter, 1 thread", inc_sharded, 1);
+  run("counter, 4 threads", inc_sharded, THREADS);
+  run("one atomic, 4 threads", inc_shared, THREADS);
+  run("histogram, 1 thread", observe, 1);
+  run("histogram, 4 threads", observe, THREADS);
+
+  double begin = now();
+  int length;
+  char *text = metrics_export(&length);
+  printf("%-28s %8.3f ms  %d bytes\n", "export", (now() - begin) * 1000, length);
+  mem_free(text);
+  return 0;
+}
@@ -0,0 +1,98 @@
+// benchmarks/persistent/bench.c - Persistent collection throughput
+//
+// Usage: bench_persistent [items]
+// Builds a vector of the given number of ints (default 1M) by persistent
+// pushes, through a transient, and as a plain array; then times random
+// reads and persistent sets. Does the same for a map with int keys against
+// the string table, whose keys are formatted up front.
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "core/hamt.h"
+#include "core/table.h"
+#include "core/vector.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, int count, double elapsed) {
+  printf("%-28s %8.1f ms  %8.1f M/s\n", name, elapsed * 1000, count / elapsed / 1e6);
+}
+
+int main(int argc, char *argv[]) {
+  int count = argc > 1 ? atoi(argv[1]) : 1000000;
+  printf("Items: %d\n\n", count);
+  int *order = malloc(sizeof(int) * count);
+  srand(42);
+  for (int i = 0; i < count; i++) order[i] = (int)(((u64)rand() * RAND_MAX + rand()) % count);
+
+  double begin = now();
+  ObjArray *array = array_make(0);
+  for (int i = 0; i < count; i++) array_push(array, value_make_int(i));
+  report("array push", count, now() - begin);
+
+  begin = now();
+  ObjVector *vector = vector_make();
+  for (int i = 0; i < count; i++) vector = vector_push(vector, value_make_int(i));
+  report("vector push", count, now() - begin);
+
+  begin = now();
+  ObjVector *built = vector_transient(vector_make());
+  for (int i = 0; i < count; i++) vector_push(built, value_make_int(i));
+  vector_freeze(built);
+  report("vector push (transient)", count, now() - begin);
+
+  begin = now();
+  i64 sum = 0;
+  for (int i = 0; i < count; i++) sum += AS_INT(vector_get(vector, order[i]));
+  report("vector get", count, now() - begin);
+
+  begin = now();
+  ObjVector *changed = vector;
+  for (int i = 0; i < count; i++) changed = vector_set(changed, order[i], value_make_int(-i));
+  report("vector set", count, now() - begin);
+
+  begin = now();
+  ObjMap *map = map_make();
+  for (int i = 0; i < count; i++) map = map_put(map, value_make_int(i), value_make_int(i));
+  report("map put", count, now() - begin);
+
+  begin = now();
+  ObjMap *filled = map_transient(map_make());
+  for (int i = 0; i < count; i++) map_put(filled, value_make_int(i), value_make_int(i));
+  map_freeze(filled);
+  report("map put (transient)", count, now() - begin);
+
+  begin = now();
+  Value found;
+  for (int i = 0; i < count; i++) {
+    if (map_get(map, value_make_int(order[i]), &found)) sum += AS_INT(found);
+  }
+  report("map get", count, now() - begin);
+
+  char (*keys)[16] = malloc(sizeof(*keys) * count);
+  for (int i = 0; i < count; i++) snprintf(keys[i], sizeof(keys[i]), "%d", i);
+  Table table;
+  table_init(&table);
+  begin = now();
+  for (int i = 0; i < count; i++) table_set(&table, keys[i], value_make_int(i));
+  report("table set (mutable)", count, now() - begin);
+
+  begin = now();
+  for (int i = 0; i < count; i++) {
+    if (table_get(&table, keys[order[i]], &found)) sum += AS_INT(found);
+  }
+  report("table get (mutable)", count, now() - begin);
+
+  printf("\nchecksum %lld\n", (long long)sum);
+  table_free(&table);
+  free(keys);
+  free(order);
+  return 0;
+}
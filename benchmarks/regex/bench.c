@@ -0,0 +1,94 @@
+// benchmarks/regex/bench.c - Regex engine throughput over a synthetic log
+//
+// Usage: bench_regex [megabytes] [logfile]
+// Without a logfile, generates an access/app log of the given size (default 64MB).
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "stdlib/regex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char *levels[] = {"INFO", "INFO", "INFO", "DEBUG", "WARN", "ERROR"};
+static const char *paths[] = {"/api/users", "/api/orders", "/static/app.js",
+                              "/health", "/login"};
+
+static char *generate_log(size_t size, size_t *length) {
+  char *buffer = malloc(size + 256);
+  size_t pos = 0;
+  unsigned seed = 42;
+  while (pos < size) {
+    seed = seed * 1103515245 + 12345;
+    unsigned r = seed >> 8;
+    pos += (size_t)sprintf(buffer + pos,
+                           "2024-03-%02u 12:%02u:%02u %s 10.%u.%u.%u GET %s %u %ums\n",
+                           r % 28 + 1, r % 60, (r >> 6) % 60, levels[r % 6],
+                           r % 256, (r >> 8) % 256, (r >> 16) % 256,
+                           paths[(r >> 4) % 5], r % 7 == 0 ? 500 : 200, r % 900);
+  }
+  *length = pos;
+  return buffer;
+}
+
+static char *read_file(const char *path, size_t *length) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) return NULL;
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  char *buffer = malloc((size_t)size + 1);
+  *length = fread(buffer, 1, (size_t)size, file);
+  fclose(file);
+  return buffer;
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench(const char *pattern, const char *text, int length) {
+  const char *error;
+  Regex *re = regex_compile(pattern, (int)strlen(pattern), &error);
+  if (re == NULL) {
+    fprintf(stderr, "Error: '%s': %s\n", pattern, error);
+    exit(1);
+  }
+
+  double begin = now();
+  long count = 0;
+  int from = 0, start, end;
+  while (from <= length && regex_search(re, text, length, from, &start, &end)) {
+    count++;
+    from = end > start ? end : end + 1;
+  }
+  double elapsed = now() - begin;
+
+  printf("%-40s %8ld matches  %8.1f ms  %8.1f MB/s\n", pattern, count,
+         elapsed * 1000, length / elapsed / (1024 * 1024));
+  regex_free(re);
+}
+
+int main(int argc, char *argv[]) {
+  size_t megabytes = argc > 1 ? (size_t)atoi(argv[1]) : 64;
+  size_t length;
+  char *text = argc > 2 ? read_file(argv[2], &length)
+                        : generate_log(megabytes * 1024 * 1024, &length);
+  if (text == NULL) {
+    fprintf(stderr, "Error: Could not read '%s'\n", argv[2]);
+    return 1;
+  }
+  printf("Input: %.1f MB\n\n", length / (1024.0 * 1024.0));
+
+  bench("ERROR", text, (int)length);
+  bench("ERROR [0-9.]+ GET /login", text, (int)length);
+  bench("\\d+\\.\\d+\\.\\d+\\.\\d+", text, (int)length);
+  bench("(WARN|ERROR).* 500 ", text, (int)length);
+  bench("(?i)/api/(users|orders)", text, (int)length);
+
+  free(text);
+  return 0;
+}
@@ -0,0 +1,105 @@
+// benchmarks/sort/bench.c - Native sort throughput
+//
+// Usage: bench_sort [millions]
+// Sorts the given number of random ints (default 10M) and floats with the
+// radix kernels, and a tenth as many strings with pdqsort, each against
+// the C library's qsort.
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "stdlib/sort.h"
+#include "core/object.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, int count, double elapsed) {
+  printf("%-24s %8.1f ms  %8.1f M/s\n", name, elapsed * 1000, count / elapsed / 1e6);
+}
+
+static int compare_ints(const void *a, const void *b) {
+  i64 x = *(const i64*)a, y = *(const i64*)b;
+  return (x > y) - (x < y);
+}
+
+static int compare_floats(const void *a, const void *b) {
+  f64 x = *(const f64*)a, y = *(const f64*)b;
+  return (x > y) - (x < y);
+}
+
+static int compare_strings(const void *a, const void *b) {
+  const Value *x = a, *y = b;
+  const char *xc, *yc;
+  int xn, yn;
+  value_get_string(x, &xc, &xn);
+  value_get_string(y, &yc, &yn);
+  int c = memcmp(xc, yc, xn < yn ? xn : yn);
+  return c != 0 ? c : xn - yn;
+}
+
+int main(int argc, char *argv[]) {
+  int count = (argc > 1 ? atoi(argv[1]) : 10) * 1000000;
+  i64 *ints = malloc(sizeof(i64) * count);
+  i64 *ints_copy = malloc(sizeof(i64) * count);
+  f64 *floats = malloc(sizeof(f64) * count);
+  f64 *floats_copy = malloc(sizeof(f64) * count);
+  u64 x = 88172645463325252ull;
+  for (int i = 0; i < count; i++) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    ints[i] = (i64)x;
+    floats[i] = (f64)(i64)x / 1e9;
+  }
+  memcpy(ints_copy, ints, sizeof(i64) * count);
+  memcpy(floats_copy, floats, sizeof(f64) * count);
+  printf("Input: %d ints, %d floats, %d strings\n\n", count, count, count / 10);
+
+  double begin = now();
+  sort_ints(ints, count);
+  report("sort_ints (radix)", count, now() - begin);
+  begin = now();
+  qsort(ints_copy, count, sizeof(i64), compare_ints);
+  report("qsort ints", count, now() - begin);
+
+  begin = now();
+  sort_floats(floats, count);
+  report("sort_floats (radix)", count, now() - begin);
+  begin = now();
+  qsort(floats_copy, count, sizeof(f64), compare_floats);
+  report("qsort floats", count, now() - begin);
+
+  // Strings: one Value per element, as a script's array would hold
+  int strings = count / 10;
+  Value *keys = malloc(sizeof(Value) * strings);
+  for (int i = 0; i < strings; i++) {
+    char buffer[32];
+    int length = sprintf(buffer, "user-%llx", (unsigned long long)ints_copy[(i * 7919L) % count]);
+    keys[i] = OBJ_VAL(string_copy(buffer, length));
+  }
+  u32 *order = malloc(sizeof(u32) * strings);
+  begin = now();
+  sort_order(keys, strings, false, order);
+  report("sort_order strings", strings, now() - begin);
+  begin = now();
+  sort_order(keys, strings, true, order);
+  report("sort_order (stable)", strings, now() - begin);
+  begin = now();
+  qsort(keys, strings, sizeof(Value), compare_strings);
+  report("qsort strings", strings, now() - begin);
+
+  free(ints);
+  free(ints_copy);
+  free(floats);
+  free(floats_copy);
+  free(keys);
+  free(order);
+  return 0;
+}
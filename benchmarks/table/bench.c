@@ -0,0 +1,157 @@
+// benchmarks/table/bench.c - Table hashing: probe counts and throughput
+//
+// Usage: bench_table [keys]
+// Compares the unseeded FNV-1a that Table and ObjString used to hash with
+// hash_key, on the same linear-probing layout Table uses (power-of-two
+// capacity, at most 75% full, hash checked before the key). Three key
+// sets: short sequential names, 200-byte keys, and a flood of keys picked
+// so that FNV-1a sends every one of them to the same slot, as anyone can
+// precompute for an unseeded hash. Then times the real Table.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "core/hash.h"
+#include "core/table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static u32 fnv1a(const char *chars, size_t length) {
+  u32 hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (u8)chars[i];
+    hash *= 16777619;
+  }
+  return hash;
+}
+
+typedef u32 (*HashFn)(const char *chars, size_t length);
+
+typedef struct {
+  char **keys;
+  int count;
+  u32 capacity;   // As Table would have grown to
+} KeySet;
+
+static KeySet key_set(int count) {
+  KeySet set = {calloc(count, sizeof(char*)), count, 8};
+  while (count > set.capacity * 0.75) set.capacity *= 2;
+  return set;
+}
+
+// Insert every key as Table does, then look each one up; reports the
+// probes per lookup and the time per lookup
+static void run(const char *name, const KeySet *set, HashFn hash, const char *hash_name) {
+  u32 mask = set->capacity - 1;
+  const char **slots = calloc(set->capacity, sizeof(char*));
+  u32 *hashes = calloc(set->capacity, sizeof(u32));
+  for (int i = 0; i < set->count; i++) {
+    u32 h = hash(set->keys[i], strlen(set->keys[i]));
+    u32 index = h & mask;
+    while (slots[index] != NULL) index = (index + 1) & mask;
+    slots[index] = set->keys[i];
+    hashes[index] = h;
+  }
+
+  u64 probes = 0, worst = 0;
+  int rounds = 0;
+  double begin = now(), elapsed;
+  do {
+    for (int i = 0; i < set->count; i++) {
+      const char *key = set->keys[i];
+      u32 h = hash(key, strlen(key));
+      u64 n = 1;
+      for (u32 index = h & mask; hashes[index] != h || strcmp(slots[index], key) != 0;
+           index = (index + 1) & mask) {
+        n++;
+      }
+      probes += n;
+      if (n > worst) worst = n;
+    }
+    rounds++;
+    elapsed = now() - begin;
+  } while (elapsed < 0.2);
+  double lookups = (double)rounds * set->count;
+  printf("%-10s %-8s %8.2f probes avg %8llu max %10.1f ns/lookup\n", name, hash_name,
+         probes / lookups, (unsigned long long)worst, elapsed / lookups * 1e9);
+  free(slots);
+  free(hashes);
+}
+
+// Time the real Table: fill, then look every key up
+static void run_table(const char *name, const KeySet *set) {
+  double begin = now();
+  Table table;
+  table_init(&table);
+  for (int i = 0; i < set->count; i++) table_set(&table, set->keys[i], value_make_int(i));
+  double filled = now();
+  Value value;
+  i64 sum = 0;
+  for (int round = 0; round < 10; round++) {
+    for (int i = 0; i < set->count; i++) {
+      if (table_get(&table, set->keys[i], &value)) sum += AS_INT(value);
+    }
+  }
+  double done = now();
+  printf("%-10s Table    %8.1f ns/set %8.1f ns/get   (%lld)\n", name,
+         (filled - begin) / set->count * 1e9, (done - filled) / (10.0 * set->count) * 1e9,
+         (long long)sum);
+  table_free(&table);
+}
+
+static void free_set(KeySet *set) {
+  for (int i = 0; i < set->count; i++) free(set->keys[i]);
+  free(set->keys);
+}
+
+int main(int argc, char *argv[]) {
+  int count = argc > 1 ? atoi(argv[1]) : 2000;
+  printf("Keys: %d\n\n", count);
+
+  KeySet names = key_set(count);
+  for (int i = 0; i < count; i++) {
+    names.keys[i] = malloc(32);
+    snprintf(names.keys[i], 32, "module.name_%d", i);
+  }
+
+  KeySet long_keys = key_set(count);
+  for (int i = 0; i < count; i++) {
+    long_keys.keys[i] = malloc(201);
+    memset(long_keys.keys[i], 'x', 200);
+    long_keys.keys[i][200] = '\0';
+    snprintf(long_keys.keys[i], 201, "https://example.com/a/long/path/%d", i);
+    long_keys.keys[i][strlen(long_keys.keys[i])] = '/';
+  }
+
+  // Every key FNV-1a hashes to slot 0 of the table they end up in
+  KeySet flood = key_set(count);
+  u32 mask = flood.capacity - 1;
+  char candidate[32];
+  for (u64 n = 0, found = 0; found < (u64)count; n++) {
+    int length = snprintf(candidate, sizeof(candidate), "field%llu", (unsigned long long)n);
+    if ((fnv1a(candidate, (size_t)length) & mask) == 0) flood.keys[found++] = strdup(candidate);
+  }
+
+  const struct {
+    const char *name;
+    KeySet *set;
+  } sets[] = {{"names", &names}, {"200-byte", &long_keys}, {"flood", &flood}};
+  for (size_t i = 0; i < sizeof(sets) / sizeof(sets[0]); i++) {
+    run(sets[i].name, sets[i].set, fnv1a, "fnv1a");
+    run(sets[i].name, sets[i].set, hash_key, "hash_key");
+    run_table(sets[i].name, sets[i].set);
+    printf("\n");
+  }
+
+  free_set(&names);
+  free_set(&long_keys);
+  free_set(&flood);
+  return 0;
+}
@@ -0,0 +1,78 @@
+// benchmarks/utf8/bench.c - UTF-8 validation and code-point indexing
+//
+// Usage: bench_utf8 [megabytes]
+// Validates and counts an ASCII buffer and a mixed-script buffer of the
+// given size (default 128MB), then looks up random code points in a
+// non-ASCII string through the breadcrumb index.
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "core/object.h"
+#include "core/utf8.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, size_t bytes, double elapsed, long long result) {
+  printf("%-24s %8.1f ms  %8.2f GB/s  (%lld)\n", name, elapsed * 1000,
+         bytes / elapsed / 1e9, result);
+}
+
+int main(int argc, char *argv[]) {
+  size_t megabytes = argc > 1 ? (size_t)atoi(argv[1]) : 128;
+  int length = (int)(megabytes * 1024 * 1024);
+  char *ascii = malloc(length);
+  char *mixed = malloc(length + 4);
+  const char *words[] = {"satori ", "caf\xc3\xa9 ", "\xe6\x82\x9f\xe3\x82\x8a ",
+                         "\xf0\x9f\x98\x80 ", "plain ", "na\xc3\xafve "};
+  unsigned seed = 1;
+  for (int i = 0; i < length; i++) ascii[i] = (char)('a' + i % 26);
+  int pos = 0;
+  while (pos < length) {
+    seed = seed * 1103515245 + 12345;
+    const char *word = words[(seed >> 16) % 6];
+    int n = (int)strlen(word);
+    memcpy(mixed + pos, word, n);
+    pos += n;
+  }
+  length = pos < length ? pos : length;
+  while (length > 0 && utf8_is_continuation((u8)mixed[length])) length--;
+  printf("Input: %zu MB\n\n", megabytes);
+
+  double begin = now();
+  bool valid = utf8_validate(ascii, length);
+  report("validate ascii", length, now() - begin, valid);
+  begin = now();
+  valid = utf8_validate(mixed, length);
+  report("validate mixed", length, now() - begin, valid);
+  begin = now();
+  int count = utf8_count(mixed, length);
+  report("count mixed", length, now() - begin, count);
+
+  // Random access into a 1MB non-ASCII string
+  int text_length = 1024 * 1024;
+  while (utf8_is_continuation((u8)mixed[text_length])) text_length--;
+  ObjString *text = string_copy(mixed, text_length);
+  int chars = string_char_count(text);
+  int lookups = 1000000;
+  long long sum = 0;
+  begin = now();
+  for (int i = 0; i < lookups; i++) {
+    seed = seed * 1103515245 + 12345;
+    sum += string_char_offset(text, (int)((seed >> 8) % (unsigned)chars));
+  }
+  double elapsed = now() - begin;
+  printf("%-24s %8.1f ms  %8.1f ns/lookup  (%lld)\n", "char_offset 1MB", elapsed * 1000,
+         elapsed / lookups * 1e9, sum);
+
+  free(ascii);
+  free(mixed);
+  return 0;
+}
@@ -3,17 +3,37 @@
 #define _POSIX_C_SOURCE 200809L
 
 #include "backend/codegen.h"
+#include "core/hamt.h"
+#include "core/vector.h"
 #include "error/error.h"
+#include "runtime/module.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+// What codegen can prove about a value's type at compile time
+typedef enum {
+  TYPE_UNKNOWN,
+  TYPE_INT,
+  TYPE_FLOAT,
+  TYPE_BOOL,
+} StaticType;
+
 // Local variable tracking
 typedef struct {
   char *name;
   int slot;
+  StaticType type;    // Holds for every value the local is given
 } Local;
 
+// Innermost loop being compiled, for break and continue
+typedef struct Loop {
+  struct Loop *enclosing;
+  int start;          // Where continue jumps back to
+  int *breaks;        // Jumps to patch to the loop's end
+  int break_count;
+} Loop;
+
 typedef struct {
   Chunk *chunk;
   bool had_error;
@@ -21,6 +41,20 @@ typedef struct {
   // Local variables
   Local locals[SATORI_MAX_LOCALS];
   int local_count;
+
+  Loop *loop;
+
+  // Modules imported so far, which comptime expressions may call
+  char **imports;
+  int import_count;
+  bool comptime;  // Compiling a comptime expression: only pure natives
+
+  // Names assigned to anywhere in the program: their locals may change
+  // type, so they are never typed
+  char **assigned;
+  int assigned_count;
+
+  StaticType last_type;  // Type of the last expression compiled
 } Compiler;
 
 static void emit_byte(Compiler *c, u8 byte) { chunk_write(c->chunk, byte); }
@@ -75,6 +109,14 @@ static int make_constant(Compiler *c, Value value) {
   return constant;
 }
 
+// A literal too long to hold inline becomes a string object, so the
+// string module's scans of it are kept rather than redone on every call
+static Value literal_value(const char *chars) {
+  size_t length = strlen(chars);
+  if (length <= VALUE_SHORT_MAX) return value_make_string(chars);
+  return OBJ_VAL(string_copy(chars, (int)length));
+}
+
 // Add a local variable
 static int add_local(Compiler *c, const char *name) {
   if (c->local_count >= SATORI_MAX_LOCALS) {
@@ -86,9 +128,98 @@ static int add_local(Compiler *c, const char *name) {
   Local *local = &c->locals[c->local_count];
   local->name = strdup(name);
   local->slot = c->local_count;
+  local->type = TYPE_UNKNOWN;
   return c->local_count++;
 }
 
+// Record the type of every value `slot` will hold, unless it is assigned
+static void type_local(Compiler *c, int slot, StaticType type) {
+  if (slot < 0) return;
+  for (int i = 0; i < c->assigned_count; i++) {
+    if (strcmp(c->assigned[i], c->locals[slot].name) == 0) return;
+  }
+  c->locals[slot].type = type;
+}
+
+// Collect the targets of every assignment under `node`
+static void find_assigned(Compiler *c, AstNode *node) {
+  if (!node) return;
+  switch (node->type) {
+  case AST_PROGRAM:
+    for (int i = 0; i < node->as.program.statement_count; i++) {
+      find_assigned(c, node->as.program.statements[i]);
+    }
+    break;
+  case AST_BLOCK:
+    for (int i = 0; i < node->as.block.statement_count; i++) {
+      find_assigned(c, node->as.block.statements[i]);
+    }
+    break;
+  case AST_ASSIGNMENT:
+    c->assigned = realloc(c->assigned, sizeof(char*) * (c->assigned_count + 1));
+    c->assigned[c->assigned_count++] = node->as.assignment.name;
+    break;
+  case AST_IF:
+    find_assigned(c, node->as.if_stmt.then_branch);
+    find_assigned(c, node->as.if_stmt.else_branch);
+    break;
+  case AST_WHILE:
+    find_assigned(c, node->as.while_loop.body);
+    break;
+  case AST_MATCH:
+    for (int i = 0; i < node->as.match.arm_count; i++) {
+      find_assigned(c, node->as.match.arms[i].body);
+    }
+    break;
+  case AST_FOR:
+    find_assigned(c, node->as.for_loop.body);
+    break;
+  case AST_LOOP:
+    find_assigned(c, node->as.loop.body);
+    break;
+  default:
+    // Assignments are statements, and no expression holds one
+    break;
+  }
+}
+
+// The opcode for `op` on two operands of type `type`, specialized when
+// there is a form for it
+static u8 binary_opcode(BinaryOperator op, StaticType type) {
+  static const u8 generic[] = {
+    OP_ADD, OP_SUBTRACT, OP_MULTIPLY, OP_DIVIDE, OP_MODULO, OP_EQUAL,
+    OP_NOT_EQUAL, OP_LESS, OP_LESS_EQUAL, OP_GREATER, OP_GREATER_EQUAL,
+  };
+  static const u8 ints[] = {
+    OP_ADD_INT, OP_SUBTRACT_INT, OP_MULTIPLY_INT, OP_DIVIDE, OP_MODULO_INT, OP_EQUAL_INT,
+    OP_NOT_EQUAL_INT, OP_LESS_INT, OP_LESS_EQUAL_INT, OP_GREATER_INT, OP_GREATER_EQUAL_INT,
+  };
+  static const u8 floats[] = {
+    OP_ADD_FLOAT, OP_SUBTRACT_FLOAT, OP_MULTIPLY_FLOAT, OP_DIVIDE_FLOAT, OP_MODULO, OP_EQUAL,
+    OP_NOT_EQUAL, OP_LESS_FLOAT, OP_LESS_EQUAL_FLOAT, OP_GREATER_FLOAT, OP_GREATER_EQUAL_FLOAT,
+  };
+  return type == TYPE_INT ? ints[op] : type == TYPE_FLOAT ? floats[op] : generic[op];
+}
+
+// Type of `left op right`, as the VM computes it
+static StaticType binary_type(BinaryOperator op, StaticType left, StaticType right) {
+  bool numeric = (left == TYPE_INT || left == TYPE_FLOAT) &&
+                 (right == TYPE_INT || right == TYPE_FLOAT);
+  switch (op) {
+  case BIN_ADD:
+  case BIN_SUB:
+  case BIN_MUL:
+    if (!numeric) return TYPE_UNKNOWN;
+    return left == TYPE_INT && right == TYPE_INT ? TYPE_INT : TYPE_FLOAT;
+  case BIN_DIV:
+    return numeric ? TYPE_FLOAT : TYPE_UNKNOWN;
+  case BIN_MOD:
+    return left == TYPE_INT && right == TYPE_INT ? TYPE_INT : TYPE_UNKNOWN;
+  default:
+    return TYPE_BOOL;
+  }
+}
+
 // Find a local variable by name
 static int resolve_local(Compiler *c, const char *name) {
   for (int i = c->local_count - 1; i >= 0; i--) {
@@ -99,8 +230,76 @@ static int resolve_local(Compiler *c, const char *name) {
   return -1;  // Not found
 }
 
+// Drop locals declared since the scope began
+static void end_scope(Compiler *c, int local_count) {
+  while (c->local_count > local_count) {
+    free(c->locals[--c->local_count].name);
+  }
+}
+
+static void begin_loop(Compiler *c, Loop *loop, int start) {
+  loop->enclosing = c->loop;
+  loop->start = start;
+  loop->breaks = NULL;
+  loop->break_count = 0;
+  c->loop = loop;
+}
+
+// Point the loop's breaks here
+static void end_loop(Compiler *c, Loop *loop) {
+  for (int i = 0; i < loop->break_count; i++) {
+    patch_jump(c, loop->breaks[i]);
+  }
+  free(loop->breaks);
+  c->loop = loop->enclosing;
+}
+
 static void compile_node(Compiler *c, AstNode *node);
 
+// Compile a node in statement position: expressions leave a value on the
+// stack, which nobody consumes here, so pop it. Its code is attributed to
+// its line, and whatever the enclosing statement emits after it to that
+// statement's line again.
+static void compile_statement(Compiler *c, AstNode *node) {
+  if (!node)
+    return;
+
+  int outer_line = c->chunk->line;
+  if (node->line > 0) c->chunk->line = node->line;
+  compile_node(c, node);
+
+  switch (node->type) {
+  case AST_PROGRAM:
+  case AST_IMPORT:
+  case AST_LET:
+  case AST_ASSIGNMENT:
+  case AST_IF:
+  case AST_WHILE:
+  case AST_MATCH:
+  case AST_FOR:
+  case AST_LOOP:
+  case AST_BREAK:
+  case AST_CONTINUE:
+  case AST_BLOCK:
+    break;
+  default:
+    emit_byte(c, OP_POP);
+    break;
+  }
+  c->chunk->line = outer_line;
+}
+
+// Load the native `name` ("module.function") to call. The compiler runs
+// comptime expressions itself, so those may only call natives without
+// effects outside their VM.
+static void emit_native(Compiler *c, const char *name) {
+  if (c->comptime && !module_native_pure(name)) {
+    error_report_simple("%s cannot be called in a comptime expression", name);
+    c->had_error = true;
+  }
+  emit_bytes(c, OP_GET_GLOBAL, make_constant(c, value_make_string(name)));
+}
+
 static void compile_call(Compiler *c, AstNode *node) {
   AstCall *call = &node->as.call;
 
@@ -115,8 +314,7 @@ static void compile_call(Compiler *c, AstNode *node) {
       snprintf(full_name, sizeof(full_name), "%s.%s", obj->name, member->member);
       
       // Emit OP_GET_GLOBAL to get the native function
-      int name_idx = make_constant(c, value_make_string(full_name));
-      emit_bytes(c, OP_GET_GLOBAL, name_idx);
+      emit_native(c, full_name);
       
       // Compile arguments (push them on stack)
       for (int i = 0; i < call->arg_count; i++) {
@@ -126,10 +324,8 @@ static void compile_call(Compiler *c, AstNode *node) {
       // Emit OP_CALL_NATIVE with argument count
       emit_bytes(c, OP_CALL_NATIVE, call->arg_count);
       
-      // The result is now on the stack
-      // For expression statements, we need to pop it
-      // For now, we'll always pop (statements only)
-      emit_byte(c, OP_POP);
+      // The result is now on the stack; compile_statement pops it
+      // when the call is used as a statement
       return;
     }
   }
@@ -138,14 +334,696 @@ static void compile_call(Compiler *c, AstNode *node) {
   c->had_error = true;
 }
 
+// Push a loop's source: a range's two bounds, or the iterable
+static void compile_source(Compiler *c, AstNode *source) {
+  if (source->type == AST_RANGE) {
+    compile_node(c, source->as.range.start);
+    compile_node(c, source->as.range.end);
+  } else {
+    compile_node(c, source);
+  }
+}
+
+// Emit a loop head over the source on the stack, binding one variable.
+// Returns the head's offset; *exit_jump gets its exit operand to patch.
+static int emit_loop_head(Compiler *c, bool is_range, int state, int var, int *exit_jump) {
+  emit_byte(c, OP_FOR_PREP);
+  int head = c->chunk->count;
+  emit_byte(c, is_range ? OP_FOR_RANGE : OP_FOR_ARRAY);
+  emit_bytes(c, (u8)state, (u8)var);
+  emit_byte(c, 1);
+  *exit_jump = c->chunk->count;
+  emit_bytes(c, 0xff, 0xff);
+  return head;
+}
+
+typedef enum { SINK_COLLECT, SINK_SUM, SINK_COUNT } Sink;
+
+// The stage's name when it is a bare `name` or `name(args)`, else NULL
+static const char *stage_name(AstNode *stage, int *arg_count, AstNode ***args) {
+  *arg_count = 0;
+  *args = NULL;
+  if (stage->type == AST_IDENTIFIER) return stage->as.identifier.name;
+  if (stage->type == AST_CALL && stage->as.call.callee->type == AST_IDENTIFIER) {
+    *arg_count = stage->as.call.arg_count;
+    *args = stage->as.call.args;
+    return stage->as.call.callee->as.identifier.name;
+  }
+  return NULL;
+}
+
+static bool is_transform(AstNode *stage) {
+  int arg_count;
+  AstNode **args;
+  const char *name = stage_name(stage, &arg_count, &args);
+  return name && arg_count == 1 && (strcmp(name, "filter") == 0 || strcmp(name, "map") == 0);
+}
+
+static bool is_sink(AstNode *stage, Sink *sink) {
+  int arg_count;
+  AstNode **args;
+  const char *name = stage_name(stage, &arg_count, &args);
+  if (!name || arg_count != 0) return false;
+  if (strcmp(name, "collect") == 0) *sink = SINK_COLLECT;
+  else if (strcmp(name, "sum") == 0) *sink = SINK_SUM;
+  else if (strcmp(name, "count") == 0) *sink = SINK_COUNT;
+  else return false;
+  return true;
+}
+
+// Fuse stages[0..count) (filter and map stages, then the sink) into one
+// loop over `source`, which is compiled here unless it is NULL, meaning
+// the value of the previous stages is already on the stack. Each item is
+// bound to `it` and streamed through every stage in turn; only the sink's
+// array is ever allocated. Returns the type of the result.
+static StaticType compile_fused(Compiler *c, AstNode *source, AstNode **stages, int count,
+                                Sink sink) {
+  bool is_range = source && source->type == AST_RANGE;
+  int scope = c->local_count;
+  int acc = add_local(c, "");
+  if (acc < 0) return TYPE_UNKNOWN;
+
+  if (sink != SINK_COLLECT) {
+    emit_bytes(c, OP_CONSTANT, make_constant(c, value_make_int(0)));
+    emit_bytes(c, OP_SET_LOCAL, (u8)acc);
+  }
+  // A sum starts from its first item, so strings and floats add up
+  // without a leading int 0; `first` is true until that item is taken
+  int first = -1;
+  if (sink == SINK_SUM) {
+    first = add_local(c, "");
+    if (first < 0) return TYPE_UNKNOWN;
+    emit_bytes(c, OP_CONSTANT, make_constant(c, value_make_bool(true)));
+    emit_bytes(c, OP_SET_LOCAL, (u8)first);
+  }
+  if (source) compile_source(c, source);
+  if (sink == SINK_COLLECT) {
+    // A filter makes the final length unknown
+    bool filtered = false;
+    for (int i = 0; i < count; i++) {
+      int arg_count;
+      AstNode **args;
+      filtered = filtered || strcmp(stage_name(stages[i], &arg_count, &args), "filter") == 0;
+    }
+    u8 size = filtered ? PIPE_SIZE_NONE : is_range ? PIPE_SIZE_RANGE : PIPE_SIZE_COLLECTION;
+    emit_bytes(c, OP_PIPE_ARRAY, size);
+    emit_bytes(c, OP_SET_LOCAL, (u8)acc);
+  }
+
+  int state = add_local(c, "");
+  add_local(c, "");
+  int it = add_local(c, "it");
+  if (it < 0) return TYPE_UNKNOWN;
+  // `it` is retyped after each map, as the stages run in order
+  type_local(c, it, is_range ? TYPE_INT : TYPE_UNKNOWN);
+  int exit_jump;
+  int head = emit_loop_head(c, is_range, state, it, &exit_jump);
+
+  // Filters that fail jump, condition still on the stack, to `skip`
+  int *skips = malloc(sizeof(int) * (count > 0 ? count : 1));
+  int skip_count = 0;
+  for (int i = 0; i < count; i++) {
+    AstCall *stage = &stages[i]->as.call;
+    compile_node(c, stage->args[0]);
+    if (strcmp(stage->callee->as.identifier.name, "filter") == 0) {
+      skips[skip_count++] = emit_jump(c, OP_JUMP_IF_FALSE);
+      emit_byte(c, OP_POP);
+    } else {
+      type_local(c, it, c->last_type);
+      emit_bytes(c, OP_SET_LOCAL, (u8)it);
+    }
+  }
+
+  // An int sum can start at int 0, so only adds ints
+  StaticType result = TYPE_UNKNOWN;
+  int added = -1;
+  if (sink == SINK_SUM && c->locals[it].type != TYPE_INT) {
+    emit_bytes(c, OP_GET_LOCAL, (u8)first);
+    int later = emit_jump(c, OP_JUMP_IF_FALSE);
+    emit_byte(c, OP_POP);
+    emit_bytes(c, OP_CONSTANT, make_constant(c, value_make_bool(false)));
+    emit_bytes(c, OP_SET_LOCAL, (u8)first);
+    emit_bytes(c, OP_GET_LOCAL, (u8)it);
+    emit_bytes(c, OP_SET_LOCAL, (u8)acc);
+    added = emit_jump(c, OP_JUMP);
+    patch_jump(c, later);
+    emit_byte(c, OP_POP);
+  }
+  if (sink == SINK_COLLECT) {
+    emit_bytes(c, OP_GET_LOCAL, (u8)it);
+    emit_bytes(c, OP_ARRAY_APPEND, (u8)acc);
+  } else {
+    emit_bytes(c, OP_GET_LOCAL, (u8)acc);
+    if (sink == SINK_SUM) {
+      emit_bytes(c, OP_GET_LOCAL, (u8)it);
+      if (c->locals[it].type == TYPE_INT) result = TYPE_INT;
+    } else {
+      emit_bytes(c, OP_CONSTANT, make_constant(c, value_make_int(1)));
+      result = TYPE_INT;
+    }
+    emit_byte(c, result == TYPE_INT ? OP_ADD_INT : OP_ADD);
+    emit_bytes(c, OP_SET_LOCAL, (u8)acc);
+  }
+  if (added >= 0) patch_jump(c, added);
+  emit_loop(c, head);
+
+  if (skip_count > 0) {
+    for (int i = 0; i < skip_count; i++) patch_jump(c, skips[i]);
+    emit_byte(c, OP_POP);
+    emit_loop(c, head);
+  }
+  free(skips);
+
+  patch_jump(c, exit_jump);
+  emit_bytes(c, OP_GET_LOCAL, (u8)acc);
+  end_scope(c, scope);
+  return result;
+}
+
+// source |> stage |> ...: each run of filter/map stages and the sink that
+// ends it (collect() when none does) becomes one fused loop. Any other
+// stage is a module call taking the value so far as its first argument.
+// Returns the type of the result.
+static StaticType compile_pipeline(Compiler *c, AstNode *node) {
+  AstPipeline *pipeline = &node->as.pipeline;
+  AstNode *source = pipeline->source;
+  StaticType type = TYPE_UNKNOWN;
+  int i = 0;
+
+  if (source->type != AST_RANGE) {
+    compile_node(c, source);
+    source = NULL;
+  }
+  while (i < pipeline->stage_count) {
+    AstNode *stage = pipeline->stages[i];
+    int first = i;
+    while (i < pipeline->stage_count && is_transform(pipeline->stages[i])) i++;
+    Sink sink = SINK_COLLECT;
+    bool has_sink = i < pipeline->stage_count && is_sink(pipeline->stages[i], &sink);
+    if (i > first || has_sink) {
+      type = compile_fused(c, source, pipeline->stages + first, i - first, sink);
+      source = NULL;
+      if (has_sink) i++;
+      continue;
+    }
+
+    if (stage->type != AST_CALL || stage->as.call.callee->type != AST_MEMBER_ACCESS ||
+        stage->as.call.callee->as.member_access.object->type != AST_IDENTIFIER) {
+      error_report_simple("Unknown pipeline stage");
+      c->had_error = true;
+      return TYPE_UNKNOWN;
+    }
+
+    if (source) {
+      // A range is collected before it is handed on
+      compile_fused(c, source, NULL, 0, SINK_COLLECT);
+      source = NULL;
+    }
+
+    // Slip the value so far in as the call's first argument
+    AstCall *call = &stage->as.call;
+    AstMemberAccess *member = &call->callee->as.member_access;
+    int scope = c->local_count;
+    int held = add_local(c, "");
+    if (held < 0) return TYPE_UNKNOWN;
+    emit_bytes(c, OP_SET_LOCAL, (u8)held);
+    char full_name[256];
+    snprintf(full_name, sizeof(full_name), "%s.%s", member->object->as.identifier.name,
+             member->member);
+    emit_native(c, full_name);
+    emit_bytes(c, OP_GET_LOCAL, (u8)held);
+    for (int a = 0; a < call->arg_count; a++) compile_node(c, call->args[a]);
+    emit_bytes(c, OP_CALL_NATIVE, (u8)(call->arg_count + 1));
+    end_scope(c, scope);
+    type = TYPE_UNKNOWN;
+    i++;
+  }
+  return type;
+}
+
+// A pattern's ints, start through last, and the arm it selects; `exact`
+// for a single int, which a float subject must equal. Bounds are
+// inclusive so that INT64_MAX is a pattern like any other.
+typedef struct {
+  i64 start;
+  i64 last;
+  int arm;
+  bool exact;
+} MatchRange;
+
+// A table entry to point at an arm (or, for -1, the default) once the
+// arms are emitted, as an offset from `base`
+typedef struct {
+  int site;
+  int base;
+  int arm;
+} MatchPatch;
+
+typedef struct {
+  MatchPatch *patches;
+  int count;
+} MatchPatches;
+
+static void add_match_patch(MatchPatches *patches, int site, int base, int arm) {
+  patches->patches = realloc(patches->patches, sizeof(MatchPatch) * (patches->count + 1));
+  patches->patches[patches->count++] = (MatchPatch){site, base, arm};
+}
+
+static int compare_i64(const void *a, const void *b) {
+  i64 x = *(const i64*)a, y = *(const i64*)b;
+  return x < y ? -1 : x > y;
+}
+
+// Split overlapping pieces wherever one starts or ends and give each
+// segment to the first piece that covers it, so the segments are sorted
+// and disjoint and first-match order is kept. Returns the segment count.
+static int build_segments(MatchRange *pieces, int count, MatchRange *segments) {
+  // Where segments may start: each piece's start, and just past its last
+  i64 *cuts = malloc(sizeof(i64) * count * 2);
+  int cut_count = 0;
+  for (int i = 0; i < count; i++) {
+    cuts[cut_count++] = pieces[i].start;
+    if (pieces[i].last < INT64_MAX) cuts[cut_count++] = pieces[i].last + 1;
+  }
+  qsort(cuts, cut_count, sizeof(i64), compare_i64);
+
+  int segment_count = 0;
+  for (int b = 0; b < cut_count; b++) {
+    if (b + 1 < cut_count && cuts[b] == cuts[b + 1]) continue;
+    i64 start = cuts[b];
+    i64 last = b + 1 < cut_count ? cuts[b + 1] - 1 : INT64_MAX;
+    for (int i = 0; i < count; i++) {
+      if (pieces[i].start > start || pieces[i].last < last) continue;
+      MatchRange *prev = segment_count > 0 ? &segments[segment_count - 1] : NULL;
+      if (prev && prev->last + 1 == start && prev->arm == pieces[i].arm && !prev->exact &&
+          !pieces[i].exact) {
+        prev->last = last;
+      } else {
+        segments[segment_count++] = (MatchRange){start, last, pieces[i].arm, pieces[i].exact};
+      }
+      break;
+    }
+  }
+  free(cuts);
+  return segment_count;
+}
+
+static void emit_short(Compiler *c, int value) {
+  emit_bytes(c, (value >> 8) & 0xff, value & 0xff);
+}
+
+// match subject: arms are chosen by table lookups rather than a chain of
+// comparisons. String keys (and ints too sparse for a jump table) go in
+// a map that OP_MATCH_KEYS looks the subject up in. Ints alone become an
+// OP_SWITCH jump table when dense; with ranges they become sorted
+// segments that OP_SWITCH_RANGES binary searches. Each table's default
+// falls through to the next table, and the last one's to the `_` arm.
+static void compile_match(Compiler *c, AstNode *node) {
+  AstMatch *m = &node->as.match;
+  int scope = c->local_count;
+  compile_node(c, m->subject);
+  int subject = add_local(c, "");
+  if (subject < 0) return;
+  emit_bytes(c, OP_SET_LOCAL, (u8)subject);
+
+  // Sort the patterns out, in order, stopping at the first `_`: nothing
+  // after it can match first
+  int pattern_total = 0;
+  for (int i = 0; i < m->arm_count; i++) pattern_total += m->arms[i].pattern_count;
+  MatchRange *pieces = malloc(sizeof(MatchRange) * (pattern_total + 1));
+  ObjMap *keys = NULL;  // Made on the first key, as most matches have none
+  int piece_count = 0, int_count = 0, string_count = 0, range_count = 0;
+  i64 min = 0, max = 0;
+  int default_arm = -1;
+  for (int i = 0; i < m->arm_count && default_arm < 0; i++) {
+    for (int j = 0; j < m->arms[i].pattern_count && default_arm < 0; j++) {
+      AstNode *pattern = m->arms[i].patterns[j];
+      if (pattern->type == AST_IDENTIFIER) {
+        default_arm = i;
+      } else if (pattern->type == AST_STRING_LITERAL) {
+        Value key = value_make_string(pattern->as.string_literal.value);
+        Value found;
+        if (keys == NULL) keys = map_transient(map_make());
+        if (!map_get(keys, key, &found)) map_put(keys, key, value_make_int(i));
+        string_count++;
+      } else if (pattern->type == AST_INT_LITERAL) {
+        i64 value = pattern->as.int_literal.value;
+        pieces[piece_count++] = (MatchRange){value, value, i, true};
+        min = int_count == 0 || value < min ? value : min;
+        max = int_count == 0 || value > max ? value : max;
+        int_count++;
+      } else {
+        i64 start = pattern->as.range.start->as.int_literal.value;
+        i64 end = pattern->as.range.end->as.int_literal.value;
+        if (end > start) pieces[piece_count++] = (MatchRange){start, end - 1, i, false};
+        range_count++;
+      }
+    }
+  }
+
+  // Ints with no ranges: a jump table when at least half its slots are
+  // used, else keys in the map
+  bool dense = int_count > 0 && range_count == 0 && (u64)max - (u64)min < 4096 &&
+               (max - min + 1) <= 2 * (i64)int_count;
+  if (int_count > 0 && range_count == 0 && !dense) {
+    for (int i = 0; i < piece_count; i++) {
+      Value key = value_make_int(pieces[i].start);
+      Value found;
+      if (keys == NULL) keys = map_transient(map_make());
+      if (!map_get(keys, key, &found)) map_put(keys, key, value_make_int(pieces[i].arm));
+    }
+  }
+  bool use_keys = keys != NULL;
+  bool use_ints = dense || range_count > 0;
+
+  MatchPatches patches = {NULL, 0};
+  if (use_keys) {
+    emit_bytes(c, OP_GET_LOCAL, (u8)subject);
+    emit_bytes(c, OP_MATCH_KEYS, (u8)make_constant(c, OBJ_VAL(map_freeze(keys))));
+    emit_short(c, m->arm_count);
+    int fallback = c->chunk->count;
+    emit_short(c, 0);
+    for (int i = 0; i < m->arm_count; i++) emit_short(c, 0);
+    int base = c->chunk->count;
+    // With an int table after this one, the default of 0 falls into it
+    if (!use_ints) add_match_patch(&patches, fallback, base, -1);
+    for (int i = 0; i < m->arm_count; i++) {
+      add_match_patch(&patches, fallback + 2 + 2 * i, base, i);
+    }
+  }
+
+  if (dense) {
+    int span = (int)(max - min + 1);
+    int *slots = malloc(sizeof(int) * span);
+    for (int i = 0; i < span; i++) slots[i] = -1;
+    for (int i = piece_count - 1; i >= 0; i--) slots[pieces[i].start - min] = pieces[i].arm;
+    emit_bytes(c, OP_GET_LOCAL, (u8)subject);
+    emit_bytes(c, OP_SWITCH, (u8)make_constant(c, value_make_int(min)));
+    emit_short(c, span);
+    int fallback = c->chunk->count;
+    for (int i = 0; i <= span; i++) emit_short(c, 0);
+    int base = c->chunk->count;
+    for (int i = 0; i <= span; i++) {
+      add_match_patch(&patches, fallback + 2 * i, base, i == 0 ? -1 : slots[i - 1]);
+    }
+    free(slots);
+  } else if (range_count > 0) {
+    MatchRange *segments = malloc(sizeof(MatchRange) * (piece_count * 2 + 1));
+    int segment_count = build_segments(pieces, piece_count, segments);
+    emit_bytes(c, OP_GET_LOCAL, (u8)subject);
+    emit_byte(c, OP_SWITCH_RANGES);
+    emit_short(c, segment_count);
+    int fallback = c->chunk->count;
+    emit_short(c, 0);
+    int entries = c->chunk->count;
+    for (int i = 0; i < segment_count; i++) {
+      u8 bounds[2 * sizeof(i64)];
+      memcpy(bounds, &segments[i].start, sizeof(i64));
+      memcpy(bounds + sizeof(i64), &segments[i].last, sizeof(i64));
+      for (size_t b = 0; b < sizeof(bounds); b++) emit_byte(c, bounds[b]);
+      emit_short(c, 0);
+      emit_byte(c, segments[i].exact);
+    }
+    int base = c->chunk->count;
+    add_match_patch(&patches, fallback, base, -1);
+    for (int i = 0; i < segment_count; i++) {
+      int site = entries + i * SWITCH_RANGE_SIZE + 2 * (int)sizeof(i64);
+      add_match_patch(&patches, site, base, segments[i].arm);
+    }
+    free(segments);
+  }
+  free(pieces);
+
+  // With no table, only `_` can match: jump straight to it
+  int skip = -1;
+  if (!use_keys && !use_ints) skip = emit_jump(c, OP_JUMP);
+
+  int *arm_starts = malloc(sizeof(int) * m->arm_count);
+  int *ends = malloc(sizeof(int) * m->arm_count);
+  for (int i = 0; i < m->arm_count; i++) {
+    arm_starts[i] = c->chunk->count;
+    compile_statement(c, m->arms[i].body);
+    if (i + 1 < m->arm_count) ends[i] = emit_jump(c, OP_JUMP);
+  }
+  int end = c->chunk->count;
+  for (int i = 0; i + 1 < m->arm_count; i++) patch_jump(c, ends[i]);
+  if (skip >= 0) {
+    add_match_patch(&patches, skip, skip + 2, -1);
+  }
+
+  for (int i = 0; i < patches.count; i++) {
+    MatchPatch *patch = &patches.patches[i];
+    int arm = patch->arm >= 0 ? patch->arm : default_arm;
+    int offset = (arm >= 0 ? arm_starts[arm] : end) - patch->base;
+    if (offset > 0xffff) {
+      error_report_simple("Too much code in match arms");
+      c->had_error = true;
+      break;
+    }
+    c->chunk->code[patch->site] = (offset >> 8) & 0xff;
+    c->chunk->code[patch->site + 1] = offset & 0xff;
+  }
+  free(patches.patches);
+  free(arm_starts);
+  free(ends);
+  end_scope(c, scope);
+}
+
+// A copy of a comptime value that shares nothing with the chunk it was
+// computed by: heap strings, which that chunk's constants own, are copied,
+// and so is every container that reaches one. False if the value holds
+// foreign data that may keep values of its own, which cannot be copied.
+static bool copy_comptime_value(Value value, Value *copy) {
+  *copy = value;
+  if (value.type == VALUE_STRING) {
+    *copy = value_make_string(AS_STRING(value));
+    return true;
+  }
+  if (!IS_OBJ(value)) return true;
+  switch (OBJ_TYPE(value)) {
+    case OBJ_STRING: {
+      ObjString *str = AS_OBJ_STRING(value);
+      *copy = OBJ_VAL(string_copy(str->chars, str->length));
+      return true;
+    }
+    case OBJ_ARRAY: {
+      ObjArray *array = AS_OBJ_ARRAY(value);
+      ObjArray *result = array_make(array->count);
+      for (int i = 0; i < array->count; i++) {
+        Value item;
+        if (!copy_comptime_value(array->items[i], &item)) return false;
+        array_push(result, item);
+      }
+      *copy = OBJ_VAL(result);
+      return true;
+    }
+    case OBJ_VECTOR: {
+      ObjVector *vector = AS_VECTOR(value);
+      ObjVector *result = vector_transient(vector_make());
+      for (int i = 0; i < vector->count; i++) {
+        Value item;
+        if (!copy_comptime_value(vector_get(vector, i), &item)) return false;
+        result = vector_push(result, item);
+      }
+      *copy = OBJ_VAL(vector_freeze(result));
+      return true;
+    }
+    case OBJ_MAP: {
+      ObjMap *result = map_transient(map_make());
+      u64 cursor = 0;
+      Value key, item;
+      while (map_next(AS_MAP(value), &cursor, &key, &item)) {
+        if (!copy_comptime_value(key, &key) || !copy_comptime_value(item, &item)) return false;
+        result = map_put(result, key, item);
+      }
+      *copy = OBJ_VAL(map_freeze(result));
+      return true;
+    }
+    case OBJ_FOREIGN:
+      return ((ObjForeign*)AS_OBJ(value))->kind->trace == NULL;
+    default:
+      return true;
+  }
+}
+
+// comptime expr: compile the expression into a chunk of its own, run it on
+// a fresh VM under fixed limits, and emit its value as a constant. The VM
+// sees only the modules imported so far, no locals and no natives with
+// effects, so the value cannot depend on anything that varies between
+// runs of the script. Returns the type of the value.
+static StaticType compile_comptime(Compiler *c, AstNode *node) {
+  VM vm;
+  vm_init(&vm);
+  Compiler inner;
+  inner.chunk = &vm.chunk;
+  inner.had_error = false;
+  inner.local_count = 0;
+  inner.loop = NULL;
+  inner.last_type = TYPE_UNKNOWN;
+  inner.imports = NULL;
+  inner.import_count = 0;
+  inner.comptime = true;
+  inner.assigned = NULL;
+  inner.assigned_count = 0;
+  for (int i = 0; i < c->import_count; i++) {
+    emit_bytes(&inner, OP_IMPORT, make_constant(&inner, value_make_string(c->imports[i])));
+  }
+  compile_node(&inner, node->as.comptime.expr);
+  emit_byte(&inner, OP_HALT);
+  for (int i = 0; i < inner.local_count; i++) free(inner.locals[i].name);
+  if (inner.had_error) {
+    c->had_error = true;
+    vm_free(&vm);
+    return TYPE_UNKNOWN;
+  }
+
+  vm_set_limits(&vm, SATORI_COMPTIME_MAX_INSTRUCTIONS, SATORI_COMPTIME_MAX_HEAP);
+  if (!vm_run(&vm)) {
+    error_report_simple(vm.limit_hit == VM_LIMIT_HEAP
+                            ? "comptime expression exceeded its heap quota"
+                            : "comptime expression ran too long");
+    c->had_error = true;
+    vm_free(&vm);
+    return TYPE_UNKNOWN;
+  }
+
+  // The value is left on the stack at OP_HALT. It may point into the
+  // inner chunk's constants, which go with the VM, so it is copied out,
+  // and the objects it still shares with the VM's heap are let go of.
+  Value value;
+  if (!copy_comptime_value(vm.stack[vm.stack_top - 1], &value)) {
+    error_report_simple("comptime expression produced a value that cannot be a constant");
+    c->had_error = true;
+    vm_free(&vm);
+    return TYPE_UNKNOWN;
+  }
+  gc_release(&vm.gc, &value, 1);
+  vm_free(&vm);
+  emit_bytes(c, OP_CONSTANT, make_constant(c, value));
+  return IS_INT(value) ? TYPE_INT : IS_FLOAT(value) ? TYPE_FLOAT
+         : IS_BOOL(value) ? TYPE_BOOL : TYPE_UNKNOWN;
+}
+
+// True for nodes that always produce a string
+static bool is_string_node(AstNode *node) {
+  return node->type == AST_STRING_LITERAL || node->type == AST_INTERPOLATION;
+}
+
+// Parts of a string being built: expressions, with adjacent literal text
+// merged at compile time
+typedef struct {
+  AstNode **nodes;
+  int count;
+  int capacity;
+} StringParts;
+
+static bool add_string_chain(StringParts *parts, AstNode *node);
+
+static void add_part(StringParts *parts, AstNode *node) {
+  if (node->type == AST_INTERPOLATION) {
+    for (int i = 0; i < node->as.interpolation.part_count; i++) {
+      add_part(parts, node->as.interpolation.parts[i]);
+    }
+    return;
+  }
+  if (node->type == AST_BINARY_OP && node->as.binary_op.op == BIN_ADD &&
+      add_string_chain(parts, node)) {
+    return;
+  }
+  if (parts->count >= parts->capacity) {
+    parts->capacity = parts->capacity < 8 ? 8 : parts->capacity * 2;
+    parts->nodes = realloc(parts->nodes, sizeof(AstNode *) * parts->capacity);
+  }
+  parts->nodes[parts->count++] = node;
+}
+
+// Add the operands of `a + b + ...` once one is known to be a string.
+// Returns false, adding nothing, if the chain has no string operand.
+static bool add_string_chain(StringParts *parts, AstNode *node) {
+  // Operands along the left spine, first operand last
+  int depth = 0;
+  for (AstNode *n = node; n->type == AST_BINARY_OP && n->as.binary_op.op == BIN_ADD;
+       n = n->as.binary_op.left) {
+    depth++;
+  }
+  AstNode **operands = malloc(sizeof(AstNode *) * (depth + 1));
+  AstNode *n = node;
+  for (int i = depth; i > 0; i--) {
+    operands[i] = n->as.binary_op.right;
+    n = n->as.binary_op.left;
+  }
+  operands[0] = n;
+
+  int first = 0;
+  while (first <= depth && !is_string_node(operands[first])) first++;
+  if (first > depth) {
+    free(operands);
+    return false;
+  }
+
+  // Additions before the first string keep their own meaning: in
+  // `1 + 2 + "x"` the numbers are summed first
+  int start = 0;
+  if (first >= 2) {
+    n = node;
+    for (int i = depth; i > first - 1; i--) n = n->as.binary_op.left;
+    add_part(parts, n);
+    start = first;
+  }
+  for (int i = start; i <= depth; i++) add_part(parts, operands[i]);
+  free(operands);
+  return true;
+}
+
+// Push each part and join them with OP_BUILD_STRING, which sizes the result
+// once instead of copying it at every `+`
+static void compile_string_parts(Compiler *c, StringParts *parts) {
+  int pending = 0;  // Values on the stack waiting to be joined
+  for (int i = 0; i < parts->count; i++) {
+    AstNode *part = parts->nodes[i];
+    if (part->type == AST_STRING_LITERAL) {
+      size_t length = 0;
+      int end = i;
+      for (; end < parts->count && parts->nodes[end]->type == AST_STRING_LITERAL; end++) {
+        length += strlen(parts->nodes[end]->as.string_literal.value);
+      }
+      if (length > 0) {
+        char *text = malloc(length + 1);
+        text[0] = '\0';
+        for (int j = i; j < end; j++) {
+          strcat(text, parts->nodes[j]->as.string_literal.value);
+        }
+        emit_bytes(c, OP_CONSTANT, make_constant(c, value_make_string(text)));
+        free(text);
+        pending++;
+      }
+      i = end - 1;
+    } else {
+      compile_node(c, part);
+      pending++;
+    }
+    if (pending == SATORI_BUILD_STRING_MAX) {
+      emit_bytes(c, OP_BUILD_STRING, pending);
+      pending = 1;
+    }
+  }
+
+  if (pending == 0) {
+    emit_bytes(c, OP_CONSTANT, make_constant(c, value_make_string("")));
+  }
+  // Even a lone part goes through OP_BUILD_STRING, which makes it a string
+  emit_bytes(c, OP_BUILD_STRING, pending == 0 ? 1 : pending);
+}
+
 static void compile_node(Compiler *c, AstNode *node) {
   if (!node)
     return;
 
+  StaticType type = TYPE_UNKNOWN;
   switch (node->type) {
   case AST_PROGRAM: {
     for (int i = 0; i < node->as.program.statement_count; i++) {
-      compile_node(c, node->as.program.statements[i]);
+      compile_statement(c, node->as.program.statements[i]);
     }
     break;
   }
@@ -154,6 +1032,8 @@ static void compile_node(Compiler *c, AstNode *node) {
     int constant =
         make_constant(c, value_make_string(node->as.import.module_name));
     emit_bytes(c, OP_IMPORT, constant);
+    c->imports = realloc(c->imports, sizeof(char*) * (c->import_count + 1));
+    c->imports[c->import_count++] = strdup(node->as.import.module_name);
     break;
   }
 
@@ -163,8 +1043,10 @@ static void compile_node(Compiler *c, AstNode *node) {
     compile_node(c, node->as.let.value);
     
     // Add local variable and emit OP_SET_LOCAL
+    StaticType value_type = c->last_type;
     int slot = add_local(c, node->as.let.name);
     if (slot >= 0) {
+      type_local(c, slot, value_type);
       emit_bytes(c, OP_SET_LOCAL, slot);
     }
     break;
@@ -189,6 +1071,7 @@ static void compile_node(Compiler *c, AstNode *node) {
     if (slot >= 0) {
       // It's a local variable
       emit_bytes(c, OP_GET_LOCAL, slot);
+      type = c->locals[slot].type;
     } else {
       // Not found - this is an error for now
       error_report_simple("Undefined variable");
@@ -198,24 +1081,27 @@ static void compile_node(Compiler *c, AstNode *node) {
   }
   
   case AST_BINARY_OP: {
+    // `+` with a string operand joins the whole chain in one build
+    if (node->as.binary_op.op == BIN_ADD) {
+      StringParts parts = {NULL, 0, 0};
+      if (add_string_chain(&parts, node)) {
+        compile_string_parts(c, &parts);
+        free(parts.nodes);
+        break;
+      }
+    }
+
     // Compile left and right operands
+    BinaryOperator op = node->as.binary_op.op;
     compile_node(c, node->as.binary_op.left);
+    StaticType left = c->last_type;
     compile_node(c, node->as.binary_op.right);
+    StaticType right = c->last_type;
     
-    // Emit the operation
-    switch (node->as.binary_op.op) {
-      case BIN_ADD: emit_byte(c, OP_ADD); break;
-      case BIN_SUB: emit_byte(c, OP_SUBTRACT); break;
-      case BIN_MUL: emit_byte(c, OP_MULTIPLY); break;
-      case BIN_DIV: emit_byte(c, OP_DIVIDE); break;
-      case BIN_MOD: emit_byte(c, OP_MODULO); break;
-      case BIN_EQ:  emit_byte(c, OP_EQUAL); break;
-      case BIN_NEQ: emit_byte(c, OP_NOT_EQUAL); break;
-      case BIN_LT:  emit_byte(c, OP_LESS); break;
-      case BIN_LTE: emit_byte(c, OP_LESS_EQUAL); break;
-      case BIN_GT:  emit_byte(c, OP_GREATER); break;
-      case BIN_GTE: emit_byte(c, OP_GREATER_EQUAL); break;
-    }
+    // Emit the operation, specialized when both operand types are known
+    // and the same
+    emit_byte(c, binary_opcode(op, left == right ? left : TYPE_UNKNOWN));
+    type = binary_type(op, left, right);
     break;
   }
   
@@ -225,8 +1111,14 @@ static void compile_node(Compiler *c, AstNode *node) {
     
     // Emit the operation
     switch (node->as.unary_op.op) {
-      case UNARY_NEG: emit_byte(c, OP_NEGATE); break;
-      case UNARY_NOT: emit_byte(c, OP_NOT); break;
+      case UNARY_NEG:
+        emit_byte(c, OP_NEGATE);
+        if (c->last_type == TYPE_INT || c->last_type == TYPE_FLOAT) type = c->last_type;
+        break;
+      case UNARY_NOT:
+        emit_byte(c, OP_NOT);
+        type = TYPE_BOOL;
+        break;
     }
     break;
   }
@@ -240,7 +1132,7 @@ static void compile_node(Compiler *c, AstNode *node) {
     emit_byte(c, OP_POP);  // Pop condition
     
     // Compile then branch
-    compile_node(c, node->as.if_stmt.then_branch);
+    compile_statement(c, node->as.if_stmt.then_branch);
     
     // Jump over else branch
     int end_jump = emit_jump(c, OP_JUMP);
@@ -251,7 +1143,7 @@ static void compile_node(Compiler *c, AstNode *node) {
     
     // Compile else branch if it exists
     if (node->as.if_stmt.else_branch) {
-      compile_node(c, node->as.if_stmt.else_branch);
+      compile_statement(c, node->as.if_stmt.else_branch);
     }
     
     // Patch end jump
@@ -261,6 +1153,8 @@ static void compile_node(Compiler *c, AstNode *node) {
   
   case AST_WHILE: {
     int loop_start = c->chunk->count;
+    Loop loop;
+    begin_loop(c, &loop, loop_start);
     
     // Compile condition
     compile_node(c, node->as.while_loop.condition);
@@ -270,7 +1164,7 @@ static void compile_node(Compiler *c, AstNode *node) {
     emit_byte(c, OP_POP);  // Pop condition
     
     // Compile body
-    compile_node(c, node->as.while_loop.body);
+    compile_statement(c, node->as.while_loop.body);
     
     // Loop back to start
     emit_loop(c, loop_start);
@@ -278,35 +1172,105 @@ static void compile_node(Compiler *c, AstNode *node) {
     // Patch exit jump
     patch_jump(c, exit_jump);
     emit_byte(c, OP_POP);  // Pop condition
+    end_loop(c, &loop);
+    break;
+  }
+
+  case AST_FOR: {
+    // Iterable (or range bounds), then OP_FOR_PREP and the loop head:
+    //   head state_slot first_var_slot var_count exit_offset
+    AstFor *for_loop = &node->as.for_loop;
+    bool is_range = for_loop->iterable->type == AST_RANGE;
+    if (is_range && for_loop->index_name) {
+      error_report_simple("A range loop takes one variable");
+      c->had_error = true;
+      break;
+    }
+    compile_source(c, for_loop->iterable);
+    emit_byte(c, OP_FOR_PREP);
+
+    // Hidden state slots (their empty names never resolve), then the
+    // loop variables, all scoped to the loop
+    int scope = c->local_count;
+    int state = add_local(c, "");
+    add_local(c, "");
+    int var = for_loop->index_name ? add_local(c, for_loop->index_name) : -1;
+    int item = add_local(c, for_loop->item_name);
+    if (item < 0) break;
+    if (is_range) type_local(c, item, TYPE_INT);
+    int var_count = for_loop->index_name ? 2 : 1;
+
+    int loop_start = c->chunk->count;
+    Loop loop;
+    begin_loop(c, &loop, loop_start);
+    // A placeholder for collections; OP_FOR_PREP puts in the right head
+    emit_byte(c, is_range ? OP_FOR_RANGE : OP_FOR_ARRAY);
+    emit_bytes(c, (u8)state, (u8)(var_count == 2 ? var : item));
+    emit_byte(c, (u8)var_count);
+    int exit_jump = c->chunk->count;
+    emit_bytes(c, 0xff, 0xff);
+
+    compile_statement(c, for_loop->body);
+    emit_loop(c, loop_start);
+    patch_jump(c, exit_jump);
+    end_loop(c, &loop);
+    end_scope(c, scope);
     break;
   }
   
+  case AST_RANGE:
+    error_report_simple("A range can only be used in a for loop or pipeline");
+    c->had_error = true;
+    break;
+
+  case AST_PIPELINE:
+    type = compile_pipeline(c, node);
+    break;
+
+  case AST_MATCH:
+    compile_match(c, node);
+    break;
+
+  case AST_COMPTIME:
+    type = compile_comptime(c, node);
+    break;
+
   case AST_LOOP: {
     int loop_start = c->chunk->count;
+    Loop loop;
+    begin_loop(c, &loop, loop_start);
     
     // Compile body
-    compile_node(c, node->as.loop.body);
+    compile_statement(c, node->as.loop.body);
     
     // Loop back to start
     emit_loop(c, loop_start);
+    end_loop(c, &loop);
     break;
   }
   
   case AST_BREAK:
-    // For now, break is not implemented (needs loop context tracking)
-    error_report_simple("break not yet implemented");
-    c->had_error = true;
+    if (!c->loop) {
+      error_report_simple("break outside a loop");
+      c->had_error = true;
+      break;
+    }
+    c->loop->breaks = realloc(c->loop->breaks, sizeof(int) * (c->loop->break_count + 1));
+    c->loop->breaks[c->loop->break_count++] = emit_jump(c, OP_JUMP);
     break;
   
   case AST_CONTINUE:
-    // For now, continue is not implemented (needs loop context tracking)
-    error_report_simple("continue not yet implemented");
-    c->had_error = true;
+    if (!c->loop) {
+      error_report_simple("continue outside a loop");
+      c->had_error = true;
+      break;
+    }
+    emit_loop(c, c->loop->start);
     break;
   
   case AST_BLOCK: {
     for (int i = 0; i < node->as.block.statement_count; i++) {
-      compile_node(c, node->as.block.statements[i]);
+      compile_statement(c, node->as.block.statements[i]);
     }
     break;
   }
@@ -325,15 +1289,23 @@ static void compile_node(Compiler *c, AstNode *node) {
   }
 
   case AST_STRING_LITERAL: {
-    int constant =
-        make_constant(c, value_make_string(node->as.string_literal.value));
+    int constant = make_constant(c, literal_value(node->as.string_literal.value));
     emit_bytes(c, OP_CONSTANT, constant);
     break;
   }
 
+  case AST_INTERPOLATION: {
+    StringParts parts = {NULL, 0, 0};
+    add_part(&parts, node);
+    compile_string_parts(c, &parts);
+    free(parts.nodes);
+    break;
+  }
+
   case AST_INT_LITERAL: {
     int constant = make_constant(c, value_make_int(node->as.int_literal.value));
     emit_bytes(c, OP_CONSTANT, constant);
+    type = TYPE_INT;
     break;
   }
 
@@ -341,6 +1313,7 @@ static void compile_node(Compiler *c, AstNode *node) {
     int constant =
         make_constant(c, value_make_float(node->as.float_literal.value));
     emit_bytes(c, OP_CONSTANT, constant);
+    type = TYPE_FLOAT;
     break;
   }
 
@@ -349,6 +1322,7 @@ static void compile_node(Compiler *c, AstNode *node) {
     c->had_error = true;
     break;
   }
+  c->last_type = type;
 }
 
 bool codegen_compile(AstNode *ast, Chunk *chunk) {
@@ -356,7 +1330,15 @@ bool codegen_compile(AstNode *ast, Chunk *chunk) {
   compiler.chunk = chunk;
   compiler.had_error = false;
   compiler.local_count = 0;
+  compiler.loop = NULL;
+  compiler.imports = NULL;
+  compiler.import_count = 0;
+  compiler.comptime = false;
+  compiler.assigned = NULL;
+  compiler.assigned_count = 0;
+  compiler.last_type = TYPE_UNKNOWN;
 
+  find_assigned(&compiler, ast);
   compile_node(&compiler, ast);
   emit_byte(&compiler, OP_HALT);
   
@@ -364,6 +1346,11 @@ bool codegen_compile(AstNode *ast, Chunk *chunk) {
   for (int i = 0; i < compiler.local_count; i++) {
     free(compiler.locals[i].name);
   }
+  for (int i = 0; i < compiler.import_count; i++) {
+    free(compiler.imports[i]);
+  }
+  free(compiler.imports);
+  free(compiler.assigned);
 
   return !compiler.had_error;
 }
@@ -21,6 +21,17 @@
 #define SATORI_MAX_PARAMS 32
 #define SATORI_MAX_UPVALUES 256
 
+// When a VM collects: once its heap has doubled, but not below this many
+// bytes. Marking takes one more thread per SATORI_GC_MARKER_OBJECTS
+// tracked objects, up to SATORI_GC_MAX_MARKERS in all.
+#define SATORI_GC_MIN_HEAP (1024 * 1024)
+#define SATORI_GC_MARKER_OBJECTS (256 * 1024)
+#define SATORI_GC_MAX_MARKERS 4
+
+// What one comptime expression may spend while the compiler runs it
+#define SATORI_COMPTIME_MAX_INSTRUCTIONS 100000000
+#define SATORI_COMPTIME_MAX_HEAP (256 * 1024 * 1024)
+
 // Debug flags
 #ifdef DEBUG
 #define SATORI_DEBUG_PRINT_CODE
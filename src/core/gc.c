@@ -0,0 +1,402 @@
+// src/core/gc.c - Mark-sweep collection implementation
+//
+// Marking: each worker pops objects off a private stack and pushes the
+// children it marks back onto it. When the private stack holds more than
+// GC_SHARE_MIN objects and the worker's shared stack is empty, the oldest
+// half moves to the shared stack, where other workers can take it. A
+// worker out of work takes back its own shared stack, then steals half of
+// the first non-empty shared stack it finds. Setting a mark is an atomic
+// exchange, so each object is traced by exactly one worker.
+//
+// A worker that finds nothing goes idle. Only a worker's owner fills its
+// shared stack, and only while busy, so once every worker is idle no work
+// is left anywhere and marking is done.
+//
+// Sweeping: gc_mark closes the page being filled and snapshots every
+// page. Objects made afterwards go to other pages, so a page still waiting
+// to be swept holds only objects that were there when marking ran. A
+// sweeper claims the next page with an atomic increment, frees the
+// unmarked objects, clears the survivors' marks and packs them down.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "gc.h"
+#include "hamt.h"
+#include "memory.h"
+#include "vector.h"
+#include <sched.h>
+#include <string.h>
+
+#define GC_SHARE_MIN 64
+
+#ifdef __GNUC__
+static __thread GcHeap *attached = NULL;
+#else
+static GcHeap *attached = NULL;
+#endif
+
+// ============================================================================
+// Tracking
+// ============================================================================
+
+void gc_init(GcHeap *heap) {
+  memset(heap, 0, sizeof(GcHeap));
+  pthread_mutex_init(&heap->lock, NULL);
+}
+
+GcHeap *gc_attach(GcHeap *heap) {
+  GcHeap *old = attached;
+  attached = heap;
+  return old;
+}
+
+// A page with room: a swept spare if there is one, else a new page. Each
+// new page first sweeps one left by the last collection. The page is the
+// collector's own, so a quota escape may not leave the lock held.
+static GcPage *next_page(GcHeap *heap) {
+  gc_sweep(heap, 1);
+  jmp_buf *escape = mem_defer_limit();
+  pthread_mutex_lock(&heap->lock);
+  GcPage *page = heap->spare;
+  if (page != NULL) {
+    heap->spare = page->spare;
+  } else {
+    page = (GcPage*)mem_alloc(sizeof(GcPage));
+    page->count = 0;
+    page->next = heap->pages;
+    heap->pages = page;
+  }
+  pthread_mutex_unlock(&heap->lock);
+  mem_resume_limit(escape);
+  page->spare = NULL;
+  heap->current = page;
+  return page;
+}
+
+void gc_track(Object *obj) {
+  GcHeap *heap = attached;
+  obj->is_tracked = heap != NULL;
+  if (heap == NULL) return;
+
+  GcPage *page = heap->current;
+  if (page == NULL || page->count == GC_PAGE_SLOTS) page = next_page(heap);
+  page->objects[page->count++] = obj;
+  __atomic_add_fetch(&heap->count, 1, __ATOMIC_RELAXED);
+}
+
+// ============================================================================
+// Marking
+// ============================================================================
+
+typedef struct {
+  Object **items;
+  int count;
+  int capacity;
+} MarkStack;
+
+typedef struct Marker Marker;
+
+typedef struct {
+  Marker *marker;
+  int id;
+  pthread_t thread;
+  MarkStack local;
+  MarkStack shared;        // Guarded by lock; count read without it
+  pthread_mutex_t lock;
+  MarkStack untracked;     // Marked objects no page will unmark
+  size_t marked;
+} MarkWorker;
+
+struct Marker {
+  MarkWorker *workers;
+  int count;
+  int idle;
+};
+
+static void stack_push(MarkStack *stack, Object *obj) {
+  if (stack->count == stack->capacity) {
+    int capacity = GROW_CAPACITY(stack->capacity);
+    stack->items = GROW_ARRAY(Object*, stack->items, stack->capacity, capacity);
+    stack->capacity = capacity;
+  }
+  stack->items[stack->count++] = obj;
+}
+
+// Move `count` objects from the bottom of `from` to the top of `to`. Counts
+// are stored atomically, as shared stacks' counts are read without the lock.
+static void stack_move(MarkStack *from, MarkStack *to, int count) {
+  if (to->count + count > to->capacity) {
+    int capacity = GROW_CAPACITY(to->count + count);
+    to->items = GROW_ARRAY(Object*, to->items, to->capacity, capacity);
+    to->capacity = capacity;
+  }
+  memcpy(to->items + to->count, from->items, sizeof(Object*) * count);
+  memmove(from->items, from->items + count, sizeof(Object*) * (from->count - count));
+  __atomic_store_n(&to->count, to->count + count, __ATOMIC_RELAXED);
+  __atomic_store_n(&from->count, from->count - count, __ATOMIC_RELAXED);
+}
+
+static void mark_object(MarkWorker *worker, Object *obj) {
+  if (__atomic_load_n(&obj->is_marked, __ATOMIC_RELAXED)) return;
+  if (__atomic_exchange_n(&obj->is_marked, true, __ATOMIC_RELAXED)) return;
+  worker->marked++;
+  if (!obj->is_tracked) stack_push(&worker->untracked, obj);
+  if (obj->type == OBJ_PACKED) return;
+  if (obj->type == OBJ_STRING && ((ObjString*)obj)->base == NULL) return;
+  stack_push(&worker->local, obj);
+}
+
+static void mark_value(Value value, void *context) {
+  if (IS_OBJ(value)) mark_object((MarkWorker*)context, AS_OBJ(value));
+}
+
+static void mark_node(Object *node, void *context) {
+  mark_object((MarkWorker*)context, node);
+}
+
+static void trace_object(MarkWorker *worker, Object *obj) {
+  switch (obj->type) {
+    case OBJ_STRING:
+      mark_object(worker, &((ObjString*)obj)->base->obj);
+      break;
+    case OBJ_ARRAY: {
+      ObjArray *array = (ObjArray*)obj;
+      for (int i = 0; i < array->count; i++) mark_value(array->items[i], worker);
+      break;
+    }
+    case OBJ_MAP: {
+      ObjMap *map = (ObjMap*)obj;
+      if (map->root != NULL) mark_object(worker, (Object*)map->root);
+      break;
+    }
+    case OBJ_MAP_NODE:
+      map_node_trace((MapNode*)obj, mark_value, mark_node, worker);
+      break;
+    case OBJ_VECTOR: {
+      ObjVector *vector = (ObjVector*)obj;
+      mark_object(worker, &vector->root->obj);
+      mark_object(worker, &vector->tail->obj);
+      break;
+    }
+    case OBJ_VEC_BRANCH: {
+      VecNode *node = (VecNode*)obj;
+      for (int i = 0; i < VEC_WIDTH; i++) {
+        if (node->as.children[i] != NULL) mark_object(worker, &node->as.children[i]->obj);
+      }
+      break;
+    }
+    case OBJ_VEC_LEAF: {
+      VecNode *node = (VecNode*)obj;
+      for (int i = 0; i < VEC_WIDTH; i++) mark_value(node->as.items[i], worker);
+      break;
+    }
+    case OBJ_FOREIGN: {
+      ObjForeign *foreign = (ObjForeign*)obj;
+      if (foreign->kind->trace != NULL) foreign->kind->trace(foreign->data, mark_value, worker);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+// Offer the oldest half of a long private stack once the last offer is gone
+static void share(MarkWorker *worker) {
+  if (worker->local.count <= GC_SHARE_MIN) return;
+  if (__atomic_load_n(&worker->shared.count, __ATOMIC_RELAXED) != 0) return;
+  pthread_mutex_lock(&worker->lock);
+  stack_move(&worker->local, &worker->shared, worker->local.count / 2);
+  pthread_mutex_unlock(&worker->lock);
+}
+
+// Take `victim`'s shared work: all of it from our own, half from others
+static bool take(MarkWorker *worker, MarkWorker *victim) {
+  if (__atomic_load_n(&victim->shared.count, __ATOMIC_RELAXED) == 0) return false;
+  pthread_mutex_lock(&victim->lock);
+  int count = victim->shared.count;
+  if (victim != worker) count -= count / 2;
+  stack_move(&victim->shared, &worker->local, count);
+  pthread_mutex_unlock(&victim->lock);
+  return count > 0;
+}
+
+static bool find_work(MarkWorker *worker) {
+  Marker *marker = worker->marker;
+  for (int i = 0; i < marker->count; i++) {
+    if (take(worker, &marker->workers[(worker->id + i) % marker->count])) return true;
+  }
+  return false;
+}
+
+static bool work_left(Marker *marker) {
+  for (int i = 0; i < marker->count; i++) {
+    if (__atomic_load_n(&marker->workers[i].shared.count, __ATOMIC_RELAXED) != 0) return true;
+  }
+  return false;
+}
+
+static void *mark_worker(void *arg) {
+  MarkWorker *worker = (MarkWorker*)arg;
+  Marker *marker = worker->marker;
+  for (;;) {
+    while (worker->local.count > 0) {
+      trace_object(worker, worker->local.items[--worker->local.count]);
+      share(worker);
+    }
+    if (find_work(worker)) continue;
+
+    __atomic_add_fetch(&marker->idle, 1, __ATOMIC_ACQ_REL);
+    for (;;) {
+      if (__atomic_load_n(&marker->idle, __ATOMIC_ACQUIRE) == marker->count) return NULL;
+      if (work_left(marker)) break;
+      sched_yield();
+    }
+    __atomic_sub_fetch(&marker->idle, 1, __ATOMIC_ACQ_REL);
+  }
+}
+
+// ============================================================================
+// Sweeping
+// ============================================================================
+
+static size_t sweep_page(GcHeap *heap, GcPage *page) {
+  int kept = 0;
+  for (int i = 0; i < page->count; i++) {
+    Object *obj = page->objects[i];
+    if (obj->is_marked) {
+      obj->is_marked = false;
+      page->objects[kept++] = obj;
+    } else {
+      object_free(obj);
+    }
+  }
+  size_t freed = (size_t)(page->count - kept);
+  page->count = kept;
+  __atomic_sub_fetch(&heap->count, freed, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&heap->freed, freed, __ATOMIC_RELAXED);
+
+  if (kept <= GC_PAGE_SLOTS / 2) {
+    pthread_mutex_lock(&heap->lock);
+    page->spare = heap->spare;
+    heap->spare = page;
+    pthread_mutex_unlock(&heap->lock);
+  }
+  return freed;
+}
+
+size_t gc_sweep(GcHeap *heap, int pages) {
+  size_t freed = 0;
+  for (int n = 0; pages < 0 || n < pages; n++) {
+    if (__atomic_load_n(&heap->sweep_next, __ATOMIC_RELAXED) >= heap->sweep_count) break;
+    int index = __atomic_fetch_add(&heap->sweep_next, 1, __ATOMIC_RELAXED);
+    if (index >= heap->sweep_count) break;
+    freed += sweep_page(heap, heap->sweep[index]);
+    __atomic_add_fetch(&heap->swept, 1, __ATOMIC_RELEASE);
+  }
+  return freed;
+}
+
+// Sweep what is left, then wait for other sweepers to finish their pages
+static void finish_sweep(GcHeap *heap) {
+  gc_sweep(heap, -1);
+  while (__atomic_load_n(&heap->swept, __ATOMIC_ACQUIRE) < heap->sweep_count) sched_yield();
+}
+
+size_t gc_mark(GcHeap *heap, const Value *roots, int root_count, int threads) {
+  finish_sweep(heap);
+  if (threads < 1) threads = 1;
+  // Mark stacks are freed before returning and the marks must all be
+  // cleared, so no allocation here may escape to the quota
+  jmp_buf *escape = mem_defer_limit();
+
+  Marker marker = {mem_alloc(sizeof(MarkWorker) * threads), threads, 0};
+  memset(marker.workers, 0, sizeof(MarkWorker) * threads);
+  for (int i = 0; i < threads; i++) {
+    marker.workers[i].marker = &marker;
+    marker.workers[i].id = i;
+    pthread_mutex_init(&marker.workers[i].lock, NULL);
+  }
+  // Roots are dealt out round robin; whoever runs out first steals
+  for (int i = 0; i < root_count; i++) {
+    MarkWorker *worker = &marker.workers[i % threads];
+    mark_value(roots[i], worker);
+    if (worker->local.count > 0) stack_move(&worker->local, &worker->shared, worker->local.count);
+  }
+
+  for (int i = 1; i < threads; i++) {
+    if (pthread_create(&marker.workers[i].thread, NULL, mark_worker, &marker.workers[i]) != 0) {
+      // Fewer threads only means less help; the rest still gets marked
+      marker.workers[i].thread = pthread_self();
+      __atomic_add_fetch(&marker.idle, 1, __ATOMIC_ACQ_REL);
+    }
+  }
+  mark_worker(&marker.workers[0]);
+
+  size_t marked = 0;
+  for (int i = 0; i < threads; i++) {
+    MarkWorker *worker = &marker.workers[i];
+    if (i > 0 && !pthread_equal(worker->thread, pthread_self())) pthread_join(worker->thread, NULL);
+    marked += worker->marked;
+    // Nothing sweeps an untracked object, so its mark goes now
+    for (int j = 0; j < worker->untracked.count; j++) worker->untracked.items[j]->is_marked = false;
+    FREE_ARRAY(Object*, worker->local.items, worker->local.capacity);
+    FREE_ARRAY(Object*, worker->shared.items, worker->shared.capacity);
+    FREE_ARRAY(Object*, worker->untracked.items, worker->untracked.capacity);
+    pthread_mutex_destroy(&worker->lock);
+  }
+  mem_free(marker.workers);
+
+  // Snapshot the pages to sweep; new objects start a new page
+  int count = 0;
+  for (GcPage *page = heap->pages; page != NULL; page = page->next) count++;
+  heap->sweep = GROW_ARRAY(GcPage*, heap->sweep, heap->sweep_count, count);
+  count = 0;
+  for (GcPage *page = heap->pages; page != NULL; page = page->next) heap->sweep[count++] = page;
+  heap->current = NULL;
+  heap->spare = NULL;
+  heap->sweep_next = 0;
+  heap->swept = 0;
+  heap->sweep_count = count;
+  mem_resume_limit(escape);
+  return marked;
+}
+
+// Free the pages and every unmarked object on them; marked objects are
+// let go untracked. Leaves the heap empty but still usable.
+static void release_pages(GcHeap *heap) {
+  GcPage *page = heap->pages;
+  while (page != NULL) {
+    GcPage *next = page->next;
+    for (int i = 0; i < page->count; i++) {
+      Object *obj = page->objects[i];
+      if (obj->is_marked) {
+        obj->is_marked = false;
+        obj->is_tracked = false;
+      } else {
+        object_free(obj);
+      }
+    }
+    mem_free(page);
+    page = next;
+  }
+  mem_free(heap->sweep);
+  heap->pages = heap->current = heap->spare = NULL;
+  heap->sweep = NULL;
+  heap->sweep_count = heap->sweep_next = heap->swept = 0;
+  heap->count = 0;
+}
+
+void gc_free(GcHeap *heap) {
+  finish_sweep(heap);
+  release_pages(heap);
+  pthread_mutex_destroy(&heap->lock);
+  if (attached == heap) attached = NULL;
+  memset(heap, 0, sizeof(GcHeap));
+}
+
+void gc_release(GcHeap *heap, const Value *roots, int root_count) {
+  // Marking snapshots every page for sweeping; none is swept before the
+  // pages are released, so the marks are all still set
+  gc_mark(heap, roots, root_count, 1);
+  release_pages(heap);
+}
@@ -0,0 +1,77 @@
+// src/core/gc.h - Mark-sweep collection of tracked objects
+//
+// A GcHeap records every object made on a thread while the heap is
+// attached to it, in pages of GC_PAGE_SLOTS. Each VM owns one, attached
+// while vm_run runs, and collects it at safepoints. Objects made with no
+// heap attached (constants, comptime values) are untracked: collection
+// traces through them but never frees them.
+//
+// Marking stops the owner thread and runs on `threads` workers, each with
+// its own mark stack; idle workers steal half of a busy one's shared
+// work. Sweeping is lazy: gc_mark only snapshots the pages, and each page
+// is swept on its own later, one whenever the owner fills a page, or in
+// bulk by gc_sweep, which any number of threads may run at once.
+
+#ifndef SATORI_GC_H
+#define SATORI_GC_H
+
+#include "common.h"
+#include "object.h"
+#include <pthread.h>
+#include <stddef.h>
+
+#define GC_PAGE_SLOTS 1024
+
+typedef struct GcPage {
+  struct GcPage *next;   // Every page of the heap
+  struct GcPage *spare;  // Next page with room, once swept
+  int count;
+  Object *objects[GC_PAGE_SLOTS];
+} GcPage;
+
+typedef struct {
+  GcPage *pages;
+  GcPage *current;   // Page being filled by the owner, NULL for a fresh one
+  GcPage *spare;     // Swept pages at most half full, to be filled again
+  pthread_mutex_t lock;  // Guards pages and spare
+
+  // Pages the last gc_mark left to sweep; sweepers claim them by index
+  GcPage **sweep;
+  int sweep_count;
+  int sweep_next;
+  int swept;
+
+  size_t count;   // Objects tracked
+  size_t freed;   // Objects swept since gc_init
+} GcHeap;
+
+void gc_init(GcHeap *heap);
+
+// Free every object the heap still tracks, reachable or not, and the heap
+void gc_free(GcHeap *heap);
+
+// Free every object the heap tracks except those reachable from `roots`,
+// which become untracked and the caller's to keep. The heap is left empty
+// and may be used again.
+void gc_release(GcHeap *heap, const Value *roots, int root_count);
+
+// Attach `heap` to the current thread (NULL detaches). Returns the heap it
+// replaces.
+GcHeap *gc_attach(GcHeap *heap);
+
+// Called by every object constructor: records `obj` in the attached heap
+// and sets obj->is_tracked accordingly.
+void gc_track(Object *obj);
+
+// Mark everything reachable from `roots` on `threads` workers, after
+// finishing any sweep left from the last collection. Untracked objects are
+// traced through but never freed. Returns the number of objects marked.
+// The heap's objects must not change while it runs.
+size_t gc_mark(GcHeap *heap, const Value *roots, int root_count, int threads);
+
+// Sweep up to `pages` pages left by gc_mark (all of them if negative),
+// freeing the unmarked objects. Returns the number freed. Safe on several
+// threads at once; frees are credited to each thread's own MemMeter.
+size_t gc_sweep(GcHeap *heap, int pages);
+
+#endif // SATORI_GC_H
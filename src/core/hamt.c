@@ -0,0 +1,558 @@
+// src/core/hamt.c - Persistent hash map implementation
+//
+// Nodes use the compact CHAMP layout: one bitmap marks the 5-bit hash
+// fragments that hold a key/value pair inline, another those that hold a
+// child node, and a single block stores the pairs followed by the child
+// pointers, each in fragment order. A slot's position is the popcount of
+// the bitmap below its bit.
+//
+// Nodes are kept canonical: below the root no node is left holding just
+// one pair, since removal pulls a lone pair up into its parent. Once all
+// 32 hash bits are used up, keys that still collide share a collision
+// node, a plain list of pairs.
+//
+// Persistent updates run with edit 0 and copy every node on the path.
+// Transients run with their own edit token: a node they already own is
+// changed in place, and one they outgrow is freed, since nothing else can
+// point at it, unless a heap tracks it. Nodes are objects of their own,
+// which the collector frees once no version reaches them.
+
+#include "hamt.h"
+#include "gc.h"
+#include "hash.h"
+#include "memory.h"
+#include <stddef.h>
+#include <string.h>
+
+#define HAMT_MASK ((1u << HAMT_BITS) - 1)
+
+struct MapNode {
+  Object obj;      // OBJ_MAP_NODE: shared by versions, freed by the collector
+  u64 edit;
+  u32 datamap;     // Fragments holding a pair
+  u32 nodemap;     // Fragments holding a child
+  int collisions;  // Pairs in a collision node, 0 in bitmap nodes
+  u32 hash;        // Hash shared by a collision node's keys
+  Value pairs[];   // Key/value pairs, then child pointers
+};
+
+static int popcount(u32 x) {
+  return __builtin_popcount(x);
+}
+
+static int pair_count(const MapNode *node) {
+  return node->collisions > 0 ? node->collisions : popcount(node->datamap);
+}
+
+static MapNode **node_children(MapNode *node) {
+  return (MapNode**)(node->pairs + 2 * pair_count(node));
+}
+
+static u32 bit_for(u32 hash, int shift) {
+  return 1u << ((hash >> shift) & HAMT_MASK);
+}
+
+static int index_of(u32 bitmap, u32 bit) {
+  return popcount(bitmap & (bit - 1));
+}
+
+static size_t node_size(int pairs, int children) {
+  return sizeof(MapNode) + sizeof(Value) * 2 * (size_t)pairs + sizeof(MapNode*) * (size_t)children;
+}
+
+static MapNode *node_alloc(size_t size) {
+  MapNode *node = mem_alloc(size);
+  node->obj.type = OBJ_MAP_NODE;
+  node->obj.is_marked = false;
+  node->obj.next = NULL;
+  gc_track(&node->obj);
+  return node;
+}
+
+static MapNode *node_new(u64 edit, int pairs, int children) {
+  MapNode *node = node_alloc(node_size(pairs, children));
+  node->edit = edit;
+  node->datamap = 0;
+  node->nodemap = 0;
+  node->collisions = 0;
+  node->hash = 0;
+  return node;
+}
+
+static bool owned(u64 edit, const MapNode *node) {
+  return edit != 0 && node->edit == edit;
+}
+
+// Free a node the transient has replaced. A tracked one has a slot in its
+// heap's pages, so it is left for the collector.
+static void retire(u64 edit, MapNode *node) {
+  if (owned(edit, node) && !node->obj.is_tracked) mem_free(node);
+}
+
+// `node` if the transient owns it, else a copy it owns
+static MapNode *editable(u64 edit, MapNode *node) {
+  if (owned(edit, node)) return node;
+  size_t size = node_size(pair_count(node), popcount(node->nodemap));
+  MapNode *copy = node_alloc(size);
+  memcpy(&copy->edit, &node->edit, size - offsetof(MapNode, edit));
+  copy->edit = edit;
+  return copy;
+}
+
+// ============================================================================
+// Keys
+// ============================================================================
+
+bool map_valid_key(Value key) {
+  return IS_STRING(key) || IS_OBJ_STRING(key) || IS_INT(key) || IS_BOOL(key) || IS_NIL(key);
+}
+
+u32 map_key_hash(Value key) {
+  if (IS_OBJ_STRING(key)) return string_hash(AS_OBJ_STRING(key));
+  const char *chars;
+  int length;
+  if (value_get_string(&key, &chars, &length)) return hash_key(chars, (size_t)length);
+  if (IS_INT(key)) {
+    // Spread consecutive ints across the top-level fragments
+    u64 x = (u64)AS_INT(key);
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    return (u32)x;
+  }
+  if (IS_BOOL(key)) return AS_BOOL(key) ? 0x9e3779b9u : 0x7f4a7c15u;
+  return 0;
+}
+
+// ============================================================================
+// Reshaping bitmap nodes
+// ============================================================================
+
+// Copy of `node` with the pair at `bit` added
+static MapNode *with_pair(u64 edit, MapNode *node, u32 bit, Value key, Value value) {
+  int pairs = popcount(node->datamap);
+  int children = popcount(node->nodemap);
+  int at = index_of(node->datamap, bit);
+  MapNode *copy = node_new(edit, pairs + 1, children);
+  copy->datamap = node->datamap | bit;
+  copy->nodemap = node->nodemap;
+  memcpy(copy->pairs, node->pairs, sizeof(Value) * 2 * at);
+  copy->pairs[2 * at] = key;
+  copy->pairs[2 * at + 1] = value;
+  memcpy(copy->pairs + 2 * at + 2, node->pairs + 2 * at, sizeof(Value) * 2 * (pairs - at));
+  memcpy(node_children(copy), node_children(node), sizeof(MapNode*) * children);
+  retire(edit, node);
+  return copy;
+}
+
+// Copy of `node` without the pair at `bit`
+static MapNode *without_pair(u64 edit, MapNode *node, u32 bit) {
+  int pairs = popcount(node->datamap);
+  int children = popcount(node->nodemap);
+  int at = index_of(node->datamap, bit);
+  MapNode *copy = node_new(edit, pairs - 1, children);
+  copy->datamap = node->datamap & ~bit;
+  copy->nodemap = node->nodemap;
+  memcpy(copy->pairs, node->pairs, sizeof(Value) * 2 * at);
+  memcpy(copy->pairs + 2 * at, node->pairs + 2 * at + 2, sizeof(Value) * 2 * (pairs - at - 1));
+  memcpy(node_children(copy), node_children(node), sizeof(MapNode*) * children);
+  retire(edit, node);
+  return copy;
+}
+
+// Copy of `node` with the pair at `bit` replaced by `child`
+static MapNode *pair_to_child(u64 edit, MapNode *node, u32 bit, MapNode *child) {
+  int pairs = popcount(node->datamap);
+  int children = popcount(node->nodemap);
+  int at = index_of(node->datamap, bit);
+  int child_at = index_of(node->nodemap, bit);
+  MapNode *copy = node_new(edit, pairs - 1, children + 1);
+  copy->datamap = node->datamap & ~bit;
+  copy->nodemap = node->nodemap | bit;
+  memcpy(copy->pairs, node->pairs, sizeof(Value) * 2 * at);
+  memcpy(copy->pairs + 2 * at, node->pairs + 2 * at + 2, sizeof(Value) * 2 * (pairs - at - 1));
+  MapNode **from = node_children(node);
+  MapNode **to = node_children(copy);
+  memcpy(to, from, sizeof(MapNode*) * child_at);
+  to[child_at] = child;
+  memcpy(to + child_at + 1, from + child_at, sizeof(MapNode*) * (children - child_at));
+  retire(edit, node);
+  return copy;
+}
+
+// Copy of `node` with the child at `bit` replaced by a pair
+static MapNode *child_to_pair(u64 edit, MapNode *node, u32 bit, Value key, Value value) {
+  int pairs = popcount(node->datamap);
+  int children = popcount(node->nodemap);
+  int at = index_of(node->datamap, bit);
+  int child_at = index_of(node->nodemap, bit);
+  MapNode *copy = node_new(edit, pairs + 1, children - 1);
+  copy->datamap = node->datamap | bit;
+  copy->nodemap = node->nodemap & ~bit;
+  memcpy(copy->pairs, node->pairs, sizeof(Value) * 2 * at);
+  copy->pairs[2 * at] = key;
+  copy->pairs[2 * at + 1] = value;
+  memcpy(copy->pairs + 2 * at + 2, node->pairs + 2 * at, sizeof(Value) * 2 * (pairs - at));
+  MapNode **from = node_children(node);
+  MapNode **to = node_children(copy);
+  memcpy(to, from, sizeof(MapNode*) * child_at);
+  memcpy(to + child_at, from + child_at + 1, sizeof(MapNode*) * (children - child_at - 1));
+  retire(edit, node);
+  return copy;
+}
+
+// Copy of `node` without the child at `bit`
+static MapNode *without_child(u64 edit, MapNode *node, u32 bit) {
+  int pairs = popcount(node->datamap);
+  int children = popcount(node->nodemap);
+  int child_at = index_of(node->nodemap, bit);
+  MapNode *copy = node_new(edit, pairs, children - 1);
+  copy->datamap = node->datamap;
+  copy->nodemap = node->nodemap & ~bit;
+  memcpy(copy->pairs, node->pairs, sizeof(Value) * 2 * pairs);
+  MapNode **from = node_children(node);
+  MapNode **to = node_children(copy);
+  memcpy(to, from, sizeof(MapNode*) * child_at);
+  memcpy(to + child_at, from + child_at + 1, sizeof(MapNode*) * (children - child_at - 1));
+  retire(edit, node);
+  return copy;
+}
+
+// Node holding two pairs whose hashes agree below `shift`
+static MapNode *merge(u64 edit, int shift, Value key1, Value value1, u32 hash1,
+                      Value key2, Value value2, u32 hash2) {
+  if (shift >= 32) {
+    MapNode *node = node_new(edit, 2, 0);
+    node->collisions = 2;
+    node->hash = hash1;
+    node->pairs[0] = key1;
+    node->pairs[1] = value1;
+    node->pairs[2] = key2;
+    node->pairs[3] = value2;
+    return node;
+  }
+  u32 bit1 = bit_for(hash1, shift);
+  u32 bit2 = bit_for(hash2, shift);
+  if (bit1 == bit2) {
+    MapNode *node = node_new(edit, 0, 1);
+    node->nodemap = bit1;
+    node_children(node)[0] = merge(edit, shift + HAMT_BITS, key1, value1, hash1,
+                                   key2, value2, hash2);
+    return node;
+  }
+  MapNode *node = node_new(edit, 2, 0);
+  node->datamap = bit1 | bit2;
+  int first = bit1 < bit2 ? 0 : 2;
+  node->pairs[first] = key1;
+  node->pairs[first + 1] = value1;
+  node->pairs[2 - first] = key2;
+  node->pairs[3 - first] = value2;
+  return node;
+}
+
+// ============================================================================
+// Collision nodes
+// ============================================================================
+
+static int collision_find(MapNode *node, Value key) {
+  for (int i = 0; i < node->collisions; i++) {
+    if (value_equal(node->pairs[2 * i], key)) return i;
+  }
+  return -1;
+}
+
+static MapNode *collision_put(u64 edit, MapNode *node, Value key, Value value, bool *added) {
+  int at = collision_find(node, key);
+  if (at >= 0) {
+    MapNode *copy = editable(edit, node);
+    copy->pairs[2 * at + 1] = value;
+    return copy;
+  }
+  *added = true;
+  MapNode *copy = node_new(edit, node->collisions + 1, 0);
+  copy->collisions = node->collisions + 1;
+  copy->hash = node->hash;
+  memcpy(copy->pairs, node->pairs, sizeof(Value) * 2 * node->collisions);
+  copy->pairs[2 * node->collisions] = key;
+  copy->pairs[2 * node->collisions + 1] = value;
+  retire(edit, node);
+  return copy;
+}
+
+static MapNode *collision_remove(u64 edit, MapNode *node, Value key, bool *removed) {
+  int at = collision_find(node, key);
+  if (at < 0) return node;
+  *removed = true;
+  MapNode *copy = node_new(edit, node->collisions - 1, 0);
+  copy->collisions = node->collisions - 1;
+  copy->hash = node->hash;
+  memcpy(copy->pairs, node->pairs, sizeof(Value) * 2 * at);
+  memcpy(copy->pairs + 2 * at, node->pairs + 2 * at + 2,
+         sizeof(Value) * 2 * (node->collisions - at - 1));
+  retire(edit, node);
+  return copy;
+}
+
+// ============================================================================
+// Trie operations
+// ============================================================================
+
+static MapNode *node_put(u64 edit, MapNode *node, int shift, u32 hash, Value key, Value value,
+                         bool *added) {
+  if (node->collisions > 0) return collision_put(edit, node, key, value, added);
+
+  u32 bit = bit_for(hash, shift);
+  if (node->datamap & bit) {
+    int at = index_of(node->datamap, bit);
+    Value old_key = node->pairs[2 * at];
+    if (value_equal(old_key, key)) {
+      MapNode *copy = editable(edit, node);
+      copy->pairs[2 * at + 1] = value;
+      return copy;
+    }
+    *added = true;
+    MapNode *child = merge(edit, shift + HAMT_BITS, old_key, node->pairs[2 * at + 1],
+                           map_key_hash(old_key), key, value, hash);
+    return pair_to_child(edit, node, bit, child);
+  }
+  if (node->nodemap & bit) {
+    int at = index_of(node->nodemap, bit);
+    MapNode *child = node_children(node)[at];
+    MapNode *new_child = node_put(edit, child, shift + HAMT_BITS, hash, key, value, added);
+    if (new_child == child) return node;
+    MapNode *copy = editable(edit, node);
+    node_children(copy)[at] = new_child;
+    return copy;
+  }
+  *added = true;
+  return with_pair(edit, node, bit, key, value);
+}
+
+// Returns NULL once the node is left empty
+static MapNode *node_remove(u64 edit, MapNode *node, int shift, u32 hash, Value key,
+                            bool *removed) {
+  if (node->collisions > 0) return collision_remove(edit, node, key, removed);
+
+  u32 bit = bit_for(hash, shift);
+  if (node->datamap & bit) {
+    int at = index_of(node->datamap, bit);
+    if (!value_equal(node->pairs[2 * at], key)) return node;
+    *removed = true;
+    if (node->datamap == bit && node->nodemap == 0) {
+      retire(edit, node);
+      return NULL;
+    }
+    return without_pair(edit, node, bit);
+  }
+  if (node->nodemap & bit) {
+    int at = index_of(node->nodemap, bit);
+    MapNode *child = node_children(node)[at];
+    MapNode *new_child = node_remove(edit, child, shift + HAMT_BITS, hash, key, removed);
+    if (!*removed) return node;
+    if (new_child == NULL) {
+      if (node->datamap == 0 && node->nodemap == bit) {
+        retire(edit, node);
+        return NULL;
+      }
+      return without_child(edit, node, bit);
+    }
+    if (new_child->nodemap == 0 && pair_count(new_child) == 1) {
+      // A lone pair moves up into this node
+      Value lone_key = new_child->pairs[0];
+      Value lone_value = new_child->pairs[1];
+      retire(edit, new_child);
+      return child_to_pair(edit, node, bit, lone_key, lone_value);
+    }
+    if (new_child == child) return node;
+    MapNode *copy = editable(edit, node);
+    node_children(copy)[at] = new_child;
+    return copy;
+  }
+  return node;
+}
+
+// Entries are visited in trie order: by fragment at each level, root
+// first, which orders them by their hash's fragments read as one number.
+// Keys in a collision node follow in list order.
+static u64 trie_position(u32 hash, int index) {
+  u32 order = 0;
+  for (int shift = 0; shift < 32; shift += HAMT_BITS) {
+    int width = 32 - shift < HAMT_BITS ? 32 - shift : HAMT_BITS;
+    order = (order << width) | ((hash >> shift) & ((1u << width) - 1));
+  }
+  return (u64)order << 32 | (u32)index;
+}
+
+static bool node_each(MapNode *node, MapVisitor visit, void *context) {
+  if (node->collisions > 0) {
+    for (int i = 0; i < node->collisions; i++) {
+      if (!visit(node->pairs[2 * i], node->pairs[2 * i + 1], context)) return false;
+    }
+    return true;
+  }
+  for (u32 slots = node->datamap | node->nodemap; slots != 0; slots &= slots - 1) {
+    u32 bit = slots & -slots;
+    if (node->datamap & bit) {
+      Value *pair = &node->pairs[2 * index_of(node->datamap, bit)];
+      if (!visit(pair[0], pair[1], context)) return false;
+    } else if (!node_each(node_children(node)[index_of(node->nodemap, bit)], visit, context)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// First entry at or after (hash, index) in trie order. `bounded` holds
+// while the path taken so far is the one `hash` takes; off it, every entry
+// comes later and the first one found will do.
+static Value *node_seek(MapNode *node, int shift, u32 hash, int index, bool bounded,
+                        u32 *found_hash, int *found_index) {
+  if (node->collisions > 0) {
+    int start = bounded ? index : 0;
+    if (start >= node->collisions) return NULL;
+    *found_hash = node->hash;
+    *found_index = start;
+    return &node->pairs[2 * start];
+  }
+  u32 from = bounded ? (hash >> shift) & HAMT_MASK : 0;
+  for (u32 slots = (node->datamap | node->nodemap) & (~0u << from); slots != 0;
+       slots &= slots - 1) {
+    u32 bit = slots & -slots;
+    bool on_path = bounded && bit == 1u << from;
+    if (node->datamap & bit) {
+      Value *pair = &node->pairs[2 * index_of(node->datamap, bit)];
+      u32 pair_hash = map_key_hash(pair[0]);
+      if (on_path && trie_position(pair_hash, 0) < trie_position(hash, index)) continue;
+      *found_hash = pair_hash;
+      *found_index = 0;
+      return pair;
+    }
+    MapNode *child = node_children(node)[index_of(node->nodemap, bit)];
+    Value *pair = node_seek(child, shift + HAMT_BITS, hash, index, on_path, found_hash,
+                            found_index);
+    if (pair != NULL) return pair;
+  }
+  return NULL;
+}
+
+// ============================================================================
+// Maps
+// ============================================================================
+
+static ObjMap *map_alloc(void) {
+  ObjMap *map = (ObjMap*)mem_alloc(sizeof(ObjMap));
+  map->obj.type = OBJ_MAP;
+  map->obj.is_marked = false;
+  map->obj.next = NULL;
+  gc_track(&map->obj);
+  return map;
+}
+
+// Header to update: the transient itself, or a copy of a persistent one
+static ObjMap *target(ObjMap *map) {
+  if (map->edit != 0) return map;
+  ObjMap *copy = map_alloc();
+  copy->count = map->count;
+  copy->root = map->root;
+  copy->edit = 0;
+  return copy;
+}
+
+ObjMap *map_make(void) {
+  ObjMap *map = map_alloc();
+  map->count = 0;
+  map->root = NULL;
+  map->edit = 0;
+  return map;
+}
+
+bool map_get(ObjMap *map, Value key, Value *value) {
+  u32 hash = map_key_hash(key);
+  MapNode *node = map->root;
+  for (int shift = 0; node != NULL; shift += HAMT_BITS) {
+    if (node->collisions > 0) {
+      int at = collision_find(node, key);
+      if (at < 0) return false;
+      *value = node->pairs[2 * at + 1];
+      return true;
+    }
+    u32 bit = bit_for(hash, shift);
+    if (node->datamap & bit) {
+      int at = index_of(node->datamap, bit);
+      if (!value_equal(node->pairs[2 * at], key)) return false;
+      *value = node->pairs[2 * at + 1];
+      return true;
+    }
+    if (!(node->nodemap & bit)) return false;
+    node = node_children(node)[index_of(node->nodemap, bit)];
+  }
+  return false;
+}
+
+ObjMap *map_put(ObjMap *map, Value key, Value value) {
+  u32 hash = map_key_hash(key);
+  bool added = false;
+  MapNode *root;
+  if (map->root == NULL) {
+    root = node_new(map->edit, 1, 0);
+    root->datamap = bit_for(hash, 0);
+    root->pairs[0] = key;
+    root->pairs[1] = value;
+    added = true;
+  } else {
+    root = node_put(map->edit, map->root, 0, hash, key, value, &added);
+  }
+  ObjMap *out = target(map);
+  out->root = root;
+  if (added) out->count++;
+  return out;
+}
+
+ObjMap *map_remove(ObjMap *map, Value key) {
+  if (map->root == NULL) return map;
+  bool removed = false;
+  MapNode *root = node_remove(map->edit, map->root, 0, map_key_hash(key), key, &removed);
+  if (!removed) return map;
+  ObjMap *out = target(map);
+  out->root = root;
+  out->count--;
+  return out;
+}
+
+ObjMap *map_transient(ObjMap *map) {
+  if (map->edit != 0) return map;
+  ObjMap *transient = target(map);
+  transient->edit = transient_edit();
+  return transient;
+}
+
+ObjMap *map_freeze(ObjMap *map) {
+  // Its token is never handed out again, so no one changes its nodes now
+  map->edit = 0;
+  return map;
+}
+
+bool map_each(ObjMap *map, MapVisitor visit, void *context) {
+  return map->root == NULL || node_each(map->root, visit, context);
+}
+
+void map_node_trace(MapNode *node, void (*visit)(Value value, void *context),
+                    void (*visit_node)(Object *node, void *context), void *context) {
+  int pairs = pair_count(node);
+  for (int i = 0; i < 2 * pairs; i++) visit(node->pairs[i], context);
+  MapNode **children = node_children(node);
+  for (int i = 0; i < popcount(node->nodemap); i++) visit_node(&children[i]->obj, context);
+}
+
+bool map_next(ObjMap *map, u64 *cursor, Value *key, Value *value) {
+  if (map->root == NULL) return false;
+  u32 hash;
+  int index;
+  Value *pair = node_seek(map->root, 0, (u32)(*cursor >> 32), (int)(u32)*cursor, true, &hash,
+                          &index);
+  if (pair == NULL) return false;
+  *key = pair[0];
+  *value = pair[1];
+  *cursor = (u64)hash << 32 | (u32)(index + 1);
+  return true;
+}
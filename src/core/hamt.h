@@ -0,0 +1,59 @@
+// src/core/hamt.h - Persistent hash maps
+
+#ifndef SATORI_HAMT_H
+#define SATORI_HAMT_H
+
+#include "common.h"
+#include "object.h"
+
+#define HAMT_BITS 5
+
+typedef struct MapNode MapNode;
+
+// Persistent map: a hash array mapped trie. Each node takes 5 bits of the
+// key's hash and keeps only the entries present, found through bitmaps.
+// Updates copy only the path to the changed node and share the rest.
+//
+// A transient map (edit != 0) is updated in place, copying a node only
+// the first time it changes it.
+typedef struct {
+  Object obj;
+  int count;
+  MapNode *root;   // NULL when empty
+  u64 edit;
+} ObjMap;
+
+#define IS_MAP(value)  (IS_OBJ(value) && OBJ_TYPE(value) == OBJ_MAP)
+#define AS_MAP(value)  ((ObjMap*)AS_OBJ(value))
+
+// Keys are strings, ints, bools or nil
+bool map_valid_key(Value key);
+u32 map_key_hash(Value key);
+
+ObjMap *map_make(void);
+bool map_get(ObjMap *map, Value key, Value *value);
+
+// Updates return a new map, or change a transient in place and return it
+ObjMap *map_put(ObjMap *map, Value key, Value value);
+ObjMap *map_remove(ObjMap *map, Value key);
+
+// A transient copy (a transient is returned as is), and back. Freezing
+// makes the transient itself persistent.
+ObjMap *map_transient(ObjMap *map);
+ObjMap *map_freeze(ObjMap *map);
+
+// Call `visit` for every entry, in hash order. Return false from it to stop.
+typedef bool (*MapVisitor)(Value key, Value value, void *context);
+bool map_each(ObjMap *map, MapVisitor visit, void *context);
+
+// For the collector: `visit` each key and value `node` holds inline, and
+// `visit_node` each child node (an OBJ_MAP_NODE object)
+void map_node_trace(MapNode *node, void (*visit)(Value value, void *context),
+                    void (*visit_node)(Object *node, void *context), void *context);
+
+// Step through the entries in map_each's order without allocating: start
+// with *cursor = 0; each call yields the next entry and advances *cursor,
+// and returns false once all have been seen.
+bool map_next(ObjMap *map, u64 *cursor, Value *key, Value *value);
+
+#endif // SATORI_HAMT_H
@@ -0,0 +1,158 @@
+// src/core/hash.c - Hashing for tables, strings and map keys
+//
+// Keys hash with wyhash, which reads eight bytes at a time and costs a
+// couple of multiplies for a short key, where FNV-1a took a multiply per
+// byte. The seed is drawn once per process from /dev/urandom, so nobody
+// can work out ahead of time which keys collide: keys chosen to pile into
+// one probe run (the fields of a hostile JSON document, say) spread like
+// any others. Hashes, and so the order maps iterate in, differ between
+// runs.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "hash.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Unaligned little-endian reads
+static inline u32 read32(const u8 *p) {
+  u32 v;
+  memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap32(v);
+#endif
+  return v;
+}
+
+static inline u64 read64(const u8 *p) {
+  u64 v;
+  memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap64(v);
+#endif
+  return v;
+}
+
+// Full 64x64 -> 128 multiply
+static inline void mul128(u64 a, u64 b, u64 *lo, u64 *hi) {
+#ifdef __SIZEOF_INT128__
+  __extension__ typedef unsigned __int128 u128;
+  u128 r = (u128)a * b;
+  *lo = (u64)r;
+  *hi = (u64)(r >> 64);
+#else
+  u64 lo_lo = (a & 0xffffffff) * (b & 0xffffffff);
+  u64 hi_lo = (a >> 32) * (b & 0xffffffff);
+  u64 lo_hi = (a & 0xffffffff) * (b >> 32);
+  u64 hi_hi = (a >> 32) * (b >> 32);
+  u64 cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+  *hi = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+  *lo = (cross << 32) | (lo_lo & 0xffffffff);
+#endif
+}
+
+// ============================================================================
+// wyhash
+// ============================================================================
+
+static const u64 wyhash_secret[4] = {
+  0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull,
+  0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull,
+};
+
+static inline u64 wymix(u64 a, u64 b) {
+  u64 lo, hi;
+  mul128(a, b, &lo, &hi);
+  return lo ^ hi;
+}
+
+static inline u64 wyhash_seed(u64 seed) {
+  return seed ^ wymix(seed ^ wyhash_secret[0], wyhash_secret[1]);
+}
+
+// wyhash from a seed wyhash_seed has already mixed
+static inline u64 wyhash_mixed(const void *data, size_t length, u64 seed) {
+  const u8 *p = data;
+  const u64 *s = wyhash_secret;
+  u64 a, b;
+
+  if (length <= 16) {
+    if (length >= 4) {
+      size_t mid = (length >> 3) << 2;
+      a = ((u64)read32(p) << 32) | read32(p + mid);
+      b = ((u64)read32(p + length - 4) << 32) | read32(p + length - 4 - mid);
+    } else if (length > 0) {
+      a = ((u64)p[0] << 16) | ((u64)p[length >> 1] << 8) | p[length - 1];
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    size_t i = length;
+    if (i >= 48) {
+      u64 seed1 = seed, seed2 = seed;
+      do {
+        seed = wymix(read64(p) ^ s[1], read64(p + 8) ^ seed);
+        seed1 = wymix(read64(p + 16) ^ s[2], read64(p + 24) ^ seed1);
+        seed2 = wymix(read64(p + 32) ^ s[3], read64(p + 40) ^ seed2);
+        p += 48;
+        i -= 48;
+      } while (i >= 48);
+      seed ^= seed1 ^ seed2;
+    }
+    while (i > 16) {
+      seed = wymix(read64(p) ^ s[1], read64(p + 8) ^ seed);
+      p += 16;
+      i -= 16;
+    }
+    a = read64(p + i - 16);
+    b = read64(p + i - 8);
+  }
+
+  mul128(a ^ s[1], b ^ seed, &a, &b);
+  return wymix(a ^ s[0] ^ length, b ^ s[1]);
+}
+
+u64 hash_wyhash(const void *data, size_t length, u64 seed) {
+  return wyhash_mixed(data, length, wyhash_seed(seed));
+}
+
+// ============================================================================
+// Keys
+// ============================================================================
+
+static u64 key_seed;   // Mixed; 0 until drawn
+
+static u64 draw_key_seed(void) {
+  u64 seed = 0;
+  int fd = open("/dev/urandom", O_RDONLY);
+  if (fd >= 0) {
+    if (read(fd, &seed, sizeof(seed)) != (ssize_t)sizeof(seed)) seed = 0;
+    close(fd);
+  }
+  if (seed == 0) {
+    // No urandom (a chroot, say): still differ between runs
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    seed = ((u64)ts.tv_sec << 32) ^ (u64)ts.tv_nsec ^ ((u64)getpid() << 16) ^
+           (u64)(uintptr_t)&seed;
+  }
+
+  // Threads that race here all keep whichever seed was stored first
+  u64 mixed = wyhash_seed(seed) | 1;
+  u64 expected = 0;
+  if (!__atomic_compare_exchange_n(&key_seed, &expected, mixed, false, __ATOMIC_RELAXED,
+                                   __ATOMIC_RELAXED)) {
+    return expected;
+  }
+  return mixed;
+}
+
+u32 hash_key(const char *chars, size_t length) {
+  u64 seed = __atomic_load_n(&key_seed, __ATOMIC_RELAXED);
+  if (seed == 0) seed = draw_key_seed();
+  return (u32)wyhash_mixed(chars, length, seed);
+}
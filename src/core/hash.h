@@ -0,0 +1,19 @@
+// src/core/hash.h - Hashing for tables, strings and map keys
+//
+// One hash serves every string the runtime looks up: Table keys, the
+// cached hash of each ObjString, and string keys of persistent maps.
+
+#ifndef SATORI_HASH_H
+#define SATORI_HASH_H
+
+#include "common.h"
+
+// wyhash (final4) of `length` bytes under `seed`
+u64 hash_wyhash(const void *data, size_t length, u64 seed);
+
+// Hash of a string key: wyhash under a seed drawn at random once per
+// process, so a key's hash is stable while the process runs and differs
+// from run to run.
+u32 hash_key(const char *chars, size_t length);
+
+#endif // SATORI_HASH_H
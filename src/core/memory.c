@@ -4,29 +4,82 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+// Block sizes come from the C library where it will tell us, so frees can
+// be credited without a header on every block. Elsewhere the requested
+// size is charged and frees are not credited, so the quota caps total
+// allocation instead.
+#ifdef __GLIBC__
+#include <malloc.h>
+#define BLOCK_SIZE(ptr, requested) ((i64)malloc_usable_size(ptr))
+#else
+#define BLOCK_SIZE(ptr, requested) ((i64)(requested))
+#define NO_FREE_CREDIT
+#endif
+
+#ifdef __GNUC__
+static __thread MemMeter *meter = NULL;
+#else
+static MemMeter *meter = NULL;
+#endif
+
+MemMeter *mem_attach_meter(MemMeter *new_meter) {
+  MemMeter *old = meter;
+  meter = new_meter;
+  return old;
+}
+
+jmp_buf *mem_defer_limit(void) {
+  if (meter == NULL) return NULL;
+  jmp_buf *escape = meter->escape;
+  meter->escape = NULL;
+  return escape;
+}
+
+void mem_resume_limit(jmp_buf *escape) {
+  if (meter != NULL) meter->escape = escape;
+}
+
+// Refuse to grow the heap by `size` bytes past the attached meter's limit
+static inline void check_limit(size_t size) {
+  if (meter == NULL || meter->escape == NULL) return;
+  i64 room = meter->limit - meter->used;
+  if (room < 0 || size > (u64)room) longjmp(*meter->escape, 1);
+}
+
 void *mem_alloc(size_t size) {
+  check_limit(size);
   void *ptr = malloc(size);
   if (ptr == NULL && size > 0) {
     fprintf(stderr, "Fatal: Out of memory\n");
     exit(1);
   }
+  if (meter != NULL) meter->used += BLOCK_SIZE(ptr, size);
   return ptr;
 }
 
 void *mem_realloc(void *ptr, size_t new_size) {
   if (new_size == 0) {
-    free(ptr);
+    mem_free(ptr);
     return NULL;
   }
   
+  i64 old_size = 0;
+#ifndef NO_FREE_CREDIT
+  if (meter != NULL && ptr != NULL) old_size = BLOCK_SIZE(ptr, 0);
+#endif
+  if ((i64)new_size > old_size) check_limit(new_size - (size_t)old_size);
   void *result = realloc(ptr, new_size);
   if (result == NULL) {
     fprintf(stderr, "Fatal: Out of memory\n");
     exit(1);
   }
+  if (meter != NULL) meter->used += BLOCK_SIZE(result, new_size) - old_size;
   return result;
 }
 
 void mem_free(void *ptr) {
+#ifndef NO_FREE_CREDIT
+  if (meter != NULL && ptr != NULL) meter->used -= BLOCK_SIZE(ptr, 0);
+#endif
   free(ptr);
 }
@@ -4,6 +4,7 @@
 #define SATORI_MEMORY_H
 
 #include "common.h"
+#include <setjmp.h>
 #include <stddef.h>
 
 // Memory allocation
@@ -11,6 +12,28 @@ void *mem_alloc(size_t size);
 void *mem_realloc(void *ptr, size_t new_size);
 void mem_free(void *ptr);
 
+// Heap accounting for one VM. While a meter is attached to the current
+// thread, mem_* calls charge it the size of each block they allocate and
+// credit it the size of each block they free. An allocation that would
+// take `used` past `limit` does not happen: mem_alloc and mem_realloc
+// longjmp to `escape` instead. With no escape set they only count, and
+// the VM compares `used` with `limit` at its safepoints.
+typedef struct {
+  i64 used;         // Net bytes allocated while attached
+  i64 limit;        // Quota in bytes, INT64_MAX for none
+  jmp_buf *escape;  // Where an allocation over the limit jumps, or NULL
+} MemMeter;
+
+// Attach `meter` (NULL detaches). Returns the meter it replaces.
+MemMeter *mem_attach_meter(MemMeter *meter);
+
+// Let allocations past the limit through until mem_resume_limit, for code
+// that must not be cut short: a native call, holding a lock, or halfway
+// through updating state that outlives the VM's run. The next safepoint still sees the
+// overrun. Returns what to pass to mem_resume_limit.
+jmp_buf *mem_defer_limit(void);
+void mem_resume_limit(jmp_buf *escape);
+
 // Dynamic array growth
 #define GROW_CAPACITY(capacity) \
   ((capacity) < 8 ? 8 : (capacity) * 2)
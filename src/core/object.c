@@ -1,79 +1,252 @@
 // src/core/object.c - Object implementation
 
 #include "object.h"
+#include "gc.h"
+#include "hamt.h"
+#include "hash.h"
 #include "memory.h"
+#include "utf8.h"
+#include "vector.h"
+#include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
 
+static bool print_entry(Value key, Value value, void *context) {
+  bool *first = context;
+  if (!*first) printf(", ");
+  *first = false;
+  value_print(key);
+  printf(": ");
+  value_print(value);
+  return true;
+}
+
 void object_print(Object *obj) {
   switch (obj->type) {
-    case OBJ_STRING:
-      printf("%s", ((ObjString*)obj)->chars);
+    case OBJ_STRING: {
+      ObjString *str = (ObjString*)obj;
+      printf("%.*s", str->length, str->chars);
       break;
+    }
     case OBJ_FUNCTION:
       printf("<function>");
       break;
     case OBJ_NATIVE:
       printf("<native fn>");
       break;
+    case OBJ_ARRAY: {
+      ObjArray *array = (ObjArray*)obj;
+      printf("[");
+      for (int i = 0; i < array->count; i++) {
+        if (i > 0) printf(", ");
+        value_print(array->items[i]);
+      }
+      printf("]");
+      break;
+    }
+    case OBJ_PACKED: {
+      ObjPacked *packed = (ObjPacked*)obj;
+      printf("[");
+      for (int i = 0; i < packed->count; i++) {
+        if (i > 0) printf(", ");
+        if (packed->element == PACKED_INT) {
+          printf("%lld", (long long)packed->as.ints[i]);
+        } else {
+          printf("%g", packed->as.floats[i]);
+        }
+      }
+      printf("]");
+      break;
+    }
+    case OBJ_VECTOR: {
+      ObjVector *vector = (ObjVector*)obj;
+      printf("[");
+      for (int i = 0; i < vector->count; i++) {
+        if (i > 0) printf(", ");
+        value_print(vector_get(vector, i));
+      }
+      printf("]");
+      break;
+    }
+    case OBJ_MAP: {
+      bool first = true;
+      printf("{");
+      map_each((ObjMap*)obj, print_entry, &first);
+      printf("}");
+      break;
+    }
+    case OBJ_FOREIGN:
+      printf("<%s>", ((ObjForeign*)obj)->kind->name);
+      break;
     default:
       printf("<object>");
       break;
   }
 }
 
+// snprintf at offset `length` of a bounded buffer. Returns the length of
+// the text, whether or not it fit.
+static int format_at(char *buffer, int size, int length, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  int n = length < size ? vsnprintf(buffer + length, size - length, format, args)
+                        : vsnprintf(NULL, 0, format, args);
+  va_end(args);
+  return n;
+}
+
+typedef struct {
+  char *buffer;
+  int size;
+  int length;
+} FormatState;
+
+static bool format_entry(Value key, Value value, void *context) {
+  FormatState *state = context;
+  char *buffer = state->buffer;
+  int size = state->size;
+  int length = state->length;
+  if (length > 1) length += format_at(buffer, size, length, ", ");
+  length += value_format(key, length < size ? buffer + length : NULL,
+                         length < size ? size - length : 0);
+  length += format_at(buffer, size, length, ": ");
+  length += value_format(value, length < size ? buffer + length : NULL,
+                         length < size ? size - length : 0);
+  state->length = length;
+  return true;
+}
+
+int object_format(Object *obj, char *buffer, int size) {
+  int length = 0;
+  switch (obj->type) {
+    case OBJ_STRING: {
+      ObjString *str = (ObjString*)obj;
+      if (size > 0) {
+        int n = str->length < size - 1 ? str->length : size - 1;
+        memcpy(buffer, str->chars, n);
+        buffer[n] = '\0';
+      }
+      return str->length;
+    }
+    case OBJ_ARRAY: {
+      ObjArray *array = (ObjArray*)obj;
+      length += format_at(buffer, size, length, "[");
+      for (int i = 0; i < array->count; i++) {
+        if (i > 0) length += format_at(buffer, size, length, ", ");
+        length += value_format(array->items[i], length < size ? buffer + length : NULL,
+                               length < size ? size - length : 0);
+      }
+      length += format_at(buffer, size, length, "]");
+      return length;
+    }
+    case OBJ_PACKED: {
+      ObjPacked *packed = (ObjPacked*)obj;
+      length += format_at(buffer, size, length, "[");
+      for (int i = 0; i < packed->count; i++) {
+        if (i > 0) length += format_at(buffer, size, length, ", ");
+        if (packed->element == PACKED_INT) {
+          length += format_at(buffer, size, length, "%lld", (long long)packed->as.ints[i]);
+        } else {
+          length += format_at(buffer, size, length, "%g", packed->as.floats[i]);
+        }
+      }
+      length += format_at(buffer, size, length, "]");
+      return length;
+    }
+    case OBJ_VECTOR: {
+      ObjVector *vector = (ObjVector*)obj;
+      length += format_at(buffer, size, length, "[");
+      for (int i = 0; i < vector->count; i++) {
+        if (i > 0) length += format_at(buffer, size, length, ", ");
+        length += value_format(vector_get(vector, i), length < size ? buffer + length : NULL,
+                               length < size ? size - length : 0);
+      }
+      length += format_at(buffer, size, length, "]");
+      return length;
+    }
+    case OBJ_MAP: {
+      FormatState state = {buffer, size, format_at(buffer, size, 0, "{")};
+      map_each((ObjMap*)obj, format_entry, &state);
+      return state.length + format_at(buffer, size, state.length, "}");
+    }
+    case OBJ_FUNCTION:
+      return snprintf(buffer, size, "<function>");
+    case OBJ_NATIVE:
+      return snprintf(buffer, size, "<native fn>");
+    case OBJ_FOREIGN:
+      return snprintf(buffer, size, "<%s>", ((ObjForeign*)obj)->kind->name);
+    default:
+      return snprintf(buffer, size, "<object>");
+  }
+}
+
 void object_free(Object *obj) {
   switch (obj->type) {
     case OBJ_STRING: {
       ObjString *str = (ObjString*)obj;
-      mem_free(str->chars);
+      if (str->base == NULL) mem_free(str->chars);
+      mem_free(str->index);
       mem_free(str);
       break;
     }
+    case OBJ_ARRAY: {
+      ObjArray *array = (ObjArray*)obj;
+      mem_free(array->items);
+      mem_free(array);
+      break;
+    }
+    case OBJ_PACKED: {
+      ObjPacked *packed = (ObjPacked*)obj;
+      mem_free(packed->as.ints);
+      mem_free(packed);
+      break;
+    }
+    case OBJ_FOREIGN: {
+      ObjForeign *foreign = (ObjForeign*)obj;
+      if (foreign->kind->free != NULL) foreign->kind->free(foreign->data);
+      mem_free(foreign);
+      break;
+    }
     default:
       mem_free(obj);
       break;
   }
 }
 
-// FNV-1a hash function
-u32 string_hash(const char *key, int length) {
-  u32 hash = 2166136261u;
-  for (int i = 0; i < length; i++) {
-    hash ^= (u8)key[i];
-    hash *= 16777619;
-  }
-  return hash;
-}
-
-static ObjString *string_allocate(char *chars, int length, u32 hash) {
+static ObjString *string_allocate(char *chars, int length) {
   ObjString *str = (ObjString*)mem_alloc(sizeof(ObjString));
   str->obj.type = OBJ_STRING;
   str->obj.is_marked = false;
   str->obj.next = NULL;
+  gc_track(&str->obj);
   str->chars = chars;
   str->length = length;
-  str->hash = hash;
+  str->hash = 0;
+  str->base = NULL;
+  str->is_ascii = utf8_is_ascii(chars, length);
+  str->index = NULL;
   return str;
 }
 
 ObjString *string_make(const char *chars, int length) {
-  u32 hash = string_hash(chars, length);
   // TODO: Intern strings here
   return string_copy(chars, length);
 }
 
 ObjString *string_copy(const char *chars, int length) {
-  u32 hash = string_hash(chars, length);
   char *heap_chars = (char*)mem_alloc(length + 1);
   memcpy(heap_chars, chars, length);
   heap_chars[length] = '\0';
-  return string_allocate(heap_chars, length, hash);
+  return string_take(heap_chars, length);
 }
 
 ObjString *string_take(char *chars, int length) {
-  u32 hash = string_hash(chars, length);
-  return string_allocate(chars, length, hash);
+  // Nothing owns `chars` until the string exists, so a quota hit waits for
+  // the next safepoint instead of leaking them
+  jmp_buf *escape = mem_defer_limit();
+  ObjString *str = string_allocate(chars, length);
+  mem_resume_limit(escape);
+  return str;
 }
 
 ObjString *string_concat(ObjString *a, ObjString *b) {
@@ -84,3 +257,146 @@ ObjString *string_concat(ObjString *a, ObjString *b) {
   chars[length] = '\0';
   return string_take(chars, length);
 }
+
+// Borrow [start, start + length) of base without copying
+ObjString *string_slice(ObjString *base, int start, int length) {
+  // Slices of slices point at the real owner
+  while (base->base != NULL) {
+    start += (int)(base->chars - base->base->chars);
+    base = base->base;
+  }
+  char *chars = base->chars + start;
+  ObjString *str = string_allocate(chars, length);
+  str->base = base;
+  return str;
+}
+
+u32 string_hash(ObjString *str) {
+  // A string whose hash really is 0 is hashed again each time, which is
+  // rare enough not to need a flag
+  if (str->hash == 0) str->hash = hash_key(str->chars, (size_t)str->length);
+  return str->hash;
+}
+
+static inline bool is_char_start(const char *chars, int offset) {
+  return offset == 0 || !utf8_is_continuation((u8)chars[offset]);
+}
+
+static StringIndex *char_index(ObjString *str) {
+  if (str->index != NULL) return str->index;
+
+  // A leading continuation byte still starts the first code point
+  int count = utf8_count(str->chars, str->length);
+  if (str->length > 0 && utf8_is_continuation((u8)str->chars[0])) count++;
+
+  int slots = count / STRING_INDEX_STRIDE + 1;
+  StringIndex *index = (StringIndex*)mem_alloc(sizeof(StringIndex) + sizeof(int) * slots);
+  index->char_count = count;
+  index->offsets[0] = 0;
+  int seen = 0;
+  for (int i = 0; i < str->length; i++) {
+    if (!is_char_start(str->chars, i)) continue;
+    if (seen % STRING_INDEX_STRIDE == 0) index->offsets[seen / STRING_INDEX_STRIDE] = i;
+    seen++;
+  }
+  str->index = index;
+  return index;
+}
+
+int string_char_count(ObjString *str) {
+  return str->is_ascii ? str->length : char_index(str)->char_count;
+}
+
+int string_char_offset(ObjString *str, int index) {
+  if (str->is_ascii) return index < str->length ? index : str->length;
+
+  StringIndex *crumbs = char_index(str);
+  if (index >= crumbs->char_count) return str->length;
+  int offset = crumbs->offsets[index / STRING_INDEX_STRIDE];
+  for (int n = index % STRING_INDEX_STRIDE; n > 0; n--) {
+    offset++;
+    while (!is_char_start(str->chars, offset)) offset++;
+  }
+  return offset;
+}
+
+ObjArray *array_make(int capacity) {
+  ObjArray *array = (ObjArray*)mem_alloc(sizeof(ObjArray));
+  array->obj.type = OBJ_ARRAY;
+  array->obj.is_marked = false;
+  array->obj.next = NULL;
+  // Empty until the items are allocated, in case the allocator refuses
+  // them after the collector has seen the array
+  array->count = 0;
+  array->capacity = 0;
+  array->items = NULL;
+  gc_track(&array->obj);
+  if (capacity > 0) {
+    array->items = (Value*)mem_alloc(sizeof(Value) * capacity);
+    array->capacity = capacity;
+  }
+  return array;
+}
+
+void array_push(ObjArray *array, Value value) {
+  if (array->capacity < array->count + 1) {
+    // Capacity changes only once the block has, as the allocator may
+    // refuse and leave the array as it was
+    int capacity = GROW_CAPACITY(array->capacity);
+    array->items = GROW_ARRAY(Value, array->items, array->capacity, capacity);
+    array->capacity = capacity;
+  }
+  array->items[array->count++] = value;
+}
+
+// Both element types are 8 bytes, so storage is managed through `ints`
+ObjPacked *packed_make(PackedType element, int capacity) {
+  ObjPacked *packed = (ObjPacked*)mem_alloc(sizeof(ObjPacked));
+  packed->obj.type = OBJ_PACKED;
+  packed->obj.is_marked = false;
+  packed->obj.next = NULL;
+  packed->element = element;
+  packed->count = 0;
+  packed->capacity = 0;
+  packed->as.ints = NULL;
+  gc_track(&packed->obj);
+  if (capacity > 0) {
+    packed->as.ints = (i64*)mem_alloc(sizeof(i64) * capacity);
+    packed->capacity = capacity;
+  }
+  return packed;
+}
+
+static void packed_reserve(ObjPacked *packed) {
+  if (packed->capacity < packed->count + 1) {
+    int capacity = GROW_CAPACITY(packed->capacity);
+    packed->as.ints = GROW_ARRAY(i64, packed->as.ints, packed->capacity, capacity);
+    packed->capacity = capacity;
+  }
+}
+
+void packed_push_int(ObjPacked *packed, i64 value) {
+  packed_reserve(packed);
+  packed->as.ints[packed->count++] = value;
+}
+
+void packed_push_float(ObjPacked *packed, f64 value) {
+  packed_reserve(packed);
+  packed->as.floats[packed->count++] = value;
+}
+
+ObjForeign *foreign_make(const ForeignType *kind, void *data) {
+  ObjForeign *foreign = (ObjForeign*)mem_alloc(sizeof(ObjForeign));
+  foreign->obj.type = OBJ_FOREIGN;
+  foreign->obj.is_marked = false;
+  foreign->obj.next = NULL;
+  gc_track(&foreign->obj);
+  foreign->kind = kind;
+  foreign->data = data;
+  return foreign;
+}
+
+u64 transient_edit(void) {
+  static u64 next_edit = 0;
+  return ++next_edit;
+}
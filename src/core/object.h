@@ -13,33 +13,117 @@ typedef enum {
   OBJ_NATIVE,
   OBJ_ARRAY,
   OBJ_MAP,
+  OBJ_FOREIGN,
+  OBJ_PACKED,
+  OBJ_VECTOR,
+  // Trie nodes of vectors and maps, tracked and traced like any object
+  // but never held by a Value
+  OBJ_VEC_LEAF,
+  OBJ_VEC_BRANCH,
+  OBJ_MAP_NODE,
 } ObjectType;
 
 // Base object (all heap objects start with this)
 struct Object {
   ObjectType type;
   bool is_marked;       // For GC
+  bool is_tracked;      // Recorded by a GcHeap (see gc.h)
   struct Object *next;  // Intrusive linked list for GC
 };
 
+// Code-point index of a non-ASCII string: the byte offset of every
+// STRING_INDEX_STRIDE-th code point, so locating any code point scans at
+// most one stride of bytes
+#define STRING_INDEX_STRIDE 64
+
+typedef struct {
+  int char_count;
+  int offsets[];  // offsets[k]: byte offset of code point k * STRING_INDEX_STRIDE
+} StringIndex;
+
 // String object
+//
+// A slice borrows its bytes from `base` instead of owning them, so cutting
+// a big string into pieces costs one small header per piece. Slices are not
+// NUL-terminated; always go through `length`.
+//
+// Code points are indexed in O(1) for ASCII strings (the common case,
+// detected at creation). Other strings build a StringIndex on first use.
+// Code points start at byte 0 and at every byte that is not a UTF-8
+// continuation byte, so invalid input still indexes consistently.
 struct ObjString {
   Object obj;
   int length;
   char *chars;
-  u32 hash;  // Cached hash
+  u32 hash;  // Cached string_hash; 0 until first needed
+  ObjString *base;  // Owner of chars for slices, NULL if chars are owned
+  bool is_ascii;
+  StringIndex *index;  // NULL until needed, always NULL for ASCII
 };
 
+// Array object
+typedef struct {
+  Object obj;
+  int count;
+  int capacity;
+  Value *items;
+} ObjArray;
+
+// Packed array: unboxed ints or floats in one contiguous block, for bulk
+// data produced and consumed by natives (CSV columns, sort keys, ...)
+typedef enum {
+  PACKED_INT,
+  PACKED_FLOAT,
+} PackedType;
+
+typedef struct {
+  Object obj;
+  PackedType element;
+  int count;
+  int capacity;
+  union {
+    i64 *ints;
+    f64 *floats;
+  } as;
+} ObjPacked;
+
+// Foreign object: an opaque resource owned by a native module
+// (compiled regex, file stream, ...). The descriptor names the type
+// and knows how to release it, how to produce its items if `for`
+// can iterate it, and which values it holds on to.
+typedef struct {
+  const char *name;            // Shown when printed: <name>
+  void (*free)(void *data);    // Release data (may be NULL)
+  bool (*next)(void *data, Value *item);  // Next item, false at the end (may be NULL)
+  void (*trace)(void *data, void (*visit)(Value value, void *context),
+                void *context);  // Visit every value data keeps (may be NULL)
+} ForeignType;
+
+typedef struct {
+  Object obj;
+  const ForeignType *kind;
+  void *data;
+} ObjForeign;
+
 // Type checking
 #define OBJ_TYPE(value)     (AS_OBJ(value)->type)
 #define IS_OBJ_STRING(value)    (IS_OBJ(value) && OBJ_TYPE(value) == OBJ_STRING)
+#define IS_OBJ_ARRAY(value)     (IS_OBJ(value) && OBJ_TYPE(value) == OBJ_ARRAY)
+#define IS_OBJ_PACKED(value)    (IS_OBJ(value) && OBJ_TYPE(value) == OBJ_PACKED)
+#define IS_FOREIGN(value, type) \
+  (IS_OBJ(value) && OBJ_TYPE(value) == OBJ_FOREIGN && \
+   ((ObjForeign*)AS_OBJ(value))->kind == (type))
 
 // Extraction
 #define AS_OBJ_STRING(value)    ((ObjString*)AS_OBJ(value))
 #define AS_CSTRING(value)   (((ObjString*)AS_OBJ(value))->chars)
+#define AS_OBJ_ARRAY(value)     ((ObjArray*)AS_OBJ(value))
+#define AS_OBJ_PACKED(value)    ((ObjPacked*)AS_OBJ(value))
+#define AS_FOREIGN_DATA(value)  (((ObjForeign*)AS_OBJ(value))->data)
 
 // Object operations
 void object_print(Object *obj);
+int object_format(Object *obj, char *buffer, int size);  // See value_format
 void object_free(Object *obj);
 
 // String operations
@@ -47,6 +131,26 @@ ObjString *string_make(const char *chars, int length);
 ObjString *string_copy(const char *chars, int length);
 ObjString *string_take(char *chars, int length);
 ObjString *string_concat(ObjString *a, ObjString *b);
-u32 string_hash(const char *key, int length);
+ObjString *string_slice(ObjString *base, int start, int length);
+u32 string_hash(ObjString *str);  // hash_key of the chars, cached on first use
+
+// Code points
+int string_char_count(ObjString *str);
+int string_char_offset(ObjString *str, int index);  // Byte offset; length if index >= count
+
+// Array operations
+ObjArray *array_make(int capacity);
+void array_push(ObjArray *array, Value value);
+
+// Packed array operations
+ObjPacked *packed_make(PackedType element, int capacity);
+void packed_push_int(ObjPacked *packed, i64 value);
+void packed_push_float(ObjPacked *packed, f64 value);
+
+// Foreign operations
+ObjForeign *foreign_make(const ForeignType *kind, void *data);
+
+// Fresh nonzero token naming a transient collection (see vector.h, hamt.h)
+u64 transient_edit(void);
 
 #endif // SATORI_OBJECT_H
@@ -1,24 +1,14 @@
 // src/core/table.c - Hash table implementation
 
-#define _POSIX_C_SOURCE 200809L
-
 #include "table.h"
-#include <stdlib.h>
+#include "hash.h"
+#include "memory.h"
 #include <string.h>
 
-// FNV-1a hash function
-static u32 hash_string(const char *key) {
-  u32 hash = 2166136261u;
-  for (int i = 0; key[i] != '\0'; i++) {
-    hash ^= (u8)key[i];
-    hash *= 16777619;
-  }
-  return hash;
-}
-
 // Find entry in table (for get, set, delete)
-static Entry *find_entry(Entry *entries, int capacity, const char *key) {
-  u32 index = hash_string(key) % capacity;
+static Entry *find_entry(Entry *entries, int capacity, const char *key, u32 hash) {
+  u32 mask = (u32)capacity - 1;
+  u32 index = hash & mask;
   
   for (;;) {
     Entry *entry = &entries[index];
@@ -26,39 +16,35 @@ static Entry *find_entry(Entry *entries, int capacity, const char *key) {
     if (entry->key == NULL) {
       // Empty slot
       return entry;
-    } else if (strcmp(entry->key, key) == 0) {
+    } else if (entry->hash == hash && strcmp(entry->key, key) == 0) {
       // Key matches
       return entry;
     }
     
     // Collision, linear probing
-    index = (index + 1) % capacity;
+    index = (index + 1) & mask;
   }
 }
 
 // Grow table capacity
 static void adjust_capacity(Table *table, int capacity) {
-  Entry *entries = calloc(capacity, sizeof(Entry));
-  
-  // Initialize all entries
-  for (int i = 0; i < capacity; i++) {
-    entries[i].key = NULL;
-  }
+  Entry *entries = mem_alloc(sizeof(Entry) * capacity);
+  memset(entries, 0, sizeof(Entry) * capacity);
+  u32 mask = (u32)capacity - 1;
   
-  // Rehash existing entries
-  table->count = 0;
+  // Reinsert existing entries by their cached hashes; keys are distinct,
+  // so each goes in the first free slot
   for (int i = 0; i < table->capacity; i++) {
     Entry *entry = &table->entries[i];
     if (entry->key == NULL) continue;
     
-    Entry *dest = find_entry(entries, capacity, entry->key);
-    dest->key = entry->key;
-    dest->value = entry->value;
-    table->count++;
+    u32 index = entry->hash & mask;
+    while (entries[index].key != NULL) index = (index + 1) & mask;
+    entries[index] = *entry;
   }
   
   // Free old array
-  free(table->entries);
+  mem_free(table->entries);
   table->entries = entries;
   table->capacity = capacity;
 }
@@ -70,20 +56,20 @@ void table_init(Table *table) {
 }
 
 void table_free(Table *table) {
-  // Free all keys (they are strdup'd)
+  // Free all keys (they are copied in)
   for (int i = 0; i < table->capacity; i++) {
     if (table->entries[i].key != NULL) {
-      free(table->entries[i].key);
+      mem_free(table->entries[i].key);
     }
   }
-  free(table->entries);
+  mem_free(table->entries);
   table_init(table);
 }
 
 bool table_get(Table *table, const char *key, Value *value) {
   if (table->count == 0) return false;
   
-  Entry *entry = find_entry(table->entries, table->capacity, key);
+  Entry *entry = find_entry(table->entries, table->capacity, key, hash_key(key, strlen(key)));
   if (entry->key == NULL) return false;
   
   *value = entry->value;
@@ -97,11 +83,15 @@ bool table_set(Table *table, const char *key, Value value) {
     adjust_capacity(table, capacity);
   }
   
-  Entry *entry = find_entry(table->entries, table->capacity, key);
+  u32 hash = hash_key(key, strlen(key));
+  Entry *entry = find_entry(table->entries, table->capacity, key, hash);
   bool is_new_key = (entry->key == NULL);
   
   if (is_new_key) {
-    entry->key = strdup(key);
+    size_t length = strlen(key);
+    entry->key = mem_alloc(length + 1);
+    memcpy(entry->key, key, length + 1);
+    entry->hash = hash;
     table->count++;
   }
   
@@ -112,13 +102,24 @@ bool table_set(Table *table, const char *key, Value value) {
 bool table_delete(Table *table, const char *key) {
   if (table->count == 0) return false;
   
-  Entry *entry = find_entry(table->entries, table->capacity, key);
+  Entry *entry = find_entry(table->entries, table->capacity, key, hash_key(key, strlen(key)));
   if (entry->key == NULL) return false;
   
-  // Free the key and mark as deleted
-  free(entry->key);
-  entry->key = NULL;
-  entry->value = value_make_nil();
+  mem_free(entry->key);
+  
+  // Shift later entries of the probe run back over the hole, so lookups
+  // for them never stop early at an empty slot
+  u32 mask = (u32)table->capacity - 1;
+  u32 hole = (u32)(entry - table->entries);
+  for (u32 i = (hole + 1) & mask; table->entries[i].key != NULL; i = (i + 1) & mask) {
+    u32 home = table->entries[i].hash & mask;
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      table->entries[hole] = table->entries[i];
+      hole = i;
+    }
+  }
+  table->entries[hole].key = NULL;
+  table->entries[hole].value = value_make_nil();
   table->count--;
   
   return true;
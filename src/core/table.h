@@ -12,13 +12,14 @@
 // Hash table entry
 typedef struct {
   char *key;      // NULL means empty slot
+  u32 hash;       // hash_key of key, so growing never rehashes
   Value value;
 } Entry;
 
 // Hash table structure
 typedef struct {
   int count;      // Number of entries
-  int capacity;   // Total slots
+  int capacity;   // Total slots, a power of two
   Entry *entries; // Array of entries
 } Table;
 
@@ -0,0 +1,132 @@
+// src/core/utf8.c - UTF-8 validation and code-point counting
+//
+// Most text is mostly ASCII, so each function runs 16 bytes at a time
+// with SSE2 over ASCII stretches and only decodes the bytes in between.
+// Without SSE2, ASCII is checked a machine word at a time.
+
+#include "utf8.h"
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define HIGH_BITS 0x8080808080808080ull
+
+static inline int lowest_bit(u32 x) {
+#ifdef __GNUC__
+  return __builtin_ctz(x);
+#else
+  int n = 0;
+  while (!(x & 1)) {
+    x >>= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+bool utf8_is_ascii(const char *chars, int length) {
+  int i = 0;
+#ifdef __SSE2__
+  for (; i + 64 <= length; i += 64) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(chars + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(chars + i + 16));
+    __m128i c = _mm_loadu_si128((const __m128i*)(chars + i + 32));
+    __m128i d = _mm_loadu_si128((const __m128i*)(chars + i + 48));
+    __m128i any = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+    if (_mm_movemask_epi8(any) != 0) return false;
+  }
+  for (; i + 16 <= length; i += 16) {
+    if (_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(chars + i))) != 0) return false;
+  }
+#else
+  for (; i + 8 <= length; i += 8) {
+    u64 word;
+    memcpy(&word, chars + i, sizeof(word));
+    if (word & HIGH_BITS) return false;
+  }
+#endif
+  u8 bits = 0;
+  for (; i < length; i++) bits |= (u8)chars[i];
+  return bits < 0x80;
+}
+
+// Index of the first non-ASCII byte at or after i, or length
+static inline int skip_ascii(const char *chars, int i, int length) {
+#ifdef __SSE2__
+  for (; i + 16 <= length; i += 16) {
+    int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(chars + i)));
+    if (mask != 0) return i + lowest_bit((u32)mask);
+  }
+#else
+  for (; i + 8 <= length; i += 8) {
+    u64 word;
+    memcpy(&word, chars + i, sizeof(word));
+    if (word & HIGH_BITS) break;
+  }
+#endif
+  while (i < length && (u8)chars[i] < 0x80) i++;
+  return i;
+}
+
+bool utf8_validate(const char *chars, int length) {
+  const u8 *s = (const u8*)chars;
+  int i = 0;
+  for (;;) {
+    i = skip_ascii(chars, i, length);
+    if (i >= length) return true;
+
+    // Decode every sequence up to the next ASCII byte
+    while (i < length && s[i] >= 0x80) {
+      u8 lead = s[i];
+      if (lead < 0xC2) return false;  // Stray continuation or overlong 2-byte form
+      if (lead < 0xE0) {
+        if (i + 1 >= length || !utf8_is_continuation(s[i + 1])) return false;
+        i += 2;
+      } else if (lead < 0xF0) {
+        if (i + 2 >= length || !utf8_is_continuation(s[i + 1]) ||
+            !utf8_is_continuation(s[i + 2])) {
+          return false;
+        }
+        if (lead == 0xE0 && s[i + 1] < 0xA0) return false;  // Overlong
+        if (lead == 0xED && s[i + 1] > 0x9F) return false;  // Surrogate
+        i += 3;
+      } else if (lead < 0xF5) {
+        if (i + 3 >= length || !utf8_is_continuation(s[i + 1]) ||
+            !utf8_is_continuation(s[i + 2]) || !utf8_is_continuation(s[i + 3])) {
+          return false;
+        }
+        if (lead == 0xF0 && s[i + 1] < 0x90) return false;  // Overlong
+        if (lead == 0xF4 && s[i + 1] > 0x8F) return false;  // Above U+10FFFF
+        i += 4;
+      } else {
+        return false;
+      }
+    }
+  }
+}
+
+int utf8_count(const char *chars, int length) {
+  int count = 0;
+  int i = 0;
+#ifdef __SSE2__
+  // Continuation bytes are the only ones below -64 as signed chars. Per-lane
+  // counters are summed every 255 blocks, before they can overflow.
+  const __m128i threshold = _mm_set1_epi8(-65);
+  const __m128i zero = _mm_setzero_si128();
+  while (i + 16 <= length) {
+    int blocks = (length - i) / 16;
+    if (blocks > 255) blocks = 255;
+    __m128i counters = zero;
+    for (int b = 0; b < blocks; b++, i += 16) {
+      __m128i chunk = _mm_loadu_si128((const __m128i*)(chars + i));
+      counters = _mm_sub_epi8(counters, _mm_cmpgt_epi8(chunk, threshold));
+    }
+    __m128i sums = _mm_sad_epu8(counters, zero);
+    count += _mm_cvtsi128_si32(sums) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(sums, sums));
+  }
+#endif
+  for (; i < length; i++) count += !utf8_is_continuation((u8)chars[i]);
+  return count;
+}
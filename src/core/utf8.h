@@ -0,0 +1,26 @@
+// src/core/utf8.h - UTF-8 validation and code-point counting
+//
+// Byte-level helpers behind string indexing. All functions take a byte
+// range and never read past it.
+
+#ifndef SATORI_UTF8_H
+#define SATORI_UTF8_H
+
+#include "common.h"
+
+// True if every byte is below 0x80
+bool utf8_is_ascii(const char *chars, int length);
+
+// True if the bytes are well-formed UTF-8: no overlong forms, surrogates,
+// code points above U+10FFFF, or truncated sequences
+bool utf8_validate(const char *chars, int length);
+
+// Number of code points (bytes that are not continuation bytes)
+int utf8_count(const char *chars, int length);
+
+// True for bytes 0x80-0xBF, which never start a code point
+static inline bool utf8_is_continuation(u8 byte) {
+  return (byte & 0xC0) == 0x80;
+}
+
+#endif // SATORI_UTF8_H
@@ -4,6 +4,7 @@
 
 #include "value.h"
 #include "object.h"
+#include "memory.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -36,9 +37,22 @@ Value value_make_float(f64 val) {
 }
 
 Value value_make_string(const char *str) {
+  return value_copy_string(str, (int)strlen(str));
+}
+
+Value value_copy_string(const char *chars, int length) {
   Value v;
+  if (length <= VALUE_SHORT_MAX) {
+    v.type = VALUE_SHORT_STRING;
+    char *inline_chars = AS_STRING(v);
+    memcpy(inline_chars, chars, length);
+    inline_chars[length] = '\0';
+    return v;
+  }
   v.type = VALUE_STRING;
-  v.u.as_string = strdup(str);
+  v.u.as_string = mem_alloc(length + 1);
+  memcpy(v.u.as_string, chars, length);
+  v.u.as_string[length] = '\0';
   return v;
 }
 
@@ -57,6 +71,13 @@ Value value_make_obj(Object *obj) {
 }
 
 bool value_equal(Value a, Value b) {
+  // Strings compare by contents, whatever their representation
+  const char *a_chars, *b_chars;
+  int a_length, b_length;
+  if (value_get_string(&a, &a_chars, &a_length) && value_get_string(&b, &b_chars, &b_length)) {
+    return a_length == b_length && memcmp(a_chars, b_chars, a_length) == 0;
+  }
+
   if (a.type != b.type) return false;
   
   switch (a.type) {
@@ -90,6 +111,7 @@ void value_print(Value value) {
       printf("%g", AS_FLOAT(value));
       break;
     case VALUE_STRING:
+    case VALUE_SHORT_STRING:
       printf("%s", AS_STRING(value));
       break;
     case VALUE_NATIVE_FN:
@@ -101,10 +123,46 @@ void value_print(Value value) {
   }
 }
 
+int value_format(Value value, char *buffer, int size) {
+  switch (value.type) {
+    case VALUE_NIL:
+      return snprintf(buffer, size, "nil");
+    case VALUE_BOOL:
+      return snprintf(buffer, size, "%s", AS_BOOL(value) ? "true" : "false");
+    case VALUE_INT:
+      return snprintf(buffer, size, "%lld", (long long)AS_INT(value));
+    case VALUE_FLOAT:
+      return snprintf(buffer, size, "%g", AS_FLOAT(value));
+    case VALUE_STRING:
+    case VALUE_SHORT_STRING:
+      return snprintf(buffer, size, "%s", AS_STRING(value));
+    case VALUE_NATIVE_FN:
+      return snprintf(buffer, size, "<native fn>");
+    case VALUE_OBJ:
+      return object_format(AS_OBJ(value), buffer, size);
+  }
+  return 0;
+}
+
 void value_free(Value value) {
-  // Free string memory
+  // Free string memory; short strings have none
   if (value.type == VALUE_STRING) {
-    free(value.u.as_string);
+    mem_free(value.u.as_string);
   }
   // Objects are freed by GC
 }
+
+bool value_get_string(const Value *value, const char **chars, int *length) {
+  if (IS_STRING(*value)) {
+    *chars = AS_STRING(*value);
+    *length = (int)strlen(*chars);
+    return true;
+  }
+  if (IS_OBJ_STRING(*value)) {
+    ObjString *str = AS_OBJ_STRING(*value);
+    *chars = str->chars;
+    *length = str->length;
+    return true;
+  }
+  return false;
+}
@@ -18,13 +18,19 @@ typedef enum {
   VALUE_INT,
   VALUE_FLOAT,
   VALUE_STRING,      // Simple string (for now, will use ObjString later)
+  VALUE_SHORT_STRING, // String of up to VALUE_SHORT_MAX bytes, held inline
   VALUE_NATIVE_FN,   // Native C function
   VALUE_OBJ,         // Heap-allocated object
 } ValueType;
 
+// Longest string kept inside the Value itself. Its bytes and terminating
+// NUL fill everything after the type byte, running on into `u`.
+#define VALUE_SHORT_MAX 14
+
 // Tagged union value
 struct Value {
-  ValueType type;
+  u8 type;           // ValueType
+  char short_chars[7];  // Start of a VALUE_SHORT_STRING
   union {
     bool as_bool;
     i64 as_int;
@@ -32,6 +38,7 @@ struct Value {
     char *as_string;  // For VALUE_STRING
     NativeFn as_native_fn;  // For VALUE_NATIVE_FN
     Object *as_obj;   // For VALUE_OBJ
+    char as_short_tail[8];  // Rest of a VALUE_SHORT_STRING
   } u;
 };
 
@@ -41,15 +48,23 @@ struct Value {
 #define IS_INT(value)       ((value).type == VALUE_INT)
 #define IS_FLOAT(value)     ((value).type == VALUE_FLOAT)
 #define IS_NUMBER(value)    (IS_INT(value) || IS_FLOAT(value))
-#define IS_STRING(value)    ((value).type == VALUE_STRING)
+#define IS_SHORT_STRING(value) ((value).type == VALUE_SHORT_STRING)
+#define IS_STRING(value)    ((value).type == VALUE_STRING || IS_SHORT_STRING(value))
 #define IS_NATIVE_FN(value) ((value).type == VALUE_NATIVE_FN)
 #define IS_OBJ(value)       ((value).type == VALUE_OBJ)
 
-// Value extraction macros
+// NUL-terminated text of a VALUE_STRING or short string. A short string's
+// bytes live in the Value, so the pointer is only good while *value is.
+static inline char *value_string_chars(const Value *value) {
+  return value->type == VALUE_SHORT_STRING ? (char*)value + offsetof(Value, short_chars)
+                                           : value->u.as_string;
+}
+
+// Value extraction macros. AS_STRING needs an lvalue.
 #define AS_BOOL(value)      ((value).u.as_bool)
 #define AS_INT(value)       ((value).u.as_int)
 #define AS_FLOAT(value)     ((value).u.as_float)
-#define AS_STRING(value)    ((value).u.as_string)
+#define AS_STRING(value)    value_string_chars(&(value))
 #define AS_NATIVE_FN(value) ((value).u.as_native_fn)
 #define AS_OBJ(value)       ((value).u.as_obj)
 
@@ -59,6 +74,7 @@ Value value_make_bool(bool val);
 Value value_make_int(i64 val);
 Value value_make_float(f64 val);
 Value value_make_string(const char *str);
+Value value_copy_string(const char *chars, int length);  // Need not be NUL-terminated
 Value value_make_native_fn(NativeFn fn);
 Value value_make_obj(Object *obj);
 
@@ -68,6 +84,15 @@ f64 value_to_float(Value v);  // Convert int or float to float
 void value_print(Value value);
 void value_free(Value value);  // Free if needed
 
+// Text of a value as value_print would show it, snprintf-style: writes at
+// most `size` bytes (NUL-terminated if size > 0) and returns the full length
+int value_format(Value value, char *buffer, int size);
+
+// View the bytes of a VALUE_STRING, short string or string object. Returns
+// false for anything else. Short strings are viewed in place, so the bytes
+// last only as long as *value does.
+bool value_get_string(const Value *value, const char **chars, int *length);
+
 // Constants
 #define NIL_VAL         value_make_nil()
 #define BOOL_VAL(b)     value_make_bool(b)
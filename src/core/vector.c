@@ -0,0 +1,260 @@
+// src/core/vector.c - Persistent vector implementation
+//
+// The layout follows Clojure's PersistentVector. Index i lives in the
+// tail when i >= tailoff (the last multiple of 32 at or below count - 1),
+// otherwise in the trie: each branch level takes 5 bits of i, from
+// `shift` down to 5, and the last 5 bits pick the item in the leaf.
+//
+// Persistent updates run with edit 0 and copy every node they change.
+// Transients run with their own edit token and copy a node only if it is
+// not yet stamped with that token; after that it is theirs to change.
+
+#include "vector.h"
+#include "gc.h"
+#include "memory.h"
+#include <stddef.h>
+#include <string.h>
+
+#define LEAF_SIZE (offsetof(VecNode, as) + sizeof(Value) * VEC_WIDTH)
+#define BRANCH_SIZE (offsetof(VecNode, as) + sizeof(VecNode*) * VEC_WIDTH)
+
+// Shared by every empty vector; never changed since its edit is 0, and
+// never freed since no heap tracks it
+static VecNode empty_branch = {{OBJ_VEC_BRANCH, false, false, NULL}, 0, {{NULL}}};
+static VecNode empty_leaf = {{OBJ_VEC_LEAF, false, false, NULL}, 0, {{NULL}}};
+
+static VecNode *node_alloc(bool leaf) {
+  VecNode *node = mem_alloc(leaf ? LEAF_SIZE : BRANCH_SIZE);
+  node->obj.type = leaf ? OBJ_VEC_LEAF : OBJ_VEC_BRANCH;
+  node->obj.is_marked = false;
+  node->obj.next = NULL;
+  gc_track(&node->obj);
+  return node;
+}
+
+// Leaves start out nil, as the collector reads every slot of one
+static VecNode *node_new(u64 edit, bool leaf) {
+  VecNode *node = node_alloc(leaf);
+  node->edit = edit;
+  if (leaf) {
+    for (int i = 0; i < VEC_WIDTH; i++) node->as.items[i] = value_make_nil();
+  } else {
+    memset(node->as.children, 0, sizeof(node->as.children));
+  }
+  return node;
+}
+
+// `node` if the transient owns it, else a copy it owns
+static VecNode *editable(u64 edit, VecNode *node, bool leaf) {
+  if (edit != 0 && node->edit == edit) return node;
+  VecNode *copy = node_alloc(leaf);
+  memcpy(&copy->edit, &node->edit, (leaf ? LEAF_SIZE : BRANCH_SIZE) - offsetof(VecNode, edit));
+  copy->edit = edit;
+  return copy;
+}
+
+static int tail_offset(ObjVector *vector) {
+  return vector->count < VEC_WIDTH ? 0 : ((vector->count - 1) >> VEC_BITS) << VEC_BITS;
+}
+
+static ObjVector *vector_alloc(void) {
+  ObjVector *vector = (ObjVector*)mem_alloc(sizeof(ObjVector));
+  vector->obj.type = OBJ_VECTOR;
+  vector->obj.is_marked = false;
+  vector->obj.next = NULL;
+  gc_track(&vector->obj);
+  return vector;
+}
+
+// Header to update: the transient itself, or a copy of a persistent one
+static ObjVector *target(ObjVector *vector) {
+  if (vector->edit != 0) return vector;
+  ObjVector *copy = vector_alloc();
+  copy->count = vector->count;
+  copy->shift = vector->shift;
+  copy->root = vector->root;
+  copy->tail = vector->tail;
+  copy->edit = 0;
+  return copy;
+}
+
+ObjVector *vector_make(void) {
+  ObjVector *vector = vector_alloc();
+  vector->count = 0;
+  vector->shift = VEC_BITS;
+  vector->root = &empty_branch;
+  vector->tail = &empty_leaf;
+  vector->edit = 0;
+  return vector;
+}
+
+ObjVector *vector_from(const Value *items, int count) {
+  ObjVector *vector = vector_transient(vector_make());
+  for (int i = 0; i < count; i++) vector_push(vector, items[i]);
+  return vector_freeze(vector);
+}
+
+// Leaf holding index `index`
+static VecNode *leaf_for(ObjVector *vector, int index) {
+  if (index >= tail_offset(vector)) return vector->tail;
+  VecNode *node = vector->root;
+  for (int level = vector->shift; level > 0; level -= VEC_BITS) {
+    node = node->as.children[(index >> level) & VEC_MASK];
+  }
+  return node;
+}
+
+Value vector_get(ObjVector *vector, int index) {
+  return leaf_for(vector, index)->as.items[index & VEC_MASK];
+}
+
+// ============================================================================
+// Push
+// ============================================================================
+
+// A chain of branches from `level` down to `leaf`
+static VecNode *new_path(u64 edit, int level, VecNode *leaf) {
+  if (level == 0) return leaf;
+  VecNode *branch = node_new(edit, false);
+  branch->as.children[0] = new_path(edit, level - VEC_BITS, leaf);
+  return branch;
+}
+
+// Hang a full tail leaf in the trie, for a vector of `count` items
+static VecNode *push_tail(u64 edit, int count, int level, VecNode *parent, VecNode *leaf) {
+  VecNode *node = editable(edit, parent, false);
+  int sub = ((count - 1) >> level) & VEC_MASK;
+  if (level == VEC_BITS) {
+    node->as.children[sub] = leaf;
+  } else {
+    VecNode *child = parent->as.children[sub];
+    node->as.children[sub] = child != NULL
+                                 ? push_tail(edit, count, level - VEC_BITS, child, leaf)
+                                 : new_path(edit, level - VEC_BITS, leaf);
+  }
+  return node;
+}
+
+ObjVector *vector_push(ObjVector *vector, Value value) {
+  ObjVector *out = target(vector);
+  u64 edit = out->edit;
+  int in_tail = vector->count - tail_offset(vector);
+
+  if (in_tail < VEC_WIDTH) {
+    out->tail = editable(edit, vector->tail, true);
+    out->tail->as.items[in_tail] = value;
+    out->count++;
+    return out;
+  }
+
+  // The tail is full: move it into the trie, adding a level if the root
+  // has no room left
+  if ((vector->count >> VEC_BITS) > (1 << vector->shift)) {
+    VecNode *root = node_new(edit, false);
+    root->as.children[0] = vector->root;
+    root->as.children[1] = new_path(edit, vector->shift, vector->tail);
+    out->root = root;
+    out->shift = vector->shift + VEC_BITS;
+  } else {
+    out->root = push_tail(edit, vector->count, vector->shift, vector->root, vector->tail);
+  }
+  out->tail = node_new(edit, true);
+  out->tail->as.items[0] = value;
+  out->count++;
+  return out;
+}
+
+// ============================================================================
+// Set
+// ============================================================================
+
+static VecNode *set_in(u64 edit, int level, VecNode *node, int index, Value value) {
+  VecNode *copy = editable(edit, node, level == 0);
+  if (level == 0) {
+    copy->as.items[index & VEC_MASK] = value;
+  } else {
+    int sub = (index >> level) & VEC_MASK;
+    copy->as.children[sub] = set_in(edit, level - VEC_BITS, node->as.children[sub], index, value);
+  }
+  return copy;
+}
+
+ObjVector *vector_set(ObjVector *vector, int index, Value value) {
+  ObjVector *out = target(vector);
+  if (index >= tail_offset(vector)) {
+    out->tail = editable(out->edit, vector->tail, true);
+    out->tail->as.items[index & VEC_MASK] = value;
+  } else {
+    out->root = set_in(out->edit, vector->shift, vector->root, index, value);
+  }
+  return out;
+}
+
+// ============================================================================
+// Pop
+// ============================================================================
+
+// Drop the last leaf of the trie, for a vector of `count` items. Returns
+// NULL when the subtree is left empty.
+static VecNode *pop_tail(u64 edit, int count, int level, VecNode *node) {
+  int sub = ((count - 2) >> level) & VEC_MASK;
+  if (level > VEC_BITS) {
+    VecNode *child = pop_tail(edit, count, level - VEC_BITS, node->as.children[sub]);
+    if (child == NULL && sub == 0) return NULL;
+    VecNode *copy = editable(edit, node, false);
+    copy->as.children[sub] = child;
+    return copy;
+  }
+  if (sub == 0) return NULL;
+  VecNode *copy = editable(edit, node, false);
+  copy->as.children[sub] = NULL;
+  return copy;
+}
+
+ObjVector *vector_pop(ObjVector *vector) {
+  ObjVector *out = target(vector);
+  if (vector->count == 1) {
+    out->count = 0;
+    out->shift = VEC_BITS;
+    out->root = &empty_branch;
+    out->tail = &empty_leaf;
+    return out;
+  }
+  if (vector->count - tail_offset(vector) > 1) {
+    // Items past count are never read, so the tail is shared as it is;
+    // until overwritten they only stay alive a little longer
+    out->count--;
+    return out;
+  }
+
+  // The tail empties: the trie's last leaf takes its place
+  out->tail = leaf_for(vector, vector->count - 2);
+  VecNode *root = pop_tail(out->edit, vector->count, vector->shift, vector->root);
+  int shift = vector->shift;
+  if (root == NULL) root = &empty_branch;
+  if (shift > VEC_BITS && root->as.children[1] == NULL) {
+    root = root->as.children[0];
+    shift -= VEC_BITS;
+  }
+  out->root = root;
+  out->shift = shift;
+  out->count--;
+  return out;
+}
+
+// ============================================================================
+// Transients
+// ============================================================================
+
+ObjVector *vector_transient(ObjVector *vector) {
+  if (vector->edit != 0) return vector;
+  ObjVector *transient = target(vector);
+  transient->edit = transient_edit();
+  return transient;
+}
+
+ObjVector *vector_freeze(ObjVector *vector) {
+  // Its token is never handed out again, so no one changes its nodes now
+  vector->edit = 0;
+  return vector;
+}
@@ -0,0 +1,60 @@
+// src/core/vector.h - Persistent vectors
+
+#ifndef SATORI_VECTOR_H
+#define SATORI_VECTOR_H
+
+#include "common.h"
+#include "object.h"
+
+#define VEC_BITS 5
+#define VEC_WIDTH (1 << VEC_BITS)
+#define VEC_MASK (VEC_WIDTH - 1)
+
+// Trie node, an object of its own (OBJ_VEC_LEAF or OBJ_VEC_BRANCH) so
+// that versions sharing it keep it alive and the collector frees it with
+// the last. Leaves hold items, branches hold children; each is allocated
+// only as large as its half of the union. `edit` names the transient that
+// may change the node in place, or is 0.
+typedef struct VecNode {
+  Object obj;
+  u64 edit;
+  union {
+    struct VecNode *children[VEC_WIDTH];
+    Value items[VEC_WIDTH];
+  } as;
+} VecNode;
+
+// Persistent vector: a 32-way radix trie of leaves plus a tail leaf kept
+// out of the trie, so pushes and pops at the end rarely touch the trie.
+// Updates copy only the path to the changed leaf and share the rest.
+//
+// A transient vector (edit != 0) is updated in place, copying a node only
+// the first time it changes it.
+typedef struct {
+  Object obj;
+  int count;
+  int shift;       // Index bits consumed above the leaves, a multiple of VEC_BITS
+  VecNode *root;
+  VecNode *tail;   // Items from the last multiple of VEC_WIDTH on
+  u64 edit;
+} ObjVector;
+
+#define IS_VECTOR(value)  (IS_OBJ(value) && OBJ_TYPE(value) == OBJ_VECTOR)
+#define AS_VECTOR(value)  ((ObjVector*)AS_OBJ(value))
+
+ObjVector *vector_make(void);
+ObjVector *vector_from(const Value *items, int count);
+Value vector_get(ObjVector *vector, int index);
+
+// Updates return a new vector, or change a transient in place and return
+// it. Indexes must be in range; pop needs a non-empty vector.
+ObjVector *vector_push(ObjVector *vector, Value value);
+ObjVector *vector_set(ObjVector *vector, int index, Value value);
+ObjVector *vector_pop(ObjVector *vector);
+
+// A transient copy (a transient is returned as is), and back. Freezing
+// makes the transient itself persistent.
+ObjVector *vector_transient(ObjVector *vector);
+ObjVector *vector_freeze(ObjVector *vector);
+
+#endif // SATORI_VECTOR_H
@@ -88,6 +88,61 @@ AstNode *ast_make_while(AstNode *condition, AstNode *body, int line, int column)
   return node;
 }
 
+AstNode *ast_make_match(AstNode *subject, MatchArm *arms, int arm_count, int line, int column) {
+  AstNode *node = malloc(sizeof(AstNode));
+  node->type = AST_MATCH;
+  node->line = line;
+  node->column = column;
+  node->as.match.subject = subject;
+  node->as.match.arms = arms;
+  node->as.match.arm_count = arm_count;
+  return node;
+}
+
+AstNode *ast_make_for(char *index_name, char *item_name, AstNode *iterable,
+                      AstNode *body, int line, int column) {
+  AstNode *node = malloc(sizeof(AstNode));
+  node->type = AST_FOR;
+  node->line = line;
+  node->column = column;
+  node->as.for_loop.index_name = index_name ? strdup(index_name) : NULL;
+  node->as.for_loop.item_name = strdup(item_name);
+  node->as.for_loop.iterable = iterable;
+  node->as.for_loop.body = body;
+  return node;
+}
+
+AstNode *ast_make_range(AstNode *start, AstNode *end, int line, int column) {
+  AstNode *node = malloc(sizeof(AstNode));
+  node->type = AST_RANGE;
+  node->line = line;
+  node->column = column;
+  node->as.range.start = start;
+  node->as.range.end = end;
+  return node;
+}
+
+AstNode *ast_make_pipeline(AstNode *source, AstNode **stages, int stage_count, int line,
+                           int column) {
+  AstNode *node = malloc(sizeof(AstNode));
+  node->type = AST_PIPELINE;
+  node->line = line;
+  node->column = column;
+  node->as.pipeline.source = source;
+  node->as.pipeline.stages = stages;
+  node->as.pipeline.stage_count = stage_count;
+  return node;
+}
+
+AstNode *ast_make_comptime(AstNode *expr, int line, int column) {
+  AstNode *node = malloc(sizeof(AstNode));
+  node->type = AST_COMPTIME;
+  node->line = line;
+  node->column = column;
+  node->as.comptime.expr = expr;
+  return node;
+}
+
 AstNode *ast_make_loop(AstNode *body, int line, int column) {
   AstNode *node = malloc(sizeof(AstNode));
   node->type = AST_LOOP;
@@ -176,6 +231,17 @@ AstNode *ast_make_string_literal(char *value, int line, int column) {
   return node;
 }
 
+AstNode *ast_make_interpolation(AstNode **parts, int part_count, int line,
+                                int column) {
+  AstNode *node = malloc(sizeof(AstNode));
+  node->type = AST_INTERPOLATION;
+  node->line = line;
+  node->column = column;
+  node->as.interpolation.parts = parts;
+  node->as.interpolation.part_count = part_count;
+  return node;
+}
+
 AstNode *ast_make_int_literal(i64 value, int line, int column) {
   AstNode *node = malloc(sizeof(AstNode));
   node->type = AST_INT_LITERAL;
@@ -245,6 +311,36 @@ void ast_free(AstNode *node) {
     ast_free(node->as.while_loop.condition);
     ast_free(node->as.while_loop.body);
     break;
+  case AST_MATCH:
+    ast_free(node->as.match.subject);
+    for (int i = 0; i < node->as.match.arm_count; i++) {
+      MatchArm *arm = &node->as.match.arms[i];
+      for (int j = 0; j < arm->pattern_count; j++) ast_free(arm->patterns[j]);
+      free(arm->patterns);
+      ast_free(arm->body);
+    }
+    free(node->as.match.arms);
+    break;
+  case AST_FOR:
+    free(node->as.for_loop.index_name);
+    free(node->as.for_loop.item_name);
+    ast_free(node->as.for_loop.iterable);
+    ast_free(node->as.for_loop.body);
+    break;
+  case AST_RANGE:
+    ast_free(node->as.range.start);
+    ast_free(node->as.range.end);
+    break;
+  case AST_PIPELINE:
+    ast_free(node->as.pipeline.source);
+    for (int i = 0; i < node->as.pipeline.stage_count; i++) {
+      ast_free(node->as.pipeline.stages[i]);
+    }
+    free(node->as.pipeline.stages);
+    break;
+  case AST_COMPTIME:
+    ast_free(node->as.comptime.expr);
+    break;
   case AST_LOOP:
     ast_free(node->as.loop.body);
     break;
@@ -275,6 +371,12 @@ void ast_free(AstNode *node) {
   case AST_STRING_LITERAL:
     free(node->as.string_literal.value);
     break;
+  case AST_INTERPOLATION:
+    for (int i = 0; i < node->as.interpolation.part_count; i++) {
+      ast_free(node->as.interpolation.parts[i]);
+    }
+    free(node->as.interpolation.parts);
+    break;
   default:
     break;
   }
@@ -320,6 +422,17 @@ void ast_print(AstNode *node, int indent) {
     ast_print(node->as.unary_op.operand, indent + 1);
     break;
   }
+  case AST_MATCH:
+    printf("Match\n");
+    ast_print(node->as.match.subject, indent + 1);
+    for (int i = 0; i < node->as.match.arm_count; i++) {
+      MatchArm *arm = &node->as.match.arms[i];
+      for (int j = 0; j < indent + 1; j++) printf("  ");
+      printf("Arm:\n");
+      for (int j = 0; j < arm->pattern_count; j++) ast_print(arm->patterns[j], indent + 2);
+      ast_print(arm->body, indent + 2);
+    }
+    break;
   case AST_IF:
     printf("If\n");
     for (int i = 0; i < indent + 1; i++) printf("  ");
@@ -343,6 +456,35 @@ void ast_print(AstNode *node, int indent) {
     printf("Body:\n");
     ast_print(node->as.while_loop.body, indent + 2);
     break;
+  case AST_FOR:
+    if (node->as.for_loop.index_name) {
+      printf("For: %s, %s in\n", node->as.for_loop.index_name, node->as.for_loop.item_name);
+    } else {
+      printf("For: %s in\n", node->as.for_loop.item_name);
+    }
+    ast_print(node->as.for_loop.iterable, indent + 2);
+    for (int i = 0; i < indent + 1; i++) printf("  ");
+    printf("Body:\n");
+    ast_print(node->as.for_loop.body, indent + 2);
+    break;
+  case AST_RANGE:
+    printf("Range\n");
+    ast_print(node->as.range.start, indent + 1);
+    ast_print(node->as.range.end, indent + 1);
+    break;
+  case AST_PIPELINE:
+    printf("Pipeline\n");
+    ast_print(node->as.pipeline.source, indent + 1);
+    for (int i = 0; i < node->as.pipeline.stage_count; i++) {
+      for (int j = 0; j < indent + 1; j++) printf("  ");
+      printf("|>\n");
+      ast_print(node->as.pipeline.stages[i], indent + 2);
+    }
+    break;
+  case AST_COMPTIME:
+    printf("Comptime\n");
+    ast_print(node->as.comptime.expr, indent + 1);
+    break;
   case AST_LOOP:
     printf("Loop\n");
     ast_print(node->as.loop.body, indent + 1);
@@ -376,6 +518,12 @@ void ast_print(AstNode *node, int indent) {
   case AST_STRING_LITERAL:
     printf("String: %s\n", node->as.string_literal.value);
     break;
+  case AST_INTERPOLATION:
+    printf("Interpolation\n");
+    for (int i = 0; i < node->as.interpolation.part_count; i++) {
+      ast_print(node->as.interpolation.parts[i], indent + 1);
+    }
+    break;
   case AST_INT_LITERAL:
     printf("Int: %ld\n", node->as.int_literal.value);
     break;
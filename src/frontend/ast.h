@@ -15,6 +15,11 @@ typedef enum {
   AST_UNARY_OP,      // Unary operation (-x, !x)
   AST_IF,            // If statement
   AST_WHILE,         // While loop
+  AST_MATCH,         // match subject, then pattern: statement arms
+  AST_FOR,           // For loop over a range or collection
+  AST_RANGE,         // start..end, in a for loop or pipeline
+  AST_PIPELINE,      // source |> stage |> ...
+  AST_COMPTIME,      // comptime expr, evaluated by the compiler
   AST_LOOP,          // Infinite loop
   AST_BREAK,         // Break statement
   AST_CONTINUE,      // Continue statement
@@ -23,6 +28,7 @@ typedef enum {
   AST_MEMBER_ACCESS,
   AST_IDENTIFIER,
   AST_STRING_LITERAL,
+  AST_INTERPOLATION, // "text {expr} text"
   AST_INT_LITERAL,
   AST_FLOAT_LITERAL,
 } AstNodeType;
@@ -99,6 +105,44 @@ typedef struct {
   AstNode *body;
 } AstWhile;
 
+// One `pattern, pattern: body` arm. A pattern is an int or string
+// literal, an AST_RANGE of int literals, or the identifier `_`.
+typedef struct {
+  AstNode **patterns;
+  int pattern_count;
+  AstNode *body;
+} MatchArm;
+
+typedef struct {
+  AstNode *subject;
+  MatchArm *arms;
+  int arm_count;
+} AstMatch;
+
+// for item in iterable / for index, item in iterable / for i in start..end
+typedef struct {
+  char *index_name;   // First of two loop variables, or NULL
+  char *item_name;
+  AstNode *iterable;  // A collection, or an AST_RANGE
+  AstNode *body;
+} AstFor;
+
+typedef struct {
+  AstNode *start;
+  AstNode *end;       // Exclusive
+} AstRange;
+
+// Each stage is a call (or a bare name), applied to the value so far
+typedef struct {
+  AstNode *source;
+  AstNode **stages;
+  int stage_count;
+} AstPipeline;
+
+typedef struct {
+  AstNode *expr;
+} AstComptime;
+
 typedef struct {
   AstNode *body;
 } AstLoop;
@@ -113,6 +157,11 @@ typedef struct {
   char *value;
 } AstStringLiteral;
 
+typedef struct {
+  AstNode **parts;   // String literals and expressions, in order
+  int part_count;
+} AstInterpolation;
+
 typedef struct {
   i64 value;
 } AstIntLiteral;
@@ -140,12 +189,18 @@ struct AstNode {
     AstUnaryOp unary_op;
     AstIf if_stmt;
     AstWhile while_loop;
+    AstMatch match;
+    AstFor for_loop;
+    AstRange range;
+    AstPipeline pipeline;
+    AstComptime comptime;
     AstLoop loop;
     AstBlock block;
     AstCall call;
     AstMemberAccess member_access;
     AstIdentifier identifier;
     AstStringLiteral string_literal;
+    AstInterpolation interpolation;
     AstIntLiteral int_literal;
     AstFloatLiteral float_literal;
   } as;
@@ -160,6 +215,13 @@ AstNode *ast_make_binary_op(BinaryOperator op, AstNode *left, AstNode *right, in
 AstNode *ast_make_unary_op(UnaryOperator op, AstNode *operand, int line, int column);
 AstNode *ast_make_if(AstNode *condition, AstNode *then_branch, AstNode *else_branch, int line, int column);
 AstNode *ast_make_while(AstNode *condition, AstNode *body, int line, int column);
+AstNode *ast_make_match(AstNode *subject, MatchArm *arms, int arm_count, int line, int column);
+AstNode *ast_make_for(char *index_name, char *item_name, AstNode *iterable,
+                      AstNode *body, int line, int column);
+AstNode *ast_make_range(AstNode *start, AstNode *end, int line, int column);
+AstNode *ast_make_pipeline(AstNode *source, AstNode **stages, int stage_count, int line,
+                           int column);
+AstNode *ast_make_comptime(AstNode *expr, int line, int column);
 AstNode *ast_make_loop(AstNode *body, int line, int column);
 AstNode *ast_make_break(int line, int column);
 AstNode *ast_make_continue(int line, int column);
@@ -171,6 +233,8 @@ AstNode *ast_make_member_access(AstNode *object, char *member, int line,
                                 int column);
 AstNode *ast_make_identifier(char *name, int line, int column);
 AstNode *ast_make_string_literal(char *value, int line, int column);
+AstNode *ast_make_interpolation(AstNode **parts, int part_count, int line,
+                                int column);
 AstNode *ast_make_int_literal(i64 value, int line, int column);
 AstNode *ast_make_float_literal(f64 value, int line, int column);
 
@@ -83,8 +83,41 @@ static void skip_whitespace(Lexer *lexer) {
   }
 }
 
+// Skip an interpolated `{expr}` inside a string literal. The expression may
+// hold braces and string literals of its own; the parser lexes it again.
+static void interpolation(Lexer *lexer) {
+  int depth = 0;
+  bool quoted = false;
+  while (!is_at_end(lexer)) {
+    char c = peek(lexer);
+    if (c == '\n') {
+      lexer->line++;
+      lexer->column = 0;
+    }
+    advance(lexer);
+    if (c == '"') {
+      quoted = !quoted;
+    } else if (!quoted && c == '{') {
+      depth++;
+    } else if (!quoted && c == '}' && --depth == 0) {
+      return;
+    }
+  }
+}
+
 static Token string(Lexer *lexer) {
   while (peek(lexer) != '"' && !is_at_end(lexer)) {
+    if (peek(lexer) == '{') {
+      // `{{` is a literal brace and `{}` a format placeholder
+      char next = peek_next(lexer);
+      if (next == '{' || next == '}') {
+        advance(lexer);
+        advance(lexer);
+        continue;
+      }
+      interpolation(lexer);
+      continue;
+    }
     if (peek(lexer) == '\n') {
       lexer->line++;
       lexer->column = 0;
@@ -125,7 +158,7 @@ static Token number(Lexer *lexer) {
 
 static TokenType check_keyword(const char *start, int length, const char *rest,
                                TokenType type) {
-  if (memcmp(start, rest, length) == 0) {
+  if (length == (int)strlen(rest) && memcmp(start, rest, length) == 0) {
     return type;
   }
   return TOKEN_IDENTIFIER;
@@ -151,7 +184,15 @@ static TokenType identifier_type(Lexer *lexer) {
     }
     break;
   case 'c':
-    return check_keyword(start + 1, length - 1, "ontinue", TOKEN_CONTINUE);
+    if (length > 2 && start[1] == 'o') {
+      switch (start[2]) {
+      case 'm':
+        return check_keyword(start + 3, length - 3, "ptime", TOKEN_COMPTIME);
+      case 'n':
+        return check_keyword(start + 3, length - 3, "tinue", TOKEN_CONTINUE);
+      }
+    }
+    break;
   case 'd':
     return check_keyword(start + 1, length - 1, "efer", TOKEN_DEFER);
   case 'e':
@@ -192,6 +233,8 @@ static TokenType identifier_type(Lexer *lexer) {
       }
     }
     break;
+  case 'm':
+    return check_keyword(start + 1, length - 1, "atch", TOKEN_MATCH);
   case 'n':
     if (length > 1) {
       switch (start[1]) {
@@ -307,7 +350,7 @@ Token lexer_next_token(Lexer *lexer) {
   case '&':
     return make_token(lexer, TOKEN_AMPERSAND);
   case '|':
-    return make_token(lexer, TOKEN_PIPE);
+    return make_token(lexer, match(lexer, '>') ? TOKEN_PIPE_GREATER : TOKEN_PIPE);
   case '^':
     return make_token(lexer, TOKEN_CARET);
   case '!':
@@ -41,6 +41,7 @@ typedef enum {
   TOKEN_GREATER_EQUAL, // >=
   TOKEN_COLON_EQUAL,   // :=
   TOKEN_DOT_DOT,       // ..
+  TOKEN_PIPE_GREATER,  // |>
   TOKEN_ARROW,         // -> (maybe for later, but honestly Ive always hated the arrow operator, I always see it as the struct dereference)
 
   // Literals
@@ -70,6 +71,8 @@ typedef enum {
   TOKEN_DEFER,
   TOKEN_SPAWN,
   TOKEN_PANIC,
+  TOKEN_COMPTIME,
+  TOKEN_MATCH,
   TOKEN_TRUE,
   TOKEN_FALSE,
   TOKEN_NIL,
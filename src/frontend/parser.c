@@ -54,6 +54,8 @@ static char *token_to_string(Token token) {
 
 // Forward declarations for expression parsing
 static AstNode *parse_expression(Parser *p);
+static AstNode *parse_pipeline(Parser *p);
+static AstNode *parse_range(Parser *p);
 static AstNode *parse_equality(Parser *p);
 static AstNode *parse_comparison(Parser *p);
 static AstNode *parse_term(Parser *p);
@@ -64,15 +66,47 @@ static AstNode *parse_primary(Parser *p);
 
 // Expression parsing with precedence climbing
 // Precedence (lowest to highest):
+//   pipeline:     |>
+//   range:        ..
 //   equality:     == !=
 //   comparison:   < <= > >=
 //   term:         + -
 //   factor:       * / %
-//   unary:        - !
+//   unary:        - ! comptime
 //   primary:      literals, identifiers, calls
 
 static AstNode *parse_expression(Parser *p) {
-  return parse_equality(p);
+  return parse_pipeline(p);
+}
+
+// source |> stage |> ..., where each stage is a call or a bare name
+static AstNode *parse_pipeline(Parser *p) {
+  AstNode *expr = parse_range(p);
+  if (!check(p, TOKEN_PIPE_GREATER)) return expr;
+
+  Token op_token = p->current;
+  int stage_capacity = 4;
+  int stage_count = 0;
+  AstNode **stages = malloc(sizeof(AstNode *) * stage_capacity);
+  while (match(p, TOKEN_PIPE_GREATER)) {
+    skip_newlines(p);
+    if (stage_count >= stage_capacity) {
+      stage_capacity *= 2;
+      stages = realloc(stages, sizeof(AstNode *) * stage_capacity);
+    }
+    stages[stage_count++] = parse_call(p);
+  }
+  return ast_make_pipeline(expr, stages, stage_count, op_token.line, op_token.column);
+}
+
+static AstNode *parse_range(Parser *p) {
+  AstNode *expr = parse_equality(p);
+  if (match(p, TOKEN_DOT_DOT)) {
+    Token op_token = p->previous;
+    AstNode *end = parse_equality(p);
+    expr = ast_make_range(expr, end, op_token.line, op_token.column);
+  }
+  return expr;
 }
 
 static AstNode *parse_equality(Parser *p) {
@@ -148,20 +182,109 @@ static AstNode *parse_unary(Parser *p) {
     AstNode *operand = parse_unary(p);  // Right-associative
     return ast_make_unary_op(op, operand, op_token.line, op_token.column);
   }
+
+  // comptime takes the whole expression that follows it
+  if (match(p, TOKEN_COMPTIME)) {
+    Token op_token = p->previous;
+    AstNode *expr = parse_expression(p);
+    return ast_make_comptime(expr, op_token.line, op_token.column);
+  }
   
   return parse_call(p);
 }
 
+// Parse the expression inside `{...}` with a parser of its own
+static AstNode *parse_embedded(Parser *p, Token token, const char *start, int length) {
+  char *source = malloc(length + 1);
+  memcpy(source, start, length);
+  source[length] = '\0';
+
+  Lexer lexer;
+  lexer_init(&lexer, source);
+  lexer.line = token.line;
+  lexer.column = token.column + (int)(start - token.start);
+  Parser parser;
+  parser_init(&parser, &lexer, p->file_path);
+  skip_newlines(&parser);
+  AstNode *expr = parse_expression(&parser);
+  skip_newlines(&parser);
+  if (!parser.had_error && !check(&parser, TOKEN_EOF)) {
+    error_report(p->file_path, parser.current.line, parser.current.column,
+                 "expected '}' after interpolated expression");
+    parser.had_error = true;
+  }
+  if (parser.had_error) {
+    p->had_error = true;
+    ast_free(expr);
+    expr = NULL;
+  }
+  free(source);
+  return expr;
+}
+
+// A string literal. `{{` and `}}` are literal braces, `{}` is left for the
+// io format functions, and any other `{expr}` makes the literal an
+// interpolation whose parts alternate text and expressions.
+static AstNode *parse_string(Parser *p, Token token) {
+  const char *chars = token.start + 1;  // Strip quotes
+  int length = token.length - 2;
+  char *text = malloc(length + 1);
+  int text_length = 0;
+  AstNode **parts = NULL;
+  int part_count = 0;
+
+  for (int i = 0; i < length; i++) {
+    char c = chars[i];
+    if (c == '{' && i + 1 < length && chars[i + 1] == '{') {
+      text[text_length++] = '{';
+      i++;
+    } else if (c == '}' && i + 1 < length && chars[i + 1] == '}') {
+      text[text_length++] = '}';
+      i++;
+    } else if (c == '{' && i + 1 < length && chars[i + 1] != '}') {
+      // Find the matching brace, as the lexer did
+      int depth = 0, end = i;
+      bool quoted = false;
+      for (; end < length; end++) {
+        if (chars[end] == '"') {
+          quoted = !quoted;
+        } else if (!quoted && chars[end] == '{') {
+          depth++;
+        } else if (!quoted && chars[end] == '}' && --depth == 0) {
+          break;
+        }
+      }
+      parts = realloc(parts, sizeof(AstNode *) * (part_count + 2));
+      if (text_length > 0) {
+        text[text_length] = '\0';
+        parts[part_count++] = ast_make_string_literal(text, token.line, token.column);
+        text_length = 0;
+      }
+      AstNode *expr = parse_embedded(p, token, chars + i + 1, end - i - 1);
+      if (expr) parts[part_count++] = expr;
+      i = end;
+    } else {
+      text[text_length++] = c;
+    }
+  }
+
+  text[text_length] = '\0';
+  if (parts == NULL) {
+    AstNode *node = ast_make_string_literal(text, token.line, token.column);
+    free(text);
+    return node;
+  }
+  if (text_length > 0) {
+    parts = realloc(parts, sizeof(AstNode *) * (part_count + 1));
+    parts[part_count++] = ast_make_string_literal(text, token.line, token.column);
+  }
+  free(text);
+  return ast_make_interpolation(parts, part_count, token.line, token.column);
+}
+
 static AstNode *parse_primary(Parser *p) {
   if (match(p, TOKEN_STRING)) {
-    // Strip quotes
-    char *value = malloc(p->previous.length - 1);
-    memcpy(value, p->previous.start + 1, p->previous.length - 2);
-    value[p->previous.length - 2] = '\0';
-    AstNode *node =
-        ast_make_string_literal(value, p->previous.line, p->previous.column);
-    free(value);
-    return node;
+    return parse_string(p, p->previous);
   }
 
   if (match(p, TOKEN_INT)) {
@@ -178,7 +301,8 @@ static AstNode *parse_primary(Parser *p) {
     return ast_make_float_literal(value, p->previous.line, p->previous.column);
   }
 
-  if (match(p, TOKEN_IDENTIFIER)) {
+  // `string` lexes as a type keyword but also names the string module
+  if (match(p, TOKEN_IDENTIFIER) || match(p, TOKEN_TYPE_STRING)) {
     char *name = token_to_string(p->previous);
     AstNode *node =
         ast_make_identifier(name, p->previous.line, p->previous.column);
@@ -186,6 +310,13 @@ static AstNode *parse_primary(Parser *p) {
     return node;
   }
 
+  if (match(p, TOKEN_LEFT_PAREN)) {
+    // Grouping: (expression)
+    AstNode *expr = parse_expression(p);
+    consume(p, TOKEN_RIGHT_PAREN, "expected ')' after expression");
+    return expr;
+  }
+
   error_report(p->file_path, p->current.line, p->current.column,
                "expected expression");
   p->had_error = true;
@@ -203,10 +334,27 @@ static AstNode *parse_call(Parser *p) {
       expr = ast_make_member_access(expr, member, p->previous.line,
                                     p->previous.column);
       free(member);
+    } else if (match(p, TOKEN_LEFT_PAREN)) {
+      // Function call with parenthesized arguments: f(a, b) or f()
+      int arg_capacity = 4;
+      int arg_count = 0;
+      AstNode **args = malloc(sizeof(AstNode *) * arg_capacity);
+
+      if (!check(p, TOKEN_RIGHT_PAREN)) {
+        do {
+          if (arg_count >= arg_capacity) {
+            arg_capacity *= 2;
+            args = realloc(args, sizeof(AstNode *) * arg_capacity);
+          }
+          args[arg_count++] = parse_expression(p);
+        } while (match(p, TOKEN_COMMA));
+      }
+      consume(p, TOKEN_RIGHT_PAREN, "expected ')' after arguments");
+
+      expr = ast_make_call(expr, args, arg_count, p->previous.line, p->previous.column);
     } else if (check(p, TOKEN_STRING) || check(p, TOKEN_INT) ||
                check(p, TOKEN_FLOAT) || check(p, TOKEN_IDENTIFIER) ||
-               check(p, TOKEN_MINUS) || check(p, TOKEN_BANG) ||
-               check(p, TOKEN_LEFT_PAREN)) {
+               check(p, TOKEN_MINUS) || check(p, TOKEN_BANG)) {
       // Function call with arguments (comma-separated, no parens)
       int arg_capacity = 4;
       int arg_count = 0;
@@ -233,11 +381,73 @@ static AstNode *parse_call(Parser *p) {
   return expr;
 }
 
+// An int literal in a pattern, which may be negative
+static bool parse_pattern_int(Parser *p, i64 *value) {
+  bool negative = match(p, TOKEN_MINUS);
+  if (!match(p, TOKEN_INT)) {
+    if (negative) {
+      error_report(p->file_path, p->current.line, p->current.column,
+                   "expected an integer after '-' in pattern");
+      p->had_error = true;
+    }
+    return false;
+  }
+  char *str = token_to_string(p->previous);
+  *value = negative ? -atoll(str) : atoll(str);
+  free(str);
+  return true;
+}
+
+// A match pattern: an int, an int range, a plain string, or `_`
+static AstNode *parse_pattern(Parser *p) {
+  Token token = p->current;
+  i64 start;
+  if (parse_pattern_int(p, &start)) {
+    AstNode *node = ast_make_int_literal(start, token.line, token.column);
+    if (match(p, TOKEN_DOT_DOT)) {
+      Token end_token = p->current;
+      i64 end;
+      if (!parse_pattern_int(p, &end)) {
+        error_report(p->file_path, end_token.line, end_token.column,
+                     "expected an integer after '..' in pattern");
+        p->had_error = true;
+        end = start;
+      }
+      node = ast_make_range(node, ast_make_int_literal(end, end_token.line, end_token.column),
+                            token.line, token.column);
+    }
+    return node;
+  }
+  if (p->had_error) return NULL;
+
+  if (match(p, TOKEN_STRING)) {
+    AstNode *node = parse_string(p, token);
+    if (node && node->type != AST_STRING_LITERAL) {
+      error_report(p->file_path, token.line, token.column,
+                   "string patterns cannot be interpolated");
+      p->had_error = true;
+    }
+    return node;
+  }
+
+  if (check(p, TOKEN_IDENTIFIER) && token.length == 1 && token.start[0] == '_') {
+    advance(p);
+    return ast_make_identifier("_", token.line, token.column);
+  }
+
+  error_report(p->file_path, token.line, token.column,
+               "expected a pattern: an integer, a range, a string or _");
+  p->had_error = true;
+  return NULL;
+}
+
 static AstNode *parse_statement(Parser *p) {
   skip_newlines(p);
 
   if (match(p, TOKEN_IMPORT)) {
-    consume(p, TOKEN_IDENTIFIER, "expected module name after 'import'");
+    if (!match(p, TOKEN_TYPE_STRING)) {
+      consume(p, TOKEN_IDENTIFIER, "expected module name after 'import'");
+    }
     char *module = token_to_string(p->previous);
     AstNode *node =
         ast_make_import(module, p->previous.line, p->previous.column);
@@ -260,6 +470,37 @@ static AstNode *parse_statement(Parser *p) {
     return node;
   }
   
+  if (match(p, TOKEN_MATCH)) {
+    // match subject, then one `pattern, ...: statement` arm per line,
+    // each indented past the `match`
+    int line = p->previous.line;
+    int column = p->previous.column;
+    AstNode *subject = parse_expression(p);
+    MatchArm *arms = NULL;
+    int arm_count = 0;
+
+    skip_newlines(p);
+    while (!check(p, TOKEN_EOF) && p->current.column > column && !p->had_error) {
+      MatchArm arm = {NULL, 0, NULL};
+      do {
+        arm.patterns = realloc(arm.patterns, sizeof(AstNode *) * (arm.pattern_count + 1));
+        arm.patterns[arm.pattern_count++] = parse_pattern(p);
+      } while (!p->had_error && match(p, TOKEN_COMMA));
+      consume(p, TOKEN_COLON, "expected ':' after match pattern");
+      skip_newlines(p);
+      if (!p->had_error) arm.body = parse_statement(p);
+
+      arms = realloc(arms, sizeof(MatchArm) * (arm_count + 1));
+      arms[arm_count++] = arm;
+      skip_newlines(p);
+    }
+    if (arm_count == 0 && !p->had_error) {
+      error_report(p->file_path, line, column, "expected an indented arm after 'match'");
+      p->had_error = true;
+    }
+    return ast_make_match(subject, arms, arm_count, line, column);
+  }
+
   if (match(p, TOKEN_IF)) {
     // if condition then statement [else statement]
     int line = p->previous.line;
@@ -294,6 +535,33 @@ static AstNode *parse_statement(Parser *p) {
     return ast_make_while(condition, body, line, column);
   }
   
+  if (match(p, TOKEN_FOR)) {
+    // for [index,] item in iterable then statement
+    // for i in start..end then statement
+    int line = p->previous.line;
+    int column = p->previous.column;
+
+    consume(p, TOKEN_IDENTIFIER, "expected loop variable after 'for'");
+    char *index_name = NULL;
+    char *item_name = token_to_string(p->previous);
+    if (match(p, TOKEN_COMMA)) {
+      index_name = item_name;
+      consume(p, TOKEN_IDENTIFIER, "expected second loop variable after ','");
+      item_name = token_to_string(p->previous);
+    }
+    consume(p, TOKEN_IN, "expected 'in' after loop variable");
+
+    AstNode *iterable = parse_expression(p);
+    consume(p, TOKEN_THEN, "expected 'then' after for clause");
+    skip_newlines(p);
+
+    AstNode *body = parse_statement(p);
+    AstNode *node = ast_make_for(index_name, item_name, iterable, body, line, column);
+    free(index_name);
+    free(item_name);
+    return node;
+  }
+
   if (match(p, TOKEN_LOOP)) {
     // loop statement
     int line = p->previous.line;
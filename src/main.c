@@ -5,6 +5,8 @@
 #include "core/common.h"
 #include "frontend/lexer.h"
 #include "frontend/parser.h"
+#include "runtime/bundle.h"
+#include "runtime/debug.h"
 #include "runtime/vm.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -12,12 +14,20 @@
 
 static void print_usage(const char *program) {
   printf("Usage: %s [options] <file>\n", program);
+  printf("       %s bundle <file> [-o <output>] [--exe]\n", program);
   printf("Options:\n");
   printf("  -h, --help       Show this help message\n");
   printf("  -v, --version    Show version\n");
   printf("  -t, --tokens     Dump tokens only\n");
   printf("  -a, --ast        Dump AST only\n");
   printf("  -i, --interpret  Interpret mode (default)\n");
+  printf("  -d, --debug      Run under the debugger, stopping at the first line\n");
+  printf("  --max-instructions <n>  Stop the script after about n instructions\n");
+  printf("  --max-heap <bytes>      Stop the script before its heap exceeds bytes\n");
+  printf("\n");
+  printf("<file> may be a script or a bundle. bundle compiles a script into\n");
+  printf("<output> (default: the script's name with .satb); with --exe the\n");
+  printf("output is a copy of this interpreter that runs the bundle.\n");
   printf("\n");
 }
 
@@ -85,15 +95,208 @@ static void dump_ast(const char *source, const char *file_path) {
   }
 }
 
+// Print line `line` of `source`, without its newline
+static void print_source_line(const char *source, int line) {
+  for (int i = 1; i < line && *source != '\0'; source++) {
+    if (*source == '\n') i++;
+  }
+  int length = (int)strcspn(source, "\n");
+  printf("%d\t%.*s\n", line, length, source);
+}
+
+static void print_debug_help(void) {
+  printf("  b, break <line>   Stop whenever <line> starts\n");
+  printf("  d, delete <line>  Remove the breakpoint on <line>\n");
+  printf("  s, step           Run to the next line\n");
+  printf("  c, continue       Run to the next breakpoint\n");
+  printf("  l, locals         Show local variable slots\n");
+  printf("  t, stack          Show the value stack\n");
+  printf("  q, quit           Stop the script\n");
+}
+
+// Debugger prompt, read from stdin at each stop. The end of input quits.
+static DebugAction debug_prompt(Debugger *debugger, VM *vm, int line) {
+  if (debugger->context != NULL) {
+    print_source_line(debugger->context, line);
+  } else {
+    printf("line %d\n", line);
+  }
+  char input[256];
+  for (;;) {
+    printf("(satori) ");
+    fflush(stdout);
+    if (!fgets(input, sizeof(input), stdin)) {
+      printf("\n");
+      return DEBUG_STOP;
+    }
+    char command[32] = "";
+    int argument = 0;
+    int fields = sscanf(input, "%31s %d", command, &argument);
+    if (fields < 1 || strcmp(command, "s") == 0 || strcmp(command, "step") == 0) {
+      return DEBUG_STEP;
+    } else if (strcmp(command, "c") == 0 || strcmp(command, "continue") == 0) {
+      return DEBUG_CONTINUE;
+    } else if (strcmp(command, "q") == 0 || strcmp(command, "quit") == 0) {
+      return DEBUG_STOP;
+    } else if ((strcmp(command, "b") == 0 || strcmp(command, "break") == 0) && fields == 2) {
+      if (debug_break_at(debugger, vm, argument)) {
+        printf("Breakpoint on line %d\n", argument);
+      } else {
+        printf("No code starts on line %d\n", argument);
+      }
+    } else if ((strcmp(command, "d") == 0 || strcmp(command, "delete") == 0) && fields == 2) {
+      if (!debug_clear(debugger, vm, argument)) printf("No breakpoint on line %d\n", argument);
+    } else if (strcmp(command, "l") == 0 || strcmp(command, "locals") == 0) {
+      for (int i = 0; i < vm->local_count; i++) {
+        printf("  [%d] ", i);
+        value_print(vm->locals[i]);
+        printf("\n");
+      }
+    } else if (strcmp(command, "t") == 0 || strcmp(command, "stack") == 0) {
+      for (int i = 0; i < vm->stack_top; i++) {
+        printf("  ");
+        value_print(vm->stack[i]);
+        printf("\n");
+      }
+    } else {
+      print_debug_help();
+    }
+  }
+}
+
+// Compile `source` into `chunk`. Errors have been reported on failure.
+static bool compile_source(const char *source, const char *file_path, Chunk *chunk) {
+  Lexer lexer;
+  lexer_init(&lexer, source);
+
+  Parser parser;
+  parser_init(&parser, &lexer, file_path);
+
+  AstNode *program = parser_parse(&parser);
+  if (!program) return false;
+  bool ok = codegen_compile(program, chunk);
+  ast_free(program);
+  return ok;
+}
+
+// Run the VM's compiled chunk, under the debugger if asked, which shows
+// lines of `source` when there is one. Returns the process exit status.
+static int run_chunk(VM *vm, bool debug, const char *source, u64 max_instructions,
+                     size_t max_heap) {
+  Debugger debugger;
+  if (debug) {
+    debug_attach(&debugger, vm, debug_prompt, (void*)source);
+    debug_step(&debugger, vm, 0);
+  }
+
+  vm_set_limits(vm, max_instructions, max_heap);
+  bool success = vm_run(vm);
+  if (debug) debug_detach(&debugger, vm);
+  if (vm->limit_hit == VM_LIMIT_INSTRUCTIONS) {
+    fprintf(stderr, "Error: instruction budget of %llu exhausted\n",
+            (unsigned long long)max_instructions);
+  } else if (vm->limit_hit == VM_LIMIT_HEAP) {
+    fprintf(stderr, "Error: heap quota of %zu bytes exceeded\n", max_heap);
+  }
+  return success ? 0 : 1;
+}
+
+// Link and run the main module of an open bundle, then close it
+static int run_bundle(Bundle *bundle, const char *path, bool debug, u64 max_instructions,
+                      size_t max_heap) {
+  VM vm;
+  vm_init(&vm);
+  const char *error = NULL;
+  int status = 1;
+  Table natives;
+  table_init(&natives);
+  if (bundle_link(bundle, BUNDLE_MAIN, &vm.chunk, &error)) {
+    bundle_natives(&vm.chunk, &natives);
+    vm.natives = &natives;
+    status = run_chunk(&vm, debug, NULL, max_instructions, max_heap);
+  } else {
+    fprintf(stderr, "Error: Could not load bundle '%s': %s\n", path, error);
+  }
+  vm_free(&vm);
+  table_free(&natives);
+  bundle_close(bundle);
+  return status;
+}
+
+// satori bundle <file> [-o <output>] [--exe]
+static int bundle_command(int argc, char **argv) {
+  const char *file_path = NULL;
+  const char *output = NULL;
+  bool executable = false;
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else if (strcmp(argv[i], "--exe") == 0) {
+      executable = true;
+    } else if (argv[i][0] != '-' && file_path == NULL) {
+      file_path = argv[i];
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", argv[i]);
+      print_usage(argv[0]);
+      return 1;
+    }
+  }
+  if (!file_path) {
+    fprintf(stderr, "Error: No input file specified\n");
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  // Default output: the script's name, .sat replaced by .satb (or dropped
+  // for an executable)
+  char default_output[4096];
+  if (output == NULL) {
+    size_t length = strlen(file_path);
+    if (length > 4 && strcmp(file_path + length - 4, ".sat") == 0) length -= 4;
+    snprintf(default_output, sizeof(default_output), "%.*s%s", (int)length, file_path,
+             executable ? "" : ".satb");
+    if (strcmp(default_output, file_path) == 0) {
+      fprintf(stderr, "Error: Give an output path with -o\n");
+      return 1;
+    }
+    output = default_output;
+  }
+
+  char *source = read_file(file_path);
+  if (!source) return 1;
+  Chunk chunk;
+  chunk_init(&chunk);
+  bool ok = compile_source(source, file_path, &chunk);
+  const char *error = NULL;
+  if (ok && !bundle_write(&chunk, output, executable ? "/proc/self/exe" : NULL, &error)) {
+    fprintf(stderr, "Error: Could not bundle '%s': %s\n", file_path, error);
+    ok = false;
+  }
+  chunk_free(&chunk);
+  free(source);
+  return ok ? 0 : 1;
+}
+
 int main(int argc, char **argv) {
+  // An interpreter with a bundle appended runs that bundle and nothing else
+  Bundle bundle;
+  const char *bundle_error = NULL;
+  if (bundle_open(&bundle, "/proc/self/exe", &bundle_error)) {
+    return run_bundle(&bundle, argv[0], false, 0, 0);
+  }
+
   if (argc < 2) {
     print_usage(argv[0]);
     return 1;
   }
+  if (strcmp(argv[1], "bundle") == 0) return bundle_command(argc, argv);
 
   bool dump_tokens_only = false;
   bool dump_ast_only = false;
+  bool debug = false;
   const char *file_path = NULL;
+  u64 max_instructions = 0;
+  size_t max_heap = 0;
 
   // Parse arguments
   for (int i = 1; i < argc; i++) {
@@ -111,6 +314,12 @@ int main(int argc, char **argv) {
     } else if (strcmp(argv[i], "-i") == 0 ||
                strcmp(argv[i], "--interpret") == 0) {
       // Default mode
+    } else if (strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "--debug") == 0) {
+      debug = true;
+    } else if (strcmp(argv[i], "--max-instructions") == 0 && i + 1 < argc) {
+      max_instructions = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--max-heap") == 0 && i + 1 < argc) {
+      max_heap = (size_t)strtoull(argv[++i], NULL, 10);
     } else if (argv[i][0] != '-') {
       file_path = argv[i];
     } else {
@@ -126,6 +335,16 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  if (!dump_tokens_only && !dump_ast_only) {
+    if (bundle_open(&bundle, file_path, &bundle_error)) {
+      return run_bundle(&bundle, file_path, debug, max_instructions, max_heap);
+    }
+    if (bundle_error != NULL) {
+      fprintf(stderr, "Error: Could not load bundle '%s': %s\n", file_path, bundle_error);
+      return 1;
+    }
+  }
+
   char *source = read_file(file_path);
   if (!source) {
     return 1;
@@ -137,36 +356,20 @@ int main(int argc, char **argv) {
     dump_ast(source, file_path);
   } else {
     // Full interpretation
-    Lexer lexer;
-    lexer_init(&lexer, source);
-
-    Parser parser;
-    parser_init(&parser, &lexer, file_path);
-
-    AstNode *program = parser_parse(&parser);
-    if (!program) {
-      free(source);
-      return 1;
-    }
-
     VM vm;
     vm_init(&vm);
 
-    if (!codegen_compile(program, &vm.chunk)) {
-      ast_free(program);
+    if (!compile_source(source, file_path, &vm.chunk)) {
       vm_free(&vm);
       free(source);
       return 1;
     }
 
-    ast_free(program);
-
-    bool success = vm_run(&vm);
+    int status = run_chunk(&vm, debug, source, max_instructions, max_heap);
     vm_free(&vm);
-
-    if (!success) {
+    if (status != 0) {
       free(source);
-      return 1;
+      return status;
     }
   }
 
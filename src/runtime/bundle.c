@@ -0,0 +1,1073 @@
+// src/runtime/bundle.c - Precompiled application bundles
+//
+// Linking verifies a module before any of it runs, so a damaged archive
+// or one from an interpreter with other opcodes is refused rather than
+// crashing the VM:
+//
+//   - every opcode is one the VM runs, with its operands and tables
+//     inside the code, and the code cannot run off its end
+//   - constants the VM reads by type (names, switch bases, match-key
+//     maps) have that type, and match-key indexes fit their tables
+//   - every jump lands on the start of an instruction
+//   - the stack depth at each instruction is the same along every path
+//     into it, never negative and never above SATORI_STACK_MAX
+//
+// This catches damage the checksums cannot explain and archives that do
+// not fit this interpreter. It does not make hostile bytecode safe to
+// run; a bundle is a program, trusted as its source would be.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "bundle.h"
+#include "module.h"
+#include "core/object.h"
+#include "core/hamt.h"
+#include "core/table.h"
+#include "core/vector.h"
+#include "stdlib/hash.h"
+#include "stdlib/regex.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Deepest nesting of arrays, vectors and maps in one constant
+#define BUNDLE_MAX_DEPTH 64
+
+static inline u16 read_u16(const u8 *at) {
+  return (u16)((at[0] << 8) | at[1]);
+}
+
+// Length of the instruction at `at`, operands included, or -1 for an
+// opcode a bundle may not hold. Table lengths are read from the code, so
+// the caller checks the result fits.
+static int instruction_length(const u8 *code, int length, int at) {
+  int left = length - at - 1;
+  switch (code[at]) {
+    case OP_POP:
+    case OP_ADD: case OP_SUBTRACT: case OP_MULTIPLY: case OP_DIVIDE: case OP_MODULO:
+    case OP_NEGATE:
+    case OP_EQUAL: case OP_NOT_EQUAL: case OP_LESS: case OP_LESS_EQUAL:
+    case OP_GREATER: case OP_GREATER_EQUAL: case OP_NOT:
+    case OP_ADD_INT: case OP_SUBTRACT_INT: case OP_MULTIPLY_INT: case OP_MODULO_INT:
+    case OP_EQUAL_INT: case OP_NOT_EQUAL_INT: case OP_LESS_INT: case OP_LESS_EQUAL_INT:
+    case OP_GREATER_INT: case OP_GREATER_EQUAL_INT:
+    case OP_ADD_FLOAT: case OP_SUBTRACT_FLOAT: case OP_MULTIPLY_FLOAT: case OP_DIVIDE_FLOAT:
+    case OP_LESS_FLOAT: case OP_LESS_EQUAL_FLOAT: case OP_GREATER_FLOAT:
+    case OP_GREATER_EQUAL_FLOAT:
+    case OP_FOR_PREP:
+    case OP_HALT:
+      return 1;
+    case OP_CONSTANT: case OP_GET_LOCAL: case OP_SET_LOCAL:
+    case OP_GET_GLOBAL: case OP_GET_GLOBAL_CACHED: case OP_CALL_NATIVE: case OP_IMPORT:
+    case OP_PIPE_ARRAY: case OP_ARRAY_APPEND: case OP_PRINT: case OP_BUILD_STRING:
+      return 2;
+    case OP_JUMP: case OP_JUMP_IF_FALSE: case OP_LOOP:
+      return 3;
+    case OP_SWITCH: case OP_MATCH_KEYS:
+      return left < 5 ? -1 : 6 + 2 * read_u16(code + at + 2);
+    case OP_SWITCH_RANGES:
+      return left < 4 ? -1 : 5 + read_u16(code + at + 1) * SWITCH_RANGE_SIZE;
+    case OP_FOR_RANGE: case OP_FOR_ARRAY: case OP_FOR_PACKED: case OP_FOR_VECTOR:
+    case OP_FOR_MAP: case OP_FOR_STRING: case OP_FOR_FOREIGN:
+      return 6;
+    default:
+      return -1;
+  }
+}
+
+static bool is_loop_head(u8 opcode) {
+  return opcode >= OP_FOR_RANGE && opcode <= OP_FOR_FOREIGN;
+}
+
+// ============================================================================
+// Verification
+// ============================================================================
+
+typedef struct {
+  const u8 *code;
+  int length;
+  const Value *constants;
+  int constant_count;
+  u8 *starts;       // 1 where an instruction starts
+  int *depths;      // Stack depth on entry, -1 until reached
+  int *pending;     // Worklist of offsets
+  int pending_count;
+} Verifier;
+
+static const char *check_constant(Verifier *v, int at, bool (*accept)(Value)) {
+  int index = v->code[at + 1];
+  if (index >= v->constant_count) return "constant index out of range";
+  if (accept != NULL && !accept(v->constants[index])) return "constant of the wrong type";
+  return NULL;
+}
+
+static bool is_name(Value value) { return IS_STRING(value); }
+static bool is_int(Value value) { return IS_INT(value); }
+static bool is_map(Value value) { return IS_MAP(value); }
+
+// Check one instruction's operands, on the first pass
+static const char *check_operands(Verifier *v, int at) {
+  const u8 *code = v->code;
+  switch (code[at]) {
+    case OP_CONSTANT:
+      return check_constant(v, at, NULL);
+    case OP_GET_GLOBAL: case OP_GET_GLOBAL_CACHED: case OP_IMPORT:
+      return check_constant(v, at, is_name);
+    case OP_SWITCH:
+      return check_constant(v, at, is_int);
+    case OP_MATCH_KEYS: {
+      const char *error = check_constant(v, at, is_map);
+      if (error != NULL) return error;
+      ObjMap *keys = AS_MAP(v->constants[code[at + 1]]);
+      int count = read_u16(code + at + 2);
+      u64 cursor = 0;
+      Value key, index;
+      while (map_next(keys, &cursor, &key, &index)) {
+        if (!IS_INT(index) || AS_INT(index) < 0 || AS_INT(index) >= count) {
+          return "match key outside its table";
+        }
+      }
+      return NULL;
+    }
+    case OP_BUILD_STRING:
+      return code[at + 1] > SATORI_BUILD_STRING_MAX ? "string built from too many parts" : NULL;
+    case OP_PIPE_ARRAY:
+      return code[at + 1] > PIPE_SIZE_RANGE ? "unknown pipeline sizing" : NULL;
+    case OP_FOR_PREP:
+      return at + 1 < v->length && is_loop_head(code[at + 1]) ? NULL
+                                                              : "loop setup without a loop head";
+    case OP_FOR_RANGE: case OP_FOR_ARRAY: case OP_FOR_PACKED: case OP_FOR_VECTOR:
+    case OP_FOR_MAP: case OP_FOR_STRING: case OP_FOR_FOREIGN: {
+      int state = code[at + 1], var = code[at + 2], var_count = code[at + 3];
+      if (state + 1 >= SATORI_MAX_LOCALS || var_count < 1 || var_count > 2 ||
+          var + var_count > SATORI_MAX_LOCALS) {
+        return "loop variables out of range";
+      }
+      return NULL;
+    }
+    default:
+      return NULL;
+  }
+}
+
+// Values the instruction at `at` takes off the stack and puts back
+static void stack_effect(const u8 *code, int at, int *pops, int *pushes) {
+  *pops = 0;
+  *pushes = 0;
+  switch (code[at]) {
+    case OP_CONSTANT: case OP_GET_LOCAL: case OP_GET_GLOBAL: case OP_GET_GLOBAL_CACHED:
+      *pushes = 1;
+      break;
+    case OP_POP: case OP_SET_LOCAL: case OP_ARRAY_APPEND:
+    case OP_SWITCH: case OP_SWITCH_RANGES: case OP_MATCH_KEYS:
+      *pops = 1;
+      break;
+    case OP_NEGATE: case OP_NOT: case OP_JUMP_IF_FALSE:
+      *pops = 1;
+      *pushes = 1;
+      break;
+    case OP_CALL_NATIVE:
+      *pops = code[at + 1] + 1;
+      *pushes = 1;
+      break;
+    case OP_PRINT: case OP_BUILD_STRING:
+      *pops = code[at + 1];
+      *pushes = 1;
+      break;
+    case OP_PIPE_ARRAY:
+      // Peeks at the source (a range's two bounds) and pushes the array
+      *pops = code[at + 1] == PIPE_SIZE_RANGE ? 2 : code[at + 1] == PIPE_SIZE_COLLECTION;
+      *pushes = *pops + 1;
+      break;
+    case OP_FOR_PREP:
+      *pops = code[at + 1] == OP_FOR_RANGE ? 2 : 1;
+      break;
+    case OP_IMPORT: case OP_JUMP: case OP_LOOP: case OP_HALT:
+    case OP_FOR_RANGE: case OP_FOR_ARRAY: case OP_FOR_PACKED: case OP_FOR_VECTOR:
+    case OP_FOR_MAP: case OP_FOR_STRING: case OP_FOR_FOREIGN:
+      break;
+    default:   // Binary operators
+      *pops = 2;
+      *pushes = 1;
+      break;
+  }
+}
+
+// Record that `target` is reached with `depth` values on the stack
+static const char *reach(Verifier *v, int target, int depth) {
+  if (target < 0 || target >= v->length || !v->starts[target]) {
+    return "jump into the middle of an instruction or off the code";
+  }
+  if (v->depths[target] < 0) {
+    v->depths[target] = depth;
+    v->pending[v->pending_count++] = target;
+  } else if (v->depths[target] != depth) {
+    return "stack depth differs between paths";
+  }
+  return NULL;
+}
+
+// Follow every path from the instruction at `at`
+static const char *follow(Verifier *v, int at) {
+  const u8 *code = v->code;
+  int pops, pushes;
+  stack_effect(code, at, &pops, &pushes);
+  if (v->depths[at] < pops) return "stack underflow";
+  int depth = v->depths[at] - pops + pushes;
+  if (depth > SATORI_STACK_MAX) return "stack overflow";
+
+  int next = at + instruction_length(code, v->length, at);
+  const char *error = NULL;
+  switch (code[at]) {
+    case OP_HALT:
+      return NULL;
+    case OP_JUMP:
+      return reach(v, next + read_u16(code + at + 1), depth);
+    case OP_LOOP:
+      return reach(v, next - read_u16(code + at + 1), depth);
+    case OP_JUMP_IF_FALSE:
+      error = reach(v, next + read_u16(code + at + 1), depth);
+      break;
+    case OP_FOR_RANGE: case OP_FOR_ARRAY: case OP_FOR_PACKED: case OP_FOR_VECTOR:
+    case OP_FOR_MAP: case OP_FOR_STRING: case OP_FOR_FOREIGN:
+      error = reach(v, next + read_u16(code + at + 4), depth);
+      break;
+    case OP_SWITCH: case OP_MATCH_KEYS: {
+      int count = read_u16(code + at + 2);
+      error = reach(v, next + read_u16(code + at + 4), depth);
+      for (int i = 0; i < count && error == NULL; i++) {
+        error = reach(v, next + read_u16(code + at + 6 + 2 * i), depth);
+      }
+      return error;
+    }
+    case OP_SWITCH_RANGES: {
+      int count = read_u16(code + at + 1);
+      error = reach(v, next + read_u16(code + at + 3), depth);
+      for (int i = 0; i < count && error == NULL; i++) {
+        const u8 *entry = code + at + 5 + i * SWITCH_RANGE_SIZE;
+        error = reach(v, next + read_u16(entry + 2 * sizeof(i64)), depth);
+      }
+      return error;
+    }
+  }
+  if (error != NULL) return error;
+  if (next >= v->length) return "code runs off its end";
+  return reach(v, next, depth);
+}
+
+// NULL if `code` is safe for the VM to start running, else why not. If
+// `reached` is given, it is set to 1 at each instruction some path runs.
+static const char *verify_code(const u8 *code, int length, const Value *constants,
+                               int constant_count, u8 *reached) {
+  if (length == 0) return "empty code";
+  Verifier v = {code, length, constants, constant_count, calloc(length, 1),
+                malloc(sizeof(int) * length), malloc(sizeof(int) * length), 0};
+  const char *error = NULL;
+
+  for (int at = 0; at < length && error == NULL;) {
+    int size = instruction_length(code, length, at);
+    if (size < 0) {
+      error = "unknown opcode";
+    } else if (size > length - at) {
+      error = "instruction runs past the code";
+    } else {
+      v.starts[at] = 1;
+      error = check_operands(&v, at);
+      at += size;
+    }
+  }
+
+  for (int i = 0; i < length; i++) v.depths[i] = -1;
+  if (error == NULL) error = reach(&v, 0, 0);
+  while (error == NULL && v.pending_count > 0) {
+    error = follow(&v, v.pending[--v.pending_count]);
+  }
+  if (error == NULL && reached != NULL) {
+    for (int i = 0; i < length; i++) reached[i] = v.depths[i] >= 0;
+  }
+
+  free(v.starts);
+  free(v.depths);
+  free(v.pending);
+  return error;
+}
+
+// ============================================================================
+// Pruning
+// ============================================================================
+//
+// A chunk is pruned before it is written, from its entry point: code no
+// path runs is dropped, as are imports of modules whose natives the
+// program never names, and then constants nothing left refers to. Equal
+// strings and scalars are merged into one constant.
+
+// Whether the operand after the opcode is a constant index
+static bool takes_constant(u8 opcode) {
+  switch (opcode) {
+    case OP_CONSTANT: case OP_GET_GLOBAL: case OP_GET_GLOBAL_CACHED: case OP_IMPORT:
+    case OP_SWITCH: case OP_MATCH_KEYS:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Whether two constants can share a slot. Objects are never merged, and
+// floats only when their bits agree, which keeps 0.0 apart from -0.0.
+static bool interchangeable(Value a, Value b) {
+  if (IS_STRING(a) && IS_STRING(b)) return value_equal(a, b);
+  if (a.type != b.type) return false;
+  switch (a.type) {
+    case VALUE_NIL: return true;
+    case VALUE_BOOL: return AS_BOOL(a) == AS_BOOL(b);
+    case VALUE_INT: return AS_INT(a) == AS_INT(b);
+    case VALUE_FLOAT: return memcmp(&AS_FLOAT(a), &AS_FLOAT(b), sizeof(f64)) == 0;
+    default: return false;
+  }
+}
+
+// Whether code that runs reads a native of module `module`, which all
+// have names of the form "module.function"
+static bool module_used(const Chunk *chunk, const u8 *reached, const char *module) {
+  size_t length = strlen(module);
+  for (int at = 0; at < chunk->count; at++) {
+    if (!reached[at] ||
+        (chunk->code[at] != OP_GET_GLOBAL && chunk->code[at] != OP_GET_GLOBAL_CACHED)) {
+      continue;
+    }
+    const char *name = AS_STRING(chunk->constants[chunk->code[at + 1]]);
+    if (strncmp(name, module, length) == 0 && name[length] == '.') return true;
+  }
+  return false;
+}
+
+static void write_u16(u8 *at, int value) {
+  at[0] = (u8)(value >> 8);
+  at[1] = (u8)(value & 0xff);
+}
+
+// Point the forward offset at `operand`, relative to `next` before the move
+// and `moved_next` after it, at where its target moved
+static void relocate_forward(u8 *operand, int next, int moved_next, const int *moved) {
+  write_u16(operand, moved[next + read_u16(operand)] - moved_next);
+}
+
+// Fix the offsets of an instruction copied to `out`, which ended at
+// `next` and now ends at `moved_next`
+static void relocate(u8 *out, int next, int moved_next, const int *moved) {
+  switch (out[0]) {
+    case OP_JUMP: case OP_JUMP_IF_FALSE:
+      relocate_forward(out + 1, next, moved_next, moved);
+      break;
+    case OP_LOOP:
+      write_u16(out + 1, moved_next - moved[next - read_u16(out + 1)]);
+      break;
+    case OP_FOR_RANGE: case OP_FOR_ARRAY: case OP_FOR_PACKED: case OP_FOR_VECTOR:
+    case OP_FOR_MAP: case OP_FOR_STRING: case OP_FOR_FOREIGN:
+      relocate_forward(out + 4, next, moved_next, moved);
+      break;
+    case OP_SWITCH: case OP_MATCH_KEYS: {
+      int count = read_u16(out + 2);
+      relocate_forward(out + 4, next, moved_next, moved);
+      for (int i = 0; i < count; i++) {
+        relocate_forward(out + 6 + 2 * i, next, moved_next, moved);
+      }
+      break;
+    }
+    case OP_SWITCH_RANGES: {
+      int count = read_u16(out + 1);
+      relocate_forward(out + 3, next, moved_next, moved);
+      for (int i = 0; i < count; i++) {
+        u8 *entry = out + 5 + i * SWITCH_RANGE_SIZE;
+        relocate_forward(entry + 2 * sizeof(i64), next, moved_next, moved);
+      }
+      break;
+    }
+  }
+}
+
+// Fill `pruned` with what of `chunk` the program can reach. Its values are
+// shared with `chunk`; its arrays are the caller's to free. Fails on code
+// that does not verify, which no bundle could run.
+static const char *prune(const Chunk *chunk, Chunk *pruned) {
+  int length = chunk->count;
+  u8 *reached = calloc(length + 1, 1);
+  const char *error =
+      verify_code(chunk->code, length, chunk->constants, chunk->constant_count, reached);
+  if (error != NULL) {
+    free(reached);
+    return error;
+  }
+  // An unknown module is kept, to fail as it would have
+  for (int at = 0; at < length; at++) {
+    if (reached[at] && chunk->code[at] == OP_IMPORT) {
+      const char *module = AS_STRING(chunk->constants[chunk->code[at + 1]]);
+      if (module_exists(module) && !module_used(chunk, reached, module)) reached[at] = 0;
+    }
+  }
+
+  // Where each offset moves to; a dropped instruction's is the next kept one's
+  int *moved = malloc(sizeof(int) * (length + 1));
+  int size = 0;
+  bool *used = calloc(chunk->constant_count + 1, sizeof(bool));
+  for (int at = 0; at < length; at++) {
+    moved[at] = reached[at] ? size : -1;
+    if (!reached[at]) continue;
+    size += instruction_length(chunk->code, length, at);
+    if (takes_constant(chunk->code[at])) used[chunk->code[at + 1]] = true;
+  }
+  moved[length] = size;
+  for (int at = length - 1; at >= 0; at--) {
+    if (moved[at] < 0) moved[at] = moved[at + 1];
+  }
+
+  chunk_init(pruned);
+  int *renumber = malloc(sizeof(int) * (chunk->constant_count + 1));
+  pruned->constants = malloc(sizeof(Value) * (chunk->constant_count + 1));
+  for (int i = 0; i < chunk->constant_count; i++) {
+    if (!used[i]) continue;
+    int slot = 0;
+    while (slot < pruned->constant_count &&
+           !interchangeable(pruned->constants[slot], chunk->constants[i])) {
+      slot++;
+    }
+    if (slot == pruned->constant_count) {
+      pruned->constants[pruned->constant_count++] = chunk->constants[i];
+    }
+    renumber[i] = slot;
+  }
+
+  pruned->code = malloc(size);
+  pruned->count = size;
+  for (int at = 0; at < length;) {
+    int n = instruction_length(chunk->code, length, at);
+    if (reached[at]) {
+      u8 *out = pruned->code + moved[at];
+      memcpy(out, chunk->code + at, n);
+      if (takes_constant(out[0])) out[1] = (u8)renumber[out[1]];
+      relocate(out, at + n, moved[at] + n, moved);
+    }
+    at += n;
+  }
+
+  // A line whose code went leaves an entry where the next one starts
+  pruned->lines = malloc(sizeof(LineStart) * (chunk->line_count + 1));
+  for (int i = 0; i < chunk->line_count; i++) {
+    if (chunk->lines[i].offset < 0 || chunk->lines[i].offset >= length) continue;
+    LineStart entry = {moved[chunk->lines[i].offset], chunk->lines[i].line};
+    if (entry.offset == size) continue;
+    if (pruned->line_count > 0 && pruned->lines[pruned->line_count - 1].offset == entry.offset) {
+      pruned->line_count--;
+    }
+    if (pruned->line_count > 0 && pruned->lines[pruned->line_count - 1].line == entry.line) {
+      continue;
+    }
+    pruned->lines[pruned->line_count++] = entry;
+  }
+
+  free(reached);
+  free(moved);
+  free(used);
+  free(renumber);
+  return NULL;
+}
+
+// ============================================================================
+// Writing
+// ============================================================================
+
+typedef struct {
+  u8 *data;
+  size_t length;
+  size_t capacity;
+} Buffer;
+
+static size_t buffer_append(Buffer *buffer, const void *data, size_t length) {
+  if (buffer->length + length > buffer->capacity) {
+    while (buffer->length + length > buffer->capacity) {
+      buffer->capacity = buffer->capacity < 256 ? 256 : buffer->capacity * 2;
+    }
+    buffer->data = realloc(buffer->data, buffer->capacity);
+  }
+  size_t at = buffer->length;
+  if (length > 0) {
+    if (data != NULL) {
+      memcpy(buffer->data + at, data, length);
+    } else {
+      memset(buffer->data + at, 0, length);
+    }
+  }
+  buffer->length += length;
+  return at;
+}
+
+static void buffer_align(Buffer *buffer) {
+  buffer_append(buffer, NULL, (8 - buffer->length % 8) % 8);
+}
+
+typedef struct {
+  Buffer strings;          // Bytes of the pool
+  u64 *offsets;            // Of each string in `strings`
+  u32 string_count;
+  Table interned;          // Text -> string index
+  BundleConstant *records;
+  u32 record_count;
+  const char *error;
+} Writer;
+
+static u32 intern(Writer *w, const char *chars, int length) {
+  // Strings with a NUL inside cannot key the table, so are never shared
+  bool keyable = (int)strlen(chars) == length;
+  Value index;
+  if (keyable && table_get(&w->interned, chars, &index)) return (u32)AS_INT(index);
+
+  w->offsets = realloc(w->offsets, sizeof(u64) * (w->string_count + 1));
+  w->offsets[w->string_count] = buffer_append(&w->strings, chars, length);
+  buffer_append(&w->strings, "", 1);
+  if (keyable) table_set(&w->interned, chars, value_make_int(w->string_count));
+  return w->string_count++;
+}
+
+static u32 reserve_records(Writer *w, u32 count) {
+  u32 first = w->record_count;
+  w->records = realloc(w->records, sizeof(BundleConstant) * (first + count));
+  memset(w->records + first, 0, sizeof(BundleConstant) * count);
+  w->record_count += count;
+  return first;
+}
+
+static bool encode(Writer *w, Value value, u32 slot, int depth);
+
+// Fill record `slot` with a collection and reserve its items after it
+static void encode_items(Writer *w, u32 slot, u32 kind, int count, int per_item) {
+  u32 first = reserve_records(w, (u32)(count * per_item));
+  w->records[slot] = (BundleConstant){kind, (u32)count, first};
+}
+
+static bool encode(Writer *w, Value value, u32 slot, int depth) {
+  const char *chars;
+  int length;
+  if (depth > BUNDLE_MAX_DEPTH) {
+    w->error = "a constant is nested too deeply to bundle";
+    return false;
+  }
+  if (value_get_string(&value, &chars, &length)) {
+    w->records[slot] = (BundleConstant){BUNDLE_STRING, (u32)length, intern(w, chars, length)};
+    return true;
+  }
+  switch (value.type) {
+    case VALUE_NIL:
+      w->records[slot] = (BundleConstant){BUNDLE_NIL, 0, 0};
+      return true;
+    case VALUE_BOOL:
+      w->records[slot] = (BundleConstant){BUNDLE_BOOL, 0, AS_BOOL(value)};
+      return true;
+    case VALUE_INT:
+      w->records[slot] = (BundleConstant){BUNDLE_INT, 0, (u64)AS_INT(value)};
+      return true;
+    case VALUE_FLOAT: {
+      u64 bits;
+      memcpy(&bits, &AS_FLOAT(value), sizeof(bits));
+      w->records[slot] = (BundleConstant){BUNDLE_FLOAT, 0, bits};
+      return true;
+    }
+    case VALUE_OBJ:
+      break;
+    default:
+      w->error = "a constant of this kind cannot be bundled";
+      return false;
+  }
+
+  switch (OBJ_TYPE(value)) {
+    case OBJ_ARRAY: {
+      ObjArray *array = AS_OBJ_ARRAY(value);
+      encode_items(w, slot, BUNDLE_ARRAY, array->count, 1);
+      for (int i = 0; i < array->count; i++) {
+        if (!encode(w, array->items[i], (u32)w->records[slot].data + i, depth + 1)) return false;
+      }
+      return true;
+    }
+    case OBJ_VECTOR: {
+      ObjVector *vector = AS_VECTOR(value);
+      encode_items(w, slot, BUNDLE_VECTOR, vector->count, 1);
+      for (int i = 0; i < vector->count; i++) {
+        if (!encode(w, vector_get(vector, i), (u32)w->records[slot].data + i, depth + 1)) {
+          return false;
+        }
+      }
+      return true;
+    }
+    case OBJ_MAP: {
+      ObjMap *map = AS_MAP(value);
+      encode_items(w, slot, BUNDLE_MAP, map->count, 2);
+      u32 at = (u32)w->records[slot].data;
+      u64 cursor = 0;
+      Value key, item;
+      while (map_next(map, &cursor, &key, &item)) {
+        if (!encode(w, key, at++, depth + 1) || !encode(w, item, at++, depth + 1)) return false;
+      }
+      return true;
+    }
+    case OBJ_PACKED: {
+      ObjPacked *packed = AS_OBJ_PACKED(value);
+      bool ints = packed->element == PACKED_INT;
+      encode_items(w, slot, ints ? BUNDLE_PACKED_INT : BUNDLE_PACKED_FLOAT, packed->count, 1);
+      u32 first = (u32)w->records[slot].data;
+      for (int i = 0; i < packed->count; i++) {
+        Value item = ints ? value_make_int(packed->as.ints[i])
+                          : value_make_float(packed->as.floats[i]);
+        encode(w, item, first + i, depth + 1);
+      }
+      return true;
+    }
+    case OBJ_FOREIGN:
+      // A compiled regex is stored as its pattern and compiled again when
+      // linked; no other foreign data can be rebuilt from a record
+      if (regex_value_pattern(value, &chars, &length)) {
+        w->records[slot] = (BundleConstant){BUNDLE_REGEX, (u32)length, intern(w, chars, length)};
+        return true;
+      }
+      w->error = "a constant holding foreign data other than a regex cannot be bundled";
+      return false;
+    default:
+      w->error = "a constant of this kind cannot be bundled";
+      return false;
+  }
+}
+
+// Native modules `chunk` imports, each once
+static int find_imports(const Chunk *chunk, const char **names, int max) {
+  int count = 0;
+  for (int at = 0; at < chunk->count;) {
+    if (chunk->code[at] == OP_IMPORT) {
+      const char *name = AS_STRING(chunk->constants[chunk->code[at + 1]]);
+      bool seen = false;
+      for (int i = 0; i < count; i++) seen = seen || strcmp(names[i], name) == 0;
+      if (!seen && count < max) names[count++] = name;
+    }
+    int length = instruction_length(chunk->code, chunk->count, at);
+    if (length < 0) break;
+    at += length;
+  }
+  return count;
+}
+
+static bool write_file(const char *path, const Buffer *archive, const char *interpreter,
+                       const char **error) {
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    *error = "could not create the output file";
+    return false;
+  }
+
+  u64 offset = 0;
+  bool ok = true;
+  if (interpreter != NULL) {
+    FILE *source = fopen(interpreter, "rb");
+    if (source == NULL) {
+      *error = "could not read the interpreter";
+      fclose(file);
+      remove(path);
+      return false;
+    }
+    char block[65536];
+    size_t read;
+    while ((read = fread(block, 1, sizeof(block), source)) > 0) {
+      ok = ok && fwrite(block, 1, read, file) == read;
+      offset += read;
+    }
+    fclose(source);
+    // Keep the archive's fields aligned once mapped
+    static const char zeros[8] = {0};
+    size_t pad = (8 - offset % 8) % 8;
+    ok = ok && fwrite(zeros, 1, pad, file) == pad;
+    offset += pad;
+  }
+
+  ok = ok && fwrite(archive->data, 1, archive->length, file) == archive->length;
+  if (interpreter != NULL) {
+    BundleTrailer trailer = {offset, archive->length, BUNDLE_MAGIC};
+    ok = ok && fwrite(&trailer, sizeof(trailer), 1, file) == 1;
+  }
+  ok = fclose(file) == 0 && ok;
+  if (ok && interpreter != NULL) ok = chmod(path, 0755) == 0;
+  if (!ok) {
+    *error = "could not write the output file";
+    remove(path);
+  }
+  return ok;
+}
+
+bool bundle_write(const Chunk *compiled, const char *path, const char *interpreter,
+                  const char **error) {
+  Chunk pruned;
+  *error = prune(compiled, &pruned);
+  if (*error != NULL) return false;
+  const Chunk *chunk = &pruned;
+
+  const char *imports[256];
+  int import_count = find_imports(chunk, imports, 256);
+  u32 module_count = 1 + (u32)import_count;
+
+  Writer w = {{NULL, 0, 0}, NULL, 0, {0, 0, NULL}, NULL, 0, NULL};
+  table_init(&w.interned);
+  reserve_records(&w, (u32)chunk->constant_count);
+  bool ok = true;
+  for (int i = 0; i < chunk->constant_count && ok; i++) {
+    ok = encode(&w, chunk->constants[i], (u32)i, 0);
+  }
+
+  Buffer archive = {NULL, 0, 0};
+  if (ok) {
+    BundleModule *modules = calloc(module_count, sizeof(BundleModule));
+    modules[0].name = intern(&w, BUNDLE_MAIN, (int)strlen(BUNDLE_MAIN));
+    modules[0].kind = BUNDLE_MODULE_CHUNK;
+    for (int i = 0; i < import_count; i++) {
+      modules[1 + i].name = intern(&w, imports[i], (int)strlen(imports[i]));
+      modules[1 + i].kind = BUNDLE_MODULE_NATIVE;
+    }
+
+    BundleHeader header;
+    memset(&header, 0, sizeof(header));
+    buffer_append(&archive, NULL, sizeof(header));
+    header.index_offset = buffer_append(&archive, NULL, sizeof(BundleModule) * module_count);
+
+    BundleModule *main_module = &modules[0];
+    main_module->code_offset = buffer_append(&archive, chunk->code, chunk->count);
+    main_module->code_length = (u32)chunk->count;
+    buffer_align(&archive);
+    main_module->constants_offset =
+        buffer_append(&archive, w.records, sizeof(BundleConstant) * w.record_count);
+    main_module->constant_count = (u32)chunk->constant_count;
+    main_module->record_count = w.record_count;
+    main_module->lines_offset =
+        buffer_append(&archive, chunk->lines, sizeof(LineStart) * chunk->line_count);
+    main_module->line_count = (u32)chunk->line_count;
+    u32 crc = hash_crc32c(0, chunk->code, chunk->count);
+    crc = hash_crc32c(crc, w.records, sizeof(BundleConstant) * w.record_count);
+    main_module->checksum = hash_crc32c(crc, chunk->lines, sizeof(LineStart) * chunk->line_count);
+
+    // The pool: string offsets, made relative to its start, then the bytes
+    buffer_align(&archive);
+    header.strings_offset = archive.length;
+    u64 base = sizeof(u64) * w.string_count;
+    for (u32 i = 0; i < w.string_count; i++) w.offsets[i] += base;
+    buffer_append(&archive, w.offsets, sizeof(u64) * w.string_count);
+    buffer_append(&archive, w.strings.data, w.strings.length);
+    buffer_align(&archive);
+
+    memcpy(header.magic, BUNDLE_MAGIC, sizeof(header.magic));
+    header.version = BUNDLE_VERSION;
+    header.module_count = module_count;
+    header.string_count = w.string_count;
+    header.strings_checksum = hash_crc32c(0, archive.data + header.strings_offset,
+                                          archive.length - header.strings_offset);
+    header.size = archive.length;
+    memcpy(archive.data, &header, sizeof(header));
+    memcpy(archive.data + header.index_offset, modules, sizeof(BundleModule) * module_count);
+    free(modules);
+
+    ok = write_file(path, &archive, interpreter, error);
+  } else {
+    *error = w.error;
+  }
+
+  free(archive.data);
+  free(w.strings.data);
+  free(w.offsets);
+  free(w.records);
+  table_free(&w.interned);
+  free(pruned.code);
+  free(pruned.constants);
+  free(pruned.lines);
+  return ok;
+}
+
+// ============================================================================
+// Reading
+// ============================================================================
+
+// Whether [offset, offset + length) lies inside the archive
+static bool in_archive(const Bundle *bundle, u64 offset, u64 length) {
+  return offset <= bundle->header->size && length <= bundle->header->size - offset;
+}
+
+// String `index` of the pool, or NULL if it does not lie inside the pool
+// followed by a NUL. A `length` of -1 is found by looking for the NUL.
+static const char *pool_string(const Bundle *bundle, u64 index, i64 length) {
+  const BundleHeader *header = bundle->header;
+  if (index >= header->string_count) return NULL;
+  const u64 *offsets = (const u64*)(bundle->archive + header->strings_offset);
+  u64 pool_size = header->size - header->strings_offset;
+  u64 offset = offsets[index];
+  if (offset >= pool_size) return NULL;
+  const char *chars = (const char*)bundle->archive + header->strings_offset + offset;
+  if (length < 0) return memchr(chars, '\0', pool_size - offset) != NULL ? chars : NULL;
+  return (u64)length < pool_size - offset && chars[length] == '\0' ? chars : NULL;
+}
+
+bool bundle_open(Bundle *bundle, const char *path, const char **error) {
+  memset(bundle, 0, sizeof(Bundle));
+  *error = NULL;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return false;
+  struct stat info;
+  char magic[8];
+  if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(BundleHeader) ||
+      pread(fd, magic, sizeof(magic), 0) != (ssize_t)sizeof(magic)) {
+    close(fd);
+    return false;
+  }
+
+  // An archive on its own, or one appended to an executable
+  u64 file_size = (u64)info.st_size, offset = 0, size = file_size;
+  if (memcmp(magic, BUNDLE_MAGIC, sizeof(magic)) != 0) {
+    BundleTrailer trailer;
+    if (pread(fd, &trailer, sizeof(trailer), (off_t)(file_size - sizeof(trailer))) !=
+            (ssize_t)sizeof(trailer) ||
+        memcmp(trailer.magic, BUNDLE_MAGIC, sizeof(trailer.magic)) != 0) {
+      close(fd);
+      return false;
+    }
+    offset = trailer.offset;
+    size = trailer.size;
+    if (offset % 8 != 0 || offset > file_size || size > file_size - offset ||
+        size < sizeof(BundleHeader)) {
+      close(fd);
+      *error = "the bundle trailer is damaged";
+      return false;
+    }
+  }
+
+  void *mapping = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    *error = "could not map the file";
+    return false;
+  }
+  bundle->mapping = mapping;
+  bundle->mapping_size = file_size;
+  bundle->archive = bundle->mapping + offset;
+  bundle->header = (const BundleHeader*)bundle->archive;
+
+  const BundleHeader *header = bundle->header;
+  if (memcmp(header->magic, BUNDLE_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != BUNDLE_VERSION) {
+    *error = "the bundle is from another version of satori";
+  } else if (header->size != size || header->index_offset % 8 != 0 ||
+             header->strings_offset % 8 != 0 ||
+             !in_archive(bundle, header->index_offset,
+                         (u64)header->module_count * sizeof(BundleModule)) ||
+             !in_archive(bundle, header->strings_offset, (u64)header->string_count * 8)) {
+    *error = "the bundle header is damaged";
+  } else if (hash_crc32c(0, bundle->archive + header->strings_offset,
+                         header->size - header->strings_offset) != header->strings_checksum) {
+    *error = "the bundle's strings fail their checksum";
+  }
+  if (*error != NULL) {
+    bundle_close(bundle);
+    return false;
+  }
+  bundle->modules = (const BundleModule*)(bundle->archive + header->index_offset);
+  return true;
+}
+
+static bool materialize(const Bundle *bundle, const BundleConstant *records, u32 record_count,
+                        u32 index, int depth, Value *value);
+
+// Whether the items of collection record `index` come after it and exist
+static bool items_fit(const BundleConstant *records, u32 record_count, u32 index, int depth,
+                      int per_item) {
+  const BundleConstant *record = &records[index];
+  return depth < BUNDLE_MAX_DEPTH && record->data > index &&
+         record->data <= record_count &&
+         (u64)record->count * per_item <= record_count - record->data;
+}
+
+static bool materialize(const Bundle *bundle, const BundleConstant *records, u32 record_count,
+                        u32 index, int depth, Value *value) {
+  const BundleConstant *record = &records[index];
+  switch (record->kind) {
+    case BUNDLE_NIL:
+      *value = value_make_nil();
+      return true;
+    case BUNDLE_BOOL:
+      *value = value_make_bool(record->data != 0);
+      return true;
+    case BUNDLE_INT:
+      *value = value_make_int((i64)record->data);
+      return true;
+    case BUNDLE_FLOAT: {
+      f64 number;
+      memcpy(&number, &record->data, sizeof(number));
+      *value = value_make_float(number);
+      return true;
+    }
+    case BUNDLE_STRING: {
+      u32 length = record->count;
+      const char *chars = pool_string(bundle, record->data, length);
+      if (chars == NULL) return false;
+      if (length <= VALUE_SHORT_MAX) {
+        *value = value_copy_string(chars, (int)length);
+      } else {
+        // Borrowed from the pool: the chunk is marked not to free it
+        value->type = VALUE_STRING;
+        value->u.as_string = (char*)chars;
+      }
+      return true;
+    }
+    case BUNDLE_REGEX: {
+      const char *pattern = pool_string(bundle, record->data, record->count);
+      const char *error;
+      if (pattern == NULL) return false;
+      *value = regex_value(pattern, (int)record->count, &error);
+      return !IS_NIL(*value);
+    }
+    case BUNDLE_ARRAY: case BUNDLE_VECTOR: case BUNDLE_PACKED_INT: case BUNDLE_PACKED_FLOAT: {
+      if (!items_fit(records, record_count, index, depth, 1)) return false;
+      ObjArray *items = array_make((int)record->count);
+      for (u32 i = 0; i < record->count; i++) {
+        Value item;
+        if (!materialize(bundle, records, record_count, (u32)record->data + i, depth + 1,
+                         &item)) {
+          return false;
+        }
+        array_push(items, item);
+      }
+      if (record->kind == BUNDLE_ARRAY) {
+        *value = OBJ_VAL(items);
+        return true;
+      }
+      if (record->kind == BUNDLE_VECTOR) {
+        *value = OBJ_VAL(vector_from(items->items, items->count));
+        return true;
+      }
+      bool ints = record->kind == BUNDLE_PACKED_INT;
+      ObjPacked *packed = packed_make(ints ? PACKED_INT : PACKED_FLOAT, items->count);
+      for (int i = 0; i < items->count; i++) {
+        if (ints ? !IS_INT(items->items[i]) : !IS_FLOAT(items->items[i])) return false;
+        if (ints) {
+          packed_push_int(packed, AS_INT(items->items[i]));
+        } else {
+          packed_push_float(packed, AS_FLOAT(items->items[i]));
+        }
+      }
+      *value = OBJ_VAL(packed);
+      return true;
+    }
+    case BUNDLE_MAP: {
+      if (!items_fit(records, record_count, index, depth, 2)) return false;
+      ObjMap *map = map_transient(map_make());
+      for (u32 i = 0; i < record->count; i++) {
+        Value key, item;
+        u32 at = (u32)record->data + 2 * i;
+        if (!materialize(bundle, records, record_count, at, depth + 1, &key) ||
+            !materialize(bundle, records, record_count, at + 1, depth + 1, &item) ||
+            !map_valid_key(key)) {
+          return false;
+        }
+        map = map_put(map, key, item);
+      }
+      *value = OBJ_VAL(map_freeze(map));
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+bool bundle_link(Bundle *bundle, const char *name, Chunk *chunk, const char **error) {
+  const BundleModule *module = NULL;
+  for (u32 i = 0; i < bundle->header->module_count; i++) {
+    const BundleModule *entry = &bundle->modules[i];
+    const char *entry_name = pool_string(bundle, entry->name, -1);
+    if (entry_name == NULL) {
+      *error = "the bundle index is damaged";
+      return false;
+    }
+    if (entry->kind == BUNDLE_MODULE_NATIVE && !module_exists(entry_name)) {
+      *error = "the bundle needs a native module this interpreter lacks";
+      return false;
+    }
+    if (entry->kind == BUNDLE_MODULE_CHUNK && strcmp(entry_name, name) == 0) module = entry;
+  }
+  if (module == NULL) {
+    *error = "the bundle has no such module";
+    return false;
+  }
+
+  const u8 *code = bundle->archive + module->code_offset;
+  const BundleConstant *records =
+      (const BundleConstant*)(bundle->archive + module->constants_offset);
+  const LineStart *lines = (const LineStart*)(bundle->archive + module->lines_offset);
+  if (!in_archive(bundle, module->code_offset, module->code_length) ||
+      module->constants_offset % 8 != 0 || module->lines_offset % 8 != 0 ||
+      !in_archive(bundle, module->constants_offset,
+                  (u64)module->record_count * sizeof(BundleConstant)) ||
+      !in_archive(bundle, module->lines_offset, (u64)module->line_count * sizeof(LineStart)) ||
+      module->constant_count > module->record_count || module->constant_count > 256 ||
+      module->code_length > INT32_MAX) {
+    *error = "the bundle index is damaged";
+    return false;
+  }
+  u32 crc = hash_crc32c(0, code, module->code_length);
+  crc = hash_crc32c(crc, records, sizeof(BundleConstant) * module->record_count);
+  crc = hash_crc32c(crc, lines, sizeof(LineStart) * module->line_count);
+  if (crc != module->checksum) {
+    *error = "the module fails its checksum";
+    return false;
+  }
+
+  Value *constants = malloc(sizeof(Value) * (module->constant_count + 1));
+  for (u32 i = 0; i < module->constant_count; i++) {
+    if (!materialize(bundle, records, module->record_count, i, 0, &constants[i])) {
+      free(constants);
+      *error = "the module has a damaged constant";
+      return false;
+    }
+  }
+  for (u32 i = 0; i < module->line_count; i++) {
+    if (lines[i].offset < 0 || (u32)lines[i].offset >= module->code_length ||
+        (i > 0 && lines[i].offset <= lines[i - 1].offset)) {
+      free(constants);
+      *error = "the module has a damaged line table";
+      return false;
+    }
+  }
+  const char *problem = verify_code(code, (int)module->code_length, constants,
+                                    (int)module->constant_count, NULL);
+  if (problem != NULL) {
+    free(constants);
+    *error = problem;
+    return false;
+  }
+
+  chunk_free(chunk);
+  chunk->code = (u8*)code;   // The mapping is private and writable
+  chunk->count = chunk->capacity = (int)module->code_length;
+  chunk->constants = constants;
+  chunk->constant_count = chunk->constant_capacity = (int)module->constant_count;
+  chunk->lines = (LineStart*)lines;
+  chunk->line_count = chunk->line_capacity = (int)module->line_count;
+  chunk->borrowed = true;
+  return true;
+}
+
+void bundle_natives(const Chunk *chunk, Table *names) {
+  for (int at = 0; at < chunk->count;) {
+    u8 opcode = chunk->code[at];
+    if (opcode == OP_GET_GLOBAL || opcode == OP_GET_GLOBAL_CACHED) {
+      table_set(names, AS_STRING(chunk->constants[chunk->code[at + 1]]), value_make_bool(true));
+    }
+    at += instruction_length(chunk->code, chunk->count, at);
+  }
+}
+
+void bundle_close(Bundle *bundle) {
+  if (bundle->mapping != NULL) munmap(bundle->mapping, bundle->mapping_size);
+  memset(bundle, 0, sizeof(Bundle));
+}
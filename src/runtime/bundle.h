@@ -0,0 +1,135 @@
+// src/runtime/bundle.h - Precompiled application bundles
+//
+// A bundle is a script compiled once and saved as an archive that the
+// interpreter maps and runs without lexing, parsing or compiling it. The
+// archive is a header, an index of modules, each module's sections, and
+// one pool of strings shared by every module:
+//
+//   BundleHeader     magic, version, counts, where the index and pool are
+//   BundleModule[]   per module: name, and the offset, size and crc32c of
+//                    its code, constants and line table
+//   sections         bytecode as codegen wrote it, constant records, and
+//                    LineStart entries, each 8-byte aligned
+//   string pool      u64 offset per string, then the strings, each
+//                    NUL-terminated. Every distinct string is stored once.
+//
+// The archive is in host byte order, as bytecode is. It can stand alone
+// or be appended to a copy of the interpreter, followed by a BundleTrailer
+// giving its offset, so that the copy runs it when started.
+//
+// Opening a bundle maps it and checks its header and string pool. A
+// module's sections are not touched until it is linked, which checks them
+// against their crc32c, verifies the bytecode and builds the constants.
+// Code and line tables are run from the mapping itself, which is private
+// and copy-on-write, so the VM can still rewrite instructions in place;
+// string constants point into the pool.
+
+#ifndef SATORI_BUNDLE_H
+#define SATORI_BUNDLE_H
+
+#include "core/common.h"
+#include "vm.h"
+
+#define BUNDLE_MAGIC "SATBNDL"   // 8 bytes with the NUL
+#define BUNDLE_VERSION 2
+
+// Name of the module that holds the entry point
+#define BUNDLE_MAIN "main"
+
+typedef enum {
+  BUNDLE_MODULE_CHUNK = 1,   // Compiled bytecode
+  BUNDLE_MODULE_NATIVE = 2,  // A native module the code imports; no sections
+} BundleModuleKind;
+
+typedef struct {
+  char magic[8];
+  u32 version;
+  u32 module_count;
+  u32 string_count;
+  u32 strings_checksum;      // crc32c of the string pool
+  u64 index_offset;          // BundleModule[module_count]
+  u64 strings_offset;        // String pool
+  u64 size;                  // Bytes in the whole archive
+} BundleHeader;
+
+typedef struct {
+  u32 name;                  // String index
+  u32 kind;                  // BundleModuleKind
+  u64 code_offset;
+  u32 code_length;
+  u32 constant_count;        // Constants the chunk indexes
+  u64 constants_offset;
+  u32 record_count;          // Those constants, then the values inside them
+  u32 line_count;
+  u64 lines_offset;
+  u32 checksum;              // crc32c of code, records and lines, in order
+  u32 reserved;
+} BundleModule;
+
+// A constant. Arrays, vectors and packed arrays list `count` items, and
+// maps `count` keys each followed by its value, as the records from index
+// `data` on; those always come after the record that lists them.
+typedef enum {
+  BUNDLE_NIL = 1,
+  BUNDLE_BOOL,               // data: 0 or 1
+  BUNDLE_INT,                // data: the i64
+  BUNDLE_FLOAT,              // data: the f64's bits
+  BUNDLE_STRING,             // data: string index, count: length
+  BUNDLE_ARRAY,
+  BUNDLE_VECTOR,
+  BUNDLE_MAP,
+  BUNDLE_PACKED_INT,
+  BUNDLE_PACKED_FLOAT,
+  BUNDLE_REGEX,              // data: string index of the pattern, count: length
+} BundleConstantKind;
+
+typedef struct {
+  u32 kind;                  // BundleConstantKind
+  u32 count;
+  u64 data;
+} BundleConstant;
+
+// Last bytes of an interpreter with a bundle appended
+typedef struct {
+  u64 offset;                // Where the archive starts in the file
+  u64 size;
+  char magic[8];
+} BundleTrailer;
+
+typedef struct {
+  u8 *mapping;
+  size_t mapping_size;
+  const u8 *archive;         // Inside the mapping
+  const BundleHeader *header;
+  const BundleModule *modules;
+} Bundle;
+
+// Compile-side: save `chunk` as the main module of a bundle at `path`,
+// with an index entry for each native module it imports. Only what the
+// program can reach is kept: unreachable code, imports of modules it never
+// calls into and unused constants are dropped. With an `interpreter`
+// path, the file is a copy of that executable with the archive appended,
+// and is made executable. Fails, leaving a message in *error, on code that
+// does not verify and constants a bundle cannot hold (foreign objects,
+// natives).
+bool bundle_write(const Chunk *chunk, const char *path, const char *interpreter,
+                  const char **error);
+
+// Map the bundle at `path`: an archive on its own or appended to an
+// executable. Returns false with *error NULL when the file holds no
+// bundle, and with a message when it holds a damaged one.
+bool bundle_open(Bundle *bundle, const char *path, const char **error);
+
+// Verify module `name` and fill `chunk` with it, for a VM to run. The
+// chunk borrows from the bundle, so it must be freed before bundle_close.
+// Native modules the bundle lists must all be built into this interpreter;
+// they are still only loaded when the code imports them.
+bool bundle_link(Bundle *bundle, const char *name, Chunk *chunk, const char **error);
+
+// Add each global a linked `chunk` reads to `names`. As a VM's `natives`,
+// it keeps modules from registering natives the program never calls.
+void bundle_natives(const Chunk *chunk, Table *names);
+
+void bundle_close(Bundle *bundle);
+
+#endif // SATORI_BUNDLE_H
@@ -0,0 +1,130 @@
+// src/runtime/debug.c - Breakpoint debugger implementation
+
+#include "debug.h"
+#include "error/error.h"
+#include <stdlib.h>
+
+static Breakpoint *find(Debugger *debugger, int offset) {
+  for (int i = 0; i < debugger->count; i++) {
+    if (debugger->breakpoints[i].offset == offset) return &debugger->breakpoints[i];
+  }
+  return NULL;
+}
+
+// The breakpoint at `offset`, writing OP_BREAKPOINT there if it is new
+static Breakpoint *arm(Debugger *debugger, VM *vm, int offset) {
+  Breakpoint *breakpoint = find(debugger, offset);
+  if (breakpoint != NULL) return breakpoint;
+
+  if (debugger->capacity < debugger->count + 1) {
+    debugger->capacity = debugger->capacity < 8 ? 8 : debugger->capacity * 2;
+    debugger->breakpoints =
+        realloc(debugger->breakpoints, debugger->capacity * sizeof(Breakpoint));
+  }
+  breakpoint = &debugger->breakpoints[debugger->count++];
+  breakpoint->offset = offset;
+  breakpoint->opcode = vm->chunk.code[offset];
+  breakpoint->user = false;
+  breakpoint->step = false;
+  vm->chunk.code[offset] = OP_BREAKPOINT;
+  return breakpoint;
+}
+
+// Put back the opcode and forget the breakpoint, unless it is still wanted
+static void disarm_if_unused(Debugger *debugger, VM *vm, Breakpoint *breakpoint) {
+  if (breakpoint->user || breakpoint->step) return;
+  vm->chunk.code[breakpoint->offset] = breakpoint->opcode;
+  *breakpoint = debugger->breakpoints[--debugger->count];
+}
+
+// Offset where `line`'s code first starts, or -1
+static int line_start(const Chunk *chunk, int line) {
+  for (int i = 0; i < chunk->line_count; i++) {
+    if (chunk->lines[i].line == line && chunk->lines[i].offset < chunk->count) {
+      return chunk->lines[i].offset;
+    }
+  }
+  return -1;
+}
+
+void debug_attach(Debugger *debugger, VM *vm, DebugHandler handler, void *context) {
+  debugger->breakpoints = NULL;
+  debugger->count = 0;
+  debugger->capacity = 0;
+  debugger->handler = handler;
+  debugger->context = context;
+  vm->debugger = debugger;
+}
+
+void debug_detach(Debugger *debugger, VM *vm) {
+  for (int i = 0; i < debugger->count; i++) {
+    vm->chunk.code[debugger->breakpoints[i].offset] = debugger->breakpoints[i].opcode;
+  }
+  free(debugger->breakpoints);
+  debugger->breakpoints = NULL;
+  debugger->count = 0;
+  debugger->capacity = 0;
+  vm->debugger = NULL;
+}
+
+bool debug_break_at(Debugger *debugger, VM *vm, int line) {
+  int offset = line_start(&vm->chunk, line);
+  if (offset < 0) return false;
+  arm(debugger, vm, offset)->user = true;
+  return true;
+}
+
+bool debug_clear(Debugger *debugger, VM *vm, int line) {
+  int offset = line_start(&vm->chunk, line);
+  Breakpoint *breakpoint = offset < 0 ? NULL : find(debugger, offset);
+  if (breakpoint == NULL || !breakpoint->user) return false;
+  breakpoint->user = false;
+  disarm_if_unused(debugger, vm, breakpoint);
+  return true;
+}
+
+void debug_step(Debugger *debugger, VM *vm, int line) {
+  const Chunk *chunk = &vm->chunk;
+  for (int i = 0; i < chunk->line_count; i++) {
+    if (chunk->lines[i].line != line && chunk->lines[i].line > 0 &&
+        chunk->lines[i].offset < chunk->count) {
+      arm(debugger, vm, chunk->lines[i].offset)->step = true;
+    }
+  }
+}
+
+int debug_hit(VM *vm, int offset) {
+  Debugger *debugger = vm->debugger;
+  Breakpoint *breakpoint = debugger == NULL ? NULL : find(debugger, offset);
+  if (breakpoint == NULL) {
+    error_fatal("Breakpoint at offset %d has no debugger", offset);
+    return -1;
+  }
+  u8 opcode = breakpoint->opcode;
+
+  // Whichever step breakpoint was hit, the step is over. Walk down, as
+  // disarming moves the last breakpoint into the freed place.
+  for (int i = debugger->count - 1; i >= 0; i--) {
+    if (debugger->breakpoints[i].step) {
+      debugger->breakpoints[i].step = false;
+      disarm_if_unused(debugger, vm, &debugger->breakpoints[i]);
+    }
+  }
+
+  int line = chunk_line(&vm->chunk, offset);
+  switch (debugger->handler(debugger, vm, line)) {
+    case DEBUG_STOP: return -1;
+    case DEBUG_STEP: debug_step(debugger, vm, line); break;
+    case DEBUG_CONTINUE: break;
+  }
+  return opcode;
+}
+
+void debug_patch(VM *vm, int offset, u8 opcode) {
+  Breakpoint *breakpoint = vm->debugger == NULL ? NULL : find(vm->debugger, offset);
+  if (breakpoint != NULL) {
+    breakpoint->opcode = opcode;
+  } else {
+    vm->chunk.code[offset] = opcode;
+  }
+}
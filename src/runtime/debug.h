@@ -0,0 +1,64 @@
+// src/runtime/debug.h - Breakpoint debugger
+//
+// A breakpoint is an OP_BREAKPOINT written over the first opcode of a
+// line's bytecode. The VM hands it to debug_hit, which calls the handler
+// and returns the opcode it replaced for the VM to run, leaving the
+// breakpoint in place. Nothing else is instrumented, so a script runs at
+// full speed with the debugger attached until a breakpoint is hit.
+//
+// Stepping uses the line table: every other line's first opcodes get a
+// one-shot breakpoint, and the first one hit clears them all.
+
+#ifndef SATORI_DEBUG_H
+#define SATORI_DEBUG_H
+
+#include "core/common.h"
+#include "vm.h"
+
+typedef enum {
+  DEBUG_CONTINUE,   // Run to the next breakpoint
+  DEBUG_STEP,       // Run until a different line starts
+  DEBUG_STOP,       // Abandon the script; vm_run returns false
+} DebugAction;
+
+typedef struct Debugger Debugger;
+
+// Called when execution reaches a breakpoint, before the line runs
+typedef DebugAction (*DebugHandler)(Debugger *debugger, VM *vm, int line);
+
+typedef struct {
+  int offset;
+  u8 opcode;        // The opcode OP_BREAKPOINT stands in for
+  bool user;        // Set with debug_break_at
+  bool step;        // Set by a step; cleared at the next stop
+} Breakpoint;
+
+struct Debugger {
+  Breakpoint *breakpoints;
+  int count;
+  int capacity;
+  DebugHandler handler;
+  void *context;    // For the handler
+};
+
+// Attach to a VM whose chunk is compiled; detaching restores its code
+void debug_attach(Debugger *debugger, VM *vm, DebugHandler handler, void *context);
+void debug_detach(Debugger *debugger, VM *vm);
+
+// Set or clear a breakpoint at the start of `line`. Setting fails when no
+// code starts on that line, clearing when there was no breakpoint.
+bool debug_break_at(Debugger *debugger, VM *vm, int line);
+bool debug_clear(Debugger *debugger, VM *vm, int line);
+
+// Stop at the next line other than `line` (0 stops at the first line)
+void debug_step(Debugger *debugger, VM *vm, int line);
+
+// For the VM: handle the breakpoint at `offset`, returning the opcode to
+// run there or -1 to stop
+int debug_hit(VM *vm, int offset);
+
+// For the VM: change the opcode a breakpoint at `offset` stands in for,
+// as self-rewriting instructions do
+void debug_patch(VM *vm, int offset, u8 opcode);
+
+#endif // SATORI_DEBUG_H
@@ -12,9 +12,39 @@
 static ModuleDescriptor builtin_modules[] = {
   {"io", io_module_init},
   {"string", string_module_init},
+  {"regex", regex_module_init},
+  {"hash", hash_module_init},
+  {"compress", compress_module_init},
+  {"csv", csv_module_init},
+  {"sort", sort_module_init},
+  {"kv", kv_module_init},
+  {"ipc", ipc_module_init},
+  {"persistent", persistent_module_init},
+  {"trace", trace_module_init},
+  {"metrics", metrics_module_init},
   {NULL, NULL}  // Sentinel
 };
 
+// Natives a comptime expression may call: their result depends only on
+// their arguments, and they touch nothing outside the VM that runs them
+// (no output, files, sockets or process-wide registries)
+static const char *pure_natives[] = {
+  "string.to_upper", "string.to_lower", "string.is_utf8", "string.from_bytes",
+  "string.char_count", "string.char_at", "string.slice",
+  "regex.compile", "regex.is_match", "regex.find", "regex.find_all", "regex.count",
+  "hash.xxh3", "hash.wyhash", "hash.crc32c", "hash.hasher", "hash.update", "hash.digest",
+  "hash.hex",
+  "compress.compress", "compress.decompress", "compress.encoder", "compress.decoder",
+  "compress.write", "compress.finish",
+  "csv.reader", "csv.next", "csv.column_int", "csv.column_float",
+  "sort.sort", "sort.sort_by_key",
+  "persistent.vector", "persistent.map", "persistent.len", "persistent.get",
+  "persistent.has", "persistent.set", "persistent.push", "persistent.pop",
+  "persistent.remove", "persistent.keys", "persistent.values", "persistent.to_array",
+  "persistent.transient", "persistent.freeze",
+  NULL  // Sentinel
+};
+
 void module_system_init(VM *vm) {
   table_init(&vm->globals);
   table_init(&vm->loaded_modules);
@@ -50,7 +80,24 @@ bool module_load(VM *vm, const char *name) {
   return false;
 }
 
+bool module_exists(const char *name) {
+  for (int i = 0; builtin_modules[i].name != NULL; i++) {
+    if (strcmp(builtin_modules[i].name, name) == 0) return true;
+  }
+  return false;
+}
+
+bool module_native_pure(const char *name) {
+  for (int i = 0; pure_natives[i] != NULL; i++) {
+    if (strcmp(pure_natives[i], name) == 0) return true;
+  }
+  return false;
+}
+
 void module_register_native(VM *vm, const char *name, NativeFn function) {
+  Value unused;
+  if (vm->natives != NULL && !table_get(vm->natives, name, &unused)) return;
   Value fn_value = value_make_native_fn(function);
   table_set(&vm->globals, name, fn_value);
+  vm->globals_version++;
 }
@@ -23,10 +23,22 @@ typedef struct {
 void module_system_init(VM *vm);
 void module_system_free(VM *vm);
 bool module_load(VM *vm, const char *name);
+bool module_exists(const char *name);  // Built into this interpreter
+bool module_native_pure(const char *name);  // "module.function" is safe at comptime
 void module_register_native(VM *vm, const char *name, NativeFn function);
 
 // Built-in module declarations
 void io_module_init(VM *vm);
 void string_module_init(VM *vm);
+void regex_module_init(VM *vm);
+void hash_module_init(VM *vm);
+void compress_module_init(VM *vm);
+void csv_module_init(VM *vm);
+void sort_module_init(VM *vm);
+void kv_module_init(VM *vm);
+void ipc_module_init(VM *vm);
+void persistent_module_init(VM *vm);
+void trace_module_init(VM *vm);
+void metrics_module_init(VM *vm);
 
 #endif // SATORI_MODULE_H
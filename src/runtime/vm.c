@@ -4,8 +4,15 @@
 
 #include "runtime/vm.h"
 #include "runtime/module.h"
+#include "runtime/debug.h"
 #include "core/value.h"
+#include "core/object.h"
+#include "core/gc.h"
+#include "core/memory.h"
 #include "core/table.h"
+#include "core/hamt.h"
+#include "core/utf8.h"
+#include "core/vector.h"
 #include "error/error.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -19,12 +26,25 @@ void chunk_init(Chunk *chunk) {
   chunk->constants = NULL;
   chunk->constant_count = 0;
   chunk->constant_capacity = 0;
+  chunk->lines = NULL;
+  chunk->line_count = 0;
+  chunk->line_capacity = 0;
+  chunk->line = 0;
+  chunk->borrowed = false;
 }
 
 void chunk_free(Chunk *chunk) {
-  free(chunk->code);
-  for (int i = 0; i < chunk->constant_count; i++) {
-    value_free(chunk->constants[i]);
+  if (!chunk->borrowed) {
+    free(chunk->code);
+    for (int i = 0; i < chunk->constant_count; i++) {
+      // String objects among the constants are literals the chunk owns
+      if (IS_OBJ_STRING(chunk->constants[i])) {
+        object_free(AS_OBJ(chunk->constants[i]));
+      } else {
+        value_free(chunk->constants[i]);
+      }
+    }
+    free(chunk->lines);
   }
   free(chunk->constants);
   chunk_init(chunk);
@@ -36,6 +56,20 @@ void chunk_write(Chunk *chunk, u8 byte) {
     chunk->capacity = old_capacity < 8 ? 8 : old_capacity * 2;
     chunk->code = realloc(chunk->code, chunk->capacity);
   }
+
+  // Start a line table entry when the line changes, first dropping one
+  // that no byte was written under
+  if (chunk->line_count > 0 && chunk->lines[chunk->line_count - 1].offset == chunk->count) {
+    chunk->line_count--;
+  }
+  if (chunk->line_count == 0 || chunk->lines[chunk->line_count - 1].line != chunk->line) {
+    if (chunk->line_capacity < chunk->line_count + 1) {
+      chunk->line_capacity = chunk->line_capacity < 8 ? 8 : chunk->line_capacity * 2;
+      chunk->lines = realloc(chunk->lines, chunk->line_capacity * sizeof(LineStart));
+    }
+    chunk->lines[chunk->line_count++] = (LineStart){chunk->count, chunk->line};
+  }
+
   chunk->code[chunk->count] = byte;
   chunk->count++;
 }
@@ -51,20 +85,102 @@ int chunk_add_constant(Chunk *chunk, Value value) {
   return chunk->constant_count++;
 }
 
+int chunk_line(const Chunk *chunk, int offset) {
+  int low = 0, high = chunk->line_count - 1, line = 0;
+  while (low <= high) {
+    int mid = low + (high - low) / 2;
+    if (chunk->lines[mid].offset <= offset) {
+      line = chunk->lines[mid].line;
+      low = mid + 1;
+    } else {
+      high = mid - 1;
+    }
+  }
+  return line;
+}
+
 // VM operations (value functions now in core/value.c)
 void vm_init(VM *vm) {
   chunk_init(&vm->chunk);
   vm->ip = vm->chunk.code;
   vm->stack_top = 0;
   vm->local_count = 0;
+  vm->global_caches = NULL;
+  vm->global_cache_count = 0;
+  vm->globals_version = 1;  // Zeroed caches never match
+  vm->natives = NULL;
+  vm->debugger = NULL;
+  gc_init(&vm->gc);
+  vm_set_limits(vm, 0, 0);
   module_system_init(vm);
 }
 
 void vm_free(VM *vm) {
+  gc_free(&vm->gc);
   chunk_free(&vm->chunk);
+  free(vm->global_caches);
+  vm->global_caches = NULL;
+  vm->global_cache_count = 0;
   module_system_free(vm);
 }
 
+// Collect again once the heap has doubled, or, under a quota, once half
+// the room left is used, so garbage is freed before the quota refuses
+// anything
+static void schedule_gc(VM *vm) {
+  i64 used = vm->heap.used;
+  i64 growth = used > SATORI_GC_MIN_HEAP ? used : SATORI_GC_MIN_HEAP;
+  if (vm->heap.limit != INT64_MAX && (vm->heap.limit - used) / 2 < growth) {
+    growth = (vm->heap.limit - used) / 2;
+  }
+  vm->next_gc = used + growth;
+}
+
+static void add_table_roots(Table *table, Value *roots, int *count) {
+  for (int i = 0; i < table->capacity; i++) {
+    if (table->entries[i].key != NULL) roots[(*count)++] = table->entries[i].value;
+  }
+}
+
+// Free what the script can no longer reach. Roots are everything the
+// interpreter may still read: the stack, locals, globals and module
+// tables, constants and global caches. Only called at safepoints, where
+// no native holds an object the roots miss. Marking and sweeping run on
+// the collector's own state, so the quota waits for the next safepoint.
+static void collect_garbage(VM *vm) {
+  jmp_buf *escape = mem_defer_limit();
+  int capacity = vm->stack_top + vm->local_count + vm->globals.capacity +
+                 vm->loaded_modules.capacity + vm->chunk.constant_count +
+                 vm->global_cache_count;
+  Value *roots = (Value*)mem_alloc(sizeof(Value) * (capacity > 0 ? capacity : 1));
+  int count = 0;
+  for (int i = 0; i < vm->stack_top; i++) roots[count++] = vm->stack[i];
+  for (int i = 0; i < vm->local_count; i++) roots[count++] = vm->locals[i];
+  add_table_roots(&vm->globals, roots, &count);
+  add_table_roots(&vm->loaded_modules, roots, &count);
+  for (int i = 0; i < vm->chunk.constant_count; i++) roots[count++] = vm->chunk.constants[i];
+  for (int i = 0; i < vm->global_cache_count; i++) roots[count++] = vm->global_caches[i].value;
+
+  size_t markers = 1 + vm->gc.count / SATORI_GC_MARKER_OBJECTS;
+  gc_mark(&vm->gc, roots, count, markers < SATORI_GC_MAX_MARKERS ? (int)markers
+                                                                 : SATORI_GC_MAX_MARKERS);
+  mem_free(roots);
+  // Left to itself, each page is swept when a new one is started. A quota
+  // needs the bytes back now.
+  if (vm->heap.limit != INT64_MAX) gc_sweep(&vm->gc, -1);
+  mem_resume_limit(escape);
+  schedule_gc(vm);
+}
+
+void vm_set_limits(VM *vm, u64 max_instructions, size_t max_heap) {
+  vm->budget = max_instructions == 0 || max_instructions > INT64_MAX
+                   ? INT64_MAX : (i64)max_instructions;
+  vm->heap.used = 0;
+  vm->heap.limit = max_heap == 0 || max_heap > INT64_MAX ? INT64_MAX : (i64)max_heap;
+  vm->limit_hit = VM_LIMIT_NONE;
+  schedule_gc(vm);
+}
+
 static void stack_push(VM *vm, Value value) {
   if (vm->stack_top >= SATORI_STACK_MAX) {
     error_fatal("Stack overflow");
@@ -94,7 +210,150 @@ static Value builtin_println(int arg_count, Value *args) {
   return value_make_nil();
 }
 
-bool vm_run(VM *vm) {
+// Replace the top `count` values with one string of their text. Every part
+// is measured first so the result is allocated once, at its final size.
+static void build_string(VM *vm, int count) {
+  Value *parts = &vm->stack[vm->stack_top - count];
+  const char *chars[SATORI_BUILD_STRING_MAX];
+  int lengths[SATORI_BUILD_STRING_MAX];
+  char scratch[SATORI_BUILD_STRING_MAX][32];
+  int total = 0;
+
+  for (int i = 0; i < count; i++) {
+    // Strings are copied in place and objects formatted straight into the
+    // result; scalars are short, so they are formatted up front
+    if (!value_get_string(&parts[i], &chars[i], &lengths[i])) {
+      if (IS_OBJ(parts[i])) {
+        chars[i] = NULL;
+        lengths[i] = object_format(AS_OBJ(parts[i]), NULL, 0);
+      } else {
+        chars[i] = scratch[i];
+        lengths[i] = value_format(parts[i], scratch[i], sizeof(scratch[i]));
+      }
+    }
+    total += lengths[i];
+  }
+
+  // Short results stay inside the Value and never touch the heap
+  char short_buffer[VALUE_SHORT_MAX + 1];
+  char *buffer = total <= VALUE_SHORT_MAX ? short_buffer : mem_alloc(total + 1);
+  int length = 0;
+  for (int i = 0; i < count; i++) {
+    if (chars[i] != NULL) {
+      memcpy(buffer + length, chars[i], lengths[i]);
+    } else {
+      object_format(AS_OBJ(parts[i]), buffer + length, lengths[i] + 1);
+    }
+    length += lengths[i];
+  }
+  buffer[total] = '\0';
+
+  vm->stack_top -= count;
+  stack_push(vm, buffer == short_buffer ? value_copy_string(buffer, total)
+                                        : OBJ_VAL(string_take(buffer, total)));
+}
+
+// Loop head opcode for iterating `iterable`, or -1 if it cannot be iterated
+static int for_opcode(Value iterable) {
+  if (IS_STRING(iterable) || IS_OBJ_STRING(iterable)) return OP_FOR_STRING;
+  if (!IS_OBJ(iterable)) return -1;
+  switch (OBJ_TYPE(iterable)) {
+    case OBJ_ARRAY: return OP_FOR_ARRAY;
+    case OBJ_PACKED: return OP_FOR_PACKED;
+    case OBJ_VECTOR: return OP_FOR_VECTOR;
+    case OBJ_MAP: return OP_FOR_MAP;
+    case OBJ_FOREIGN:
+      return ((ObjForeign*)AS_OBJ(iterable))->kind->next != NULL ? OP_FOR_FOREIGN : -1;
+    default: return -1;
+  }
+}
+
+// Items `source` will yield, when that is known without iterating
+static int known_length(Value source) {
+  if (!IS_OBJ(source)) return 0;
+  switch (OBJ_TYPE(source)) {
+    case OBJ_ARRAY: return AS_OBJ_ARRAY(source)->count;
+    case OBJ_PACKED: return AS_OBJ_PACKED(source)->count;
+    case OBJ_VECTOR: return AS_VECTOR(source)->count;
+    case OBJ_MAP: return AS_MAP(source)->count;
+    default: return 0;
+  }
+}
+
+static inline u16 read_offset(const u8 *at) {
+  return (u16)((at[0] << 8) | at[1]);
+}
+
+// The int a float subject stands for in a match: only a whole float in
+// i64's range matches int patterns
+static inline bool match_int(Value subject, i64 *out) {
+  if (IS_INT(subject)) {
+    *out = AS_INT(subject);
+    return true;
+  }
+  if (!IS_FLOAT(subject)) return false;
+  f64 f = AS_FLOAT(subject);
+  if (!(f >= -9223372036854775808.0 && f < 9223372036854775808.0) || (f64)(i64)f != f) {
+    return false;
+  }
+  *out = (i64)f;
+  return true;
+}
+
+// Offset of the OP_SWITCH_RANGES entry holding `subject`, or `fallback`.
+// Ints are compared exactly; a float matches whole ranges but not the
+// entries for single int patterns, unless it equals the int. A range
+// entry holds the floats up to, not including, last + 1.
+static u16 find_range(Value subject, const u8 *table, int count, u16 fallback) {
+  if (!IS_INT(subject) && !IS_FLOAT(subject)) return fallback;
+  int low = 0, high = count - 1;
+  while (low <= high) {
+    int mid = low + (high - low) / 2;
+    const u8 *entry = table + mid * SWITCH_RANGE_SIZE;
+    i64 start, last;
+    memcpy(&start, entry, sizeof(i64));
+    memcpy(&last, entry + sizeof(i64), sizeof(i64));
+    bool below, above;
+    if (IS_INT(subject)) {
+      below = AS_INT(subject) < start;
+      above = AS_INT(subject) > last;
+    } else {
+      below = !(AS_FLOAT(subject) >= (f64)start);  // NaN sorts below all
+      above = AS_FLOAT(subject) >= (f64)last + 1.0;
+    }
+    if (below) {
+      high = mid - 1;
+    } else if (above) {
+      low = mid + 1;
+    } else {
+      bool exact = entry[2 * sizeof(i64) + 2];
+      if (exact && IS_FLOAT(subject) && AS_FLOAT(subject) != (f64)start) return fallback;
+      return read_offset(entry + 2 * sizeof(i64));
+    }
+  }
+  return fallback;
+}
+
+// Rewrite the opcode at `at`, or the one a breakpoint there stands in for
+static inline void patch_opcode(VM *vm, u8 *at, u8 opcode) {
+  if (*at == OP_BREAKPOINT) {
+    debug_patch(vm, (int)(at - vm->chunk.code), opcode);
+  } else {
+    *at = opcode;
+  }
+}
+
+// Bind a loop's variables: the item, after its index or key if there are two
+static inline void bind_loop_vars(VM *vm, int slot, int count, Value index, Value item) {
+  if (count == 2) {
+    vm->locals[slot] = index;
+    vm->locals[slot + 1] = item;
+  } else {
+    vm->locals[slot] = item;
+  }
+}
+
+static bool run(VM *vm) {
   vm->ip = vm->chunk.code;
 
 #define READ_BYTE() (*vm->ip++)
@@ -102,6 +361,44 @@ bool vm_run(VM *vm) {
 #define READ_STRING() AS_STRING(READ_CONSTANT())
 #define READ_SHORT() (vm->ip += 2, (u16)((vm->ip[-2] << 8) | vm->ip[-1]))
 
+// Operands of a loop head: its state slots, its variables, and the jump
+// past the loop. locals[state] holds the iterable (a range's end) and
+// locals[state + 1] the cursor, so iterating allocates nothing.
+#define READ_LOOP_HEAD()                                 \
+  u8 state = READ_BYTE();                                \
+  u8 var = READ_BYTE();                                  \
+  u8 var_count = READ_BYTE();                            \
+  u16 exit = READ_SHORT();                               \
+  i64 cursor = AS_INT(vm->locals[state + 1])
+
+// Specialized binary operators: the right operand is popped and the left
+// replaced in place, with no tag checks, as codegen proved both types
+#define INT_BINARY(make, op)                                           \
+  do {                                                                 \
+    i64 b = AS_INT(vm->stack[--vm->stack_top]);                        \
+    Value *a = &vm->stack[vm->stack_top - 1];                          \
+    *a = make(AS_INT(*a) op b);                                        \
+  } while (0)
+#define FLOAT_BINARY(make, op)                                         \
+  do {                                                                 \
+    f64 b = AS_FLOAT(vm->stack[--vm->stack_top]);                      \
+    Value *a = &vm->stack[vm->stack_top - 1];                          \
+    *a = make(AS_FLOAT(*a) op b);                                      \
+  } while (0)
+
+// Safepoint, only at back-edges and calls: collect if the heap has grown
+// enough, charge `cost` to the budget and stop if it is spent or the heap
+// is over quota. Without limits both of the last compares always pass.
+#define CHECK_LIMITS(cost)                                                 \
+  do {                                                                     \
+    if (vm->heap.used >= vm->next_gc) collect_garbage(vm);                 \
+    vm->budget -= (cost);                                                  \
+    if (vm->budget < 0 || vm->heap.used > vm->heap.limit) {                \
+      vm->limit_hit = vm->budget < 0 ? VM_LIMIT_INSTRUCTIONS : VM_LIMIT_HEAP; \
+      return false;                                                        \
+    }                                                                      \
+  } while (0)
+
   for (;;) {
 #ifdef SATORI_DEBUG_TRACE_EXECUTION
     printf("Stack: ");
@@ -114,6 +411,7 @@ bool vm_run(VM *vm) {
 #endif
 
     u8 instruction = READ_BYTE();
+  dispatch:
     switch (instruction) {
     case OP_CONSTANT: {
       Value constant = READ_CONSTANT();
@@ -150,15 +448,33 @@ bool vm_run(VM *vm) {
     }
     
     case OP_GET_GLOBAL: {
-      const char *name = READ_STRING();
+      // Look the name up, then turn the site into a cached one. The
+      // cache is keyed by the name's constant; codegen adds one per site.
+      u8 constant = READ_BYTE();
+      const char *name = AS_STRING(vm->chunk.constants[constant]);
       Value value;
       if (!table_get(&vm->globals, name, &value)) {
         error_fatal("Undefined global '%s'", name);
         return false;
       }
+      vm->global_caches[constant].version = vm->globals_version;
+      vm->global_caches[constant].value = value;
+      patch_opcode(vm, vm->ip - 2, OP_GET_GLOBAL_CACHED);
       stack_push(vm, value);
       break;
     }
+
+    case OP_GET_GLOBAL_CACHED: {
+      GlobalCache *cache = &vm->global_caches[READ_BYTE()];
+      if (cache->version != vm->globals_version) {
+        // A module was loaded since: look up again
+        vm->ip--;
+        instruction = OP_GET_GLOBAL;
+        goto dispatch;
+      }
+      stack_push(vm, cache->value);
+      break;
+    }
     
     case OP_CALL_NATIVE: {
       u8 arg_count = READ_BYTE();
@@ -174,15 +490,19 @@ bool vm_run(VM *vm) {
       // Prepare arguments (they're already on the stack)
       Value *args = &vm->stack[vm->stack_top - arg_count];
       
-      // Call the native function
+      // Call the native function. Natives are not written to be cut short
+      // halfway, so the quota waits for the safepoint after the call.
       NativeFn native = AS_NATIVE_FN(callee);
+      jmp_buf *escape = mem_defer_limit();
       Value result = native(arg_count, args);
+      mem_resume_limit(escape);
       
       // Pop arguments and function from stack
       vm->stack_top -= arg_count + 1;
       
       // Push result
       stack_push(vm, result);
+      CHECK_LIMITS(1);
       break;
     }
 
@@ -197,8 +517,15 @@ bool vm_run(VM *vm) {
     
     // Arithmetic operations
     case OP_ADD: {
-      Value b = stack_pop(vm);
-      Value a = stack_pop(vm);
+      Value b = stack_peek(vm, 0);
+      Value a = stack_peek(vm, 1);
+      const char *chars;
+      int length;
+      if (value_get_string(&a, &chars, &length) || value_get_string(&b, &chars, &length)) {
+        build_string(vm, 2);
+        break;
+      }
+      vm->stack_top -= 2;
       if (IS_INT(a) && IS_INT(b)) {
         stack_push(vm, value_make_int(AS_INT(a) + AS_INT(b)));
       } else {
@@ -335,6 +662,39 @@ bool vm_run(VM *vm) {
       break;
     }
     
+    case OP_ADD_INT: INT_BINARY(value_make_int, +); break;
+    case OP_SUBTRACT_INT: INT_BINARY(value_make_int, -); break;
+    case OP_MULTIPLY_INT: INT_BINARY(value_make_int, *); break;
+    case OP_MODULO_INT: {
+      if (AS_INT(stack_peek(vm, 0)) == 0) {
+        error_fatal("Modulo by zero");
+        return false;
+      }
+      INT_BINARY(value_make_int, %);
+      break;
+    }
+    case OP_EQUAL_INT: INT_BINARY(value_make_bool, ==); break;
+    case OP_NOT_EQUAL_INT: INT_BINARY(value_make_bool, !=); break;
+    case OP_LESS_INT: INT_BINARY(value_make_bool, <); break;
+    case OP_LESS_EQUAL_INT: INT_BINARY(value_make_bool, <=); break;
+    case OP_GREATER_INT: INT_BINARY(value_make_bool, >); break;
+    case OP_GREATER_EQUAL_INT: INT_BINARY(value_make_bool, >=); break;
+    case OP_ADD_FLOAT: FLOAT_BINARY(value_make_float, +); break;
+    case OP_SUBTRACT_FLOAT: FLOAT_BINARY(value_make_float, -); break;
+    case OP_MULTIPLY_FLOAT: FLOAT_BINARY(value_make_float, *); break;
+    case OP_DIVIDE_FLOAT: {
+      if (AS_FLOAT(stack_peek(vm, 0)) == 0.0) {
+        error_fatal("Division by zero");
+        return false;
+      }
+      FLOAT_BINARY(value_make_float, /);
+      break;
+    }
+    case OP_LESS_FLOAT: FLOAT_BINARY(value_make_bool, <); break;
+    case OP_LESS_EQUAL_FLOAT: FLOAT_BINARY(value_make_bool, <=); break;
+    case OP_GREATER_FLOAT: FLOAT_BINARY(value_make_bool, >); break;
+    case OP_GREATER_EQUAL_FLOAT: FLOAT_BINARY(value_make_bool, >=); break;
+    
     // Control flow
     case OP_JUMP: {
       u16 offset = READ_SHORT();
@@ -356,6 +716,206 @@ bool vm_run(VM *vm) {
     case OP_LOOP: {
       u16 offset = READ_SHORT();
       vm->ip -= offset;
+      CHECK_LIMITS(offset);
+      break;
+    }
+
+    case OP_SWITCH: {
+      Value subject = stack_pop(vm);
+      i64 min = AS_INT(READ_CONSTANT());
+      u16 count = READ_SHORT();
+      u16 offset = READ_SHORT();
+      i64 value;
+      if (match_int(subject, &value) && (u64)value - (u64)min < count) {
+        offset = read_offset(vm->ip + 2 * ((u64)value - (u64)min));
+      }
+      vm->ip += 2 * count + offset;
+      break;
+    }
+
+    case OP_SWITCH_RANGES: {
+      Value subject = stack_pop(vm);
+      u16 count = READ_SHORT();
+      u16 fallback = READ_SHORT();
+      u16 offset = find_range(subject, vm->ip, count, fallback);
+      vm->ip += count * SWITCH_RANGE_SIZE + offset;
+      break;
+    }
+
+    case OP_MATCH_KEYS: {
+      Value subject = stack_pop(vm);
+      ObjMap *keys = AS_MAP(READ_CONSTANT());
+      u16 count = READ_SHORT();
+      u16 offset = READ_SHORT();
+      Value index;
+      i64 value;
+      if (IS_FLOAT(subject) && match_int(subject, &value)) subject = value_make_int(value);
+      if (map_valid_key(subject) && map_get(keys, subject, &index)) {
+        offset = read_offset(vm->ip + 2 * AS_INT(index));
+      }
+      vm->ip += 2 * count + offset;
+      break;
+    }
+
+    case OP_FOR_PREP: {
+      u8 *head = vm->ip;
+      u8 state = head[1];
+      int end_slot = head[2] + head[3];
+      if (*head == OP_FOR_RANGE) {
+        Value end = stack_pop(vm);
+        Value start = stack_pop(vm);
+        if (!IS_INT(start) || !IS_INT(end)) {
+          error_fatal("Range bounds must be integers");
+          return false;
+        }
+        vm->locals[state] = end;
+        vm->locals[state + 1] = start;
+      } else {
+        Value iterable = stack_pop(vm);
+        int op = for_opcode(iterable);
+        if (op < 0) {
+          error_fatal("Cannot iterate over this value");
+          return false;
+        }
+        patch_opcode(vm, head, (u8)op);
+        i64 cursor = 0;
+        if (op == OP_FOR_STRING) {
+          // The cursor keeps the length above the byte offset
+          const char *chars;
+          int length;
+          value_get_string(&iterable, &chars, &length);
+          cursor = (i64)length << 32;
+        }
+        vm->locals[state] = iterable;
+        vm->locals[state + 1] = value_make_int(cursor);
+      }
+      if (end_slot > vm->local_count) vm->local_count = end_slot;
+      break;
+    }
+
+    case OP_FOR_RANGE: {
+      READ_LOOP_HEAD();
+      if (cursor >= AS_INT(vm->locals[state])) {
+        vm->ip += exit;
+        break;
+      }
+      vm->locals[state + 1] = value_make_int(cursor + 1);
+      vm->locals[var] = value_make_int(cursor);
+      (void)var_count;
+      break;
+    }
+
+    case OP_FOR_ARRAY: {
+      READ_LOOP_HEAD();
+      ObjArray *array = AS_OBJ_ARRAY(vm->locals[state]);
+      if (cursor >= array->count) {
+        vm->ip += exit;
+        break;
+      }
+      vm->locals[state + 1] = value_make_int(cursor + 1);
+      bind_loop_vars(vm, var, var_count, value_make_int(cursor), array->items[cursor]);
+      break;
+    }
+
+    case OP_FOR_PACKED: {
+      READ_LOOP_HEAD();
+      ObjPacked *packed = AS_OBJ_PACKED(vm->locals[state]);
+      if (cursor >= packed->count) {
+        vm->ip += exit;
+        break;
+      }
+      vm->locals[state + 1] = value_make_int(cursor + 1);
+      bind_loop_vars(vm, var, var_count, value_make_int(cursor),
+                     packed->element == PACKED_INT ? value_make_int(packed->as.ints[cursor])
+                                                   : value_make_float(packed->as.floats[cursor]));
+      break;
+    }
+
+    case OP_FOR_VECTOR: {
+      READ_LOOP_HEAD();
+      ObjVector *vector = AS_VECTOR(vm->locals[state]);
+      if (cursor >= vector->count) {
+        vm->ip += exit;
+        break;
+      }
+      vm->locals[state + 1] = value_make_int(cursor + 1);
+      bind_loop_vars(vm, var, var_count, value_make_int(cursor), vector_get(vector, (int)cursor));
+      break;
+    }
+
+    case OP_FOR_MAP: {
+      READ_LOOP_HEAD();
+      u64 position = (u64)cursor;
+      Value key, value;
+      if (!map_next(AS_MAP(vm->locals[state]), &position, &key, &value)) {
+        vm->ip += exit;
+        break;
+      }
+      vm->locals[state + 1] = value_make_int((i64)position);
+      // A lone variable takes the key
+      bind_loop_vars(vm, var, var_count, key, var_count == 2 ? value : key);
+      break;
+    }
+
+    case OP_FOR_STRING: {
+      READ_LOOP_HEAD();
+      Value *text = &vm->locals[state];
+      const char *chars = IS_OBJ(*text) ? AS_OBJ_STRING(*text)->chars : AS_STRING(*text);
+      int length = (int)(cursor >> 32);
+      int offset = (int)(cursor & 0xffffffff);
+      if (offset >= length) {
+        vm->ip += exit;
+        break;
+      }
+      int end = offset + 1;
+      while (end < length && utf8_is_continuation((u8)chars[end])) end++;
+      vm->locals[state + 1] = value_make_int(cursor - offset + end);
+      bind_loop_vars(vm, var, var_count, value_make_int(offset),
+                     value_copy_string(chars + offset, end - offset));
+      break;
+    }
+
+    case OP_FOR_FOREIGN: {
+      READ_LOOP_HEAD();
+      ObjForeign *foreign = (ObjForeign*)AS_OBJ(vm->locals[state]);
+      Value item;
+      // Like a native, `next` runs to the end; the loop's safepoint follows
+      jmp_buf *escape = mem_defer_limit();
+      bool more = foreign->data != NULL && foreign->kind->next(foreign->data, &item);
+      mem_resume_limit(escape);
+      if (!more) {
+        vm->ip += exit;
+        break;
+      }
+      vm->locals[state + 1] = value_make_int(cursor + 1);
+      bind_loop_vars(vm, var, var_count, value_make_int(cursor), item);
+      break;
+    }
+
+    case OP_PIPE_ARRAY: {
+      // Only peeks: the source stays for OP_FOR_PREP
+      int capacity = 0;
+      switch (READ_BYTE()) {
+        case PIPE_SIZE_COLLECTION:
+          capacity = known_length(stack_peek(vm, 0));
+          break;
+        case PIPE_SIZE_RANGE: {
+          Value start = stack_peek(vm, 1);
+          Value end = stack_peek(vm, 0);
+          if (IS_INT(start) && IS_INT(end) && AS_INT(end) > AS_INT(start) &&
+              AS_INT(end) - AS_INT(start) <= INT32_MAX) {
+            capacity = (int)(AS_INT(end) - AS_INT(start));
+          }
+          break;
+        }
+      }
+      stack_push(vm, OBJ_VAL(array_make(capacity)));
+      break;
+    }
+
+    case OP_ARRAY_APPEND: {
+      u8 slot = READ_BYTE();
+      array_push(AS_OBJ_ARRAY(vm->locals[slot]), stack_pop(vm));
       break;
     }
 
@@ -371,10 +931,22 @@ bool vm_run(VM *vm) {
       break;
     }
 
+    case OP_BUILD_STRING: {
+      build_string(vm, READ_BYTE());
+      break;
+    }
+
     case OP_HALT: {
       return true;
     }
 
+    case OP_BREAKPOINT: {
+      int opcode = debug_hit(vm, (int)(vm->ip - 1 - vm->chunk.code));
+      if (opcode < 0) return false;
+      instruction = (u8)opcode;
+      goto dispatch;
+    }
+
     default:
       error_fatal("Unknown opcode: %d", instruction);
       return false;
@@ -384,4 +956,33 @@ bool vm_run(VM *vm) {
 #undef READ_BYTE
 #undef READ_CONSTANT
 #undef READ_STRING
+#undef READ_SHORT
+#undef READ_LOOP_HEAD
+#undef INT_BINARY
+#undef FLOAT_BINARY
+#undef CHECK_LIMITS
+}
+
+bool vm_run(VM *vm) {
+  if (vm->global_cache_count < vm->chunk.constant_count) {
+    free(vm->global_caches);
+    vm->global_cache_count = vm->chunk.constant_count;
+    vm->global_caches = calloc(vm->global_cache_count, sizeof(GlobalCache));
+  }
+  MemMeter *outer = mem_attach_meter(&vm->heap);
+  GcHeap *outer_gc = gc_attach(&vm->gc);
+  jmp_buf escape;
+  bool ok;
+  vm->heap.escape = &escape;
+  if (setjmp(escape) == 0) {
+    ok = run(vm);
+  } else {
+    // The allocator refused a block that would have gone over the quota
+    vm->limit_hit = VM_LIMIT_HEAP;
+    ok = false;
+  }
+  vm->heap.escape = NULL;
+  gc_attach(outer_gc);
+  mem_attach_meter(outer);
+  return ok;
 }
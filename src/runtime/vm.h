@@ -5,6 +5,8 @@
 
 #include "core/common.h"
 #include "core/value.h"
+#include "core/gc.h"
+#include "core/memory.h"
 #include "core/table.h"
 
 typedef enum {
@@ -13,6 +15,7 @@ typedef enum {
   OP_GET_LOCAL,     // Get local variable
   OP_SET_LOCAL,     // Set local variable
   OP_GET_GLOBAL,    // Get global variable/function
+  OP_GET_GLOBAL_CACHED, // OP_GET_GLOBAL after its first lookup
   OP_CALL_NATIVE,   // Call native function
   OP_IMPORT,        // Import module
   OP_GET_MEMBER,    // Get member from object
@@ -24,6 +27,7 @@ typedef enum {
   OP_DIVIDE,        // /
   OP_MODULO,        // %
   OP_NEGATE,        // unary -
+  OP_BUILD_STRING,  // Join the top n values into one string
   
   // Comparison operations
   OP_EQUAL,         // ==
@@ -33,17 +37,86 @@ typedef enum {
   OP_GREATER,       // >
   OP_GREATER_EQUAL, // >=
   OP_NOT,           // unary !
+
+  // Forms of the above that codegen emits when it knows both operands are
+  // ints (or both floats), skipping the tag checks and conversions
+  OP_ADD_INT,
+  OP_SUBTRACT_INT,
+  OP_MULTIPLY_INT,
+  OP_MODULO_INT,
+  OP_EQUAL_INT,
+  OP_NOT_EQUAL_INT,
+  OP_LESS_INT,
+  OP_LESS_EQUAL_INT,
+  OP_GREATER_INT,
+  OP_GREATER_EQUAL_INT,
+  OP_ADD_FLOAT,
+  OP_SUBTRACT_FLOAT,
+  OP_MULTIPLY_FLOAT,
+  OP_DIVIDE_FLOAT,
+  OP_LESS_FLOAT,
+  OP_LESS_EQUAL_FLOAT,
+  OP_GREATER_FLOAT,
+  OP_GREATER_EQUAL_FLOAT,
   
   // Control flow
   OP_JUMP,          // Unconditional jump
   OP_JUMP_IF_FALSE, // Jump if top of stack is false
   OP_LOOP,          // Jump backwards (for loops)
+
+  // match dispatch. Each pops the subject and jumps through a table of
+  // u16 offsets, counted from the end of the instruction; the default
+  // offset is taken when no entry applies.
+  OP_SWITCH,        // Dense ints: min constant, count, default, offsets
+  OP_SWITCH_RANGES, // count, default, then sorted SWITCH_RANGE_SIZE entries
+  OP_MATCH_KEYS,    // Map constant of key -> index, count, default, offsets
+
+  // for loops. OP_FOR_PREP stores the iterable in the loop head that
+  // follows it and rewrites the head to the opcode for the iterable's
+  // kind. Each head binds the next item or jumps past the loop.
+  OP_FOR_PREP,
+  OP_FOR_RANGE,     // start..end
+  OP_FOR_ARRAY,
+  OP_FOR_PACKED,
+  OP_FOR_VECTOR,
+  OP_FOR_MAP,
+  OP_FOR_STRING,    // Code points, as strings
+  OP_FOR_FOREIGN,   // Items from ForeignType.next
+
+  // Fused pipelines. The collecting loop appends straight into one array,
+  // preallocated when the source's length is known up front.
+  OP_PIPE_ARRAY,    // Push an empty array (operand: PIPE_SIZE_*)
+  OP_ARRAY_APPEND,  // Pop a value onto the array in a local
   
+  // Written over an instruction's opcode by the debugger, which keeps the
+  // original and runs it once the breakpoint has been handled
+  OP_BREAKPOINT,
+
   OP_PRINT,         // Built-in print (deprecated, use io.println)
   OP_RETURN,        // Return from function
   OP_HALT,          // Stop execution
 } OpCode;
 
+// An OP_SWITCH_RANGES entry: i64 first and last (inclusive), in host byte
+// order, the u16 offset, then 1 if only `first` itself matches
+#define SWITCH_RANGE_SIZE 19
+
+// How OP_PIPE_ARRAY sizes its array: not at all, by the collection on top
+// of the stack, or by the range whose bounds are the top two values
+#define PIPE_SIZE_NONE 0
+#define PIPE_SIZE_COLLECTION 1
+#define PIPE_SIZE_RANGE 2
+
+// Most values one OP_BUILD_STRING joins; longer chains build in steps
+#define SATORI_BUILD_STRING_MAX 64
+
+// Where a source line's bytecode starts. Code from `offset` up to the next
+// entry's offset came from `line`.
+typedef struct {
+  int offset;
+  int line;
+} LineStart;
+
 typedef struct {
   u8 *code;
   int count;
@@ -51,8 +124,29 @@ typedef struct {
   Value *constants;
   int constant_count;
   int constant_capacity;
+  LineStart *lines;                // Sorted by offset
+  int line_count;
+  int line_capacity;
+  int line;                        // Line chunk_write attributes bytes to
+  bool borrowed;                   // Code, lines and string constants live in
+                                   // a mapped bundle, which frees them
 } Chunk;
 
+// Why vm_run stopped a script early. Running out of a limit is not fatal:
+// vm_run returns false and the host can report it and carry on.
+typedef enum {
+  VM_LIMIT_NONE,
+  VM_LIMIT_INSTRUCTIONS,  // Instruction budget spent
+  VM_LIMIT_HEAP,          // Heap quota exceeded
+} VMLimit;
+
+// The global an OP_GET_GLOBAL_CACHED site resolved, valid while `version`
+// matches the VM's globals_version
+typedef struct {
+  u32 version;
+  Value value;
+} GlobalCache;
+
 typedef struct VM {
   Chunk chunk;
   u8 *ip;                          // Instruction pointer
@@ -66,6 +160,21 @@ typedef struct VM {
   // Module system
   Table globals;                   // Global functions and variables
   Table loaded_modules;            // Tracking loaded modules
+  GlobalCache *global_caches;      // One per constant, made by vm_run
+  int global_cache_count;
+  u32 globals_version;             // Bumped whenever a global is set
+  Table *natives;                  // If set, the only natives modules register
+
+  // Execution limits, checked at loop back-edges and calls
+  i64 budget;                      // Instructions left; INT64_MAX for none
+  MemMeter heap;                   // Heap charged while running
+  VMLimit limit_hit;               // Set when vm_run stops on a limit
+
+  // Objects made while running, collected at the same safepoints
+  GcHeap gc;
+  i64 next_gc;                     // heap.used at which the next one collects
+
+  struct Debugger *debugger;       // Handles OP_BREAKPOINT; NULL if none
 } VM;
 
 // Chunk operations
@@ -74,9 +183,17 @@ void chunk_free(Chunk *chunk);
 void chunk_write(Chunk *chunk, u8 byte);
 int chunk_add_constant(Chunk *chunk, Value value);
 
+// Source line of the instruction at `offset`, or 0 if unknown
+int chunk_line(const Chunk *chunk, int offset);
+
 // VM operations
 void vm_init(VM *vm);
 void vm_free(VM *vm);
 bool vm_run(VM *vm);
 
+// Cap the instructions one vm_run may execute and the heap bytes it may
+// hold; 0 means unlimited. A loop iteration is charged the length of its
+// body's bytecode, an upper bound on the instructions it ran.
+void vm_set_limits(VM *vm, u64 max_instructions, size_t max_heap);
+
 #endif // SATORI_VM_H
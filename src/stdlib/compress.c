@@ -0,0 +1,816 @@
+// src/stdlib/compress.c - Compression module implementation
+//
+// LZ4 block and frame formats, compatible with the reference lz4 tool:
+// frames written here decode with `lz4 -d`, and frames from `lz4` decode
+// here (linked or independent blocks, block/content checksums, content
+// size, skippable frames; dictionaries are not supported).
+//
+// The compressor is the single-pass greedy LZ4 matcher: a 4096-entry hash
+// of 4-byte sequences, stepping faster through input that does not match.
+// The encoder writes independent 64KB blocks with a content checksum.
+//
+// Both directions stream: input can arrive in pieces of any size and
+// output is produced as soon as a whole block is available.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "compress.h"
+#include "hash.h"
+#include "runtime/module.h"
+#include "core/memory.h"
+#include "core/object.h"
+#include "core/value.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LZ4_MIN_MATCH 4
+#define LZ4_LAST_LITERALS 5        // Blocks end with at least this many literals
+#define LZ4_MFLIMIT 12             // Last match starts at least this far from the end
+#define LZ4_MAX_DISTANCE 65535
+#define LZ4_HASH_LOG 12
+#define LZ4_SKIP_TRIGGER 6         // Step grows every 2^6 failed probes
+#define LZ4_WINDOW (64 * 1024)     // History kept for linked blocks
+
+#define LZ4_FRAME_MAGIC 0x184D2204u
+#define LZ4_SKIPPABLE_MAGIC 0x184D2A50u  // Low 4 bits are free
+#define LZ4_FLAG_VERSION 0x40
+#define LZ4_FLAG_INDEPENDENT 0x20
+#define LZ4_FLAG_BLOCK_CHECKSUM 0x10
+#define LZ4_FLAG_CONTENT_SIZE 0x08
+#define LZ4_FLAG_CONTENT_CHECKSUM 0x04
+#define LZ4_FLAG_DICT_ID 0x01
+#define LZ4_BLOCK_RAW 0x80000000u       // Block size flag: stored uncompressed
+
+#define COMPRESS_FILE_CHUNK (64 * 1024)
+
+static inline u32 read32(const u8 *p) {
+  return (u32)p[0] | ((u32)p[1] << 8) | ((u32)p[2] << 16) | ((u32)p[3] << 24);
+}
+
+static inline u32 load32(const u8 *p) {
+  u32 v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline void write32(u8 *p, u32 v) {
+  p[0] = (u8)v;
+  p[1] = (u8)(v >> 8);
+  p[2] = (u8)(v >> 16);
+  p[3] = (u8)(v >> 24);
+}
+
+// ============================================================================
+// Byte buffers
+// ============================================================================
+
+static u8 *buffer_reserve(ByteBuffer *buffer, size_t extra) {
+  if (buffer->count + extra > buffer->capacity) {
+    size_t capacity = GROW_CAPACITY(buffer->capacity);
+    while (capacity < buffer->count + extra) capacity *= 2;
+    buffer->data = GROW_ARRAY(u8, buffer->data, buffer->capacity, capacity);
+    buffer->capacity = capacity;
+  }
+  return buffer->data + buffer->count;
+}
+
+static void buffer_append(ByteBuffer *buffer, const void *data, size_t length) {
+  memcpy(buffer_reserve(buffer, length), data, length);
+  buffer->count += length;
+}
+
+// ============================================================================
+// Block format
+// ============================================================================
+
+int lz4_block_bound(int length) {
+  return length + length / 255 + 16;
+}
+
+// Hash of the 5 bytes at p (4 where 64-bit loads are not cheap)
+static inline u32 lz4_hash(const u8 *p) {
+#if UINTPTR_MAX > 0xFFFFFFFFu
+  u64 sequence;
+  memcpy(&sequence, p, sizeof(sequence));
+  return (u32)(((sequence << 24) * 889523592379ull) >> (64 - LZ4_HASH_LOG));
+#else
+  return (load32(p) * 2654435761u) >> (32 - LZ4_HASH_LOG);
+#endif
+}
+
+// Length of the common run of p and m, stopping at limit
+static inline int lz4_count(const u8 *p, const u8 *m, const u8 *limit) {
+  const u8 *start = p;
+#if defined(__GNUC__) && (!defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+  while (p + 8 <= limit) {
+    u64 a, b;
+    memcpy(&a, p, 8);
+    memcpy(&b, m, 8);
+    if (a != b) return (int)(p - start) + (__builtin_ctzll(a ^ b) >> 3);
+    p += 8;
+    m += 8;
+  }
+#endif
+  while (p < limit && *p == *m) {
+    p++;
+    m++;
+  }
+  return (int)(p - start);
+}
+
+static inline u8 *lz4_write_length(u8 *op, int length) {
+  for (; length >= 255; length -= 255) *op++ = 255;
+  *op++ = (u8)length;
+  return op;
+}
+
+static u8 *lz4_write_sequence(u8 *op, const u8 *literals, int literal_count,
+                              int offset, int match_length) {
+  int extra = match_length - LZ4_MIN_MATCH;
+  *op++ = (u8)(((literal_count < 15 ? literal_count : 15) << 4) | (extra < 15 ? extra : 15));
+  if (literal_count >= 15) op = lz4_write_length(op, literal_count - 15);
+  memcpy(op, literals, literal_count);
+  op += literal_count;
+  *op++ = (u8)offset;
+  *op++ = (u8)(offset >> 8);
+  if (extra >= 15) op = lz4_write_length(op, extra - 15);
+  return op;
+}
+
+int lz4_compress_block(const u8 *src, int length, u8 *dst) {
+  u32 table[1 << LZ4_HASH_LOG];
+  u8 *op = dst;
+  int anchor = 0;
+
+  if (length >= LZ4_MFLIMIT + 1) {
+    const int match_limit = length - LZ4_MFLIMIT;
+    const u8 *count_limit = src + length - LZ4_LAST_LITERALS;
+    memset(table, 0, sizeof(table));
+    int ip = 1;
+
+    for (;;) {
+      // Probe forward until a 4-byte match turns up
+      int match;
+      int attempts = 1 << LZ4_SKIP_TRIGGER;
+      for (;;) {
+        if (ip > match_limit) goto last_literals;
+        u32 h = lz4_hash(src + ip);
+        match = (int)table[h];
+        table[h] = (u32)ip;
+        if (ip - match <= LZ4_MAX_DISTANCE && load32(src + match) == load32(src + ip)) break;
+        ip += attempts++ >> LZ4_SKIP_TRIGGER;
+      }
+
+      while (ip > anchor && match > 0 && src[ip - 1] == src[match - 1]) {
+        ip--;
+        match--;
+      }
+
+      // Emit sequences for as long as each match is followed by another
+      for (;;) {
+        int match_length = LZ4_MIN_MATCH +
+          lz4_count(src + ip + LZ4_MIN_MATCH, src + match + LZ4_MIN_MATCH, count_limit);
+        op = lz4_write_sequence(op, src + anchor, ip - anchor, ip - match, match_length);
+        ip += match_length;
+        anchor = ip;
+        if (ip > match_limit) goto last_literals;
+
+        table[lz4_hash(src + ip - 2)] = (u32)(ip - 2);
+        u32 h = lz4_hash(src + ip);
+        match = (int)table[h];
+        table[h] = (u32)ip;
+        if (ip - match > LZ4_MAX_DISTANCE || load32(src + match) != load32(src + ip)) break;
+      }
+      ip++;
+    }
+  }
+
+last_literals: {
+    int literal_count = length - anchor;
+    *op++ = (u8)((literal_count < 15 ? literal_count : 15) << 4);
+    if (literal_count >= 15) op = lz4_write_length(op, literal_count - 15);
+    memcpy(op, src + anchor, literal_count);
+    op += literal_count;
+  }
+  return (int)(op - dst);
+}
+
+// Read an extended length; false if it runs past the input or overflows
+static inline bool lz4_read_length(const u8 *src, int length, int *ip, int *value) {
+  u8 byte;
+  do {
+    if (*ip >= length) return false;
+    byte = src[(*ip)++];
+    if (*value > INT_MAX - 255) return false;
+    *value += byte;
+  } while (byte == 255);
+  return true;
+}
+
+int lz4_decompress_block(const u8 *src, int length, u8 *dst, int capacity, int history) {
+  int ip = 0, op = 0;
+
+  for (;;) {
+    if (ip >= length) return -1;
+    u8 token = src[ip++];
+
+    int literal_count = token >> 4;
+    if (literal_count == 15 && !lz4_read_length(src, length, &ip, &literal_count)) return -1;
+    if (literal_count > length - ip || literal_count > capacity - op) return -1;
+    memcpy(dst + op, src + ip, literal_count);
+    ip += literal_count;
+    op += literal_count;
+
+    if (ip == length) return op;  // Last sequence has no match
+
+    if (length - ip < 2) return -1;
+    int offset = src[ip] | (src[ip + 1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > op + history) return -1;
+
+    int match_length = token & 15;
+    if (match_length == 15 && !lz4_read_length(src, length, &ip, &match_length)) return -1;
+    match_length += LZ4_MIN_MATCH;
+    if (match_length > capacity - op) return -1;
+
+    u8 *out = dst + op;
+    const u8 *match = out - offset;
+    if (offset >= match_length) {
+      memcpy(out, match, match_length);
+    } else {
+      for (int i = 0; i < match_length; i++) out[i] = match[i];
+    }
+    op += match_length;
+  }
+}
+
+// ============================================================================
+// Frame encoder
+// ============================================================================
+
+struct Lz4Encoder {
+  u8 block[LZ4_BLOCK_SIZE];  // Input waiting to fill a block
+  int pending;
+  bool started;              // Frame header written
+  Xxh32State checksum;
+};
+
+Lz4Encoder *lz4_encoder_new(void) {
+  Lz4Encoder *encoder = mem_alloc(sizeof(Lz4Encoder));
+  encoder->pending = 0;
+  encoder->started = false;
+  return encoder;
+}
+
+void lz4_encoder_free(Lz4Encoder *encoder) {
+  mem_free(encoder);
+}
+
+static void lz4_encoder_start(Lz4Encoder *encoder, ByteBuffer *out) {
+  u8 header[7];
+  write32(header, LZ4_FRAME_MAGIC);
+  header[4] = LZ4_FLAG_VERSION | LZ4_FLAG_INDEPENDENT | LZ4_FLAG_CONTENT_CHECKSUM;
+  header[5] = 4 << 4;  // 64KB blocks
+  header[6] = (u8)(hash_xxh32(header + 4, 2, 0) >> 8);
+  buffer_append(out, header, sizeof(header));
+
+  hash_xxh32_init(&encoder->checksum, 0);
+  encoder->started = true;
+}
+
+static void lz4_encoder_flush(Lz4Encoder *encoder, ByteBuffer *out) {
+  int length = encoder->pending;
+  u8 *size = buffer_reserve(out, 4 + lz4_block_bound(length));
+  int compressed = lz4_compress_block(encoder->block, length, size + 4);
+
+  // Incompressible blocks are stored as-is
+  if (compressed >= length) {
+    memcpy(size + 4, encoder->block, length);
+    write32(size, (u32)length | LZ4_BLOCK_RAW);
+    out->count += 4 + length;
+  } else {
+    write32(size, (u32)compressed);
+    out->count += 4 + compressed;
+  }
+  encoder->pending = 0;
+}
+
+void lz4_encoder_write(Lz4Encoder *encoder, const u8 *data, size_t length, ByteBuffer *out) {
+  if (!encoder->started) lz4_encoder_start(encoder, out);
+  hash_xxh32_update(&encoder->checksum, data, length);
+
+  while (length > 0) {
+    size_t fill = LZ4_BLOCK_SIZE - encoder->pending;
+    if (fill > length) fill = length;
+    memcpy(encoder->block + encoder->pending, data, fill);
+    encoder->pending += (int)fill;
+    data += fill;
+    length -= fill;
+    if (encoder->pending == LZ4_BLOCK_SIZE) lz4_encoder_flush(encoder, out);
+  }
+}
+
+void lz4_encoder_finish(Lz4Encoder *encoder, ByteBuffer *out) {
+  if (!encoder->started) lz4_encoder_start(encoder, out);
+  if (encoder->pending > 0) lz4_encoder_flush(encoder, out);
+
+  u8 trailer[8];
+  write32(trailer, 0);  // End mark
+  write32(trailer + 4, hash_xxh32_digest(&encoder->checksum));
+  buffer_append(out, trailer, sizeof(trailer));
+  encoder->started = false;
+}
+
+// ============================================================================
+// Frame decoder
+// ============================================================================
+
+typedef enum {
+  DECODE_MAGIC,
+  DECODE_HEADER,
+  DECODE_BLOCK_SIZE,
+  DECODE_BLOCK,
+  DECODE_CHECKSUM,
+  DECODE_SKIP,
+  DECODE_ERROR,
+} DecodeState;
+
+struct Lz4Decoder {
+  DecodeState state;
+  ByteBuffer input;      // Received but not yet parsed
+  size_t input_pos;
+  u8 flags;              // Frame FLG byte
+  int block_max;
+  u32 block_size;
+  bool block_raw;
+  u64 content_size;      // 0 when the frame does not declare it
+  u64 produced;
+  Xxh32State checksum;
+  u8 *window;            // History, then room for one block
+  int history;
+  size_t skip;           // Bytes left of a skippable frame
+  const char *error;
+};
+
+Lz4Decoder *lz4_decoder_new(void) {
+  Lz4Decoder *decoder = mem_alloc(sizeof(Lz4Decoder));
+  memset(decoder, 0, sizeof(Lz4Decoder));
+  decoder->state = DECODE_MAGIC;
+  return decoder;
+}
+
+void lz4_decoder_free(Lz4Decoder *decoder) {
+  free(decoder->input.data);
+  free(decoder->window);
+  mem_free(decoder);
+}
+
+const char *lz4_decoder_error(const Lz4Decoder *decoder) {
+  return decoder->error;
+}
+
+static bool lz4_decoder_fail(Lz4Decoder *decoder, const char *error) {
+  decoder->state = DECODE_ERROR;
+  decoder->error = error;
+  return false;
+}
+
+// Parse FLG, BD, optional fields and the header checksum.
+// Returns bytes consumed, 0 if more input is needed, -1 on error.
+static int lz4_decode_header(Lz4Decoder *decoder, const u8 *p, size_t available) {
+  if (available < 2) return 0;
+  u8 flags = p[0], descriptor = p[1];
+  size_t length = 3 + (flags & LZ4_FLAG_CONTENT_SIZE ? 8 : 0) +
+                  (flags & LZ4_FLAG_DICT_ID ? 4 : 0);
+  if (available < length) return 0;
+
+  if ((flags & 0xC0) != LZ4_FLAG_VERSION || (flags & 0x02) || (descriptor & 0x8F)) {
+    lz4_decoder_fail(decoder, "unsupported frame version or flags");
+    return -1;
+  }
+  if (flags & LZ4_FLAG_DICT_ID) {
+    lz4_decoder_fail(decoder, "frames with dictionaries are not supported");
+    return -1;
+  }
+  int size_code = (descriptor >> 4) & 7;
+  if (size_code < 4) {
+    lz4_decoder_fail(decoder, "invalid block size");
+    return -1;
+  }
+  if (p[length - 1] != (u8)(hash_xxh32(p, length - 1, 0) >> 8)) {
+    lz4_decoder_fail(decoder, "header checksum mismatch");
+    return -1;
+  }
+
+  int block_max = 1 << (8 + 2 * size_code);
+  if (decoder->window == NULL || block_max > decoder->block_max) {
+    free(decoder->window);
+    decoder->window = mem_alloc(LZ4_WINDOW + block_max);
+  }
+  decoder->flags = flags;
+  decoder->block_max = block_max;
+  decoder->content_size = 0;
+  if (flags & LZ4_FLAG_CONTENT_SIZE) {
+    decoder->content_size = read32(p + 2) | ((u64)read32(p + 6) << 32);
+  }
+  decoder->produced = 0;
+  decoder->history = 0;
+  hash_xxh32_init(&decoder->checksum, 0);
+  return (int)length;
+}
+
+// Decode one block into the window and hand it to `out`
+static bool lz4_decode_block(Lz4Decoder *decoder, const u8 *p, ByteBuffer *out) {
+  int size = (int)decoder->block_size;
+  if (decoder->flags & LZ4_FLAG_BLOCK_CHECKSUM) {
+    if (read32(p + size) != hash_xxh32(p, size, 0)) {
+      return lz4_decoder_fail(decoder, "block checksum mismatch");
+    }
+  }
+
+  bool linked = !(decoder->flags & LZ4_FLAG_INDEPENDENT);
+  int history = linked ? decoder->history : 0;
+  u8 *dst = decoder->window + history;
+  int produced;
+  if (decoder->block_raw) {
+    memcpy(dst, p, size);
+    produced = size;
+  } else {
+    produced = lz4_decompress_block(p, size, dst, decoder->block_max, history);
+    if (produced < 0) return lz4_decoder_fail(decoder, "corrupt block");
+  }
+
+  buffer_append(out, dst, produced);
+  hash_xxh32_update(&decoder->checksum, dst, produced);
+  decoder->produced += produced;
+
+  // Later blocks may reach back up to 64KB into this one
+  if (linked) {
+    int total = history + produced;
+    int keep = total < LZ4_WINDOW ? total : LZ4_WINDOW;
+    memmove(decoder->window, decoder->window + total - keep, keep);
+    decoder->history = keep;
+  }
+  return true;
+}
+
+static bool lz4_decode_end_frame(Lz4Decoder *decoder) {
+  if ((decoder->flags & LZ4_FLAG_CONTENT_SIZE) &&
+      decoder->produced != decoder->content_size) {
+    return lz4_decoder_fail(decoder, "content size mismatch");
+  }
+  decoder->state = DECODE_MAGIC;
+  return true;
+}
+
+bool lz4_decoder_write(Lz4Decoder *decoder, const u8 *data, size_t length, ByteBuffer *out) {
+  if (decoder->state == DECODE_ERROR) return false;
+  buffer_append(&decoder->input, data, length);
+
+  for (;;) {
+    const u8 *p = decoder->input.data + decoder->input_pos;
+    size_t available = decoder->input.count - decoder->input_pos;
+    size_t consumed = 0;
+    DecodeState state = decoder->state;
+
+    switch (decoder->state) {
+      case DECODE_MAGIC: {
+        if (available < 4) break;
+        u32 magic = read32(p);
+        if (magic == LZ4_FRAME_MAGIC) {
+          decoder->state = DECODE_HEADER;
+          consumed = 4;
+        } else if ((magic & 0xFFFFFFF0u) == LZ4_SKIPPABLE_MAGIC) {
+          if (available < 8) break;
+          decoder->skip = read32(p + 4);
+          decoder->state = DECODE_SKIP;
+          consumed = 8;
+        } else {
+          return lz4_decoder_fail(decoder, "not an LZ4 frame");
+        }
+        break;
+      }
+
+      case DECODE_HEADER: {
+        int header = lz4_decode_header(decoder, p, available);
+        if (header < 0) return false;
+        if (header > 0) decoder->state = DECODE_BLOCK_SIZE;
+        consumed = (size_t)header;
+        break;
+      }
+
+      case DECODE_BLOCK_SIZE: {
+        if (available < 4) break;
+        u32 size = read32(p);
+        consumed = 4;
+        if (size == 0) {
+          if (decoder->flags & LZ4_FLAG_CONTENT_CHECKSUM) {
+            decoder->state = DECODE_CHECKSUM;
+          } else if (!lz4_decode_end_frame(decoder)) {
+            return false;
+          }
+          break;
+        }
+        decoder->block_raw = (size & LZ4_BLOCK_RAW) != 0;
+        decoder->block_size = size & ~LZ4_BLOCK_RAW;
+        if (decoder->block_size > (u32)decoder->block_max) {
+          return lz4_decoder_fail(decoder, "block larger than the frame allows");
+        }
+        decoder->state = DECODE_BLOCK;
+        break;
+      }
+
+      case DECODE_BLOCK: {
+        size_t needed = decoder->block_size +
+                        (decoder->flags & LZ4_FLAG_BLOCK_CHECKSUM ? 4 : 0);
+        if (available < needed) break;
+        if (!lz4_decode_block(decoder, p, out)) return false;
+        decoder->state = DECODE_BLOCK_SIZE;
+        consumed = needed;
+        break;
+      }
+
+      case DECODE_CHECKSUM:
+        if (available < 4) break;
+        if (read32(p) != hash_xxh32_digest(&decoder->checksum)) {
+          return lz4_decoder_fail(decoder, "content checksum mismatch");
+        }
+        if (!lz4_decode_end_frame(decoder)) return false;
+        consumed = 4;
+        break;
+
+      case DECODE_SKIP:
+        consumed = available < decoder->skip ? available : decoder->skip;
+        decoder->skip -= consumed;
+        if (decoder->skip == 0) decoder->state = DECODE_MAGIC;
+        break;
+
+      case DECODE_ERROR:
+        return false;
+    }
+
+    if (consumed == 0 && decoder->state == state) break;
+    decoder->input_pos += consumed;
+  }
+
+  // Drop parsed input
+  size_t rest = decoder->input.count - decoder->input_pos;
+  memmove(decoder->input.data, decoder->input.data + decoder->input_pos, rest);
+  decoder->input.count = rest;
+  decoder->input_pos = 0;
+  return true;
+}
+
+bool lz4_decoder_finish(Lz4Decoder *decoder) {
+  if (decoder->state == DECODE_ERROR) return false;
+  if (decoder->state != DECODE_MAGIC || decoder->input.count > 0) {
+    return lz4_decoder_fail(decoder, "truncated frame");
+  }
+  return true;
+}
+
+// ============================================================================
+// Natives
+// ============================================================================
+
+static void encoder_release(void *data) {
+  lz4_encoder_free((Lz4Encoder*)data);
+}
+
+static void decoder_release(void *data) {
+  lz4_decoder_free((Lz4Decoder*)data);
+}
+
+static const ForeignType encoder_type = {"lz4 encoder", encoder_release, NULL, NULL};
+static const ForeignType decoder_type = {"lz4 decoder", decoder_release, NULL, NULL};
+
+// Hand a buffer's bytes to a new string object
+static Value buffer_take_string(const char *name, ByteBuffer *buffer) {
+  if (buffer->count > INT_MAX - 1) {
+    fprintf(stderr, "Error: %s: result too large for a string\n", name);
+    free(buffer->data);
+    return value_make_nil();
+  }
+  *buffer_reserve(buffer, 1) = '\0';
+  return OBJ_VAL(string_take((char*)buffer->data, (int)buffer->count));
+}
+
+static bool compress_string_arg(const char *name, int arg_count, Value *args, int expected,
+                                const char **data, int *length) {
+  if (arg_count != expected) {
+    fprintf(stderr, "Error: %s expects %d argument%s, got %d\n",
+            name, expected, expected == 1 ? "" : "s", arg_count);
+    return false;
+  }
+  if (!value_get_string(&args[expected - 1], data, length)) {
+    fprintf(stderr, "Error: %s expects string argument\n", name);
+    return false;
+  }
+  return true;
+}
+
+// compress.compress - Whole string to an LZ4 frame
+Value native_compress_compress(int arg_count, Value *args) {
+  const char *data;
+  int length;
+  if (!compress_string_arg("compress", arg_count, args, 1, &data, &length)) {
+    return value_make_nil();
+  }
+
+  ByteBuffer out = {NULL, 0, 0};
+  Lz4Encoder *encoder = lz4_encoder_new();
+  lz4_encoder_write(encoder, (const u8*)data, (size_t)length, &out);
+  lz4_encoder_finish(encoder, &out);
+  lz4_encoder_free(encoder);
+  return buffer_take_string("compress", &out);
+}
+
+// compress.decompress - LZ4 frame(s) back to a string, or nil if corrupt
+Value native_compress_decompress(int arg_count, Value *args) {
+  const char *data;
+  int length;
+  if (!compress_string_arg("decompress", arg_count, args, 1, &data, &length)) {
+    return value_make_nil();
+  }
+
+  ByteBuffer out = {NULL, 0, 0};
+  Lz4Decoder *decoder = lz4_decoder_new();
+  if (!lz4_decoder_write(decoder, (const u8*)data, (size_t)length, &out) ||
+      !lz4_decoder_finish(decoder)) {
+    fprintf(stderr, "Error: decompress: %s\n", lz4_decoder_error(decoder));
+    lz4_decoder_free(decoder);
+    free(out.data);
+    return value_make_nil();
+  }
+  lz4_decoder_free(decoder);
+  return buffer_take_string("decompress", &out);
+}
+
+// compress.encoder - New streaming compressor
+Value native_compress_encoder(int arg_count, Value *args) {
+  (void)args;
+  if (arg_count != 0) {
+    fprintf(stderr, "Error: encoder expects 0 arguments, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  return OBJ_VAL(foreign_make(&encoder_type, lz4_encoder_new()));
+}
+
+// compress.decoder - New streaming decompressor
+Value native_compress_decoder(int arg_count, Value *args) {
+  (void)args;
+  if (arg_count != 0) {
+    fprintf(stderr, "Error: decoder expects 0 arguments, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  return OBJ_VAL(foreign_make(&decoder_type, lz4_decoder_new()));
+}
+
+// compress.write - Feed a stream; returns the output produced so far
+Value native_compress_write(int arg_count, Value *args) {
+  const char *data;
+  int length;
+  if (!compress_string_arg("write", arg_count, args, 2, &data, &length)) {
+    return value_make_nil();
+  }
+
+  ByteBuffer out = {NULL, 0, 0};
+  if (IS_FOREIGN(args[0], &encoder_type)) {
+    lz4_encoder_write((Lz4Encoder*)AS_FOREIGN_DATA(args[0]), (const u8*)data,
+                      (size_t)length, &out);
+  } else if (IS_FOREIGN(args[0], &decoder_type)) {
+    Lz4Decoder *decoder = (Lz4Decoder*)AS_FOREIGN_DATA(args[0]);
+    if (!lz4_decoder_write(decoder, (const u8*)data, (size_t)length, &out)) {
+      fprintf(stderr, "Error: write: %s\n", lz4_decoder_error(decoder));
+      free(out.data);
+      return value_make_nil();
+    }
+  } else {
+    fprintf(stderr, "Error: write expects an encoder or decoder\n");
+    return value_make_nil();
+  }
+  return buffer_take_string("write", &out);
+}
+
+// compress.finish - End a stream; returns the remaining output
+Value native_compress_finish(int arg_count, Value *args) {
+  if (arg_count != 1) {
+    fprintf(stderr, "Error: finish expects 1 argument, got %d\n", arg_count);
+    return value_make_nil();
+  }
+
+  ByteBuffer out = {NULL, 0, 0};
+  if (IS_FOREIGN(args[0], &encoder_type)) {
+    lz4_encoder_finish((Lz4Encoder*)AS_FOREIGN_DATA(args[0]), &out);
+  } else if (IS_FOREIGN(args[0], &decoder_type)) {
+    Lz4Decoder *decoder = (Lz4Decoder*)AS_FOREIGN_DATA(args[0]);
+    if (!lz4_decoder_finish(decoder)) {
+      fprintf(stderr, "Error: finish: %s\n", lz4_decoder_error(decoder));
+      return value_make_nil();
+    }
+  } else {
+    fprintf(stderr, "Error: finish expects an encoder or decoder\n");
+    return value_make_nil();
+  }
+  return buffer_take_string("finish", &out);
+}
+
+// Stream src through an encoder or decoder into dst.
+// Returns bytes written, or -1 after reporting the error.
+static i64 compress_file_stream(const char *name, Value *args, bool decode) {
+  const char *src_path, *dst_path;
+  int length;
+  if (!value_get_string(&args[0], &src_path, &length) ||
+      !value_get_string(&args[1], &dst_path, &length)) {
+    fprintf(stderr, "Error: %s expects string arguments\n", name);
+    return -1;
+  }
+
+  FILE *src = fopen(src_path, "rb");
+  if (src == NULL) {
+    fprintf(stderr, "Error: Could not open file '%s'\n", src_path);
+    return -1;
+  }
+  FILE *dst = fopen(dst_path, "wb");
+  if (dst == NULL) {
+    fprintf(stderr, "Error: Could not open file '%s'\n", dst_path);
+    fclose(src);
+    return -1;
+  }
+
+  Lz4Encoder *encoder = decode ? NULL : lz4_encoder_new();
+  Lz4Decoder *decoder = decode ? lz4_decoder_new() : NULL;
+  u8 *chunk = mem_alloc(COMPRESS_FILE_CHUNK);
+  ByteBuffer out = {NULL, 0, 0};
+  i64 written = 0;
+  const char *error = NULL;
+  size_t read;
+
+  while (error == NULL && (read = fread(chunk, 1, COMPRESS_FILE_CHUNK, src)) > 0) {
+    if (decode) {
+      if (!lz4_decoder_write(decoder, chunk, read, &out)) error = lz4_decoder_error(decoder);
+    } else {
+      lz4_encoder_write(encoder, chunk, read, &out);
+    }
+    if (fwrite(out.data, 1, out.count, dst) != out.count) error = "write failed";
+    written += (i64)out.count;
+    out.count = 0;
+  }
+  if (error == NULL && ferror(src)) error = "read failed";
+  if (error == NULL) {
+    if (decode) {
+      if (!lz4_decoder_finish(decoder)) error = lz4_decoder_error(decoder);
+    } else {
+      lz4_encoder_finish(encoder, &out);
+      if (fwrite(out.data, 1, out.count, dst) != out.count) error = "write failed";
+      written += (i64)out.count;
+    }
+  }
+  if (fclose(dst) != 0 && error == NULL) error = "write failed";
+
+  fclose(src);
+  free(out.data);
+  mem_free(chunk);
+  if (encoder != NULL) lz4_encoder_free(encoder);
+  if (decoder != NULL) lz4_decoder_free(decoder);
+
+  if (error != NULL) {
+    fprintf(stderr, "Error: %s: %s\n", name, error);
+    return -1;
+  }
+  return written;
+}
+
+// compress.compress_file - Compress src into an LZ4 file at dst
+Value native_compress_compress_file(int arg_count, Value *args) {
+  if (arg_count != 2) {
+    fprintf(stderr, "Error: compress_file expects 2 arguments, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  i64 written = compress_file_stream("compress_file", args, false);
+  return written < 0 ? value_make_nil() : value_make_int(written);
+}
+
+// compress.decompress_file - Decompress the LZ4 file src into dst
+Value native_compress_decompress_file(int arg_count, Value *args) {
+  if (arg_count != 2) {
+    fprintf(stderr, "Error: decompress_file expects 2 arguments, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  i64 written = compress_file_stream("decompress_file", args, true);
+  return written < 0 ? value_make_nil() : value_make_int(written);
+}
+
+// Module initialization
+void compress_module_init(VM *vm) {
+  module_register_native(vm, "compress.compress", native_compress_compress);
+  module_register_native(vm, "compress.decompress", native_compress_decompress);
+  module_register_native(vm, "compress.encoder", native_compress_encoder);
+  module_register_native(vm, "compress.decoder", native_compress_decoder);
+  module_register_native(vm, "compress.write", native_compress_write);
+  module_register_native(vm, "compress.finish", native_compress_finish);
+  module_register_native(vm, "compress.compress_file", native_compress_compress_file);
+  module_register_native(vm, "compress.decompress_file", native_compress_decompress_file);
+}
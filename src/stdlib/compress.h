@@ -0,0 +1,55 @@
+// src/stdlib/compress.h - Compression module interface
+
+#ifndef SATORI_STDLIB_COMPRESS_H
+#define SATORI_STDLIB_COMPRESS_H
+
+#include "core/value.h"
+#include "runtime/vm.h"
+
+#define LZ4_BLOCK_SIZE (64 * 1024)  // Block size written by the encoder
+
+// Growable output buffer. Zero-initialise; release data with free().
+typedef struct {
+  u8 *data;
+  size_t count;
+  size_t capacity;
+} ByteBuffer;
+
+// LZ4 block format. dst must hold lz4_block_bound(length) bytes.
+// Decompression returns -1 on malformed input. `history` is how many bytes
+// before dst matches may reach back into (0 for independent blocks).
+int lz4_block_bound(int length);
+int lz4_compress_block(const u8 *src, int length, u8 *dst);
+int lz4_decompress_block(const u8 *src, int length, u8 *dst, int capacity, int history);
+
+// LZ4 frame format, streamed. Output is appended to `out`.
+typedef struct Lz4Encoder Lz4Encoder;
+typedef struct Lz4Decoder Lz4Decoder;
+
+Lz4Encoder *lz4_encoder_new(void);
+void lz4_encoder_write(Lz4Encoder *encoder, const u8 *data, size_t length, ByteBuffer *out);
+void lz4_encoder_finish(Lz4Encoder *encoder, ByteBuffer *out);  // Ends the frame
+void lz4_encoder_free(Lz4Encoder *encoder);
+
+// write returns false once the input is found to be corrupt; finish
+// returns false if the input stopped partway through a frame
+Lz4Decoder *lz4_decoder_new(void);
+bool lz4_decoder_write(Lz4Decoder *decoder, const u8 *data, size_t length, ByteBuffer *out);
+bool lz4_decoder_finish(Lz4Decoder *decoder);
+const char *lz4_decoder_error(const Lz4Decoder *decoder);
+void lz4_decoder_free(Lz4Decoder *decoder);
+
+// Module initialization
+void compress_module_init(VM *vm);
+
+// Native functions
+Value native_compress_compress(int arg_count, Value *args);
+Value native_compress_decompress(int arg_count, Value *args);
+Value native_compress_encoder(int arg_count, Value *args);
+Value native_compress_decoder(int arg_count, Value *args);
+Value native_compress_write(int arg_count, Value *args);
+Value native_compress_finish(int arg_count, Value *args);
+Value native_compress_compress_file(int arg_count, Value *args);
+Value native_compress_decompress_file(int arg_count, Value *args);
+
+#endif // SATORI_STDLIB_COMPRESS_H
@@ -0,0 +1,549 @@
+// src/stdlib/csv.c - CSV module implementation
+//
+// Parsing is split in two stages, as in simdjson-style parsers:
+//
+//   1. Scan. Each 64-byte block is classified at once (SSE2 compares) into
+//      bitmasks of quotes, delimiters and newlines. A prefix XOR over the
+//      quote mask marks every byte inside quotes, carried from block to
+//      block, so delimiters and newlines inside quoted fields drop out.
+//      The surviving positions are queued as marks.
+//   2. Split. Rows are cut at newline marks and fields at delimiter marks.
+//      Fields become slices of the input; only fields with doubled quotes
+//      ("") are copied to unescape them.
+//
+// Blocks are scanned lazily, just ahead of the row being read, so a reader
+// over a large file touches each byte once. Column extraction reuses the
+// same rows but parses numbers straight from the input into a packed
+// array, without creating a string per field.
+//
+// CRLF line endings are accepted. A quote in the middle of an unquoted
+// field is taken as the start of a quoted section (RFC 4180 does not allow
+// it anyway).
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "csv.h"
+#include "runtime/module.h"
+#include "core/memory.h"
+#include "core/object.h"
+#include "core/value.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define CSV_BLOCK 64
+#define CSV_MAX_NUMBER 64    // Longest numeric field parsed
+
+// ============================================================================
+// Scanner
+// ============================================================================
+
+// Bitmasks of quote, delimiter and newline bytes in a 64-byte block
+static void csv_classify(const u8 *block, u8 delimiter,
+                         u64 *quotes, u64 *delimiters, u64 *newlines) {
+#ifdef __SSE2__
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i delim = _mm_set1_epi8((char)delimiter);
+  const __m128i newline = _mm_set1_epi8('\n');
+  u64 q = 0, d = 0, n = 0;
+  for (int i = 0; i < 4; i++) {
+    __m128i chunk = _mm_loadu_si128((const __m128i*)(block + 16 * i));
+    q |= (u64)(u32)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote)) << (16 * i);
+    d |= (u64)(u32)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, delim)) << (16 * i);
+    n |= (u64)(u32)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)) << (16 * i);
+  }
+  *quotes = q;
+  *delimiters = d;
+  *newlines = n;
+#else
+  u64 q = 0, d = 0, n = 0;
+  for (int i = 0; i < CSV_BLOCK; i++) {
+    q |= (u64)(block[i] == '"') << i;
+    d |= (u64)(block[i] == delimiter) << i;
+    n |= (u64)(block[i] == '\n') << i;
+  }
+  *quotes = q;
+  *delimiters = d;
+  *newlines = n;
+#endif
+}
+
+// Bit i of the result is the XOR of bits 0..i: set from an opening quote
+// up to (not including) its closing quote
+static inline u64 prefix_xor(u64 x) {
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+}
+
+static inline int lowest_bit(u64 x) {
+#ifdef __GNUC__
+  return __builtin_ctzll(x);
+#else
+  int n = 0;
+  while (!(x & 1)) {
+    x >>= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+// Scan the next block and queue its structural positions
+static void csv_scan_block(CsvReader *reader) {
+  const u8 *text = (const u8*)reader->text->chars;
+  int base = reader->scan_pos;
+  int remaining = reader->text->length - base;
+
+  // The last partial block is scanned from a zero-padded copy
+  u8 padded[CSV_BLOCK];
+  const u8 *block = text + base;
+  if (remaining < CSV_BLOCK) {
+    memset(padded, 0, CSV_BLOCK);
+    memcpy(padded, block, remaining);
+    block = padded;
+  }
+
+  u64 quotes, delimiters, newlines;
+  csv_classify(block, (u8)reader->delimiter, &quotes, &delimiters, &newlines);
+  u64 inside = prefix_xor(quotes) ^ reader->in_quote;
+  reader->in_quote = inside >> 63 ? ~0ull : 0;
+  u64 structural = (delimiters | newlines) & ~inside;
+
+  // Make room for up to 64 marks, reusing consumed space first
+  if (reader->mark_head == reader->mark_count) {
+    reader->mark_head = reader->mark_count = 0;
+  }
+  if (reader->mark_count + CSV_BLOCK > reader->mark_capacity) {
+    if (reader->mark_head > 0) {
+      reader->mark_count -= reader->mark_head;
+      memmove(reader->marks, reader->marks + reader->mark_head,
+              sizeof(int) * reader->mark_count);
+      reader->mark_head = 0;
+    }
+    if (reader->mark_count + CSV_BLOCK > reader->mark_capacity) {
+      int capacity = GROW_CAPACITY(reader->mark_capacity) + CSV_BLOCK;
+      reader->marks = GROW_ARRAY(int, reader->marks, reader->mark_capacity, capacity);
+      reader->mark_capacity = capacity;
+    }
+  }
+
+  int *marks = reader->marks + reader->mark_count;
+  int count = 0;
+  while (structural != 0) {
+    marks[count++] = base + lowest_bit(structural);
+    structural &= structural - 1;
+  }
+  reader->mark_count += count;
+  reader->scan_pos = base + CSV_BLOCK;
+}
+
+// Next unquoted delimiter or newline, or -1 at end of input
+static inline int csv_next_mark(CsvReader *reader) {
+  while (reader->mark_head == reader->mark_count) {
+    if (reader->scan_pos >= reader->text->length) return -1;
+    csv_scan_block(reader);
+  }
+  return reader->marks[reader->mark_head++];
+}
+
+// ============================================================================
+// Rows and fields
+// ============================================================================
+
+void csv_reader_init(CsvReader *reader, ObjString *text, char delimiter) {
+  reader->text = text;
+  reader->delimiter = delimiter;
+  reader->pos = 0;
+  reader->scan_pos = 0;
+  reader->in_quote = 0;
+  reader->marks = NULL;
+  reader->mark_head = 0;
+  reader->mark_count = 0;
+  reader->mark_capacity = 0;
+  reader->spans = NULL;
+  reader->span_count = 0;
+  reader->span_capacity = 0;
+}
+
+void csv_reader_free(CsvReader *reader) {
+  FREE_ARRAY(int, reader->marks, reader->mark_capacity);
+  FREE_ARRAY(CsvSpan, reader->spans, reader->span_capacity);
+  csv_reader_init(reader, NULL, reader->delimiter);
+}
+
+static inline void csv_push_span(CsvReader *reader, int start, int end) {
+  if (reader->span_count == reader->span_capacity) {
+    int capacity = GROW_CAPACITY(reader->span_capacity);
+    reader->spans = GROW_ARRAY(CsvSpan, reader->spans, reader->span_capacity, capacity);
+    reader->span_capacity = capacity;
+  }
+  reader->spans[reader->span_count].start = start;
+  reader->spans[reader->span_count].end = end;
+  reader->span_count++;
+}
+
+bool csv_next_row(CsvReader *reader) {
+  const char *chars = reader->text->chars;
+  int length = reader->text->length;
+
+  for (;;) {
+    if (reader->pos >= length) return false;
+
+    reader->span_count = 0;
+    int field_start = reader->pos;
+    for (;;) {
+      int mark = csv_next_mark(reader);
+      if (mark < 0) {
+        csv_push_span(reader, field_start, length);
+        reader->pos = length;
+        break;
+      }
+      if (chars[mark] == reader->delimiter) {
+        csv_push_span(reader, field_start, mark);
+        field_start = mark + 1;
+        continue;
+      }
+      int end = mark;
+      if (end > field_start && chars[end - 1] == '\r') end--;
+      csv_push_span(reader, field_start, end);
+      reader->pos = mark + 1;
+      break;
+    }
+
+    // Blank lines are skipped
+    if (reader->span_count > 1 || reader->spans[0].start != reader->spans[0].end) {
+      return true;
+    }
+  }
+}
+
+void csv_field_view(const CsvReader *reader, CsvSpan span,
+                    const char **chars, int *length, bool *escaped) {
+  const char *p = reader->text->chars + span.start;
+  int n = span.end - span.start;
+  *escaped = false;
+
+  if (n > 0 && p[0] == '"') {
+    p++;
+    n--;
+    if (n > 0 && p[n - 1] == '"') n--;  // Unterminated quotes run to the end
+    *escaped = n > 0 && memchr(p, '"', n) != NULL;
+  }
+  *chars = p;
+  *length = n;
+}
+
+// Field as a string: a slice of the input, or a copy with "" collapsed
+static Value csv_field_value(const CsvReader *reader, CsvSpan span) {
+  const char *chars;
+  int length;
+  bool escaped;
+  csv_field_view(reader, span, &chars, &length, &escaped);
+
+  if (!escaped) {
+    return OBJ_VAL(string_slice(reader->text, (int)(chars - reader->text->chars), length));
+  }
+
+  char *unescaped = mem_alloc(length + 1);
+  int count = 0;
+  for (int i = 0; i < length; i++) {
+    unescaped[count++] = chars[i];
+    if (chars[i] == '"' && i + 1 < length && chars[i + 1] == '"') i++;
+  }
+  unescaped[count] = '\0';
+  return OBJ_VAL(string_take(unescaped, count));
+}
+
+// ============================================================================
+// Number parsing
+// ============================================================================
+
+static void trim_spaces(const char **chars, int *length) {
+  while (*length > 0 && (**chars == ' ' || **chars == '\t')) {
+    (*chars)++;
+    (*length)--;
+  }
+  while (*length > 0 && ((*chars)[*length - 1] == ' ' || (*chars)[*length - 1] == '\t')) {
+    (*length)--;
+  }
+}
+
+static bool csv_parse_int(const char *chars, int length, i64 *out) {
+  trim_spaces(&chars, &length);
+  bool negative = false;
+  int i = 0;
+  if (length > 0 && (chars[0] == '-' || chars[0] == '+')) {
+    negative = chars[0] == '-';
+    i++;
+  }
+  if (i == length) return false;
+
+  u64 value = 0;
+  const u64 limit = negative ? (u64)INT64_MAX + 1 : (u64)INT64_MAX;
+  for (; i < length; i++) {
+    unsigned digit = (unsigned)(chars[i] - '0');
+    if (digit > 9) return false;
+    if (value > (limit - digit) / 10) return false;
+    value = value * 10 + digit;
+  }
+  *out = negative ? (i64)(0 - value) : (i64)value;
+  return true;
+}
+
+static const f64 powers_of_ten[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// Empty fields read as NaN. Plain decimals with up to 15 significant
+// digits take the exact fast path (one correctly rounded multiply or
+// divide); anything else goes through strtod.
+static bool csv_parse_float(const char *chars, int length, f64 *out) {
+  trim_spaces(&chars, &length);
+  if (length == 0) {
+    *out = NAN;
+    return true;
+  }
+  if (length >= CSV_MAX_NUMBER) return false;
+
+  int i = 0;
+  bool negative = false;
+  if (chars[0] == '-' || chars[0] == '+') {
+    negative = chars[0] == '-';
+    i++;
+  }
+  u64 mantissa = 0;
+  int digits = 0, scale = 0;
+  bool seen_digit = false;
+  for (; i < length && chars[i] >= '0' && chars[i] <= '9'; i++) {
+    mantissa = mantissa * 10 + (u64)(chars[i] - '0');
+    if (mantissa != 0) digits++;
+    seen_digit = true;
+  }
+  if (i < length && chars[i] == '.') {
+    for (i++; i < length && chars[i] >= '0' && chars[i] <= '9'; i++) {
+      mantissa = mantissa * 10 + (u64)(chars[i] - '0');
+      if (mantissa != 0) digits++;
+      scale++;
+      seen_digit = true;
+    }
+  }
+  if (i == length && seen_digit && digits <= 15 && scale <= 22) {
+    f64 value = (f64)mantissa / powers_of_ten[scale];
+    *out = negative ? -value : value;
+    return true;
+  }
+
+  char buffer[CSV_MAX_NUMBER];
+  memcpy(buffer, chars, length);
+  buffer[length] = '\0';
+  char *end;
+  *out = strtod(buffer, &end);
+  return end == buffer + length && end != buffer;
+}
+
+// ============================================================================
+// Natives
+// ============================================================================
+
+static void csv_release(void *data) {
+  csv_reader_free((CsvReader*)data);
+  mem_free(data);
+}
+
+// Next row as an array of fields; `for row in reader` reads rows this way
+static bool csv_next_value(void *data, Value *row) {
+  CsvReader *reader = (CsvReader*)data;
+  if (!csv_next_row(reader)) return false;
+
+  ObjArray *fields = array_make(reader->span_count);
+  for (int i = 0; i < reader->span_count; i++) {
+    array_push(fields, csv_field_value(reader, reader->spans[i]));
+  }
+  *row = OBJ_VAL(fields);
+  return true;
+}
+
+// The reader keeps the text its fields point into
+static void csv_trace(void *data, void (*visit)(Value value, void *context), void *context) {
+  CsvReader *reader = (CsvReader*)data;
+  if (reader->text != NULL) visit(OBJ_VAL(reader->text), context);
+}
+
+static const ForeignType csv_type = {"csv reader", csv_release, csv_next_value, csv_trace};
+
+// Optional single-character delimiter argument, ',' by default
+static bool csv_delimiter_arg(const char *name, int arg_count, Value *args, char *delimiter) {
+  *delimiter = ',';
+  if (arg_count < 2) return true;
+  const char *chars;
+  int length;
+  if (!value_get_string(&args[1], &chars, &length) || length != 1 ||
+      chars[0] == '"' || chars[0] == '\n' || chars[0] == '\r') {
+    fprintf(stderr, "Error: %s expects a single-character delimiter\n", name);
+    return false;
+  }
+  *delimiter = chars[0];
+  return true;
+}
+
+static Value csv_make_reader(ObjString *text, char delimiter) {
+  CsvReader *reader = mem_alloc(sizeof(CsvReader));
+  csv_reader_init(reader, text, delimiter);
+  return OBJ_VAL(foreign_make(&csv_type, reader));
+}
+
+// csv.reader - Row reader over a string
+Value native_csv_reader(int arg_count, Value *args) {
+  const char *chars;
+  int length;
+  char delimiter;
+  if (arg_count < 1 || arg_count > 2) {
+    fprintf(stderr, "Error: reader expects 1 or 2 arguments, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  if (!value_get_string(&args[0], &chars, &length)) {
+    fprintf(stderr, "Error: reader expects string argument\n");
+    return value_make_nil();
+  }
+  if (!csv_delimiter_arg("reader", arg_count, args, &delimiter)) return value_make_nil();
+
+  // Fields are slices, so plain strings are lifted into one object first
+  ObjString *text = IS_OBJ_STRING(args[0]) ? AS_OBJ_STRING(args[0])
+                                           : string_copy(chars, length);
+  return csv_make_reader(text, delimiter);
+}
+
+// csv.open - Row reader over a file
+Value native_csv_open(int arg_count, Value *args) {
+  const char *path;
+  int length;
+  char delimiter;
+  if (arg_count < 1 || arg_count > 2) {
+    fprintf(stderr, "Error: open expects 1 or 2 arguments, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  if (!value_get_string(&args[0], &path, &length)) {
+    fprintf(stderr, "Error: open expects string argument\n");
+    return value_make_nil();
+  }
+  if (!csv_delimiter_arg("open", arg_count, args, &delimiter)) return value_make_nil();
+
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "Error: Could not open file '%s'\n", path);
+    return value_make_nil();
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  if (size < 0 || size > 0x7FFFFFFE) {
+    fprintf(stderr, "Error: Could not read file '%s'\n", path);
+    fclose(file);
+    return value_make_nil();
+  }
+
+  char *contents = mem_alloc((size_t)size + 1);
+  size_t read = fread(contents, 1, (size_t)size, file);
+  fclose(file);
+  if (read != (size_t)size) {
+    fprintf(stderr, "Error: Could not read file '%s'\n", path);
+    mem_free(contents);
+    return value_make_nil();
+  }
+  contents[size] = '\0';
+  return csv_make_reader(string_take(contents, (int)size), delimiter);
+}
+
+// csv.next - Next row as an array of fields, or nil at the end
+Value native_csv_next(int arg_count, Value *args) {
+  if (arg_count != 1) {
+    fprintf(stderr, "Error: next expects 1 argument, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  if (!IS_FOREIGN(args[0], &csv_type)) {
+    fprintf(stderr, "Error: next expects a csv reader\n");
+    return value_make_nil();
+  }
+
+  Value row;
+  return csv_next_value(AS_FOREIGN_DATA(args[0]), &row) ? row : value_make_nil();
+}
+
+// Read one column of every remaining row into a packed array
+static Value csv_column(const char *name, int arg_count, Value *args, PackedType element) {
+  if (arg_count != 2) {
+    fprintf(stderr, "Error: %s expects 2 arguments, got %d\n", name, arg_count);
+    return value_make_nil();
+  }
+  if (!IS_FOREIGN(args[0], &csv_type)) {
+    fprintf(stderr, "Error: %s expects a csv reader\n", name);
+    return value_make_nil();
+  }
+  if (!IS_INT(args[1]) || AS_INT(args[1]) < 0) {
+    fprintf(stderr, "Error: %s expects a column index\n", name);
+    return value_make_nil();
+  }
+
+  CsvReader *reader = (CsvReader*)AS_FOREIGN_DATA(args[0]);
+  i64 column = AS_INT(args[1]);
+  ObjPacked *packed = packed_make(element, 0);
+  int row = 0;
+
+  while (csv_next_row(reader)) {
+    row++;
+    if (column >= reader->span_count) {
+      fprintf(stderr, "Error: %s: row %d has no column %lld\n", name, row, (long long)column);
+      return value_make_nil();
+    }
+
+    const char *chars;
+    int length;
+    bool escaped, ok;
+    csv_field_view(reader, reader->spans[column], &chars, &length, &escaped);
+    if (element == PACKED_INT) {
+      i64 value;
+      ok = !escaped && csv_parse_int(chars, length, &value);
+      if (ok) packed_push_int(packed, value);
+    } else {
+      f64 value;
+      ok = !escaped && csv_parse_float(chars, length, &value);
+      if (ok) packed_push_float(packed, value);
+    }
+    if (!ok) {
+      fprintf(stderr, "Error: %s: row %d column %lld is not a number: '%.*s'\n",
+              name, row, (long long)column, length, chars);
+      return value_make_nil();
+    }
+  }
+  return OBJ_VAL(packed);
+}
+
+// csv.column_int - Remaining rows' column as packed ints
+Value native_csv_column_int(int arg_count, Value *args) {
+  return csv_column("column_int", arg_count, args, PACKED_INT);
+}
+
+// csv.column_float - Remaining rows' column as packed floats (empty = NaN)
+Value native_csv_column_float(int arg_count, Value *args) {
+  return csv_column("column_float", arg_count, args, PACKED_FLOAT);
+}
+
+// Module initialization
+void csv_module_init(VM *vm) {
+  module_register_native(vm, "csv.reader", native_csv_reader);
+  module_register_native(vm, "csv.open", native_csv_open);
+  module_register_native(vm, "csv.next", native_csv_next);
+  module_register_native(vm, "csv.column_int", native_csv_column_int);
+  module_register_native(vm, "csv.column_float", native_csv_column_float);
+}
@@ -0,0 +1,56 @@
+// src/stdlib/csv.h - CSV module interface
+
+#ifndef SATORI_STDLIB_CSV_H
+#define SATORI_STDLIB_CSV_H
+
+#include "core/value.h"
+#include "core/object.h"
+#include "runtime/vm.h"
+
+// Byte range of one field within the reader's text. Quotes are still
+// included; csv_field_view strips them.
+typedef struct {
+  int start;
+  int end;
+} CsvSpan;
+
+// Row reader over text held in a string object. The text is scanned in
+// 64-byte blocks as rows are consumed; fields point into it.
+typedef struct {
+  ObjString *text;
+  char delimiter;
+  int pos;              // Start of the next row
+  int scan_pos;         // Start of the next block to scan
+  u64 in_quote;         // All ones if the scan stopped inside quotes
+  int *marks;           // Unquoted delimiter/newline positions, in order
+  int mark_head;
+  int mark_count;
+  int mark_capacity;
+  CsvSpan *spans;       // Fields of the current row
+  int span_count;
+  int span_capacity;
+} CsvReader;
+
+// C API, shared by the natives and by benchmarks/tests
+void csv_reader_init(CsvReader *reader, ObjString *text, char delimiter);
+void csv_reader_free(CsvReader *reader);
+
+// Split the next row into reader->spans. Returns false at end of input.
+bool csv_next_row(CsvReader *reader);
+
+// Field contents without surrounding quotes. Sets *escaped if the field
+// contains doubled quotes that still need collapsing.
+void csv_field_view(const CsvReader *reader, CsvSpan span,
+                    const char **chars, int *length, bool *escaped);
+
+// Module initialization
+void csv_module_init(VM *vm);
+
+// Native functions
+Value native_csv_reader(int arg_count, Value *args);
+Value native_csv_open(int arg_count, Value *args);
+Value native_csv_next(int arg_count, Value *args);
+Value native_csv_column_int(int arg_count, Value *args);
+Value native_csv_column_float(int arg_count, Value *args);
+
+#endif // SATORI_STDLIB_CSV_H
@@ -0,0 +1,808 @@
+// src/stdlib/hash.c - Hashing and checksum module implementation
+//
+// Three hashes, each picked for a job:
+//
+//   xxh3    XXH3-64. Bulk data and content addressing. The long-input loop
+//           is 64-byte stripes of independent lanes, run with SSE2 where
+//           available. Streamable; digests match the reference xxHash.
+//   wyhash  wyhash (final4), from core/hash.c. Short keys such as record
+//           ids for sharding.
+//   xxh32   XXH32. C API only; the checksum inside LZ4 frames.
+//   crc32c  CRC-32C (Castagnoli). Checksums for interchange with other
+//           tools. Uses the SSE4.2 crc32 instruction when the CPU has it,
+//           a table otherwise.
+//
+// Hash values surface as ints; 64-bit hashes use the full range, so they
+// may be negative.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "hash.h"
+#include "runtime/module.h"
+#include "core/memory.h"
+#include "core/object.h"
+#include "core/value.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <nmmintrin.h>
+#define HASH_HAVE_CRC32_INSN 1
+#endif
+
+#define HASH_FILE_CHUNK (64 * 1024)
+
+// ============================================================================
+// Primitives
+// ============================================================================
+
+#define PRIME32_1 0x9E3779B1u
+#define PRIME32_2 0x85EBCA77u
+#define PRIME32_3 0xC2B2AE3Du
+#define PRIME32_4 0x27D4EB2Fu
+#define PRIME32_5 0x165667B1u
+#define PRIME64_1 0x9E3779B185EBCA87ull
+#define PRIME64_2 0xC2B2AE3D27D4EB4Full
+#define PRIME64_3 0x165667B19E3779F9ull
+#define PRIME64_4 0x85EBCA77C2B2AE63ull
+#define PRIME64_5 0x27D4EB2F165667C5ull
+#define PRIME_MX1 0x165667919E3779F9ull
+#define PRIME_MX2 0x9FB21C651E98DF25ull
+
+static inline u32 swap32(u32 x) {
+  return (x >> 24) | ((x >> 8) & 0xff00) | ((x << 8) & 0xff0000) | (x << 24);
+}
+
+static inline u64 swap64(u64 x) {
+  return ((u64)swap32((u32)x) << 32) | swap32((u32)(x >> 32));
+}
+
+// Unaligned little-endian reads
+static inline u32 read32(const u8 *p) {
+  u32 v;
+  memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = swap32(v);
+#endif
+  return v;
+}
+
+static inline u64 read64(const u8 *p) {
+  u64 v;
+  memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = swap64(v);
+#endif
+  return v;
+}
+
+static inline void write64(u8 *p, u64 v) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = swap64(v);
+#endif
+  memcpy(p, &v, sizeof(v));
+}
+
+static inline u32 rotl32(u32 x, int r) {
+  return (x << r) | (x >> (32 - r));
+}
+
+static inline u64 rotl64(u64 x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+// Full 64x64 -> 128 multiply
+static inline void mul128(u64 a, u64 b, u64 *lo, u64 *hi) {
+#ifdef __SIZEOF_INT128__
+  __extension__ typedef unsigned __int128 u128;
+  u128 r = (u128)a * b;
+  *lo = (u64)r;
+  *hi = (u64)(r >> 64);
+#else
+  u64 lo_lo = (a & 0xffffffff) * (b & 0xffffffff);
+  u64 hi_lo = (a >> 32) * (b & 0xffffffff);
+  u64 lo_hi = (a & 0xffffffff) * (b >> 32);
+  u64 hi_hi = (a >> 32) * (b >> 32);
+  u64 cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+  *hi = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+  *lo = (cross << 32) | (lo_lo & 0xffffffff);
+#endif
+}
+
+static inline u64 mul128_fold64(u64 a, u64 b) {
+  u64 lo, hi;
+  mul128(a, b, &lo, &hi);
+  return lo ^ hi;
+}
+
+// ============================================================================
+// XXH3-64
+// ============================================================================
+
+#define XXH3_STRIPE_LEN 64
+#define XXH3_SECRET_CONSUME_RATE 8
+#define XXH3_STRIPES_PER_BLOCK ((XXH3_SECRET_SIZE - XXH3_STRIPE_LEN) / XXH3_SECRET_CONSUME_RATE)
+#define XXH3_BLOCK_LEN (XXH3_STRIPE_LEN * XXH3_STRIPES_PER_BLOCK)
+#define XXH3_MIDSIZE_MAX 240
+#define XXH3_MIDSIZE_START_OFFSET 3
+#define XXH3_MIDSIZE_LAST_OFFSET 17
+#define XXH3_LAST_SECRET_OFFSET 7
+#define XXH3_MERGE_ACCS_START 11
+#define XXH3_SECRET_SIZE_MIN 136
+
+static const u8 xxh3_default_secret[XXH3_SECRET_SIZE] = {
+  0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+  0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+  0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+  0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+  0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+  0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+  0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+  0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+  0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+  0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+  0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+  0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+static u64 xxh64_avalanche(u64 h) {
+  h ^= h >> 33;
+  h *= PRIME64_2;
+  h ^= h >> 29;
+  h *= PRIME64_3;
+  h ^= h >> 32;
+  return h;
+}
+
+static u64 xxh3_avalanche(u64 h) {
+  h ^= h >> 37;
+  h *= PRIME_MX1;
+  h ^= h >> 32;
+  return h;
+}
+
+static u64 xxh3_rrmxmx(u64 h, u64 length) {
+  h ^= rotl64(h, 49) ^ rotl64(h, 24);
+  h *= PRIME_MX2;
+  h ^= (h >> 35) + length;
+  h *= PRIME_MX2;
+  return h ^ (h >> 28);
+}
+
+static u64 xxh3_mix16(const u8 *input, const u8 *secret, u64 seed) {
+  return mul128_fold64(read64(input) ^ (read64(secret) + seed),
+                       read64(input + 8) ^ (read64(secret + 8) - seed));
+}
+
+// 0..16 bytes
+static u64 xxh3_short(const u8 *input, size_t length, const u8 *secret, u64 seed) {
+  if (length > 8) {
+    u64 flip_lo = (read64(secret + 24) ^ read64(secret + 32)) + seed;
+    u64 flip_hi = (read64(secret + 40) ^ read64(secret + 48)) - seed;
+    u64 lo = read64(input) ^ flip_lo;
+    u64 hi = read64(input + length - 8) ^ flip_hi;
+    u64 acc = length + swap64(lo) + hi + mul128_fold64(lo, hi);
+    return xxh3_avalanche(acc);
+  }
+  if (length >= 4) {
+    seed ^= (u64)swap32((u32)seed) << 32;
+    u64 flip = (read64(secret + 8) ^ read64(secret + 16)) - seed;
+    u64 combined = read32(input + length - 4) + ((u64)read32(input) << 32);
+    return xxh3_rrmxmx(combined ^ flip, length);
+  }
+  if (length > 0) {
+    u32 combined = ((u32)input[0] << 16) | ((u32)input[length >> 1] << 24) |
+                   (u32)input[length - 1] | ((u32)length << 8);
+    u64 flip = (read32(secret) ^ read32(secret + 4)) + seed;
+    return xxh64_avalanche((u64)combined ^ flip);
+  }
+  return xxh64_avalanche(seed ^ read64(secret + 56) ^ read64(secret + 64));
+}
+
+// 17..240 bytes
+static u64 xxh3_medium(const u8 *input, size_t length, const u8 *secret, u64 seed) {
+  u64 acc = length * PRIME64_1;
+
+  if (length <= 128) {
+    if (length > 32) {
+      if (length > 64) {
+        if (length > 96) {
+          acc += xxh3_mix16(input + 48, secret + 96, seed);
+          acc += xxh3_mix16(input + length - 64, secret + 112, seed);
+        }
+        acc += xxh3_mix16(input + 32, secret + 64, seed);
+        acc += xxh3_mix16(input + length - 48, secret + 80, seed);
+      }
+      acc += xxh3_mix16(input + 16, secret + 32, seed);
+      acc += xxh3_mix16(input + length - 32, secret + 48, seed);
+    }
+    acc += xxh3_mix16(input, secret, seed);
+    acc += xxh3_mix16(input + length - 16, secret + 16, seed);
+    return xxh3_avalanche(acc);
+  }
+
+  int rounds = (int)length / 16;
+  for (int i = 0; i < 8; i++) {
+    acc += xxh3_mix16(input + 16 * i, secret + 16 * i, seed);
+  }
+  acc = xxh3_avalanche(acc);
+  for (int i = 8; i < rounds; i++) {
+    acc += xxh3_mix16(input + 16 * i,
+                      secret + 16 * (i - 8) + XXH3_MIDSIZE_START_OFFSET, seed);
+  }
+  acc += xxh3_mix16(input + length - 16,
+                    secret + XXH3_SECRET_SIZE_MIN - XXH3_MIDSIZE_LAST_OFFSET, seed);
+  return xxh3_avalanche(acc);
+}
+
+// Fold `stripes` 64-byte stripes into the eight lanes, advancing the secret
+// 8 bytes per stripe
+static void xxh3_accumulate(u64 *acc, const u8 *input, const u8 *secret, int stripes) {
+#ifdef __SSE2__
+  __m128i lanes[4];
+  for (int i = 0; i < 4; i++) {
+    lanes[i] = _mm_loadu_si128((const __m128i*)(acc + 2 * i));
+  }
+  for (int s = 0; s < stripes; s++) {
+    const u8 *in = input + s * XXH3_STRIPE_LEN;
+    const u8 *key = secret + s * XXH3_SECRET_CONSUME_RATE;
+    for (int i = 0; i < 4; i++) {
+      __m128i data = _mm_loadu_si128((const __m128i*)(in + 16 * i));
+      __m128i data_key = _mm_xor_si128(data, _mm_loadu_si128((const __m128i*)(key + 16 * i)));
+      __m128i data_key_hi = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+      __m128i product = _mm_mul_epu32(data_key, data_key_hi);
+      __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+      lanes[i] = _mm_add_epi64(lanes[i], _mm_add_epi64(product, swapped));
+    }
+  }
+  for (int i = 0; i < 4; i++) {
+    _mm_storeu_si128((__m128i*)(acc + 2 * i), lanes[i]);
+  }
+#else
+  for (int s = 0; s < stripes; s++) {
+    const u8 *in = input + s * XXH3_STRIPE_LEN;
+    const u8 *key = secret + s * XXH3_SECRET_CONSUME_RATE;
+    for (int i = 0; i < 8; i++) {
+      u64 data = read64(in + 8 * i);
+      u64 data_key = data ^ read64(key + 8 * i);
+      acc[i ^ 1] += data;
+      acc[i] += (data_key & 0xffffffff) * (data_key >> 32);
+    }
+  }
+#endif
+}
+
+static void xxh3_scramble(u64 *acc, const u8 *secret) {
+#ifdef __SSE2__
+  const __m128i prime = _mm_set1_epi32((int)PRIME32_1);
+  for (int i = 0; i < 4; i++) {
+    __m128i lane = _mm_loadu_si128((const __m128i*)(acc + 2 * i));
+    lane = _mm_xor_si128(lane, _mm_srli_epi64(lane, 47));
+    lane = _mm_xor_si128(lane, _mm_loadu_si128((const __m128i*)(secret + 16 * i)));
+    __m128i lane_hi = _mm_shuffle_epi32(lane, _MM_SHUFFLE(0, 3, 0, 1));
+    __m128i product_lo = _mm_mul_epu32(lane, prime);
+    __m128i product_hi = _mm_mul_epu32(lane_hi, prime);
+    _mm_storeu_si128((__m128i*)(acc + 2 * i),
+                     _mm_add_epi64(product_lo, _mm_slli_epi64(product_hi, 32)));
+  }
+#else
+  for (int i = 0; i < 8; i++) {
+    u64 lane = acc[i];
+    lane ^= lane >> 47;
+    lane ^= read64(secret + 8 * i);
+    acc[i] = lane * PRIME32_1;
+  }
+#endif
+}
+
+static void xxh3_init_acc(u64 *acc) {
+  acc[0] = PRIME32_3; acc[1] = PRIME64_1; acc[2] = PRIME64_2; acc[3] = PRIME64_3;
+  acc[4] = PRIME64_4; acc[5] = PRIME32_2; acc[6] = PRIME64_5; acc[7] = PRIME32_1;
+}
+
+static u64 xxh3_merge(const u64 *acc, const u8 *secret, u64 length) {
+  u64 result = length * PRIME64_1;
+  for (int i = 0; i < 4; i++) {
+    result += mul128_fold64(acc[2 * i] ^ read64(secret + 16 * i),
+                            acc[2 * i + 1] ^ read64(secret + 16 * i + 8));
+  }
+  return xxh3_avalanche(result);
+}
+
+// Seeded hashes of long inputs use a secret derived from the seed
+static void xxh3_derive_secret(u8 *secret, u64 seed) {
+  for (int i = 0; i < XXH3_SECRET_SIZE / 16; i++) {
+    write64(secret + 16 * i, read64(xxh3_default_secret + 16 * i) + seed);
+    write64(secret + 16 * i + 8, read64(xxh3_default_secret + 16 * i + 8) - seed);
+  }
+}
+
+// More than 240 bytes
+static u64 xxh3_long(const u8 *input, size_t length, const u8 *secret) {
+  u64 acc[8];
+  xxh3_init_acc(acc);
+
+  size_t blocks = (length - 1) / XXH3_BLOCK_LEN;
+  for (size_t n = 0; n < blocks; n++) {
+    xxh3_accumulate(acc, input + n * XXH3_BLOCK_LEN, secret, XXH3_STRIPES_PER_BLOCK);
+    xxh3_scramble(acc, secret + XXH3_SECRET_SIZE - XXH3_STRIPE_LEN);
+  }
+
+  int stripes = (int)(((length - 1) - blocks * XXH3_BLOCK_LEN) / XXH3_STRIPE_LEN);
+  xxh3_accumulate(acc, input + blocks * XXH3_BLOCK_LEN, secret, stripes);
+  xxh3_accumulate(acc, input + length - XXH3_STRIPE_LEN,
+                  secret + XXH3_SECRET_SIZE - XXH3_STRIPE_LEN - XXH3_LAST_SECRET_OFFSET, 1);
+
+  return xxh3_merge(acc, secret + XXH3_MERGE_ACCS_START, length);
+}
+
+u64 hash_xxh3(const void *data, size_t length, u64 seed) {
+  const u8 *input = data;
+  if (length <= 16) return xxh3_short(input, length, xxh3_default_secret, seed);
+  if (length <= XXH3_MIDSIZE_MAX) {
+    return xxh3_medium(input, length, xxh3_default_secret, seed);
+  }
+  if (seed == 0) return xxh3_long(input, length, xxh3_default_secret);
+
+  u8 secret[XXH3_SECRET_SIZE];
+  xxh3_derive_secret(secret, seed);
+  return xxh3_long(input, length, secret);
+}
+
+void hash_xxh3_init(Xxh3State *state, u64 seed) {
+  xxh3_init_acc(state->acc);
+  if (seed == 0) {
+    memcpy(state->secret, xxh3_default_secret, XXH3_SECRET_SIZE);
+  } else {
+    xxh3_derive_secret(state->secret, seed);
+  }
+  state->seed = seed;
+  state->total_length = 0;
+  state->buffered = 0;
+  state->stripes = 0;
+}
+
+// Consume whole stripes, scrambling at every block boundary
+static void xxh3_consume(Xxh3State *state, const u8 *input, int stripes) {
+  int to_block_end = XXH3_STRIPES_PER_BLOCK - state->stripes;
+  if (stripes >= to_block_end) {
+    xxh3_accumulate(state->acc, input,
+                    state->secret + state->stripes * XXH3_SECRET_CONSUME_RATE, to_block_end);
+    xxh3_scramble(state->acc, state->secret + XXH3_SECRET_SIZE - XXH3_STRIPE_LEN);
+    xxh3_accumulate(state->acc, input + to_block_end * XXH3_STRIPE_LEN,
+                    state->secret, stripes - to_block_end);
+    state->stripes = stripes - to_block_end;
+  } else {
+    xxh3_accumulate(state->acc, input,
+                    state->secret + state->stripes * XXH3_SECRET_CONSUME_RATE, stripes);
+    state->stripes += stripes;
+  }
+}
+
+// Input is only consumed once more follows it, so the final 1..256 bytes
+// always stay in the buffer for the digest. The last consumed stripe is
+// kept at the end of the buffer for digests that need to look back.
+void hash_xxh3_update(Xxh3State *state, const void *data, size_t length) {
+  const u8 *input = data;
+  const int buffer_stripes = XXH3_BUFFER_SIZE / XXH3_STRIPE_LEN;
+  state->total_length += length;
+
+  if (state->buffered + length <= XXH3_BUFFER_SIZE) {
+    memcpy(state->buffer + state->buffered, input, length);
+    state->buffered += (int)length;
+    return;
+  }
+
+  if (state->buffered > 0) {
+    size_t fill = XXH3_BUFFER_SIZE - state->buffered;
+    memcpy(state->buffer + state->buffered, input, fill);
+    input += fill;
+    length -= fill;
+    xxh3_consume(state, state->buffer, buffer_stripes);
+    state->buffered = 0;
+  }
+
+  if (length > XXH3_BUFFER_SIZE) {
+    do {
+      xxh3_consume(state, input, buffer_stripes);
+      input += XXH3_BUFFER_SIZE;
+      length -= XXH3_BUFFER_SIZE;
+    } while (length > XXH3_BUFFER_SIZE);
+    memcpy(state->buffer + XXH3_BUFFER_SIZE - XXH3_STRIPE_LEN,
+           input - XXH3_STRIPE_LEN, XXH3_STRIPE_LEN);
+  }
+
+  memcpy(state->buffer, input, length);
+  state->buffered = (int)length;
+}
+
+u64 hash_xxh3_digest(const Xxh3State *state) {
+  if (state->total_length <= XXH3_MIDSIZE_MAX) {
+    return hash_xxh3(state->buffer, (size_t)state->total_length, state->seed);
+  }
+
+  Xxh3State tail = *state;
+  u8 last_stripe[XXH3_STRIPE_LEN];
+  const u8 *last;
+  if (tail.buffered >= XXH3_STRIPE_LEN) {
+    xxh3_consume(&tail, tail.buffer, (tail.buffered - 1) / XXH3_STRIPE_LEN);
+    last = tail.buffer + tail.buffered - XXH3_STRIPE_LEN;
+  } else {
+    int catch_up = XXH3_STRIPE_LEN - tail.buffered;
+    memcpy(last_stripe, tail.buffer + XXH3_BUFFER_SIZE - catch_up, catch_up);
+    memcpy(last_stripe + catch_up, tail.buffer, tail.buffered);
+    last = last_stripe;
+  }
+  xxh3_accumulate(tail.acc, last,
+                  tail.secret + XXH3_SECRET_SIZE - XXH3_STRIPE_LEN - XXH3_LAST_SECRET_OFFSET, 1);
+  return xxh3_merge(tail.acc, tail.secret + XXH3_MERGE_ACCS_START, tail.total_length);
+}
+
+// ============================================================================
+// XXH32
+// ============================================================================
+
+static inline u32 xxh32_round(u32 acc, u32 input) {
+  acc += input * PRIME32_2;
+  return rotl32(acc, 13) * PRIME32_1;
+}
+
+static void xxh32_init_acc(u32 *acc, u32 seed) {
+  acc[0] = seed + PRIME32_1 + PRIME32_2;
+  acc[1] = seed + PRIME32_2;
+  acc[2] = seed;
+  acc[3] = seed - PRIME32_1;
+}
+
+// Fold whole 16-byte stripes; returns bytes consumed
+static size_t xxh32_stripes(u32 *acc, const u8 *p, size_t length) {
+  size_t consumed = length & ~(size_t)15;
+  for (size_t i = 0; i < consumed; i += 16) {
+    acc[0] = xxh32_round(acc[0], read32(p + i));
+    acc[1] = xxh32_round(acc[1], read32(p + i + 4));
+    acc[2] = xxh32_round(acc[2], read32(p + i + 8));
+    acc[3] = xxh32_round(acc[3], read32(p + i + 12));
+  }
+  return consumed;
+}
+
+// Mix in the total length and the trailing (< 16) bytes
+static u32 xxh32_finish(u32 h, const u8 *p, size_t length, u64 total_length) {
+  h += (u32)total_length;
+  for (; length >= 4; p += 4, length -= 4) {
+    h = rotl32(h + read32(p) * PRIME32_3, 17) * PRIME32_4;
+  }
+  for (; length > 0; p++, length--) {
+    h = rotl32(h + *p * PRIME32_5, 11) * PRIME32_1;
+  }
+  h ^= h >> 15;
+  h *= PRIME32_2;
+  h ^= h >> 13;
+  h *= PRIME32_3;
+  h ^= h >> 16;
+  return h;
+}
+
+static u32 xxh32_merge(const u32 *acc) {
+  return rotl32(acc[0], 1) + rotl32(acc[1], 7) + rotl32(acc[2], 12) + rotl32(acc[3], 18);
+}
+
+u32 hash_xxh32(const void *data, size_t length, u32 seed) {
+  const u8 *p = data;
+  if (length < 16) return xxh32_finish(seed + PRIME32_5, p, length, length);
+
+  u32 acc[4];
+  xxh32_init_acc(acc, seed);
+  size_t consumed = xxh32_stripes(acc, p, length);
+  return xxh32_finish(xxh32_merge(acc), p + consumed, length - consumed, length);
+}
+
+void hash_xxh32_init(Xxh32State *state, u32 seed) {
+  xxh32_init_acc(state->acc, seed);
+  state->seed = seed;
+  state->total_length = 0;
+  state->buffered = 0;
+}
+
+void hash_xxh32_update(Xxh32State *state, const void *data, size_t length) {
+  const u8 *p = data;
+  state->total_length += length;
+
+  if (state->buffered > 0) {
+    size_t fill = 16 - state->buffered;
+    if (length < fill) fill = length;
+    memcpy(state->buffer + state->buffered, p, fill);
+    state->buffered += (int)fill;
+    p += fill;
+    length -= fill;
+    if (state->buffered < 16) return;
+    xxh32_stripes(state->acc, state->buffer, 16);
+    state->buffered = 0;
+  }
+
+  size_t consumed = xxh32_stripes(state->acc, p, length);
+  memcpy(state->buffer, p + consumed, length - consumed);
+  state->buffered = (int)(length - consumed);
+}
+
+u32 hash_xxh32_digest(const Xxh32State *state) {
+  u32 h = state->total_length >= 16 ? xxh32_merge(state->acc)
+                                    : state->seed + PRIME32_5;
+  return xxh32_finish(h, state->buffer, (size_t)state->buffered, state->total_length);
+}
+
+// ============================================================================
+// CRC-32C
+// ============================================================================
+
+static u32 crc32c_table[256];
+static bool crc32c_table_ready = false;
+
+static u32 crc32c_soft(u32 crc, const u8 *p, size_t length) {
+  if (!crc32c_table_ready) {
+    for (u32 i = 0; i < 256; i++) {
+      u32 c = i;
+      for (int k = 0; k < 8; k++) {
+        c = c & 1 ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+      }
+      crc32c_table[i] = c;
+    }
+    crc32c_table_ready = true;
+  }
+  while (length--) {
+    crc = crc32c_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+#ifdef HASH_HAVE_CRC32_INSN
+__attribute__((target("sse4.2")))
+static u32 crc32c_hard(u32 crc, const u8 *p, size_t length) {
+  u64 c = crc;
+  for (; length >= 8; p += 8, length -= 8) {
+    c = _mm_crc32_u64(c, read64(p));
+  }
+  crc = (u32)c;
+  while (length--) {
+    crc = _mm_crc32_u8(crc, *p++);
+  }
+  return crc;
+}
+#endif
+
+u32 hash_crc32c(u32 crc, const void *data, size_t length) {
+  crc = ~crc;
+#ifdef HASH_HAVE_CRC32_INSN
+  static int has_sse42 = -1;
+  if (has_sse42 < 0) has_sse42 = __builtin_cpu_supports("sse4.2") ? 1 : 0;
+  if (has_sse42) return ~crc32c_hard(crc, data, length);
+#endif
+  return ~crc32c_soft(crc, data, length);
+}
+
+// ============================================================================
+// Natives
+// ============================================================================
+
+typedef enum {
+  HASHER_XXH3,
+  HASHER_CRC32C,
+} HasherKind;
+
+typedef struct {
+  HasherKind kind;
+  u32 crc;
+  Xxh3State xxh3;
+} Hasher;
+
+static const ForeignType hasher_type = {"hasher", mem_free, NULL, NULL};
+
+static bool parse_hasher_kind(const char *name, Value value, HasherKind *kind) {
+  const char *chars;
+  int length;
+  if (!value_get_string(&value, &chars, &length)) {
+    fprintf(stderr, "Error: %s expects an algorithm name\n", name);
+    return false;
+  }
+  if (length == 4 && memcmp(chars, "xxh3", 4) == 0) {
+    *kind = HASHER_XXH3;
+  } else if (length == 6 && memcmp(chars, "crc32c", 6) == 0) {
+    *kind = HASHER_CRC32C;
+  } else {
+    fprintf(stderr, "Error: %s: unknown streaming algorithm '%.*s' (use xxh3 or crc32c)\n",
+            name, length, chars);
+    return false;
+  }
+  return true;
+}
+
+static void hasher_update(Hasher *hasher, const void *data, size_t length) {
+  if (hasher->kind == HASHER_XXH3) {
+    hash_xxh3_update(&hasher->xxh3, data, length);
+  } else {
+    hasher->crc = hash_crc32c(hasher->crc, data, length);
+  }
+}
+
+static u64 hasher_digest(const Hasher *hasher) {
+  return hasher->kind == HASHER_XXH3 ? hash_xxh3_digest(&hasher->xxh3) : hasher->crc;
+}
+
+// Shared argument check for (data [, int]) natives
+static bool hash_args(const char *name, int arg_count, Value *args,
+                      const char **data, int *length, u64 *extra) {
+  if (arg_count < 1 || arg_count > 2) {
+    fprintf(stderr, "Error: %s expects 1 or 2 arguments, got %d\n", name, arg_count);
+    return false;
+  }
+  if (!value_get_string(&args[0], data, length)) {
+    fprintf(stderr, "Error: %s expects string argument\n", name);
+    return false;
+  }
+  *extra = 0;
+  if (arg_count == 2) {
+    if (!IS_INT(args[1])) {
+      fprintf(stderr, "Error: %s expects int as second argument\n", name);
+      return false;
+    }
+    *extra = (u64)AS_INT(args[1]);
+  }
+  return true;
+}
+
+// hash.xxh3 - XXH3-64 of a string, with optional seed
+Value native_hash_xxh3(int arg_count, Value *args) {
+  const char *data;
+  int length;
+  u64 seed;
+  if (!hash_args("xxh3", arg_count, args, &data, &length, &seed)) {
+    return value_make_nil();
+  }
+  return value_make_int((i64)hash_xxh3(data, (size_t)length, seed));
+}
+
+// hash.wyhash - wyhash of a string, with optional seed
+Value native_hash_wyhash(int arg_count, Value *args) {
+  const char *data;
+  int length;
+  u64 seed;
+  if (!hash_args("wyhash", arg_count, args, &data, &length, &seed)) {
+    return value_make_nil();
+  }
+  return value_make_int((i64)hash_wyhash(data, (size_t)length, seed));
+}
+
+// hash.crc32c - CRC-32C of a string, optionally continuing a previous crc
+Value native_hash_crc32c(int arg_count, Value *args) {
+  const char *data;
+  int length;
+  u64 crc;
+  if (!hash_args("crc32c", arg_count, args, &data, &length, &crc)) {
+    return value_make_nil();
+  }
+  return value_make_int(hash_crc32c((u32)crc, data, (size_t)length));
+}
+
+// hash.hasher - New streaming hasher ("xxh3" or "crc32c")
+Value native_hash_hasher(int arg_count, Value *args) {
+  HasherKind kind;
+  if (arg_count != 1) {
+    fprintf(stderr, "Error: hasher expects 1 argument, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  if (!parse_hasher_kind("hasher", args[0], &kind)) return value_make_nil();
+
+  Hasher *hasher = (Hasher*)mem_alloc(sizeof(Hasher));
+  hasher->kind = kind;
+  hasher->crc = 0;
+  hash_xxh3_init(&hasher->xxh3, 0);
+  return OBJ_VAL(foreign_make(&hasher_type, hasher));
+}
+
+// hash.update - Feed bytes to a hasher; returns the hasher
+Value native_hash_update(int arg_count, Value *args) {
+  const char *data;
+  int length;
+  if (arg_count != 2) {
+    fprintf(stderr, "Error: update expects 2 arguments, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  if (!IS_FOREIGN(args[0], &hasher_type)) {
+    fprintf(stderr, "Error: update expects a hasher\n");
+    return value_make_nil();
+  }
+  if (!value_get_string(&args[1], &data, &length)) {
+    fprintf(stderr, "Error: update expects string argument\n");
+    return value_make_nil();
+  }
+  hasher_update((Hasher*)AS_FOREIGN_DATA(args[0]), data, (size_t)length);
+  return args[0];
+}
+
+// hash.digest - Hash of everything fed so far (the hasher stays usable)
+Value native_hash_digest(int arg_count, Value *args) {
+  if (arg_count != 1) {
+    fprintf(stderr, "Error: digest expects 1 argument, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  if (!IS_FOREIGN(args[0], &hasher_type)) {
+    fprintf(stderr, "Error: digest expects a hasher\n");
+    return value_make_nil();
+  }
+  return value_make_int((i64)hasher_digest((Hasher*)AS_FOREIGN_DATA(args[0])));
+}
+
+// hash.file - Stream a file through a hasher (xxh3 unless named)
+Value native_hash_file(int arg_count, Value *args) {
+  const char *path;
+  int path_length;
+  if (arg_count < 1 || arg_count > 2) {
+    fprintf(stderr, "Error: file expects 1 or 2 arguments, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  if (!value_get_string(&args[0], &path, &path_length)) {
+    fprintf(stderr, "Error: file expects string argument\n");
+    return value_make_nil();
+  }
+
+  Hasher hasher;
+  hasher.kind = HASHER_XXH3;
+  hasher.crc = 0;
+  if (arg_count == 2 && !parse_hasher_kind("file", args[1], &hasher.kind)) {
+    return value_make_nil();
+  }
+  hash_xxh3_init(&hasher.xxh3, 0);
+
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "Error: Could not open file '%s'\n", path);
+    return value_make_nil();
+  }
+  char *chunk = (char*)mem_alloc(HASH_FILE_CHUNK);
+  size_t read;
+  while ((read = fread(chunk, 1, HASH_FILE_CHUNK, file)) > 0) {
+    hasher_update(&hasher, chunk, read);
+  }
+  bool failed = ferror(file);
+  mem_free(chunk);
+  fclose(file);
+
+  if (failed) {
+    fprintf(stderr, "Error: Could not read file '%s'\n", path);
+    return value_make_nil();
+  }
+  return value_make_int((i64)hasher_digest(&hasher));
+}
+
+// hash.hex - Format a hash as 16 hex digits
+Value native_hash_hex(int arg_count, Value *args) {
+  if (arg_count != 1) {
+    fprintf(stderr, "Error: hex expects 1 argument, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  if (!IS_INT(args[0])) {
+    fprintf(stderr, "Error: hex expects int argument\n");
+    return value_make_nil();
+  }
+  char buffer[17];
+  snprintf(buffer, sizeof(buffer), "%016llx", (unsigned long long)(u64)AS_INT(args[0]));
+  // Too long to hold inline, so a string object the collector tracks
+  return OBJ_VAL(string_copy(buffer, 16));
+}
+
+// Module initialization
+void hash_module_init(VM *vm) {
+  module_register_native(vm, "hash.xxh3", native_hash_xxh3);
+  module_register_native(vm, "hash.wyhash", native_hash_wyhash);
+  module_register_native(vm, "hash.crc32c", native_hash_crc32c);
+  module_register_native(vm, "hash.hasher", native_hash_hasher);
+  module_register_native(vm, "hash.update", native_hash_update);
+  module_register_native(vm, "hash.digest", native_hash_digest);
+  module_register_native(vm, "hash.file", native_hash_file);
+  module_register_native(vm, "hash.hex", native_hash_hex);
+}
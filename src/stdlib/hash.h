@@ -0,0 +1,60 @@
+// src/stdlib/hash.h - Hashing and checksum module interface
+
+#ifndef SATORI_STDLIB_HASH_H
+#define SATORI_STDLIB_HASH_H
+
+#include "core/hash.h"
+#include "core/value.h"
+#include "runtime/vm.h"
+
+#define XXH3_BUFFER_SIZE 256
+#define XXH3_SECRET_SIZE 192
+
+// Streaming XXH3-64 state. Digests match hash_xxh3 over the same bytes.
+typedef struct {
+  u64 acc[8];
+  u8 buffer[XXH3_BUFFER_SIZE];
+  u8 secret[XXH3_SECRET_SIZE];
+  u64 seed;
+  u64 total_length;
+  int buffered;
+  int stripes;  // Stripes consumed in the current block
+} Xxh3State;
+
+// Streaming XXH32 state (used by the LZ4 frame format for checksums)
+typedef struct {
+  u32 acc[4];
+  u8 buffer[16];
+  u32 seed;
+  u64 total_length;
+  int buffered;
+} Xxh32State;
+
+// C API, shared by the natives and by benchmarks/tests. hash_wyhash lives
+// in core, which hashes keys with it.
+u64 hash_xxh3(const void *data, size_t length, u64 seed);
+u32 hash_crc32c(u32 crc, const void *data, size_t length);
+u32 hash_xxh32(const void *data, size_t length, u32 seed);
+
+void hash_xxh3_init(Xxh3State *state, u64 seed);
+void hash_xxh3_update(Xxh3State *state, const void *data, size_t length);
+u64 hash_xxh3_digest(const Xxh3State *state);
+
+void hash_xxh32_init(Xxh32State *state, u32 seed);
+void hash_xxh32_update(Xxh32State *state, const void *data, size_t length);
+u32 hash_xxh32_digest(const Xxh32State *state);
+
+// Module initialization
+void hash_module_init(VM *vm);
+
+// Native functions
+Value native_hash_xxh3(int arg_count, Value *args);
+Value native_hash_wyhash(int arg_count, Value *args);
+Value native_hash_crc32c(int arg_count, Value *args);
+Value native_hash_hasher(int arg_count, Value *args);
+Value native_hash_update(int arg_count, Value *args);
+Value native_hash_digest(int arg_count, Value *args);
+Value native_hash_file(int arg_count, Value *args);
+Value native_hash_hex(int arg_count, Value *args);
+
+#endif // SATORI_STDLIB_HASH_H
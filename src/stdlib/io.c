@@ -14,11 +14,12 @@
 #include <stdlib.h>
 
 // Helper: Process format string with {} placeholders
-static void print_formatted(const char *format, int arg_count, Value *args) {
+static void print_formatted(const char *format, int length, int arg_count, Value *args) {
   int arg_index = 1;  // Skip format string itself
+  const char *end = format + length;
   
-  for (const char *p = format; *p; p++) {
-    if (*p == '{' && *(p + 1) == '}') {
+  for (const char *p = format; p < end; p++) {
+    if (*p == '{' && p + 1 < end && *(p + 1) == '}') {
       // Found placeholder
       if (arg_index < arg_count) {
         value_print(args[arg_index]);
@@ -43,21 +44,21 @@ Value native_io_println(int arg_count, Value *args) {
   }
   
   // First argument should be a string (format or plain text)
-  if (!IS_STRING(args[0])) {
+  const char *format;
+  int length;
+  if (!value_get_string(&args[0], &format, &length)) {
     // Fallback: just print the value
     value_print(args[0]);
     printf("\n");
     return value_make_nil();
   }
   
-  const char *format = AS_STRING(args[0]);
-  
   if (arg_count == 1) {
     // No placeholders, just print the string
-    printf("%s\n", format);
+    printf("%.*s\n", length, format);
   } else {
     // Format string with arguments
-    print_formatted(format, arg_count, args);
+    print_formatted(format, length, arg_count, args);
     printf("\n");
   }
   
@@ -70,17 +71,17 @@ Value native_io_print(int arg_count, Value *args) {
     return value_make_nil();
   }
   
-  if (!IS_STRING(args[0])) {
+  const char *format;
+  int length;
+  if (!value_get_string(&args[0], &format, &length)) {
     value_print(args[0]);
     return value_make_nil();
   }
   
-  const char *format = AS_STRING(args[0]);
-  
   if (arg_count == 1) {
-    printf("%s", format);
+    printf("%.*s", length, format);
   } else {
-    print_formatted(format, arg_count, args);
+    print_formatted(format, length, arg_count, args);
   }
   
   return value_make_nil();
@@ -0,0 +1,614 @@
+// src/stdlib/ipc.c - Shared-memory channel module implementation
+//
+// A channel is a byte ring in a POSIX shared-memory object, so processes
+// on one host pass messages without copying them through the kernel:
+//
+//   IpcShared   control block; producer and consumer fields on their own
+//               cache lines
+//   data        `capacity` bytes of records, capacity a power of two
+//
+// A record is an 8-byte header (u32 length, u32 flags) and the payload,
+// padded to 8 bytes. Records never wrap: when one does not fit before the
+// end of the ring, the producer fills the rest with a pad record and
+// starts again at offset 0. `head` and `tail` count bytes forever; their
+// difference is the space in use.
+//
+// SPSC rings have one producer. It writes a record and then publishes it
+// by moving `tail` forward (release); the consumer reads up to the tail it
+// last saw (acquire). Each side caches the other's counter and only
+// reloads it when the ring looks full or empty, so the two cache lines are
+// not passed back and forth on every message.
+//
+// MPSC rings have many producers. A producer claims space by moving
+// `tail` with compare-and-swap, fills it, and then marks the header
+// committed. Since producers finish out of order, the consumer goes by the
+// committed flag rather than by `tail`, and zeroes each record as it
+// releases it so stale bytes never look like a header.
+//
+// A side that has to wait spins for a moment if there is another CPU to
+// make progress, then sleeps on a futex: `data_seq` for the consumer,
+// `space_seq` for producers. The sleeper first raises the matching
+// `asleep` flag; the other side only bumps the sequence and makes the wake
+// system call when it finds the flag raised, and clears it, so a busy
+// channel makes no system calls at all. Without futexes (outside Linux)
+// sleepers poll.
+//
+// The protocol trusts its users: nothing stops a second consumer, or a
+// second producer on an SPSC ring.
+
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE    // syscall() for futexes
+
+#include "ipc.h"
+#include "runtime/module.h"
+#include "core/memory.h"
+#include "core/object.h"
+#include "core/value.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#define IPC_MAGIC 0x43505453u       // "STPC"
+#define IPC_LINE 64
+#define IPC_DATA_OFFSET 256         // Control block, rounded up
+#define IPC_MIN_CAPACITY 4096
+#define IPC_RECORD_HEADER 8
+#define IPC_NAME_MAX 256
+#define IPC_OPEN_TRIES 1000         // 1ms apart, while the creator sets up
+#define IPC_SPINS 2000              // Attempts before sleeping, on SMP
+
+#define IPC_COMMITTED 1u
+#define IPC_PAD 2u
+
+struct IpcShared {
+  u32 magic;               // Set last by the creator
+  u32 mode;
+  u64 capacity;
+  u8 pad0[IPC_LINE - 16];
+
+  u64 tail;                // Producers
+  u32 space_seq;           // Bumped to wake producers
+  u32 producers_asleep;
+  u8 pad1[IPC_LINE - 16];
+
+  u64 head;                // Consumer
+  u32 data_seq;            // Bumped to wake the consumer
+  u32 consumer_asleep;
+  u8 pad2[IPC_LINE - 16];
+};
+
+static u64 record_size(u64 length) {
+  return (IPC_RECORD_HEADER + length + 7) & ~(u64)7;
+}
+
+static u32 *record_flags(u8 *record) {
+  return (u32*)(record + 4);
+}
+
+int ipc_max_message(u64 capacity) {
+  // Padding can waste up to a record's size, so a record may take at most
+  // half the ring
+  u64 max = capacity / 2 - IPC_RECORD_HEADER;
+  return max > INT_MAX ? INT_MAX : (int)max;
+}
+
+// ============================================================================
+// Waiting
+// ============================================================================
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// Sleep until *seq moves on from `seen` or the deadline (monotonic ms,
+// negative for none) passes. Returns false once the deadline is past.
+static bool ipc_wait(u32 *seq, u32 seen, double deadline) {
+  struct timespec timeout;
+  struct timespec *timeout_ptr = NULL;
+  if (deadline >= 0) {
+    double left = deadline - now_ms();
+    if (left <= 0) return false;
+    timeout.tv_sec = (time_t)(left / 1000);
+    timeout.tv_nsec = (long)((left - timeout.tv_sec * 1000.0) * 1e6);
+    timeout_ptr = &timeout;
+  }
+#ifdef __linux__
+  syscall(SYS_futex, seq, FUTEX_WAIT, seen, timeout_ptr, NULL, 0);
+#else
+  (void)seq;
+  (void)seen;
+  (void)timeout_ptr;
+  struct timespec pause = {0, 50000};
+  nanosleep(&pause, NULL);
+#endif
+  return true;
+}
+
+// Wake the other side if it went to sleep
+static void ipc_notify(u32 *seq, u32 *asleep) {
+  // Pairs with the sleeper raising its flag before its last attempt
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(asleep, __ATOMIC_RELAXED) == 0) return;
+  if (__atomic_exchange_n(asleep, 0, __ATOMIC_SEQ_CST) == 0) return;
+  __atomic_add_fetch(seq, 1, __ATOMIC_SEQ_CST);
+#ifdef __linux__
+  syscall(SYS_futex, seq, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+static void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+// A non-blocking step: claim space, or find a record
+typedef bool (*IpcAttempt)(IpcRing *ring, void *state);
+
+// Repeat `attempt` until it succeeds or the timeout passes, sleeping on
+// `seq` between tries
+static bool ipc_block(IpcRing *ring, IpcAttempt attempt, void *state, u32 *seq, u32 *asleep,
+                      int timeout_ms) {
+  static long cpus = 0;
+  if (attempt(ring, state)) return true;
+  if (timeout_ms == 0) return false;
+
+  // With one CPU the other side cannot run while we spin
+  if (cpus == 0) cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if (cpus > 1) {
+    for (int i = 0; i < IPC_SPINS; i++) {
+      cpu_relax();
+      if (attempt(ring, state)) return true;
+    }
+  }
+
+  double deadline = timeout_ms < 0 ? -1 : now_ms() + timeout_ms;
+  for (;;) {
+    __atomic_store_n(asleep, 1, __ATOMIC_SEQ_CST);
+    u32 seen = __atomic_load_n(seq, __ATOMIC_SEQ_CST);
+    if (attempt(ring, state)) return true;
+    if (!ipc_wait(seq, seen, deadline)) return false;
+  }
+}
+
+// ============================================================================
+// Rings
+// ============================================================================
+
+// Shared-memory object name for a channel name
+static bool ipc_shm_name(const char *name, char *out, const char **error) {
+  if (name[0] == '\0' || strchr(name, '/') != NULL ||
+      strlen(name) + sizeof("/satori.") > IPC_NAME_MAX) {
+    *error = "channel names must be non-empty and contain no '/'";
+    return false;
+  }
+  snprintf(out, IPC_NAME_MAX, "/satori.%s", name);
+  return true;
+}
+
+static IpcRing *ipc_map(int fd, u64 length, const char **error) {
+  void *map = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    *error = strerror(errno);
+    return NULL;
+  }
+  IpcRing *ring = mem_alloc(sizeof(IpcRing));
+  memset(ring, 0, sizeof(IpcRing));
+  ring->shared = map;
+  ring->data = (u8*)map + IPC_DATA_OFFSET;
+  ring->map_length = length;
+  return ring;
+}
+
+static void ipc_attach(IpcRing *ring) {
+  ring->capacity = ring->shared->capacity;
+  ring->mode = (IpcMode)ring->shared->mode;
+  ring->cached_head = __atomic_load_n(&ring->shared->head, __ATOMIC_ACQUIRE);
+  ring->cached_tail = __atomic_load_n(&ring->shared->tail, __ATOMIC_ACQUIRE);
+}
+
+IpcRing *ipc_create(const char *name, u64 capacity, IpcMode mode, const char **error) {
+  char shm_name[IPC_NAME_MAX];
+  if (!ipc_shm_name(name, shm_name, error)) return NULL;
+  u64 size = IPC_MIN_CAPACITY;
+  while (size < capacity) size *= 2;
+
+  int fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    *error = errno == EEXIST ? "channel already exists" : strerror(errno);
+    return NULL;
+  }
+  IpcRing *ring = NULL;
+  if (ftruncate(fd, (off_t)(IPC_DATA_OFFSET + size)) != 0) {
+    *error = strerror(errno);
+  } else {
+    ring = ipc_map(fd, IPC_DATA_OFFSET + size, error);
+  }
+  close(fd);
+  if (ring == NULL) {
+    shm_unlink(shm_name);
+    return NULL;
+  }
+
+  // The object starts zeroed: empty ring, no committed records
+  ring->shared->mode = (u32)mode;
+  ring->shared->capacity = size;
+  __atomic_store_n(&ring->shared->magic, IPC_MAGIC, __ATOMIC_RELEASE);
+  ipc_attach(ring);
+  return ring;
+}
+
+IpcRing *ipc_open(const char *name, const char **error) {
+  char shm_name[IPC_NAME_MAX];
+  if (!ipc_shm_name(name, shm_name, error)) return NULL;
+  int fd = shm_open(shm_name, O_RDWR, 0);
+  if (fd < 0) {
+    *error = errno == ENOENT ? "no such channel" : strerror(errno);
+    return NULL;
+  }
+
+  // The creator may still be sizing and initializing the object
+  struct stat st;
+  IpcRing *ring = NULL;
+  for (int i = 0; i < IPC_OPEN_TRIES; i++) {
+    if (fstat(fd, &st) != 0) {
+      *error = strerror(errno);
+      break;
+    }
+    if (st.st_size > IPC_DATA_OFFSET) {
+      ring = ipc_map(fd, (u64)st.st_size, error);
+      if (ring == NULL) break;
+      if (__atomic_load_n(&ring->shared->magic, __ATOMIC_ACQUIRE) == IPC_MAGIC) break;
+      ipc_close(ring);
+      ring = NULL;
+    }
+    struct timespec pause = {0, 1000000};
+    nanosleep(&pause, NULL);
+  }
+  close(fd);
+  if (ring == NULL) {
+    if (*error == NULL) *error = "not a satori channel";
+    return NULL;
+  }
+  ipc_attach(ring);
+  return ring;
+}
+
+void ipc_close(IpcRing *ring) {
+  munmap(ring->shared, ring->map_length);
+  mem_free(ring);
+}
+
+bool ipc_remove(const char *name, const char **error) {
+  char shm_name[IPC_NAME_MAX];
+  if (!ipc_shm_name(name, shm_name, error)) return false;
+  if (shm_unlink(shm_name) != 0) {
+    *error = errno == ENOENT ? "no such channel" : strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+// ============================================================================
+// Sending and receiving
+// ============================================================================
+
+typedef struct {
+  u64 size;
+  u64 start;
+  u64 claimed;
+} IpcClaim;
+
+// Claim `size` bytes, plus padding if they would run past the end. Fails
+// while the ring is too full.
+static bool ipc_reserve(IpcRing *ring, void *state) {
+  IpcClaim *claim = state;
+  IpcShared *shared = ring->shared;
+  u64 tail = __atomic_load_n(&shared->tail, __ATOMIC_RELAXED);
+  for (;;) {
+    u64 offset = tail & (ring->capacity - 1);
+    u64 need = offset + claim->size > ring->capacity
+                   ? ring->capacity - offset + claim->size
+                   : claim->size;
+    if (tail + need - ring->cached_head > ring->capacity) {
+      ring->cached_head = __atomic_load_n(&shared->head, __ATOMIC_ACQUIRE);
+      if (tail + need - ring->cached_head > ring->capacity) return false;
+    }
+    if (ring->mode == IPC_SPSC ||
+        __atomic_compare_exchange_n(&shared->tail, &tail, tail + need, true,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      claim->start = tail;
+      claim->claimed = need;
+      return true;
+    }
+  }
+}
+
+bool ipc_send(IpcRing *ring, const void *data, int length, int timeout_ms) {
+  IpcShared *shared = ring->shared;
+  if (length > ipc_max_message(ring->capacity)) return false;
+  IpcClaim claim = {record_size((u64)length), 0, 0};
+  if (!ipc_block(ring, ipc_reserve, &claim, &shared->space_seq, &shared->producers_asleep,
+                 timeout_ms)) {
+    return false;
+  }
+
+  u64 offset = claim.start & (ring->capacity - 1);
+  if (claim.claimed != claim.size) {
+    u8 *pad = ring->data + offset;
+    u32 pad_length = (u32)(ring->capacity - offset);
+    memcpy(pad, &pad_length, sizeof(u32));
+    __atomic_store_n(record_flags(pad), IPC_COMMITTED | IPC_PAD, __ATOMIC_RELEASE);
+    offset = 0;
+  }
+  u8 *record = ring->data + offset;
+  u32 length32 = (u32)length;
+  memcpy(record, &length32, sizeof(u32));
+  memcpy(record + IPC_RECORD_HEADER, data, (size_t)length);
+  __atomic_store_n(record_flags(record), IPC_COMMITTED, __ATOMIC_RELEASE);
+  if (ring->mode == IPC_SPSC) {
+    __atomic_store_n(&shared->tail, claim.start + claim.claimed, __ATOMIC_RELEASE);
+  }
+
+  ipc_notify(&shared->data_seq, &shared->consumer_asleep);
+  return true;
+}
+
+// Give the `size` bytes at head back to producers
+static void ipc_advance(IpcRing *ring, u8 *record, u64 size) {
+  IpcShared *shared = ring->shared;
+  if (ring->mode == IPC_MPSC) memset(record, 0, size);
+  u64 head = __atomic_load_n(&shared->head, __ATOMIC_RELAXED);
+  __atomic_store_n(&shared->head, head + size, __ATOMIC_RELEASE);
+  ipc_notify(&shared->space_seq, &shared->producers_asleep);
+}
+
+// The published record at head, skipping padding. Fails while there is
+// none.
+static bool ipc_peek(IpcRing *ring, void *state) {
+  IpcShared *shared = ring->shared;
+  for (;;) {
+    u64 head = __atomic_load_n(&shared->head, __ATOMIC_RELAXED);
+    u8 *record = ring->data + (head & (ring->capacity - 1));
+    u32 flags;
+    if (ring->mode == IPC_SPSC) {
+      if (head == ring->cached_tail) {
+        ring->cached_tail = __atomic_load_n(&shared->tail, __ATOMIC_ACQUIRE);
+        if (head == ring->cached_tail) return false;
+      }
+      flags = *record_flags(record);
+    } else {
+      flags = __atomic_load_n(record_flags(record), __ATOMIC_ACQUIRE);
+      if (!(flags & IPC_COMMITTED)) return false;
+    }
+
+    if (!(flags & IPC_PAD)) {
+      *(u8**)state = record;
+      return true;
+    }
+    u32 pad_length;
+    memcpy(&pad_length, record, sizeof(u32));
+    ipc_advance(ring, record, pad_length);
+  }
+}
+
+bool ipc_recv(IpcRing *ring, const u8 **data, int *length, int timeout_ms) {
+  IpcShared *shared = ring->shared;
+  u8 *record;
+  if (!ipc_block(ring, ipc_peek, &record, &shared->data_seq, &shared->consumer_asleep,
+                 timeout_ms)) {
+    return false;
+  }
+
+  u32 length32;
+  memcpy(&length32, record, sizeof(u32));
+  *data = record + IPC_RECORD_HEADER;
+  *length = (int)length32;
+  ring->taken = record_size(length32);
+  return true;
+}
+
+void ipc_release(IpcRing *ring) {
+  if (ring->taken == 0) return;
+  u64 head = __atomic_load_n(&ring->shared->head, __ATOMIC_RELAXED);
+  ipc_advance(ring, ring->data + (head & (ring->capacity - 1)), ring->taken);
+  ring->taken = 0;
+}
+
+// ============================================================================
+// Natives
+// ============================================================================
+
+static void ipc_release_channel(void *data) {
+  if (data != NULL) ipc_close((IpcRing*)data);
+}
+
+static const ForeignType channel_type = {"ipc channel", ipc_release_channel, NULL, NULL};
+
+// The open channel behind args[0], or NULL after reporting why not
+static IpcRing *channel_arg(const char *name, Value *args) {
+  if (!IS_FOREIGN(args[0], &channel_type)) {
+    fprintf(stderr, "Error: %s expects an ipc channel\n", name);
+    return NULL;
+  }
+  IpcRing *ring = (IpcRing*)AS_FOREIGN_DATA(args[0]);
+  if (ring == NULL) fprintf(stderr, "Error: %s: channel is closed\n", name);
+  return ring;
+}
+
+// Optional timeout argument in milliseconds; waiting forever by default
+static bool timeout_arg(const char *name, int arg_count, Value *args, int index, int *timeout) {
+  *timeout = -1;
+  if (arg_count <= index) return true;
+  if (!IS_INT(args[index])) {
+    fprintf(stderr, "Error: %s expects an int timeout in milliseconds\n", name);
+    return false;
+  }
+  i64 ms = AS_INT(args[index]);
+  *timeout = ms < 0 ? -1 : ms > INT_MAX ? INT_MAX : (int)ms;
+  return true;
+}
+
+// ipc.create - Create a named channel
+Value native_ipc_create(int arg_count, Value *args) {
+  const char *name, *mode_name = "spsc";
+  int length, mode_length = 4;
+  if (arg_count < 2 || arg_count > 3) {
+    fprintf(stderr, "Error: create expects 2 or 3 arguments, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  if (!value_get_string(&args[0], &name, &length)) {
+    fprintf(stderr, "Error: create expects a string name\n");
+    return value_make_nil();
+  }
+  if (!IS_INT(args[1]) || AS_INT(args[1]) <= 0 || AS_INT(args[1]) > (1ll << 40)) {
+    fprintf(stderr, "Error: create expects a positive capacity in bytes\n");
+    return value_make_nil();
+  }
+  if (arg_count == 3 && !value_get_string(&args[2], &mode_name, &mode_length)) {
+    fprintf(stderr, "Error: create expects mode \"spsc\" or \"mpsc\"\n");
+    return value_make_nil();
+  }
+  IpcMode mode;
+  if (mode_length == 4 && memcmp(mode_name, "spsc", 4) == 0) {
+    mode = IPC_SPSC;
+  } else if (mode_length == 4 && memcmp(mode_name, "mpsc", 4) == 0) {
+    mode = IPC_MPSC;
+  } else {
+    fprintf(stderr, "Error: create expects mode \"spsc\" or \"mpsc\"\n");
+    return value_make_nil();
+  }
+
+  const char *error = NULL;
+  IpcRing *ring = ipc_create(name, (u64)AS_INT(args[1]), mode, &error);
+  if (ring == NULL) {
+    fprintf(stderr, "Error: Could not create channel '%s': %s\n", name, error);
+    return value_make_nil();
+  }
+  return OBJ_VAL(foreign_make(&channel_type, ring));
+}
+
+// ipc.open - Attach to a channel another process created
+Value native_ipc_open(int arg_count, Value *args) {
+  const char *name;
+  int length;
+  if (arg_count != 1) {
+    fprintf(stderr, "Error: open expects 1 argument, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  if (!value_get_string(&args[0], &name, &length)) {
+    fprintf(stderr, "Error: open expects a string name\n");
+    return value_make_nil();
+  }
+
+  const char *error = NULL;
+  IpcRing *ring = ipc_open(name, &error);
+  if (ring == NULL) {
+    fprintf(stderr, "Error: Could not open channel '%s': %s\n", name, error);
+    return value_make_nil();
+  }
+  return OBJ_VAL(foreign_make(&channel_type, ring));
+}
+
+// ipc.send - Send a message; false if the channel stayed full until the timeout
+Value native_ipc_send(int arg_count, Value *args) {
+  const char *data;
+  int length, timeout;
+  if (arg_count < 2 || arg_count > 3) {
+    fprintf(stderr, "Error: send expects 2 or 3 arguments, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  IpcRing *ring = channel_arg("send", args);
+  if (ring == NULL) return value_make_nil();
+  if (!value_get_string(&args[1], &data, &length)) {
+    fprintf(stderr, "Error: send expects a string message\n");
+    return value_make_nil();
+  }
+  if (!timeout_arg("send", arg_count, args, 2, &timeout)) return value_make_nil();
+  if (length > ipc_max_message(ring->capacity)) {
+    fprintf(stderr, "Error: send: message of %d bytes is larger than the channel allows (%d)\n",
+            length, ipc_max_message(ring->capacity));
+    return value_make_nil();
+  }
+  return value_make_bool(ipc_send(ring, data, length, timeout));
+}
+
+// ipc.recv - Next message, or nil if none arrived before the timeout
+Value native_ipc_recv(int arg_count, Value *args) {
+  int timeout;
+  if (arg_count < 1 || arg_count > 2) {
+    fprintf(stderr, "Error: recv expects 1 or 2 arguments, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  IpcRing *ring = channel_arg("recv", args);
+  if (ring == NULL) return value_make_nil();
+  if (!timeout_arg("recv", arg_count, args, 1, &timeout)) return value_make_nil();
+
+  const u8 *data;
+  int length;
+  if (!ipc_recv(ring, &data, &length, timeout)) return value_make_nil();
+  Value message = length <= VALUE_SHORT_MAX
+                      ? value_copy_string((const char*)data, length)
+                      : OBJ_VAL(string_copy((const char*)data, length));
+  ipc_release(ring);
+  return message;
+}
+
+// ipc.close - Detach from a channel; it lives on until removed
+Value native_ipc_close(int arg_count, Value *args) {
+  if (arg_count != 1) {
+    fprintf(stderr, "Error: close expects 1 argument, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  IpcRing *ring = channel_arg("close", args);
+  if (ring == NULL) return value_make_nil();
+  ((ObjForeign*)AS_OBJ(args[0]))->data = NULL;
+  ipc_close(ring);
+  return value_make_bool(true);
+}
+
+// ipc.remove - Delete a channel's name; attached processes keep using it
+Value native_ipc_remove(int arg_count, Value *args) {
+  const char *name;
+  int length;
+  if (arg_count != 1) {
+    fprintf(stderr, "Error: remove expects 1 argument, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  if (!value_get_string(&args[0], &name, &length)) {
+    fprintf(stderr, "Error: remove expects a string name\n");
+    return value_make_nil();
+  }
+  const char *error = NULL;
+  if (!ipc_remove(name, &error)) {
+    fprintf(stderr, "Error: Could not remove channel '%s': %s\n", name, error);
+    return value_make_nil();
+  }
+  return value_make_bool(true);
+}
+
+// ============================================================================
+// Module initialization
+// ============================================================================
+
+void ipc_module_init(VM *vm) {
+  module_register_native(vm, "ipc.create", native_ipc_create);
+  module_register_native(vm, "ipc.open", native_ipc_open);
+  module_register_native(vm, "ipc.send", native_ipc_send);
+  module_register_native(vm, "ipc.recv", native_ipc_recv);
+  module_register_native(vm, "ipc.close", native_ipc_close);
+  module_register_native(vm, "ipc.remove", native_ipc_remove);
+}
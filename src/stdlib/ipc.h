@@ -0,0 +1,58 @@
+// src/stdlib/ipc.h - Shared-memory channel module interface
+
+#ifndef SATORI_STDLIB_IPC_H
+#define SATORI_STDLIB_IPC_H
+
+#include "core/value.h"
+#include "runtime/vm.h"
+
+typedef enum {
+  IPC_SPSC = 1,    // One producer, one consumer
+  IPC_MPSC = 2,    // Many producers, one consumer
+} IpcMode;
+
+typedef struct IpcShared IpcShared;
+
+// A process's handle on a ring in shared memory
+typedef struct {
+  IpcShared *shared;
+  u8 *data;
+  u64 capacity;     // Bytes in the data area, power of two
+  u64 map_length;
+  IpcMode mode;
+  u64 cached_head;  // Last head seen by a producer (SPSC)
+  u64 cached_tail;  // Last tail seen by the consumer (SPSC)
+  u64 taken;        // Bytes of the message handed out by ipc_recv
+} IpcRing;
+
+// Largest message a ring of `capacity` bytes carries
+int ipc_max_message(u64 capacity);
+
+// C API. Functions that can fail leave a message in *error. Timeouts are
+// in milliseconds; a negative timeout waits forever.
+IpcRing *ipc_create(const char *name, u64 capacity, IpcMode mode, const char **error);
+IpcRing *ipc_open(const char *name, const char **error);
+void ipc_close(IpcRing *ring);
+bool ipc_remove(const char *name, const char **error);
+
+// Returns false if the ring stayed full until the timeout, or if the
+// message is longer than ipc_max_message
+bool ipc_send(IpcRing *ring, const void *data, int length, int timeout_ms);
+
+// Next message, viewed in place in the ring. The space is only handed
+// back to producers by ipc_release, which must come before the next recv.
+bool ipc_recv(IpcRing *ring, const u8 **data, int *length, int timeout_ms);
+void ipc_release(IpcRing *ring);
+
+// Module initialization
+void ipc_module_init(VM *vm);
+
+// Native functions
+Value native_ipc_create(int arg_count, Value *args);
+Value native_ipc_open(int arg_count, Value *args);
+Value native_ipc_send(int arg_count, Value *args);
+Value native_ipc_recv(int arg_count, Value *args);
+Value native_ipc_close(int arg_count, Value *args);
+Value native_ipc_remove(int arg_count, Value *args);
+
+#endif // SATORI_STDLIB_IPC_H
@@ -0,0 +1,833 @@
+// src/stdlib/kv.c - Key-value store module implementation
+//
+// A store is one append-only log file, in the Bitcask style:
+//
+//   magic "SATKV001"
+//   record*   crc32c u32 | tag u8 | key length u32 | value length u32 |
+//             key bytes | value bytes
+//
+// All integers are little-endian; the checksum covers everything after
+// itself. A put appends a record and a delete appends a tombstone, so the
+// last record for a key wins.
+//
+// Reads never touch the disk. The log is mapped read-only and an in-memory
+// hash index (open addressing, linear probing) maps each live key to the
+// offset of its record. Keys are compared against the record bytes, so the
+// index holds no copies. Opening a store scans the log once to rebuild the
+// index; a torn record at the end, left by a crash mid-write, fails its
+// checksum and is cut off.
+//
+// Writes are group-committed: records collect in a pending buffer, past
+// the mapped log, and kv_commit writes the batch with one write and one
+// fsync. A batch is committed when it reaches KV_BATCH_BYTES, on
+// kv.flush and on close; writes since the last commit are lost in a crash.
+//
+// Once most of the log is dead, compaction rewrites the live records to a
+// new file on a background thread, from a private mapping of the log as it
+// stood when it began. The store keeps serving reads and writes; the next
+// commit after the thread finishes appends the records written meanwhile,
+// renames the new file over the log and rebases the index offsets.
+//
+// A store belongs to one process at a time.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "kv.h"
+#include "hash.h"
+#include "runtime/module.h"
+#include "core/memory.h"
+#include "core/object.h"
+#include "core/value.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define KV_MAGIC "SATKV001"
+#define KV_MAGIC_LENGTH 8
+#define KV_HEADER 13                     // crc, tag, key length, value length
+#define KV_BATCH_BYTES (64 * 1024)       // Pending bytes that force a commit
+#define KV_MAP_MIN (1u << 20)
+#define KV_COMPACT_MIN (1u << 20)        // Log size before compaction is worth it
+#define KV_MIN_CAPACITY 16
+
+// ============================================================================
+// Encoding
+// ============================================================================
+
+static void put_u32(u8 *p, u32 x) {
+  p[0] = (u8)x;
+  p[1] = (u8)(x >> 8);
+  p[2] = (u8)(x >> 16);
+  p[3] = (u8)(x >> 24);
+}
+
+static u32 get_u32(const u8 *p) {
+  return (u32)p[0] | (u32)p[1] << 8 | (u32)p[2] << 16 | (u32)p[3] << 24;
+}
+
+static void put_u64(u8 *p, u64 x) {
+  put_u32(p, (u32)x);
+  put_u32(p + 4, (u32)(x >> 32));
+}
+
+static u64 get_u64(const u8 *p) {
+  return (u64)get_u32(p) | (u64)get_u32(p + 4) << 32;
+}
+
+static u64 record_size(const u8 *record) {
+  return KV_HEADER + (u64)get_u32(record + 5) + get_u32(record + 9);
+}
+
+i64 kv_value_int(KvValue value) {
+  return (i64)get_u64((const u8*)value.bytes);
+}
+
+f64 kv_value_float(KvValue value) {
+  u64 bits = get_u64((const u8*)value.bytes);
+  f64 x;
+  memcpy(&x, &bits, sizeof(x));
+  return x;
+}
+
+// Record at `offset`, in the mapped log or in the pending batch
+static const u8 *kv_record(const KvStore *kv, u64 offset) {
+  if (offset >= kv->committed) return kv->pending + (offset - kv->committed);
+  return kv->map + offset;
+}
+
+// ============================================================================
+// File helpers
+// ============================================================================
+
+static bool write_all(int fd, const void *data, u64 length) {
+  const u8 *p = data;
+  while (length > 0) {
+    ssize_t written = write(fd, p, length);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    p += written;
+    length -= (u64)written;
+  }
+  return true;
+}
+
+static bool pwrite_all(int fd, const void *data, u64 length, u64 offset) {
+  const u8 *p = data;
+  while (length > 0) {
+    ssize_t written = pwrite(fd, p, length, (off_t)offset);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    p += written;
+    offset += (u64)written;
+    length -= (u64)written;
+  }
+  return true;
+}
+
+// Make a rename in the directory holding `path` durable
+static bool sync_parent(const char *path) {
+  const char *slash = strrchr(path, '/');
+  char *dir = slash == NULL ? NULL : mem_alloc((size_t)(slash - path) + 2);
+  if (dir != NULL) {
+    size_t length = slash == path ? 1 : (size_t)(slash - path);
+    memcpy(dir, path, length);
+    dir[length] = '\0';
+  }
+  int fd = open(dir == NULL ? "." : dir, O_RDONLY);
+  if (dir != NULL) mem_free(dir);
+  if (fd < 0) return false;
+  bool ok = fsync(fd) == 0;
+  close(fd);
+  return ok;
+}
+
+// Map at least `length` bytes of the log. The mapping is sized in powers
+// of two past the end of the file, so appends rarely need a new one.
+static bool kv_map(KvStore *kv, u64 length, const char **error) {
+  if (length <= kv->map_length) return true;
+  u64 map_length = KV_MAP_MIN;
+  while (map_length < length) map_length *= 2;
+  void *map = mmap(NULL, map_length, PROT_READ, MAP_SHARED, kv->fd, 0);
+  if (map == MAP_FAILED) {
+    *error = strerror(errno);
+    return false;
+  }
+  if (kv->map != NULL) munmap((void*)kv->map, kv->map_length);
+  kv->map = map;
+  kv->map_length = map_length;
+  return true;
+}
+
+// ============================================================================
+// Index
+// ============================================================================
+
+static u64 kv_hash(const char *key, int length) {
+  u64 hash = hash_wyhash(key, (size_t)length, 0);
+  return hash == 0 ? 1 : hash;
+}
+
+// Slot holding `key`, or the empty slot where it belongs
+static KvSlot *kv_find(const KvStore *kv, const char *key, int length, u64 hash) {
+  u32 mask = (u32)kv->capacity - 1;
+  for (u32 i = (u32)hash & mask;; i = (i + 1) & mask) {
+    KvSlot *slot = &kv->slots[i];
+    if (slot->hash == 0) return slot;
+    if (slot->hash == hash) {
+      const u8 *record = kv_record(kv, slot->offset);
+      if (get_u32(record + 5) == (u32)length &&
+          memcmp(record + KV_HEADER, key, (size_t)length) == 0) {
+        return slot;
+      }
+    }
+  }
+}
+
+static void kv_grow(KvStore *kv) {
+  int old_capacity = kv->capacity;
+  KvSlot *old = kv->slots;
+  kv->capacity = old_capacity == 0 ? KV_MIN_CAPACITY : old_capacity * 2;
+  kv->slots = mem_alloc(sizeof(KvSlot) * (size_t)kv->capacity);
+  memset(kv->slots, 0, sizeof(KvSlot) * (size_t)kv->capacity);
+
+  // Keys are unique, so entries go to the first free slot
+  u32 mask = (u32)kv->capacity - 1;
+  for (int i = 0; i < old_capacity; i++) {
+    if (old[i].hash == 0) continue;
+    u32 j = (u32)old[i].hash & mask;
+    while (kv->slots[j].hash != 0) j = (j + 1) & mask;
+    kv->slots[j] = old[i];
+  }
+  if (old != NULL) mem_free(old);
+}
+
+// Empty `slot`, shifting later entries of its probe run back so lookups
+// never stop early at the hole
+static void kv_remove_slot(KvStore *kv, KvSlot *slot) {
+  u32 mask = (u32)kv->capacity - 1;
+  u32 hole = (u32)(slot - kv->slots);
+  for (u32 i = (hole + 1) & mask; kv->slots[i].hash != 0; i = (i + 1) & mask) {
+    u32 home = (u32)kv->slots[i].hash & mask;
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      kv->slots[hole] = kv->slots[i];
+      hole = i;
+    }
+  }
+  kv->slots[hole].hash = 0;
+  kv->count--;
+}
+
+// Point the index at the record at `offset`
+static void kv_apply(KvStore *kv, u64 offset) {
+  if ((kv->count + 1) * 4 > kv->capacity * 3) kv_grow(kv);
+
+  const u8 *record = kv_record(kv, offset);
+  int key_length = (int)get_u32(record + 5);
+  const char *key = (const char*)record + KV_HEADER;
+  u64 hash = kv_hash(key, key_length);
+  KvSlot *slot = kv_find(kv, key, key_length, hash);
+
+  if (slot->hash != 0) kv->live_bytes -= record_size(kv_record(kv, slot->offset));
+  if (record[4] == KV_TOMBSTONE) {
+    if (slot->hash != 0) kv_remove_slot(kv, slot);
+    return;
+  }
+  if (slot->hash == 0) kv->count++;
+  slot->hash = hash;
+  slot->offset = offset;
+  kv->live_bytes += record_size(record);
+}
+
+// ============================================================================
+// Compaction
+// ============================================================================
+
+// A live record's place in the old and the new log
+typedef struct {
+  u64 from;
+  u64 to;
+  u64 size;
+} KvMove;
+
+struct KvCompaction {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  bool done;            // Guarded by lock
+  bool ok;
+  char *temp_path;
+  const u8 *source;     // Private mapping of the log up to `snapshot`
+  u64 snapshot;         // Log length when the compaction began
+  KvMove *moves;        // Sorted by old offset
+  int move_count;
+  u64 length;           // Length of the new log
+};
+
+static int compare_moves(const void *a, const void *b) {
+  u64 x = ((const KvMove*)a)->from;
+  u64 y = ((const KvMove*)b)->from;
+  return (x > y) - (x < y);
+}
+
+// Thread body: copy the live records, in log order, to the new file
+static void *kv_compaction_run(void *arg) {
+  KvCompaction *job = arg;
+  bool ok = false;
+  int fd = open(job->temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd >= 0) {
+    u64 length = KV_MAGIC_LENGTH;
+    ok = write_all(fd, KV_MAGIC, KV_MAGIC_LENGTH);
+    for (int i = 0; ok && i < job->move_count; i++) {
+      KvMove *move = &job->moves[i];
+      move->to = length;
+      ok = write_all(fd, job->source + move->from, move->size);
+      length += move->size;
+    }
+    ok = ok && fsync(fd) == 0;
+    close(fd);
+    job->length = length;
+  }
+
+  pthread_mutex_lock(&job->lock);
+  job->ok = ok;
+  job->done = true;
+  pthread_mutex_unlock(&job->lock);
+  return NULL;
+}
+
+static bool kv_compaction_done(KvCompaction *job) {
+  pthread_mutex_lock(&job->lock);
+  bool done = job->done;
+  pthread_mutex_unlock(&job->lock);
+  return done;
+}
+
+static void kv_compaction_free(KvCompaction *job) {
+  munmap((void*)job->source, job->snapshot);
+  pthread_mutex_destroy(&job->lock);
+  mem_free(job->temp_path);
+  mem_free(job->moves);
+  mem_free(job);
+}
+
+// Where the record at `offset` lives in the compacted log
+static u64 kv_rebase(const KvCompaction *job, u64 offset) {
+  if (offset >= job->snapshot) return offset - job->snapshot + job->length;
+  int low = 0, high = job->move_count - 1;
+  while (low < high) {
+    int mid = low + (high - low) / 2;
+    if (job->moves[mid].from < offset) low = mid + 1;
+    else high = mid;
+  }
+  return job->moves[low].to;
+}
+
+static bool kv_write_pending(KvStore *kv, const char **error);
+
+// Swap in the log of a finished compaction. The records written since it
+// began are appended to it first. On failure the old log stays in use.
+static bool kv_install_compaction(KvStore *kv, const char **error) {
+  KvCompaction *job = kv->compaction;
+  pthread_join(job->thread, NULL);
+  kv->compaction = NULL;
+
+  bool ok = job->ok && kv_write_pending(kv, error);
+  int fd = ok ? open(job->temp_path, O_WRONLY | O_APPEND) : -1;
+  if (fd >= 0) {
+    ok = write_all(fd, kv->map + job->snapshot, kv->committed - job->snapshot) &&
+         fsync(fd) == 0;
+    close(fd);
+  } else {
+    ok = false;
+  }
+  ok = ok && rename(job->temp_path, kv->path) == 0;
+  if (!ok) {
+    if (*error == NULL) *error = "compaction failed";
+    unlink(job->temp_path);
+    kv_compaction_free(job);
+    return false;
+  }
+  sync_parent(kv->path);
+
+  // The old descriptor and mapping still see the old file; switch over
+  int new_fd = open(kv->path, O_RDWR);
+  if (new_fd < 0) {
+    *error = strerror(errno);
+    kv_compaction_free(job);
+    return false;
+  }
+  for (int i = 0; i < kv->capacity; i++) {
+    if (kv->slots[i].hash != 0) kv->slots[i].offset = kv_rebase(job, kv->slots[i].offset);
+  }
+  munmap((void*)kv->map, kv->map_length);
+  close(kv->fd);
+  kv->fd = new_fd;
+  kv->map = NULL;
+  kv->map_length = 0;
+  kv->committed = kv->committed - job->snapshot + job->length;
+  kv_compaction_free(job);
+  return kv_map(kv, kv->committed, error);
+}
+
+bool kv_compact(KvStore *kv, const char **error) {
+  if (kv->compaction != NULL) return true;
+  if (!kv_write_pending(kv, error)) return false;
+
+  KvCompaction *job = mem_alloc(sizeof(KvCompaction));
+  memset(job, 0, sizeof(KvCompaction));
+  job->snapshot = kv->committed;
+  job->moves = mem_alloc(sizeof(KvMove) * (size_t)(kv->count + 1));
+  for (int i = 0; i < kv->capacity; i++) {
+    if (kv->slots[i].hash == 0) continue;
+    KvMove *move = &job->moves[job->move_count++];
+    move->from = kv->slots[i].offset;
+    move->size = record_size(kv->map + move->from);
+  }
+  qsort(job->moves, (size_t)job->move_count, sizeof(KvMove), compare_moves);
+
+  size_t path_length = strlen(kv->path);
+  job->temp_path = mem_alloc(path_length + sizeof(".compact"));
+  memcpy(job->temp_path, kv->path, path_length);
+  memcpy(job->temp_path + path_length, ".compact", sizeof(".compact"));
+
+  // The store's own mapping is replaced as the log grows, so the thread
+  // reads from one of its own
+  void *source = mmap(NULL, job->snapshot, PROT_READ, MAP_SHARED, kv->fd, 0);
+  if (source == MAP_FAILED) {
+    *error = strerror(errno);
+    mem_free(job->temp_path);
+    mem_free(job->moves);
+    mem_free(job);
+    return false;
+  }
+  job->source = source;
+  pthread_mutex_init(&job->lock, NULL);
+  if (pthread_create(&job->thread, NULL, kv_compaction_run, job) != 0) {
+    *error = "could not start compaction thread";
+    kv_compaction_free(job);
+    return false;
+  }
+  kv->compaction = job;
+  return true;
+}
+
+bool kv_finish_compaction(KvStore *kv, const char **error) {
+  if (kv->compaction == NULL) return true;
+  return kv_install_compaction(kv, error);
+}
+
+// ============================================================================
+// Store
+// ============================================================================
+
+// Write and sync the pending batch
+static bool kv_write_pending(KvStore *kv, const char **error) {
+  if (kv->pending_length == 0) return true;
+  if (!pwrite_all(kv->fd, kv->pending, kv->pending_length, kv->committed) ||
+      fsync(kv->fd) != 0) {
+    *error = strerror(errno);
+    return false;
+  }
+  kv->committed += kv->pending_length;
+  kv->pending_length = 0;
+  return kv_map(kv, kv->committed, error);
+}
+
+bool kv_commit(KvStore *kv, const char **error) {
+  if (!kv_write_pending(kv, error)) return false;
+  if (kv->compaction != NULL) {
+    return kv_compaction_done(kv->compaction) ? kv_install_compaction(kv, error) : true;
+  }
+  // Compact once dead records outweigh live ones
+  u64 records = kv->committed - KV_MAGIC_LENGTH;
+  if (kv->committed >= KV_COMPACT_MIN && records > 2 * kv->live_bytes) {
+    return kv_compact(kv, error);
+  }
+  return true;
+}
+
+KvStore *kv_open(const char *path, const char **error) {
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    *error = strerror(errno);
+    if (fd >= 0) close(fd);
+    return NULL;
+  }
+  u64 size = (u64)st.st_size;
+  if (size == 0) {
+    if (!write_all(fd, KV_MAGIC, KV_MAGIC_LENGTH) || fsync(fd) != 0) {
+      *error = strerror(errno);
+      close(fd);
+      return NULL;
+    }
+    size = KV_MAGIC_LENGTH;
+  }
+
+  KvStore *kv = mem_alloc(sizeof(KvStore));
+  memset(kv, 0, sizeof(KvStore));
+  size_t path_length = strlen(path);
+  kv->path = mem_alloc(path_length + 1);
+  memcpy(kv->path, path, path_length + 1);
+  kv->fd = fd;
+  kv->committed = size;
+  kv_grow(kv);
+
+  if (!kv_map(kv, size, error)) {
+    kv->committed = 0;
+    kv_close(kv, error);
+    return NULL;
+  }
+  if (size < KV_MAGIC_LENGTH || memcmp(kv->map, KV_MAGIC, KV_MAGIC_LENGTH) != 0) {
+    *error = "not a kv store";
+    kv->committed = 0;
+    kv_close(kv, error);
+    return NULL;
+  }
+
+  // Replay the log, stopping at the first record that is cut short or
+  // fails its checksum
+  u64 offset = KV_MAGIC_LENGTH;
+  while (offset + KV_HEADER <= size) {
+    const u8 *record = kv->map + offset;
+    u64 length = record_size(record);
+    if (length > size - offset || record[4] < KV_STRING || record[4] > KV_TOMBSTONE ||
+        get_u32(record) != hash_crc32c(0, record + 4, length - 4)) {
+      break;
+    }
+    kv_apply(kv, offset);
+    offset += length;
+  }
+  if (offset < size) {
+    if (ftruncate(fd, (off_t)offset) != 0 || fsync(fd) != 0) {
+      *error = strerror(errno);
+      kv->committed = 0;
+      kv_close(kv, error);
+      return NULL;
+    }
+  }
+  kv->committed = offset;
+  return kv;
+}
+
+bool kv_close(KvStore *kv, const char **error) {
+  bool ok = true;
+  if (kv->committed > 0) {
+    ok = kv_finish_compaction(kv, error);
+    ok = kv_write_pending(kv, error) && ok;
+  }
+  if (kv->map != NULL) munmap((void*)kv->map, kv->map_length);
+  close(kv->fd);
+  mem_free(kv->path);
+  if (kv->pending != NULL) mem_free(kv->pending);
+  if (kv->slots != NULL) mem_free(kv->slots);
+  mem_free(kv);
+  return ok;
+}
+
+bool kv_get(KvStore *kv, const char *key, int key_length, KvValue *value) {
+  KvSlot *slot = kv_find(kv, key, key_length, kv_hash(key, key_length));
+  if (slot->hash == 0) return false;
+  const u8 *record = kv_record(kv, slot->offset);
+  value->tag = (KvTag)record[4];
+  value->bytes = (const char*)record + KV_HEADER + key_length;
+  value->length = (int)get_u32(record + 9);
+  return true;
+}
+
+bool kv_put(KvStore *kv, const char *key, int key_length, KvTag tag,
+            const void *bytes, int length, const char **error) {
+  u64 size = KV_HEADER + (u64)key_length + (u64)length;
+  if (kv->pending_length + size > kv->pending_capacity) {
+    u64 capacity = kv->pending_capacity < 4096 ? 4096 : kv->pending_capacity;
+    while (capacity < kv->pending_length + size) capacity *= 2;
+    kv->pending = mem_realloc(kv->pending, capacity);
+    kv->pending_capacity = capacity;
+  }
+
+  u8 *record = kv->pending + kv->pending_length;
+  record[4] = (u8)tag;
+  put_u32(record + 5, (u32)key_length);
+  put_u32(record + 9, (u32)length);
+  memcpy(record + KV_HEADER, key, (size_t)key_length);
+  if (length > 0) memcpy(record + KV_HEADER + key_length, bytes, (size_t)length);
+  put_u32(record, hash_crc32c(0, record + 4, size - 4));
+
+  u64 offset = kv->committed + kv->pending_length;
+  kv->pending_length += size;
+  kv_apply(kv, offset);
+  if (kv->pending_length >= KV_BATCH_BYTES) return kv_commit(kv, error);
+  return true;
+}
+
+bool kv_delete(KvStore *kv, const char *key, int key_length, bool *existed,
+               const char **error) {
+  KvSlot *slot = kv_find(kv, key, key_length, kv_hash(key, key_length));
+  *existed = slot->hash != 0;
+  if (!*existed) return true;
+  return kv_put(kv, key, key_length, KV_TOMBSTONE, NULL, 0, error);
+}
+
+// ============================================================================
+// Natives
+// ============================================================================
+
+static void kv_release(void *data) {
+  const char *error = NULL;
+  if (data != NULL) kv_close((KvStore*)data, &error);
+}
+
+static const ForeignType kv_type = {"kv store", kv_release, NULL, NULL};
+
+// The open store behind args[0], or NULL after reporting why not
+static KvStore *kv_arg(const char *name, Value *args) {
+  if (!IS_FOREIGN(args[0], &kv_type)) {
+    fprintf(stderr, "Error: %s expects a kv store\n", name);
+    return NULL;
+  }
+  KvStore *kv = (KvStore*)AS_FOREIGN_DATA(args[0]);
+  if (kv == NULL) fprintf(stderr, "Error: %s: store is closed\n", name);
+  return kv;
+}
+
+// Store and key arguments shared by the per-key natives
+static KvStore *kv_key_args(const char *name, int arg_count, int min_args, int max_args,
+                            Value *args, const char **key, int *key_length) {
+  if (arg_count < min_args || arg_count > max_args) {
+    if (min_args == max_args) {
+      fprintf(stderr, "Error: %s expects %d arguments, got %d\n", name, min_args, arg_count);
+    } else {
+      fprintf(stderr, "Error: %s expects %d or %d arguments, got %d\n", name, min_args,
+              max_args, arg_count);
+    }
+    return NULL;
+  }
+  KvStore *kv = kv_arg(name, args);
+  if (kv == NULL) return NULL;
+  if (!value_get_string(&args[1], key, key_length)) {
+    fprintf(stderr, "Error: %s expects a string key\n", name);
+    return NULL;
+  }
+  return kv;
+}
+
+static Value kv_failed(const char *name, const char *error) {
+  fprintf(stderr, "Error: %s: %s\n", name, error);
+  return value_make_nil();
+}
+
+static Value kv_make_value(KvValue value) {
+  switch (value.tag) {
+    case KV_INT:
+      return value_make_int(kv_value_int(value));
+    case KV_FLOAT:
+      return value_make_float(kv_value_float(value));
+    default:
+      if (value.length <= VALUE_SHORT_MAX) return value_copy_string(value.bytes, value.length);
+      return OBJ_VAL(string_copy(value.bytes, value.length));
+  }
+}
+
+// kv.open - Open or create a store at a path
+Value native_kv_open(int arg_count, Value *args) {
+  const char *path;
+  int length;
+  if (arg_count != 1) {
+    fprintf(stderr, "Error: open expects 1 argument, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  if (!value_get_string(&args[0], &path, &length)) {
+    fprintf(stderr, "Error: open expects string argument\n");
+    return value_make_nil();
+  }
+
+  const char *error = NULL;
+  KvStore *kv = kv_open(path, &error);
+  if (kv == NULL) {
+    fprintf(stderr, "Error: Could not open store '%s': %s\n", path, error);
+    return value_make_nil();
+  }
+  return OBJ_VAL(foreign_make(&kv_type, kv));
+}
+
+// kv.get - Value for a key, or the default (nil) when it is absent
+Value native_kv_get(int arg_count, Value *args) {
+  const char *key;
+  int key_length;
+  KvStore *kv = kv_key_args("get", arg_count, 2, 3, args, &key, &key_length);
+  if (kv == NULL) return value_make_nil();
+
+  KvValue value;
+  if (!kv_get(kv, key, key_length, &value)) {
+    return arg_count == 3 ? args[2] : value_make_nil();
+  }
+  return kv_make_value(value);
+}
+
+// kv.set - Store a string, int or float under a key
+Value native_kv_set(int arg_count, Value *args) {
+  const char *key;
+  int key_length;
+  KvStore *kv = kv_key_args("set", arg_count, 3, 3, args, &key, &key_length);
+  if (kv == NULL) return value_make_nil();
+
+  u8 number[8];
+  const char *bytes;
+  int length;
+  KvTag tag;
+  if (IS_INT(args[2])) {
+    put_u64(number, (u64)AS_INT(args[2]));
+    tag = KV_INT;
+  } else if (IS_FLOAT(args[2])) {
+    f64 x = AS_FLOAT(args[2]);
+    u64 bits;
+    memcpy(&bits, &x, sizeof(bits));
+    put_u64(number, bits);
+    tag = KV_FLOAT;
+  } else if (value_get_string(&args[2], &bytes, &length)) {
+    tag = KV_STRING;
+  } else {
+    fprintf(stderr, "Error: set expects a string, int or float value\n");
+    return value_make_nil();
+  }
+  if (tag != KV_STRING) {
+    bytes = (const char*)number;
+    length = 8;
+  }
+
+  const char *error = NULL;
+  if (!kv_put(kv, key, key_length, tag, bytes, length, &error)) return kv_failed("set", error);
+  return value_make_bool(true);
+}
+
+// kv.has - Whether a key is present
+Value native_kv_has(int arg_count, Value *args) {
+  const char *key;
+  int key_length;
+  KvStore *kv = kv_key_args("has", arg_count, 2, 2, args, &key, &key_length);
+  if (kv == NULL) return value_make_nil();
+
+  KvValue value;
+  return value_make_bool(kv_get(kv, key, key_length, &value));
+}
+
+// kv.delete - Remove a key; returns whether it was present
+Value native_kv_delete(int arg_count, Value *args) {
+  const char *key;
+  int key_length;
+  KvStore *kv = kv_key_args("delete", arg_count, 2, 2, args, &key, &key_length);
+  if (kv == NULL) return value_make_nil();
+
+  bool existed;
+  const char *error = NULL;
+  if (!kv_delete(kv, key, key_length, &existed, &error)) return kv_failed("delete", error);
+  return value_make_bool(existed);
+}
+
+// kv.incr - Add to an int counter (missing counts as 0); returns the sum
+Value native_kv_incr(int arg_count, Value *args) {
+  const char *key;
+  int key_length;
+  KvStore *kv = kv_key_args("incr", arg_count, 2, 3, args, &key, &key_length);
+  if (kv == NULL) return value_make_nil();
+  if (arg_count == 3 && !IS_INT(args[2])) {
+    fprintf(stderr, "Error: incr expects an int amount\n");
+    return value_make_nil();
+  }
+
+  i64 total = arg_count == 3 ? AS_INT(args[2]) : 1;
+  KvValue value;
+  if (kv_get(kv, key, key_length, &value)) {
+    if (value.tag != KV_INT) {
+      fprintf(stderr, "Error: incr: value of '%.*s' is not an int\n", key_length, key);
+      return value_make_nil();
+    }
+    total = (i64)((u64)total + (u64)kv_value_int(value));
+  }
+
+  u8 number[8];
+  put_u64(number, (u64)total);
+  const char *error = NULL;
+  if (!kv_put(kv, key, key_length, KV_INT, number, 8, &error)) return kv_failed("incr", error);
+  return value_make_int(total);
+}
+
+// kv.count - Number of keys
+Value native_kv_count(int arg_count, Value *args) {
+  if (arg_count != 1) {
+    fprintf(stderr, "Error: count expects 1 argument, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  KvStore *kv = kv_arg("count", args);
+  if (kv == NULL) return value_make_nil();
+  return value_make_int(kv->count);
+}
+
+// kv.flush - Commit pending writes to disk
+Value native_kv_flush(int arg_count, Value *args) {
+  if (arg_count != 1) {
+    fprintf(stderr, "Error: flush expects 1 argument, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  KvStore *kv = kv_arg("flush", args);
+  if (kv == NULL) return value_make_nil();
+
+  const char *error = NULL;
+  if (!kv_commit(kv, &error)) return kv_failed("flush", error);
+  return value_make_bool(true);
+}
+
+// kv.compact - Start compacting the log in the background
+Value native_kv_compact(int arg_count, Value *args) {
+  if (arg_count != 1) {
+    fprintf(stderr, "Error: compact expects 1 argument, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  KvStore *kv = kv_arg("compact", args);
+  if (kv == NULL) return value_make_nil();
+
+  const char *error = NULL;
+  if (!kv_compact(kv, &error)) return kv_failed("compact", error);
+  return value_make_bool(true);
+}
+
+// kv.close - Commit and close; the store cannot be used afterwards
+Value native_kv_close(int arg_count, Value *args) {
+  if (arg_count != 1) {
+    fprintf(stderr, "Error: close expects 1 argument, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  KvStore *kv = kv_arg("close", args);
+  if (kv == NULL) return value_make_nil();
+
+  ((ObjForeign*)AS_OBJ(args[0]))->data = NULL;
+  const char *error = NULL;
+  if (!kv_close(kv, &error)) return kv_failed("close", error);
+  return value_make_bool(true);
+}
+
+// ============================================================================
+// Module initialization
+// ============================================================================
+
+void kv_module_init(VM *vm) {
+  module_register_native(vm, "kv.open", native_kv_open);
+  module_register_native(vm, "kv.get", native_kv_get);
+  module_register_native(vm, "kv.set", native_kv_set);
+  module_register_native(vm, "kv.has", native_kv_has);
+  module_register_native(vm, "kv.delete", native_kv_delete);
+  module_register_native(vm, "kv.incr", native_kv_incr);
+  module_register_native(vm, "kv.count", native_kv_count);
+  module_register_native(vm, "kv.flush", native_kv_flush);
+  module_register_native(vm, "kv.compact", native_kv_compact);
+  module_register_native(vm, "kv.close", native_kv_close);
+}
@@ -0,0 +1,88 @@
+// src/stdlib/kv.h - Key-value store module interface
+
+#ifndef SATORI_STDLIB_KV_H
+#define SATORI_STDLIB_KV_H
+
+#include "core/value.h"
+#include "runtime/vm.h"
+
+// Record tags. A tombstone records a delete.
+typedef enum {
+  KV_STRING = 1,
+  KV_INT = 2,
+  KV_FLOAT = 3,
+  KV_TOMBSTONE = 4,
+} KvTag;
+
+// A stored value, viewed in place. Ints and floats are 8 little-endian
+// bytes; read them with kv_value_int and kv_value_float.
+typedef struct {
+  KvTag tag;
+  const char *bytes;
+  int length;
+} KvValue;
+
+// Index slot: where the latest record for a key starts in the log
+typedef struct {
+  u64 hash;    // 0 marks an empty slot
+  u64 offset;
+} KvSlot;
+
+typedef struct KvCompaction KvCompaction;
+
+// Store over one append-only log file. The committed part of the log is
+// mapped; records appended since the last commit wait in `pending` and
+// are written and fsynced together.
+typedef struct {
+  char *path;
+  int fd;
+  const u8 *map;
+  u64 map_length;      // Bytes mapped; may run past the end of the file
+  u64 committed;       // Log bytes written and synced
+  u8 *pending;         // Records not yet written, starting at `committed`
+  u64 pending_length;
+  u64 pending_capacity;
+  KvSlot *slots;
+  int count;
+  int capacity;        // Power of two
+  u64 live_bytes;      // Bytes of the records the index points at
+  KvCompaction *compaction;  // Running in the background, or NULL
+} KvStore;
+
+// C API, shared by the natives and by benchmarks/tests. Functions that
+// can fail on I/O return false and leave a message in *error.
+KvStore *kv_open(const char *path, const char **error);
+bool kv_close(KvStore *kv, const char **error);  // Commits, then frees kv
+bool kv_get(KvStore *kv, const char *key, int key_length, KvValue *value);
+bool kv_put(KvStore *kv, const char *key, int key_length, KvTag tag,
+            const void *bytes, int length, const char **error);
+bool kv_delete(KvStore *kv, const char *key, int key_length, bool *existed,
+               const char **error);
+bool kv_commit(KvStore *kv, const char **error);
+
+// Start rewriting the log with only live records on a background thread.
+// The store stays usable; the new log is swapped in by a later commit.
+bool kv_compact(KvStore *kv, const char **error);
+
+// Wait for a running compaction and swap its log in
+bool kv_finish_compaction(KvStore *kv, const char **error);
+
+i64 kv_value_int(KvValue value);
+f64 kv_value_float(KvValue value);
+
+// Module initialization
+void kv_module_init(VM *vm);
+
+// Native functions
+Value native_kv_open(int arg_count, Value *args);
+Value native_kv_get(int arg_count, Value *args);
+Value native_kv_set(int arg_count, Value *args);
+Value native_kv_has(int arg_count, Value *args);
+Value native_kv_delete(int arg_count, Value *args);
+Value native_kv_incr(int arg_count, Value *args);
+Value native_kv_count(int arg_count, Value *args);
+Value native_kv_flush(int arg_count, Value *args);
+Value native_kv_compact(int arg_count, Value *args);
+Value native_kv_close(int arg_count, Value *args);
+
+#endif // SATORI_STDLIB_KV_H
@@ -0,0 +1,655 @@
+// src/stdlib/metrics.c - Metrics module implementation
+//
+// Recording has to stay cheap with many threads recording into the same
+// metric, so a counter or histogram is kept METRICS_SHARDS times over,
+// each copy on its own cache lines. A thread picks a shard the first time
+// it records, round-robin, and from then on only adds to that shard with
+// relaxed atomics; readers sum the shards. Gauges are set more than added
+// to, so a gauge is a single double updated in place.
+//
+// A histogram value goes into one of METRICS_BUCKETS buckets found from
+// the bits of the double alone: the exponent picks the power of two and
+// the top METRICS_SUB_BITS bits of the mantissa the bucket within it. No
+// search, no division, no logarithm. A bucket holds the values above its
+// lower bound up to and including its upper bound. Sums are doubles kept
+// as bits and added to with compare-and-swap.
+//
+// The registry is a list guarded by a mutex that only registering and
+// exporting take. Metrics are never freed, so a handle a script holds
+// stays valid however long the script keeps it.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "metrics.h"
+#include "runtime/module.h"
+#include "core/memory.h"
+#include "core/object.h"
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define METRICS_LINE 64
+
+typedef struct {
+  u64 value;
+  u8 pad[METRICS_LINE - sizeof(u64)];
+} CounterShard;
+
+typedef struct {
+  u64 buckets[METRICS_BUCKETS];
+  u64 sum;                // f64 bits
+  u8 pad[METRICS_LINE];   // Keeps the next shard's first line apart
+} HistogramShard;
+
+struct Metric {
+  CounterShard counts[METRICS_SHARDS];   // Counters
+  HistogramShard *shards;                // Histograms
+  u64 gauge;                             // Gauges, f64 bits
+  MetricKind kind;
+  char *name;
+  char *help;
+  Metric *next;
+};
+
+static struct {
+  pthread_mutex_t lock;
+  Metric *first;
+  Metric *last;
+  u32 next_shard;
+} registry = {PTHREAD_MUTEX_INITIALIZER, NULL, NULL, 0};
+
+// Shard the calling thread records into, plus one; 0 until it records
+#ifdef __GNUC__
+static __thread u32 local_shard = 0;
+#else
+static u32 local_shard = 0;
+#endif
+
+static inline u32 thread_shard(void) {
+  if (local_shard == 0) {
+    local_shard = __atomic_fetch_add(&registry.next_shard, 1, __ATOMIC_RELAXED) %
+                  METRICS_SHARDS + 1;
+  }
+  return local_shard - 1;
+}
+
+static inline u64 to_bits(f64 value) {
+  u64 bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static inline f64 from_bits(u64 bits) {
+  f64 value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static void add_double(u64 *target, f64 delta) {
+  u64 old = __atomic_load_n(target, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(target, &old, to_bits(from_bits(old) + delta), true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+}
+
+// ============================================================================
+// Registry
+// ============================================================================
+
+static bool valid_name(const char *name) {
+  if (name[0] == '\0' || (name[0] >= '0' && name[0] <= '9')) return false;
+  for (const char *c = name; *c != '\0'; c++) {
+    bool ok = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') ||
+              (*c >= '0' && *c <= '9') || *c == '_' || *c == ':';
+    if (!ok) return false;
+  }
+  return true;
+}
+
+static char *copy_text(const char *text) {
+  size_t length = strlen(text);
+  char *copy = (char*)mem_alloc(length + 1);
+  memcpy(copy, text, length + 1);
+  return copy;
+}
+
+Metric *metrics_register(MetricKind kind, const char *name, const char *help,
+                         const char **error) {
+  if (!valid_name(name)) {
+    *error = "names must match [a-zA-Z_:][a-zA-Z0-9_:]*";
+    return NULL;
+  }
+
+  // The registry outlives the VM, and an allocation refused under the lock
+  // would never release it
+  jmp_buf *escape = mem_defer_limit();
+  pthread_mutex_lock(&registry.lock);
+  Metric *metric = registry.first;
+  while (metric != NULL && strcmp(metric->name, name) != 0) metric = metric->next;
+  if (metric != NULL) {
+    pthread_mutex_unlock(&registry.lock);
+    mem_resume_limit(escape);
+    if (metric->kind != kind) {
+      *error = "the name is taken by a metric of another kind";
+      return NULL;
+    }
+    return metric;
+  }
+
+  metric = (Metric*)mem_alloc(sizeof(Metric));
+  memset(metric, 0, sizeof(Metric));
+  metric->kind = kind;
+  metric->name = copy_text(name);
+  metric->help = copy_text(help != NULL ? help : "");
+  if (kind == METRIC_HISTOGRAM) {
+    metric->shards = (HistogramShard*)mem_alloc(sizeof(HistogramShard) * METRICS_SHARDS);
+    memset(metric->shards, 0, sizeof(HistogramShard) * METRICS_SHARDS);
+  }
+  if (registry.last != NULL) {
+    registry.last->next = metric;
+  } else {
+    registry.first = metric;
+  }
+  registry.last = metric;
+  pthread_mutex_unlock(&registry.lock);
+  mem_resume_limit(escape);
+  return metric;
+}
+
+MetricKind metrics_kind(const Metric *metric) {
+  return metric->kind;
+}
+
+// ============================================================================
+// Recording
+// ============================================================================
+
+void metrics_inc(Metric *counter, u64 by) {
+  __atomic_fetch_add(&counter->counts[thread_shard()].value, by, __ATOMIC_RELAXED);
+}
+
+void metrics_set(Metric *gauge, f64 value) {
+  __atomic_store_n(&gauge->gauge, to_bits(value), __ATOMIC_RELAXED);
+}
+
+void metrics_add(Metric *gauge, f64 delta) {
+  add_double(&gauge->gauge, delta);
+}
+
+int metrics_bucket(f64 value) {
+  if (!(value > 0)) return 0;   // Zero, negative or NaN
+  // One ulp down, so a value on a bucket's upper bound stays in that
+  // bucket, as Prometheus's `le` has it
+  u64 bits = to_bits(value) - 1;
+  int exponent = (int)(bits >> 52) - 1023;
+  if (exponent < METRICS_MIN_EXP) return 0;
+  if (exponent > METRICS_MAX_EXP) return METRICS_BUCKETS - 1;
+  return 1 + ((exponent - METRICS_MIN_EXP) << METRICS_SUB_BITS) +
+         (int)((bits >> (52 - METRICS_SUB_BITS)) & ((1u << METRICS_SUB_BITS) - 1));
+}
+
+f64 metrics_bucket_upper(int bucket) {
+  if (bucket <= 0) return ldexp(1.0, METRICS_MIN_EXP);
+  if (bucket >= METRICS_BUCKETS - 1) return INFINITY;
+  int index = bucket - 1;
+  int sub = index & ((1 << METRICS_SUB_BITS) - 1);
+  return ldexp(1.0 + (sub + 1) / (f64)(1 << METRICS_SUB_BITS),
+               METRICS_MIN_EXP + (index >> METRICS_SUB_BITS));
+}
+
+void metrics_observe(Metric *histogram, f64 value) {
+  HistogramShard *shard = &histogram->shards[thread_shard()];
+  __atomic_fetch_add(&shard->buckets[metrics_bucket(value)], 1, __ATOMIC_RELAXED);
+  add_double(&shard->sum, value);
+}
+
+// ============================================================================
+// Reading
+// ============================================================================
+
+static void load_buckets(const Metric *histogram, u64 *buckets) {
+  memset(buckets, 0, sizeof(u64) * METRICS_BUCKETS);
+  for (int s = 0; s < METRICS_SHARDS; s++) {
+    for (int i = 0; i < METRICS_BUCKETS; i++) {
+      buckets[i] += __atomic_load_n(&histogram->shards[s].buckets[i], __ATOMIC_RELAXED);
+    }
+  }
+}
+
+u64 metrics_count(const Metric *metric) {
+  u64 total = 0;
+  if (metric->kind == METRIC_HISTOGRAM) {
+    u64 buckets[METRICS_BUCKETS];
+    load_buckets(metric, buckets);
+    for (int i = 0; i < METRICS_BUCKETS; i++) total += buckets[i];
+    return total;
+  }
+  for (int s = 0; s < METRICS_SHARDS; s++) {
+    total += __atomic_load_n(&metric->counts[s].value, __ATOMIC_RELAXED);
+  }
+  return total;
+}
+
+f64 metrics_value(const Metric *metric) {
+  switch (metric->kind) {
+    case METRIC_COUNTER:
+      return (f64)metrics_count(metric);
+    case METRIC_GAUGE:
+      return from_bits(__atomic_load_n(&metric->gauge, __ATOMIC_RELAXED));
+    case METRIC_HISTOGRAM: {
+      f64 sum = 0;
+      for (int s = 0; s < METRICS_SHARDS; s++) {
+        sum += from_bits(__atomic_load_n(&metric->shards[s].sum, __ATOMIC_RELAXED));
+      }
+      return sum;
+    }
+  }
+  return 0;
+}
+
+// The value at rank q * count, taken as the middle of its bucket
+f64 metrics_quantile(const Metric *histogram, f64 q) {
+  u64 buckets[METRICS_BUCKETS];
+  load_buckets(histogram, buckets);
+  u64 total = 0;
+  for (int i = 0; i < METRICS_BUCKETS; i++) total += buckets[i];
+  if (total == 0) return NAN;
+
+  u64 rank = (u64)(q * (f64)(total - 1));
+  u64 seen = 0;
+  int bucket = 0;
+  while (seen + buckets[bucket] <= rank) seen += buckets[bucket++];
+  if (bucket == 0) return 0;
+  f64 lower = metrics_bucket_upper(bucket - 1);
+  if (bucket == METRICS_BUCKETS - 1) return lower;
+  return (lower + metrics_bucket_upper(bucket)) / 2;
+}
+
+// ============================================================================
+// Prometheus text format
+// ============================================================================
+
+typedef struct {
+  char *data;
+  int length;
+  int capacity;
+} Text;
+
+static void text_reserve(Text *text, int extra) {
+  if (text->length + extra + 1 <= text->capacity) return;
+  int capacity = text->capacity;
+  while (text->length + extra + 1 > capacity) capacity = GROW_CAPACITY(capacity);
+  text->data = (char*)mem_realloc(text->data, capacity);
+  text->capacity = capacity;
+}
+
+static void text_printf(Text *text, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(NULL, 0, format, args);
+  va_end(args);
+  text_reserve(text, length);
+  va_start(args, format);
+  vsnprintf(text->data + text->length, length + 1, format, args);
+  va_end(args);
+  text->length += length;
+}
+
+// A sample value the way Prometheus spells it
+static const char *format_value(char *buffer, size_t size, f64 value) {
+  if (isnan(value)) return "NaN";
+  if (isinf(value)) return value > 0 ? "+Inf" : "-Inf";
+  snprintf(buffer, size, "%.17g", value);
+  return buffer;
+}
+
+// HELP text with backslashes and newlines escaped
+static void put_help(Text *text, const Metric *metric) {
+  text_printf(text, "# HELP %s ", metric->name);
+  for (const char *c = metric->help; *c != '\0'; c++) {
+    if (*c == '\\') {
+      text_printf(text, "\\\\");
+    } else if (*c == '\n') {
+      text_printf(text, "\\n");
+    } else {
+      text_printf(text, "%c", *c);
+    }
+  }
+  text_printf(text, "\n");
+}
+
+static void put_histogram(Text *text, const Metric *metric) {
+  u64 buckets[METRICS_BUCKETS];
+  load_buckets(metric, buckets);
+  char number[32];
+
+  // Only buckets that hold values are listed; the rest add nothing to the
+  // cumulative counts and would be hundreds of lines per histogram
+  u64 seen = 0;
+  for (int i = 0; i < METRICS_BUCKETS - 1; i++) {
+    if (buckets[i] == 0) continue;
+    seen += buckets[i];
+    text_printf(text, "%s_bucket{le=\"%s\"} %llu\n", metric->name,
+                format_value(number, sizeof(number), metrics_bucket_upper(i)),
+                (unsigned long long)seen);
+  }
+  seen += buckets[METRICS_BUCKETS - 1];
+  text_printf(text, "%s_bucket{le=\"+Inf\"} %llu\n", metric->name, (unsigned long long)seen);
+  text_printf(text, "%s_sum %s\n", metric->name,
+              format_value(number, sizeof(number), metrics_value(metric)));
+  text_printf(text, "%s_count %llu\n", metric->name, (unsigned long long)seen);
+}
+
+char *metrics_export(int *length) {
+  static const char *type_names[] = {"", "counter", "gauge", "histogram"};
+  Text text = {NULL, 0, 0};
+  text_reserve(&text, 0);
+  text.data[0] = '\0';
+
+  jmp_buf *escape = mem_defer_limit();
+  pthread_mutex_lock(&registry.lock);
+  for (Metric *metric = registry.first; metric != NULL; metric = metric->next) {
+    if (metric->help[0] != '\0') put_help(&text, metric);
+    text_printf(&text, "# TYPE %s %s\n", metric->name, type_names[metric->kind]);
+    char number[32];
+    switch (metric->kind) {
+      case METRIC_COUNTER:
+        text_printf(&text, "%s %llu\n", metric->name,
+                    (unsigned long long)metrics_count(metric));
+        break;
+      case METRIC_GAUGE:
+        text_printf(&text, "%s %s\n", metric->name,
+                    format_value(number, sizeof(number), metrics_value(metric)));
+        break;
+      case METRIC_HISTOGRAM:
+        put_histogram(&text, metric);
+        break;
+    }
+  }
+  pthread_mutex_unlock(&registry.lock);
+  mem_resume_limit(escape);
+
+  if (length != NULL) *length = text.length;
+  return text.data;
+}
+
+static bool write_all(int fd, const char *data, int length) {
+  while (length > 0) {
+    ssize_t written = write(fd, data, length);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data += written;
+    length -= (int)written;
+  }
+  return true;
+}
+
+static bool send_to_socket(const char *path, const char *data, int length,
+                           const char **error) {
+  struct sockaddr_un address;
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    *error = "socket path too long";
+    return false;
+  }
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    *error = strerror(errno);
+    return false;
+  }
+  bool ok = connect(fd, (struct sockaddr*)&address, sizeof(address)) == 0 &&
+            write_all(fd, data, length);
+  if (!ok) *error = strerror(errno);
+  close(fd);
+  return ok;
+}
+
+// Write beside the target and rename over it, so a collector reading the
+// file never sees half an export
+static bool replace_file(const char *path, const char *data, int length,
+                         const char **error) {
+  size_t path_length = strlen(path);
+  char *temporary = (char*)mem_alloc(path_length + 5);
+  memcpy(temporary, path, path_length);
+  memcpy(temporary + path_length, ".tmp", 5);
+
+  FILE *file = fopen(temporary, "wb");
+  bool ok = file != NULL;
+  if (ok) {
+    ok = fwrite(data, 1, length, file) == (size_t)length;
+    ok = fclose(file) == 0 && ok;
+    ok = ok && rename(temporary, path) == 0;
+    if (!ok) remove(temporary);
+  }
+  if (!ok) *error = strerror(errno);
+  mem_free(temporary);
+  return ok;
+}
+
+bool metrics_write(const char *path, const char **error) {
+  int length;
+  char *data = metrics_export(&length);
+  struct stat info;
+  bool ok = stat(path, &info) == 0 && S_ISSOCK(info.st_mode)
+                ? send_to_socket(path, data, length, error)
+                : replace_file(path, data, length, error);
+  mem_free(data);
+  return ok;
+}
+
+// ============================================================================
+// Native Functions
+// ============================================================================
+
+static const ForeignType metric_type = {"metric", NULL, NULL, NULL};
+
+static const char *kind_names[] = {"", "counter", "gauge", "histogram"};
+
+static Metric *metric_arg(const char *function, Value value, MetricKind kind) {
+  if (!IS_FOREIGN(value, &metric_type)) {
+    fprintf(stderr, "Error: %s expects a metric\n", function);
+    return NULL;
+  }
+  Metric *metric = (Metric*)AS_FOREIGN_DATA(value);
+  if (kind != 0 && metric->kind != kind) {
+    fprintf(stderr, "Error: %s expects a %s, got a %s\n", function, kind_names[kind],
+            kind_names[metric->kind]);
+    return NULL;
+  }
+  return metric;
+}
+
+static bool number_arg(Value value, f64 *number) {
+  if (IS_INT(value)) {
+    *number = (f64)AS_INT(value);
+  } else if (IS_FLOAT(value)) {
+    *number = AS_FLOAT(value);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static Value make_metric(const char *function, MetricKind kind, int arg_count, Value *args) {
+  const char *name, *help = "";
+  int length, help_length = 0;
+  if (arg_count < 1 || arg_count > 2) {
+    fprintf(stderr, "Error: %s expects 1 or 2 arguments, got %d\n", function, arg_count);
+    return value_make_nil();
+  }
+  if (!value_get_string(&args[0], &name, &length) ||
+      (arg_count == 2 && !value_get_string(&args[1], &help, &help_length))) {
+    fprintf(stderr, "Error: %s expects a string name and help text\n", function);
+    return value_make_nil();
+  }
+
+  const char *error = NULL;
+  Metric *metric = metrics_register(kind, name, help, &error);
+  if (metric == NULL) {
+    fprintf(stderr, "Error: Could not register metric '%s': %s\n", name, error);
+    return value_make_nil();
+  }
+  return OBJ_VAL(foreign_make(&metric_type, metric));
+}
+
+// metrics.counter - A counter that only goes up
+Value native_metrics_counter(int arg_count, Value *args) {
+  return make_metric("counter", METRIC_COUNTER, arg_count, args);
+}
+
+// metrics.gauge - A value that is set or moves either way
+Value native_metrics_gauge(int arg_count, Value *args) {
+  return make_metric("gauge", METRIC_GAUGE, arg_count, args);
+}
+
+// metrics.histogram - A distribution of observed values
+Value native_metrics_histogram(int arg_count, Value *args) {
+  return make_metric("histogram", METRIC_HISTOGRAM, arg_count, args);
+}
+
+// metrics.inc - Add to a counter (by 1 unless told otherwise) or a gauge
+Value native_metrics_inc(int arg_count, Value *args) {
+  if (arg_count < 1 || arg_count > 2) {
+    fprintf(stderr, "Error: inc expects 1 or 2 arguments, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  Metric *metric = metric_arg("inc", args[0], 0);
+  if (metric == NULL) return value_make_nil();
+
+  if (metric->kind == METRIC_COUNTER) {
+    i64 by = arg_count == 2 && IS_INT(args[1]) ? AS_INT(args[1]) : 1;
+    if ((arg_count == 2 && !IS_INT(args[1])) || by < 0) {
+      fprintf(stderr, "Error: inc expects a counter to go up by a non-negative integer\n");
+      return value_make_nil();
+    }
+    metrics_inc(metric, (u64)by);
+  } else if (metric->kind == METRIC_GAUGE) {
+    f64 by = 1;
+    if (arg_count == 2 && !number_arg(args[1], &by)) {
+      fprintf(stderr, "Error: inc expects a number\n");
+      return value_make_nil();
+    }
+    metrics_add(metric, by);
+  } else {
+    fprintf(stderr, "Error: inc expects a counter or gauge, got a histogram\n");
+  }
+  return value_make_nil();
+}
+
+// metrics.set - Set a gauge
+Value native_metrics_set(int arg_count, Value *args) {
+  f64 value;
+  if (arg_count != 2) {
+    fprintf(stderr, "Error: set expects 2 arguments, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  Metric *gauge = metric_arg("set", args[0], METRIC_GAUGE);
+  if (gauge == NULL) return value_make_nil();
+  if (!number_arg(args[1], &value)) {
+    fprintf(stderr, "Error: set expects a number\n");
+    return value_make_nil();
+  }
+  metrics_set(gauge, value);
+  return value_make_nil();
+}
+
+// metrics.observe - Record a value in a histogram
+Value native_metrics_observe(int arg_count, Value *args) {
+  f64 value;
+  if (arg_count != 2) {
+    fprintf(stderr, "Error: observe expects 2 arguments, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  Metric *histogram = metric_arg("observe", args[0], METRIC_HISTOGRAM);
+  if (histogram == NULL) return value_make_nil();
+  if (!number_arg(args[1], &value)) {
+    fprintf(stderr, "Error: observe expects a number\n");
+    return value_make_nil();
+  }
+  metrics_observe(histogram, value);
+  return value_make_nil();
+}
+
+// metrics.value - A counter's count, a gauge's value, or how many values a
+// histogram has observed
+Value native_metrics_value(int arg_count, Value *args) {
+  if (arg_count != 1) {
+    fprintf(stderr, "Error: value expects 1 argument, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  Metric *metric = metric_arg("value", args[0], 0);
+  if (metric == NULL) return value_make_nil();
+  if (metric->kind == METRIC_GAUGE) return value_make_float(metrics_value(metric));
+  return value_make_int((i64)metrics_count(metric));
+}
+
+// metrics.quantile - Estimate a quantile (0 to 1) of a histogram; nil if empty
+Value native_metrics_quantile(int arg_count, Value *args) {
+  f64 q;
+  if (arg_count != 2) {
+    fprintf(stderr, "Error: quantile expects 2 arguments, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  Metric *histogram = metric_arg("quantile", args[0], METRIC_HISTOGRAM);
+  if (histogram == NULL) return value_make_nil();
+  if (!number_arg(args[1], &q) || !(q >= 0 && q <= 1)) {
+    fprintf(stderr, "Error: quantile expects a number from 0 to 1\n");
+    return value_make_nil();
+  }
+  f64 value = metrics_quantile(histogram, q);
+  return isnan(value) ? value_make_nil() : value_make_float(value);
+}
+
+// metrics.export - Every metric in the Prometheus text format
+Value native_metrics_export(int arg_count, Value *args) {
+  (void)args;
+  if (arg_count != 0) {
+    fprintf(stderr, "Error: export expects no arguments, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  int length;
+  char *text = metrics_export(&length);
+  return OBJ_VAL(string_take(text, length));
+}
+
+// metrics.write - Export to a file, or to the Unix socket at the path
+Value native_metrics_write(int arg_count, Value *args) {
+  const char *path;
+  int length;
+  if (arg_count != 1 || !value_get_string(&args[0], &path, &length)) {
+    fprintf(stderr, "Error: write expects a string path\n");
+    return value_make_nil();
+  }
+  const char *error = NULL;
+  if (!metrics_write(path, &error)) {
+    fprintf(stderr, "Error: Could not write metrics to '%s': %s\n", path, error);
+    return value_make_nil();
+  }
+  return value_make_bool(true);
+}
+
+// Module initialization
+void metrics_module_init(VM *vm) {
+  module_register_native(vm, "metrics.counter", native_metrics_counter);
+  module_register_native(vm, "metrics.gauge", native_metrics_gauge);
+  module_register_native(vm, "metrics.histogram", native_metrics_histogram);
+  module_register_native(vm, "metrics.inc", native_metrics_inc);
+  module_register_native(vm, "metrics.set", native_metrics_set);
+  module_register_native(vm, "metrics.observe", native_metrics_observe);
+  module_register_native(vm, "metrics.value", native_metrics_value);
+  module_register_native(vm, "metrics.quantile", native_metrics_quantile);
+  module_register_native(vm, "metrics.export", native_metrics_export);
+  module_register_native(vm, "metrics.write", native_metrics_write);
+}
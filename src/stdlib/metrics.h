@@ -0,0 +1,79 @@
+// src/stdlib/metrics.h - Metrics module interface
+
+#ifndef SATORI_STDLIB_METRICS_H
+#define SATORI_STDLIB_METRICS_H
+
+#include "core/value.h"
+#include "runtime/vm.h"
+
+typedef enum {
+  METRIC_COUNTER = 1,
+  METRIC_GAUGE = 2,
+  METRIC_HISTOGRAM = 3,
+} MetricKind;
+
+// Copies of each counter and histogram, one per group of threads, so
+// threads recording at once rarely write the same cache line
+#define METRICS_SHARDS 8
+
+// Histogram buckets are log-linear, as in HdrHistogram: each power of two
+// from 2^METRICS_MIN_EXP to 2^(METRICS_MAX_EXP + 1) is split into
+// 2^METRICS_SUB_BITS equal buckets, so a bucket is at most 1/8 of its
+// values wide. Bucket 0 takes everything below the range, including zero
+// and negative values, and the last bucket everything above it.
+#define METRICS_SUB_BITS 3
+#define METRICS_MIN_EXP (-30)
+#define METRICS_MAX_EXP 33
+#define METRICS_BUCKETS \
+  (((METRICS_MAX_EXP - METRICS_MIN_EXP + 1) << METRICS_SUB_BITS) + 2)
+
+typedef struct Metric Metric;
+
+// C API. Metrics live for the rest of the process in one registry shared
+// by every thread. Asking for a name that is registered returns the same
+// metric, or fails if it is of another kind; names must be valid
+// Prometheus metric names. Failures leave a message in *error.
+Metric *metrics_register(MetricKind kind, const char *name, const char *help,
+                         const char **error);
+MetricKind metrics_kind(const Metric *metric);
+
+// Recording never locks and takes O(1) time
+void metrics_inc(Metric *counter, u64 by);
+void metrics_set(Metric *gauge, f64 value);
+void metrics_add(Metric *gauge, f64 delta);
+void metrics_observe(Metric *histogram, f64 value);
+
+// Reading sums the shards, so it sees each thread's updates but is not a
+// snapshot of all of them at one instant
+u64 metrics_count(const Metric *metric);    // Counter value, or values observed
+f64 metrics_value(const Metric *metric);    // Gauge value, or sum observed
+f64 metrics_quantile(const Metric *histogram, f64 q);  // NaN when empty
+
+// Bucket of a histogram value, and the largest value a bucket takes
+int metrics_bucket(f64 value);
+f64 metrics_bucket_upper(int bucket);
+
+// Every metric in the Prometheus text exposition format; the caller frees
+// the text with mem_free
+char *metrics_export(int *length);
+
+// Export to `path`: sent to a listening Unix socket if that is what the
+// path names, and otherwise written to a file that is replaced atomically
+bool metrics_write(const char *path, const char **error);
+
+// Module initialization
+void metrics_module_init(VM *vm);
+
+// Native functions
+Value native_metrics_counter(int arg_count, Value *args);
+Value native_metrics_gauge(int arg_count, Value *args);
+Value native_metrics_histogram(int arg_count, Value *args);
+Value native_metrics_inc(int arg_count, Value *args);
+Value native_metrics_set(int arg_count, Value *args);
+Value native_metrics_observe(int arg_count, Value *args);
+Value native_metrics_value(int arg_count, Value *args);
+Value native_metrics_quantile(int arg_count, Value *args);
+Value native_metrics_export(int arg_count, Value *args);
+Value native_metrics_write(int arg_count, Value *args);
+
+#endif // SATORI_STDLIB_METRICS_H
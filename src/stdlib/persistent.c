@@ -0,0 +1,298 @@
+// src/stdlib/persistent.c - Persistent collections module implementation
+//
+// Script-facing wrappers over core/vector.h and core/hamt.h. Updates
+// return a new collection and leave their argument as it was; old and new
+// versions share everything but the changed path, so keeping every
+// version costs O(log n) per update rather than a full copy.
+//
+// For bulk building, transient() gives a private copy that updates change
+// in place (each returns the same collection), and freeze() makes it
+// persistent again. A transient must not be used after it is frozen.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "persistent.h"
+#include "runtime/module.h"
+#include "core/hamt.h"
+#include "core/memory.h"
+#include "core/object.h"
+#include "core/vector.h"
+#include <stdio.h>
+
+static bool check_args(const char *name, int arg_count, int min, int max) {
+  if (arg_count >= min && arg_count <= max) return true;
+  if (min == max) {
+    fprintf(stderr, "Error: %s expects %d argument%s, got %d\n", name, min,
+            min == 1 ? "" : "s", arg_count);
+  } else {
+    fprintf(stderr, "Error: %s expects %d to %d arguments, got %d\n", name, min, max, arg_count);
+  }
+  return false;
+}
+
+static bool check_vector(const char *name, Value value) {
+  if (IS_VECTOR(value)) return true;
+  fprintf(stderr, "Error: %s expects a persistent vector\n", name);
+  return false;
+}
+
+static bool check_map(const char *name, Value value) {
+  if (IS_MAP(value)) return true;
+  fprintf(stderr, "Error: %s expects a persistent map\n", name);
+  return false;
+}
+
+static bool check_key(const char *name, Value key) {
+  if (map_valid_key(key)) return true;
+  fprintf(stderr, "Error: %s: map keys must be strings, ints, bools or nil\n", name);
+  return false;
+}
+
+// Index into `vector`, or -1 with an error printed. `end` also admits
+// the index one past the last item.
+static int check_index(const char *name, ObjVector *vector, Value index, bool end) {
+  if (!IS_INT(index)) {
+    fprintf(stderr, "Error: %s expects an int index\n", name);
+    return -1;
+  }
+  i64 i = AS_INT(index);
+  if (i < 0 || i > vector->count || (i == vector->count && !end)) {
+    fprintf(stderr, "Error: %s: index %lld out of range for %d items\n", name, (long long)i,
+            vector->count);
+    return -1;
+  }
+  return (int)i;
+}
+
+// ============================================================================
+// Constructors
+// ============================================================================
+
+// persistent.vector - Empty vector, or one holding an array's items
+Value native_persistent_vector(int arg_count, Value *args) {
+  if (!check_args("vector", arg_count, 0, 1)) return value_make_nil();
+  if (arg_count == 0) return OBJ_VAL(vector_make());
+
+  if (IS_OBJ_ARRAY(args[0])) {
+    ObjArray *array = AS_OBJ_ARRAY(args[0]);
+    return OBJ_VAL(vector_from(array->items, array->count));
+  }
+  if (IS_OBJ_PACKED(args[0])) {
+    ObjPacked *packed = AS_OBJ_PACKED(args[0]);
+    ObjVector *vector = vector_transient(vector_make());
+    for (int i = 0; i < packed->count; i++) {
+      vector_push(vector, packed->element == PACKED_INT ? value_make_int(packed->as.ints[i])
+                                                        : value_make_float(packed->as.floats[i]));
+    }
+    return OBJ_VAL(vector_freeze(vector));
+  }
+  fprintf(stderr, "Error: vector expects an array\n");
+  return value_make_nil();
+}
+
+// persistent.map - Map of the given key, value, key, value... arguments
+Value native_persistent_map(int arg_count, Value *args) {
+  if (arg_count % 2 != 0) {
+    fprintf(stderr, "Error: map expects key/value pairs, got %d arguments\n", arg_count);
+    return value_make_nil();
+  }
+  ObjMap *map = map_transient(map_make());
+  for (int i = 0; i < arg_count; i += 2) {
+    if (!check_key("map", args[i])) return value_make_nil();
+    map_put(map, args[i], args[i + 1]);
+  }
+  return OBJ_VAL(map_freeze(map));
+}
+
+// ============================================================================
+// Lookups
+// ============================================================================
+
+// persistent.len - Number of items or entries
+Value native_persistent_len(int arg_count, Value *args) {
+  if (!check_args("len", arg_count, 1, 1)) return value_make_nil();
+  if (IS_VECTOR(args[0])) return value_make_int(AS_VECTOR(args[0])->count);
+  if (IS_MAP(args[0])) return value_make_int(AS_MAP(args[0])->count);
+  fprintf(stderr, "Error: len expects a persistent vector or map\n");
+  return value_make_nil();
+}
+
+// persistent.get - Item at an index or value under a key; the default
+// (or nil) when there is none
+Value native_persistent_get(int arg_count, Value *args) {
+  if (!check_args("get", arg_count, 2, 3)) return value_make_nil();
+  Value fallback = arg_count == 3 ? args[2] : value_make_nil();
+
+  if (IS_VECTOR(args[0])) {
+    ObjVector *vector = AS_VECTOR(args[0]);
+    if (!IS_INT(args[1])) {
+      fprintf(stderr, "Error: get expects an int index\n");
+      return value_make_nil();
+    }
+    i64 i = AS_INT(args[1]);
+    return i >= 0 && i < vector->count ? vector_get(vector, (int)i) : fallback;
+  }
+  if (IS_MAP(args[0])) {
+    if (!check_key("get", args[1])) return value_make_nil();
+    Value value;
+    return map_get(AS_MAP(args[0]), args[1], &value) ? value : fallback;
+  }
+  fprintf(stderr, "Error: get expects a persistent vector or map\n");
+  return value_make_nil();
+}
+
+// persistent.has - Whether an index is in range or a key is present
+Value native_persistent_has(int arg_count, Value *args) {
+  if (!check_args("has", arg_count, 2, 2)) return value_make_nil();
+  if (IS_VECTOR(args[0])) {
+    return value_make_bool(IS_INT(args[1]) && AS_INT(args[1]) >= 0 &&
+                           AS_INT(args[1]) < AS_VECTOR(args[0])->count);
+  }
+  if (IS_MAP(args[0])) {
+    Value value;
+    return value_make_bool(map_valid_key(args[1]) && map_get(AS_MAP(args[0]), args[1], &value));
+  }
+  fprintf(stderr, "Error: has expects a persistent vector or map\n");
+  return value_make_nil();
+}
+
+// ============================================================================
+// Updates
+// ============================================================================
+
+// persistent.set - Replace the item at an index (or append at len), or
+// store a value under a key
+Value native_persistent_set(int arg_count, Value *args) {
+  if (!check_args("set", arg_count, 3, 3)) return value_make_nil();
+
+  if (IS_VECTOR(args[0])) {
+    ObjVector *vector = AS_VECTOR(args[0]);
+    int index = check_index("set", vector, args[1], true);
+    if (index < 0) return value_make_nil();
+    if (index == vector->count) return OBJ_VAL(vector_push(vector, args[2]));
+    return OBJ_VAL(vector_set(vector, index, args[2]));
+  }
+  if (IS_MAP(args[0])) {
+    if (!check_key("set", args[1])) return value_make_nil();
+    return OBJ_VAL(map_put(AS_MAP(args[0]), args[1], args[2]));
+  }
+  fprintf(stderr, "Error: set expects a persistent vector or map\n");
+  return value_make_nil();
+}
+
+// persistent.push - Append an item
+Value native_persistent_push(int arg_count, Value *args) {
+  if (!check_args("push", arg_count, 2, 2) || !check_vector("push", args[0])) {
+    return value_make_nil();
+  }
+  return OBJ_VAL(vector_push(AS_VECTOR(args[0]), args[1]));
+}
+
+// persistent.pop - Drop the last item
+Value native_persistent_pop(int arg_count, Value *args) {
+  if (!check_args("pop", arg_count, 1, 1) || !check_vector("pop", args[0])) {
+    return value_make_nil();
+  }
+  if (AS_VECTOR(args[0])->count == 0) {
+    fprintf(stderr, "Error: pop on an empty vector\n");
+    return value_make_nil();
+  }
+  return OBJ_VAL(vector_pop(AS_VECTOR(args[0])));
+}
+
+// persistent.remove - Drop a key, if present
+Value native_persistent_remove(int arg_count, Value *args) {
+  if (!check_args("remove", arg_count, 2, 2) || !check_map("remove", args[0]) ||
+      !check_key("remove", args[1])) {
+    return value_make_nil();
+  }
+  return OBJ_VAL(map_remove(AS_MAP(args[0]), args[1]));
+}
+
+// ============================================================================
+// Conversions
+// ============================================================================
+
+static bool collect_key(Value key, Value value, void *context) {
+  (void)value;
+  array_push(context, key);
+  return true;
+}
+
+static bool collect_value(Value key, Value value, void *context) {
+  (void)key;
+  array_push(context, value);
+  return true;
+}
+
+// persistent.keys - Array of a map's keys, in hash order
+Value native_persistent_keys(int arg_count, Value *args) {
+  if (!check_args("keys", arg_count, 1, 1) || !check_map("keys", args[0])) {
+    return value_make_nil();
+  }
+  ObjArray *array = array_make(AS_MAP(args[0])->count);
+  map_each(AS_MAP(args[0]), collect_key, array);
+  return OBJ_VAL(array);
+}
+
+// persistent.values - Array of a map's values, in the order keys() gives
+Value native_persistent_values(int arg_count, Value *args) {
+  if (!check_args("values", arg_count, 1, 1) || !check_map("values", args[0])) {
+    return value_make_nil();
+  }
+  ObjArray *array = array_make(AS_MAP(args[0])->count);
+  map_each(AS_MAP(args[0]), collect_value, array);
+  return OBJ_VAL(array);
+}
+
+// persistent.to_array - Array of a vector's items
+Value native_persistent_to_array(int arg_count, Value *args) {
+  if (!check_args("to_array", arg_count, 1, 1) || !check_vector("to_array", args[0])) {
+    return value_make_nil();
+  }
+  ObjVector *vector = AS_VECTOR(args[0]);
+  ObjArray *array = array_make(vector->count);
+  for (int i = 0; i < vector->count; i++) array->items[i] = vector_get(vector, i);
+  array->count = vector->count;
+  return OBJ_VAL(array);
+}
+
+// ============================================================================
+// Transients
+// ============================================================================
+
+// persistent.transient - Copy that updates change in place
+Value native_persistent_transient(int arg_count, Value *args) {
+  if (!check_args("transient", arg_count, 1, 1)) return value_make_nil();
+  if (IS_VECTOR(args[0])) return OBJ_VAL(vector_transient(AS_VECTOR(args[0])));
+  if (IS_MAP(args[0])) return OBJ_VAL(map_transient(AS_MAP(args[0])));
+  fprintf(stderr, "Error: transient expects a persistent vector or map\n");
+  return value_make_nil();
+}
+
+// persistent.freeze - Make a transient persistent again
+Value native_persistent_freeze(int arg_count, Value *args) {
+  if (!check_args("freeze", arg_count, 1, 1)) return value_make_nil();
+  if (IS_VECTOR(args[0])) return OBJ_VAL(vector_freeze(AS_VECTOR(args[0])));
+  if (IS_MAP(args[0])) return OBJ_VAL(map_freeze(AS_MAP(args[0])));
+  fprintf(stderr, "Error: freeze expects a persistent vector or map\n");
+  return value_make_nil();
+}
+
+// Module initialization
+void persistent_module_init(VM *vm) {
+  module_register_native(vm, "persistent.vector", native_persistent_vector);
+  module_register_native(vm, "persistent.map", native_persistent_map);
+  module_register_native(vm, "persistent.len", native_persistent_len);
+  module_register_native(vm, "persistent.get", native_persistent_get);
+  module_register_native(vm, "persistent.has", native_persistent_has);
+  module_register_native(vm, "persistent.set", native_persistent_set);
+  module_register_native(vm, "persistent.push", native_persistent_push);
+  module_register_native(vm, "persistent.pop", native_persistent_pop);
+  module_register_native(vm, "persistent.remove", native_persistent_remove);
+  module_register_native(vm, "persistent.keys", native_persistent_keys);
+  module_register_native(vm, "persistent.values", native_persistent_values);
+  module_register_native(vm, "persistent.to_array", native_persistent_to_array);
+  module_register_native(vm, "persistent.transient", native_persistent_transient);
+  module_register_native(vm, "persistent.freeze", native_persistent_freeze);
+}
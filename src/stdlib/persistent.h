@@ -0,0 +1,28 @@
+// src/stdlib/persistent.h - Persistent collections module interface
+
+#ifndef SATORI_STDLIB_PERSISTENT_H
+#define SATORI_STDLIB_PERSISTENT_H
+
+#include "core/value.h"
+#include "runtime/vm.h"
+
+// Module initialization
+void persistent_module_init(VM *vm);
+
+// Native functions
+Value native_persistent_vector(int arg_count, Value *args);
+Value native_persistent_map(int arg_count, Value *args);
+Value native_persistent_len(int arg_count, Value *args);
+Value native_persistent_get(int arg_count, Value *args);
+Value native_persistent_has(int arg_count, Value *args);
+Value native_persistent_set(int arg_count, Value *args);
+Value native_persistent_push(int arg_count, Value *args);
+Value native_persistent_pop(int arg_count, Value *args);
+Value native_persistent_remove(int arg_count, Value *args);
+Value native_persistent_keys(int arg_count, Value *args);
+Value native_persistent_values(int arg_count, Value *args);
+Value native_persistent_to_array(int arg_count, Value *args);
+Value native_persistent_transient(int arg_count, Value *args);
+Value native_persistent_freeze(int arg_count, Value *args);
+
+#endif // SATORI_STDLIB_PERSISTENT_H
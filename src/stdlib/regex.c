@@ -0,0 +1,1370 @@
+// src/stdlib/regex.c - Regular expression module implementation
+//
+// Patterns compile once into a Thompson NFA program (forward and reversed).
+// Searching runs a lazily built DFA over that program:
+//
+//   1. A literal prefix, if the pattern has one, is located with a SIMD
+//      scan and the DFA only starts where it can possibly match.
+//   2. The forward DFA runs unanchored and finds where the leftmost-longest
+//      match ends. DFA states keep NFA threads grouped by start position
+//      (groups separated by DFA_MARK) so later starts are dropped as soon
+//      as an earlier one matches.
+//   3. The reverse DFA runs backwards from that end to find the start.
+//
+// States are built on demand and cached per regex. When the cache outgrows
+// its budget it is flushed; if a single search keeps flushing, that search
+// falls back to a Pike VM simulation of the NFA. Either way matching is
+// linear in the input - there is no backtracking.
+//
+// Supported syntax: literals, ., [classes], \d \w \s (and negations),
+// \n \t \r \f \v \xHH, ^ $, (groups), (?:groups), |, * + ? {m} {m,} {m,n},
+// and a leading (?i) for ASCII case-insensitive matching.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "regex.h"
+#include "runtime/module.h"
+#include "core/memory.h"
+#include "core/object.h"
+#include "core/value.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define REGEX_MAX_PROGRAM 10000            // Instructions after expansion
+#define REGEX_MAX_REPEAT 1000              // Largest {m,n} bound
+#define REGEX_MAX_PREFIX 64                // Longest literal prefix kept
+#define REGEX_DFA_CACHE_BYTES (1 << 20)    // Per-direction state cache
+#define REGEX_MAX_FLUSHES 8                // Per search, before NFA fallback
+
+#define DFA_UNKNOWN (-1)    // Transition not computed yet
+#define DFA_GAVE_UP (-2)    // Cache thrashing, use the NFA instead
+#define DFA_MARK (-1)       // Separates priority groups inside a state
+
+#define DFA_MATCHED 0x01    // A match was seen: no new start threads
+#define DFA_AT_BEGIN 0x02   // State sits at the scan's starting edge
+
+// ============================================================================
+// Program representation
+// ============================================================================
+
+typedef enum {
+  RE_BYTES,   // Consume one byte in sets[x]
+  RE_SPLIT,   // Fork to x and y
+  RE_JMP,     // Go to x
+  RE_BEGIN,   // Assert at the edge where the scan started
+  RE_END,     // Assert at the edge where the scan stops
+  RE_MATCH,
+} RegexOp;
+
+typedef struct {
+  u8 op;
+  int x;
+  int y;
+} RegexInst;
+
+typedef struct {
+  u64 bits[4];
+} ByteSet;
+
+typedef struct {
+  RegexInst *code;
+  int count;
+  int capacity;
+} RegexProg;
+
+#define SET_HAS(set, b) (((set)->bits[(b) >> 6] >> ((b) & 63)) & 1)
+#define SET_ADD(set, b) ((set)->bits[(b) >> 6] |= (u64)1 << ((b) & 63))
+
+// Sparse set over instruction indices (Briggs & Torczon)
+typedef struct {
+  int *dense;
+  int *sparse;
+  int count;
+} SparseSet;
+
+// ============================================================================
+// Lazy DFA
+// ============================================================================
+
+typedef struct {
+  int *insts;        // RE_BYTES/RE_END/RE_MATCH pcs, DFA_MARK between groups
+  int count;
+  u32 hash;
+  u8 flags;
+  bool is_match;     // A match ends where this state is entered
+  bool match_at_end; // A match ends here if the input stops here
+  bool skippable;    // Nothing in flight: the prefilter may skip ahead
+  int next[256];
+} DfaState;
+
+typedef struct {
+  RegexProg *prog;
+  bool unanchored;   // Forward search adds a start thread at every byte
+  DfaState **states;
+  int count;
+  int capacity;
+  int *table;        // Open addressing over state ids, -1 = empty
+  int table_capacity;
+  size_t memory;
+  int start[2];      // Start state per DFA_AT_BEGIN, -1 if not built
+  int generation;    // Bumped on every flush
+  int flushes;       // Flushes during the current search
+} Dfa;
+
+struct Regex {
+  char *pattern;     // Source, so a bundle can store the regex as text
+  int pattern_length;
+  ByteSet *sets;
+  int set_count;
+  RegexProg forward;
+  RegexProg reverse;
+  u8 prefix[REGEX_MAX_PREFIX];
+  int prefix_length;
+  bool anchored;     // Every match starts at offset 0
+  Dfa fwd_dfa;
+  Dfa rev_dfa;
+
+  // Scratch, sized for the larger program
+  int max_code;
+  SparseSet seen;
+  SparseSet seen2;
+  int *stack;
+  int *buf;
+  int *mid_start;    // Closure of the forward start away from offset 0
+  int mid_start_count;
+
+  // Pike VM thread lists: parallel pc/start arrays
+  int *thread_pc[2];
+  int *thread_start[2];
+};
+
+// ============================================================================
+// Parser: pattern -> syntax tree
+// ============================================================================
+
+typedef enum {
+  RN_EMPTY,
+  RN_SET,
+  RN_BOL,
+  RN_EOL,
+  RN_CAT,
+  RN_ALT,
+  RN_REPEAT,
+} RegexNodeKind;
+
+typedef struct {
+  RegexNodeKind kind;
+  int a;      // Set index, or first child
+  int b;      // Second child
+  int min;
+  int max;    // -1 = unbounded
+} RegexNode;
+
+typedef struct {
+  const char *src;
+  int pos;
+  int length;
+  bool fold_case;
+  RegexNode *nodes;
+  int node_count;
+  int node_capacity;
+  ByteSet *sets;
+  int set_count;
+  int set_capacity;
+  int depth;
+  const char *error;
+} RegexParser;
+
+static int parse_alt(RegexParser *p);
+
+static int new_node(RegexParser *p, RegexNodeKind kind, int a, int b) {
+  if (p->node_capacity < p->node_count + 1) {
+    int capacity = GROW_CAPACITY(p->node_capacity);
+    p->nodes = GROW_ARRAY(RegexNode, p->nodes, p->node_capacity, capacity);
+    p->node_capacity = capacity;
+  }
+  RegexNode *node = &p->nodes[p->node_count];
+  node->kind = kind;
+  node->a = a;
+  node->b = b;
+  node->min = 0;
+  node->max = 0;
+  return p->node_count++;
+}
+
+static int new_set(RegexParser *p, const ByteSet *set) {
+  ByteSet folded = *set;
+  if (p->fold_case) {
+    for (int c = 'a'; c <= 'z'; c++) {
+      if (SET_HAS(set, c) || SET_HAS(set, c - 32)) {
+        SET_ADD(&folded, c);
+        SET_ADD(&folded, c - 32);
+      }
+    }
+  }
+  if (p->set_capacity < p->set_count + 1) {
+    int capacity = GROW_CAPACITY(p->set_capacity);
+    p->sets = GROW_ARRAY(ByteSet, p->sets, p->set_capacity, capacity);
+    p->set_capacity = capacity;
+  }
+  p->sets[p->set_count] = folded;
+  return new_node(p, RN_SET, p->set_count++, 0);
+}
+
+static void set_range(ByteSet *set, int lo, int hi) {
+  for (int c = lo; c <= hi; c++) SET_ADD(set, c);
+}
+
+static void set_negate(ByteSet *set) {
+  for (int i = 0; i < 4; i++) set->bits[i] = ~set->bits[i];
+}
+
+// Add a \d \w \s style class. Returns false if `c` is not a class letter.
+static bool set_add_class(ByteSet *set, char c) {
+  ByteSet cls = {{0, 0, 0, 0}};
+  switch (c) {
+    case 'd': case 'D':
+      set_range(&cls, '0', '9');
+      break;
+    case 'w': case 'W':
+      set_range(&cls, '0', '9');
+      set_range(&cls, 'a', 'z');
+      set_range(&cls, 'A', 'Z');
+      SET_ADD(&cls, '_');
+      break;
+    case 's': case 'S':
+      set_range(&cls, '\t', '\r');
+      SET_ADD(&cls, ' ');
+      break;
+    default:
+      return false;
+  }
+  if (c == 'D' || c == 'W' || c == 'S') set_negate(&cls);
+  for (int i = 0; i < 4; i++) set->bits[i] |= cls.bits[i];
+  return true;
+}
+
+static int hex_digit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Parse the escape after a backslash. Class escapes are added to `set` and
+// return -1; everything else returns the literal byte (or -2 on error).
+static int parse_escape(RegexParser *p, ByteSet *set) {
+  if (p->pos >= p->length) {
+    p->error = "trailing backslash";
+    return -2;
+  }
+  char c = p->src[p->pos++];
+  if (set_add_class(set, c)) return -1;
+
+  switch (c) {
+    case 'n': return '\n';
+    case 't': return '\t';
+    case 'r': return '\r';
+    case 'f': return '\f';
+    case 'v': return '\v';
+    case '0': return '\0';
+    case 'x': {
+      if (p->pos + 2 > p->length ||
+          hex_digit(p->src[p->pos]) < 0 || hex_digit(p->src[p->pos + 1]) < 0) {
+        p->error = "expected two hex digits after \\x";
+        return -2;
+      }
+      int value = hex_digit(p->src[p->pos]) * 16 + hex_digit(p->src[p->pos + 1]);
+      p->pos += 2;
+      return value;
+    }
+  }
+
+  if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+      (c >= '0' && c <= '9')) {
+    p->error = "unknown escape sequence";
+    return -2;
+  }
+  return (u8)c;  // Escaped punctuation is literal
+}
+
+static int parse_class(RegexParser *p) {
+  ByteSet set = {{0, 0, 0, 0}};
+  bool negate = false;
+
+  if (p->pos < p->length && p->src[p->pos] == '^') {
+    negate = true;
+    p->pos++;
+  }
+
+  bool first = true;
+  while (p->pos < p->length && (p->src[p->pos] != ']' || first)) {
+    first = false;
+    int lo;
+    char c = p->src[p->pos++];
+    if (c == '\\') {
+      lo = parse_escape(p, &set);
+      if (lo == -2) return -1;
+      if (lo == -1) continue;
+    } else {
+      lo = (u8)c;
+    }
+
+    // Range a-z (a trailing '-' is literal)
+    if (p->pos + 1 < p->length && p->src[p->pos] == '-' &&
+        p->src[p->pos + 1] != ']') {
+      p->pos++;
+      int hi;
+      char h = p->src[p->pos++];
+      if (h == '\\') {
+        ByteSet ignored = {{0, 0, 0, 0}};
+        hi = parse_escape(p, &ignored);
+        if (hi == -2) return -1;
+        if (hi == -1) {
+          p->error = "class escape cannot end a range";
+          return -1;
+        }
+      } else {
+        hi = (u8)h;
+      }
+      if (hi < lo) {
+        p->error = "invalid range in character class";
+        return -1;
+      }
+      set_range(&set, lo, hi);
+    } else {
+      SET_ADD(&set, lo);
+    }
+  }
+
+  if (p->pos >= p->length) {
+    p->error = "missing ']'";
+    return -1;
+  }
+  p->pos++;  // ']'
+
+  if (negate) set_negate(&set);
+  return new_set(p, &set);
+}
+
+static int parse_atom(RegexParser *p) {
+  char c = p->src[p->pos++];
+  ByteSet set = {{0, 0, 0, 0}};
+
+  switch (c) {
+    case '(': {
+      if (++p->depth > 200) {
+        p->error = "groups nested too deeply";
+        return -1;
+      }
+      if (p->pos + 1 < p->length && p->src[p->pos] == '?' &&
+          p->src[p->pos + 1] == ':') {
+        p->pos += 2;
+      }
+      int inner = parse_alt(p);
+      if (inner < 0) return -1;
+      if (p->pos >= p->length || p->src[p->pos] != ')') {
+        p->error = "missing ')'";
+        return -1;
+      }
+      p->pos++;
+      p->depth--;
+      return inner;
+    }
+    case '[':
+      return parse_class(p);
+    case '.':
+      set_range(&set, 0, 255);
+      set.bits['\n' >> 6] &= ~((u64)1 << ('\n' & 63));
+      return new_set(p, &set);
+    case '^':
+      return new_node(p, RN_BOL, 0, 0);
+    case '$':
+      return new_node(p, RN_EOL, 0, 0);
+    case '*':
+    case '+':
+    case '?':
+      p->error = "nothing to repeat";
+      return -1;
+    case '\\': {
+      int lit = parse_escape(p, &set);
+      if (lit == -2) return -1;
+      if (lit >= 0) SET_ADD(&set, lit);
+      return new_set(p, &set);
+    }
+    default:
+      SET_ADD(&set, (u8)c);
+      return new_set(p, &set);
+  }
+}
+
+static bool parse_int(RegexParser *p, int *out) {
+  int start = p->pos;
+  int value = 0;
+  while (p->pos < p->length && p->src[p->pos] >= '0' && p->src[p->pos] <= '9') {
+    if (value <= REGEX_MAX_REPEAT) value = value * 10 + (p->src[p->pos] - '0');
+    p->pos++;
+  }
+  *out = value;
+  return p->pos > start;
+}
+
+static int parse_repeat(RegexParser *p) {
+  int atom = parse_atom(p);
+  if (atom < 0) return -1;
+
+  while (p->pos < p->length) {
+    char c = p->src[p->pos];
+    int min, max;
+
+    if (c == '*') {
+      min = 0; max = -1;
+      p->pos++;
+    } else if (c == '+') {
+      min = 1; max = -1;
+      p->pos++;
+    } else if (c == '?') {
+      min = 0; max = 1;
+      p->pos++;
+    } else if (c == '{' && p->pos + 1 < p->length &&
+               p->src[p->pos + 1] >= '0' && p->src[p->pos + 1] <= '9') {
+      p->pos++;
+      parse_int(p, &min);
+      max = min;
+      if (p->pos < p->length && p->src[p->pos] == ',') {
+        p->pos++;
+        if (!parse_int(p, &max)) max = -1;
+      }
+      if (p->pos >= p->length || p->src[p->pos] != '}') {
+        p->error = "missing '}' in repetition";
+        return -1;
+      }
+      p->pos++;
+      if (min > REGEX_MAX_REPEAT || max > REGEX_MAX_REPEAT) {
+        p->error = "repetition count too large";
+        return -1;
+      }
+      if (max != -1 && max < min) {
+        p->error = "invalid repetition range";
+        return -1;
+      }
+    } else {
+      break;
+    }
+
+    if (p->pos < p->length && p->src[p->pos] == '?') {
+      p->error = "lazy quantifiers are not supported (matching is leftmost-longest)";
+      return -1;
+    }
+
+    int node = new_node(p, RN_REPEAT, atom, 0);
+    p->nodes[node].min = min;
+    p->nodes[node].max = max;
+    atom = node;
+  }
+  return atom;
+}
+
+static int parse_cat(RegexParser *p) {
+  int node = new_node(p, RN_EMPTY, 0, 0);
+  while (p->pos < p->length && p->src[p->pos] != '|' && p->src[p->pos] != ')') {
+    int next = parse_repeat(p);
+    if (next < 0) return -1;
+    node = p->nodes[node].kind == RN_EMPTY ? next : new_node(p, RN_CAT, node, next);
+  }
+  return node;
+}
+
+static int parse_alt(RegexParser *p) {
+  int node = parse_cat(p);
+  if (node < 0) return -1;
+  while (p->pos < p->length && p->src[p->pos] == '|') {
+    p->pos++;
+    int right = parse_cat(p);
+    if (right < 0) return -1;
+    node = new_node(p, RN_ALT, node, right);
+  }
+  return node;
+}
+
+// ============================================================================
+// Compiler: syntax tree -> NFA program
+// ============================================================================
+
+typedef struct {
+  RegexParser *parser;
+  RegexProg *prog;
+  bool reverse;
+  const char *error;
+} RegexCompiler;
+
+static int emit(RegexCompiler *c, RegexOp op, int x, int y) {
+  RegexProg *prog = c->prog;
+  if (prog->count >= REGEX_MAX_PROGRAM) {
+    c->error = "pattern too large";
+    return 0;
+  }
+  if (prog->capacity < prog->count + 1) {
+    int capacity = GROW_CAPACITY(prog->capacity);
+    prog->code = GROW_ARRAY(RegexInst, prog->code, prog->capacity, capacity);
+    prog->capacity = capacity;
+  }
+  prog->code[prog->count].op = (u8)op;
+  prog->code[prog->count].x = x;
+  prog->code[prog->count].y = y;
+  return prog->count++;
+}
+
+static void compile_regex_node(RegexCompiler *c, int index) {
+  if (c->error) return;
+  RegexNode *node = &c->parser->nodes[index];
+
+  switch (node->kind) {
+    case RN_EMPTY:
+      break;
+    case RN_SET:
+      emit(c, RE_BYTES, node->a, 0);
+      break;
+    case RN_BOL:
+      // Reversed, the start of text is where the scan stops
+      emit(c, c->reverse ? RE_END : RE_BEGIN, 0, 0);
+      break;
+    case RN_EOL:
+      emit(c, c->reverse ? RE_BEGIN : RE_END, 0, 0);
+      break;
+    case RN_CAT:
+      compile_regex_node(c, c->reverse ? node->b : node->a);
+      compile_regex_node(c, c->reverse ? node->a : node->b);
+      break;
+    case RN_ALT: {
+      int split = emit(c, RE_SPLIT, 0, 0);
+      c->prog->code[split].x = c->prog->count;
+      compile_regex_node(c, node->a);
+      int jmp = emit(c, RE_JMP, 0, 0);
+      c->prog->code[split].y = c->prog->count;
+      compile_regex_node(c, node->b);
+      c->prog->code[jmp].x = c->prog->count;
+      break;
+    }
+    case RN_REPEAT: {
+      int min = node->min;
+      int max = node->max;
+      int child = node->a;
+
+      if (max == -1) {
+        // x{m,} = x{m-1} followed by x+ (loop back over the last copy)
+        for (int i = 0; i < min - 1; i++) compile_regex_node(c, child);
+        if (min > 0) {
+          int body = c->prog->count;
+          compile_regex_node(c, child);
+          int split = emit(c, RE_SPLIT, body, 0);
+          c->prog->code[split].y = c->prog->count;
+        } else {
+          int split = emit(c, RE_SPLIT, 0, 0);
+          c->prog->code[split].x = c->prog->count;
+          compile_regex_node(c, child);
+          emit(c, RE_JMP, split, 0);
+          c->prog->code[split].y = c->prog->count;
+        }
+        break;
+      }
+
+      for (int i = 0; i < min; i++) compile_regex_node(c, child);
+
+      // Optional copies nest: (x(x(x)?)?)? - each split exits to the end
+      int first_split = c->prog->count;
+      for (int i = 0; i < max - min && !c->error; i++) {
+        int split = emit(c, RE_SPLIT, 0, -1);
+        c->prog->code[split].x = c->prog->count;
+        compile_regex_node(c, child);
+      }
+      if (c->error) break;
+      for (int pc = first_split; pc < c->prog->count; pc++) {
+        if (c->prog->code[pc].op == RE_SPLIT && c->prog->code[pc].y == -1) {
+          c->prog->code[pc].y = c->prog->count;
+        }
+      }
+      break;
+    }
+  }
+}
+
+static bool compile_program(RegexParser *parser, int root, RegexProg *prog,
+                            bool reverse, const char **error) {
+  RegexCompiler c = {parser, prog, reverse, NULL};
+  compile_regex_node(&c, root);
+  emit(&c, RE_MATCH, 0, 0);
+  if (c.error) {
+    *error = c.error;
+    return false;
+  }
+  return true;
+}
+
+// Collect the literal bytes every match must begin with
+static bool collect_prefix(RegexParser *p, int index, Regex *re) {
+  RegexNode *node = &p->nodes[index];
+  switch (node->kind) {
+    case RN_CAT:
+      return collect_prefix(p, node->a, re) && collect_prefix(p, node->b, re);
+    case RN_EMPTY:
+      return true;
+    case RN_SET: {
+      const ByteSet *set = &p->sets[node->a];
+      int only = -1;
+      for (int b = 0; b < 256; b++) {
+        if (!SET_HAS(set, b)) continue;
+        if (only != -1) return false;
+        only = b;
+      }
+      if (only == -1 || re->prefix_length >= REGEX_MAX_PREFIX) return false;
+      re->prefix[re->prefix_length++] = (u8)only;
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+static bool starts_with_bol(RegexParser *p, int index) {
+  RegexNode *node = &p->nodes[index];
+  if (node->kind == RN_BOL) return true;
+  if (node->kind == RN_CAT) return starts_with_bol(p, node->a);
+  return false;
+}
+
+// ============================================================================
+// Literal prefilter
+// ============================================================================
+
+// Find the next offset >= pos where the prefix occurs, -1 if none
+static int prefix_find(const Regex *re, const u8 *text, int length, int pos) {
+  const u8 *lit = re->prefix;
+  int n = re->prefix_length;
+
+#ifdef __SSE2__
+  // Compare the first and last prefix byte against 16 positions at once,
+  // then verify the candidates the mask turns up
+  if (n > 1) {
+    const __m128i first = _mm_set1_epi8((char)lit[0]);
+    const __m128i last = _mm_set1_epi8((char)lit[n - 1]);
+    for (; pos + n - 1 + 16 <= length; pos += 16) {
+      __m128i a = _mm_loadu_si128((const __m128i *)(text + pos));
+      __m128i b = _mm_loadu_si128((const __m128i *)(text + pos + n - 1));
+      unsigned mask = (unsigned)_mm_movemask_epi8(
+          _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+      while (mask != 0) {
+        int bit = __builtin_ctz(mask);
+        if (memcmp(text + pos + bit + 1, lit + 1, n - 2) == 0) return pos + bit;
+        mask &= mask - 1;
+      }
+    }
+  }
+#endif
+
+  while (pos + n <= length) {
+    const u8 *hit = memchr(text + pos, lit[0], length - n + 1 - pos);
+    if (hit == NULL) return -1;
+    pos = (int)(hit - text);
+    if (memcmp(hit + 1, lit + 1, n - 1) == 0) return pos;
+    pos++;
+  }
+  return -1;
+}
+
+// ============================================================================
+// Closures
+// ============================================================================
+
+static void sparse_init(SparseSet *set, int capacity) {
+  set->dense = (int*)mem_alloc(sizeof(int) * capacity);
+  set->sparse = (int*)calloc(capacity, sizeof(int));
+  set->count = 0;
+}
+
+static void sparse_free(SparseSet *set) {
+  mem_free(set->dense);
+  free(set->sparse);
+}
+
+static bool sparse_insert(SparseSet *set, int value) {
+  int i = set->sparse[value];
+  if (i < set->count && set->dense[i] == value) return false;
+  set->sparse[value] = set->count;
+  set->dense[set->count++] = value;
+  return true;
+}
+
+// Add the epsilon closure of pc to out[]. Keeps only instructions a DFA
+// state needs: byte consumers, MATCH, and RE_END when at_end is unknown.
+static void dfa_closure(Regex *re, RegexProg *prog, SparseSet *seen, int pc,
+                        bool at_begin, bool at_end, int *out, int *n) {
+  int top = 0;
+  re->stack[top++] = pc;
+  while (top > 0) {
+    pc = re->stack[--top];
+    if (!sparse_insert(seen, pc)) continue;
+    RegexInst *inst = &prog->code[pc];
+    switch (inst->op) {
+      case RE_JMP:
+        re->stack[top++] = inst->x;
+        break;
+      case RE_SPLIT:
+        re->stack[top++] = inst->y;
+        re->stack[top++] = inst->x;
+        break;
+      case RE_BEGIN:
+        if (at_begin) re->stack[top++] = pc + 1;
+        break;
+      case RE_END:
+        if (at_end) re->stack[top++] = pc + 1;
+        else out[(*n)++] = pc;
+        break;
+      case RE_BYTES:
+      case RE_MATCH:
+        out[(*n)++] = pc;
+        break;
+    }
+  }
+}
+
+static int compare_int(const void *a, const void *b) {
+  int x = *(const int*)a;
+  int y = *(const int*)b;
+  return (x > y) - (x < y);
+}
+
+// ============================================================================
+// DFA cache
+// ============================================================================
+
+static void dfa_init(Dfa *d, RegexProg *prog, bool unanchored) {
+  d->prog = prog;
+  d->unanchored = unanchored;
+  d->states = NULL;
+  d->count = 0;
+  d->capacity = 0;
+  d->table_capacity = 64;
+  d->table = (int*)mem_alloc(sizeof(int) * d->table_capacity);
+  for (int i = 0; i < d->table_capacity; i++) d->table[i] = -1;
+  d->memory = 0;
+  d->start[0] = -1;
+  d->start[1] = -1;
+  d->generation = 0;
+  d->flushes = 0;
+}
+
+static void dfa_clear(Dfa *d) {
+  for (int i = 0; i < d->count; i++) {
+    mem_free(d->states[i]->insts);
+    mem_free(d->states[i]);
+  }
+  d->count = 0;
+  for (int i = 0; i < d->table_capacity; i++) d->table[i] = -1;
+  d->memory = 0;
+  d->start[0] = -1;
+  d->start[1] = -1;
+  d->generation++;
+}
+
+static void dfa_free(Dfa *d) {
+  dfa_clear(d);
+  mem_free(d->states);
+  mem_free(d->table);
+}
+
+static u32 dfa_hash(const int *insts, int count, u8 flags) {
+  u32 hash = 2166136261u ^ flags;
+  for (int i = 0; i < count; i++) {
+    hash ^= (u32)insts[i];
+    hash *= 16777619;
+  }
+  return hash;
+}
+
+static bool dfa_group_matches(Dfa *d, const int *insts, int from, int to) {
+  for (int i = from; i < to; i++) {
+    if (d->prog->code[insts[i]].op == RE_MATCH) return true;
+  }
+  return false;
+}
+
+// Intern the state in re->buf[0..count). Returns its id, or DFA_GAVE_UP.
+static int dfa_intern(Regex *re, Dfa *d, int count, u8 flags) {
+  int *insts = re->buf;
+  u32 hash = dfa_hash(insts, count, flags);
+
+  int mask = d->table_capacity - 1;
+  for (int i = hash & mask;; i = (i + 1) & mask) {
+    int id = d->table[i];
+    if (id == -1) break;
+    DfaState *s = d->states[id];
+    if (s->hash == hash && s->flags == flags && s->count == count &&
+        memcmp(s->insts, insts, sizeof(int) * count) == 0) {
+      return id;
+    }
+  }
+
+  size_t cost = sizeof(DfaState) + sizeof(int) * count;
+  if (d->memory + cost > REGEX_DFA_CACHE_BYTES) {
+    if (++d->flushes > REGEX_MAX_FLUSHES) return DFA_GAVE_UP;
+    dfa_clear(d);
+  }
+
+  // Make room before the state exists, so a refused block leaves no
+  // state half added
+  if (d->capacity < d->count + 1) {
+    int capacity = GROW_CAPACITY(d->capacity);
+    d->states = GROW_ARRAY(DfaState*, d->states, d->capacity, capacity);
+    d->capacity = capacity;
+  }
+
+  DfaState *s = (DfaState*)mem_alloc(sizeof(DfaState));
+  s->insts = (int*)mem_alloc(sizeof(int) * (count > 0 ? count : 1));
+  memcpy(s->insts, insts, sizeof(int) * count);
+  s->count = count;
+  s->hash = hash;
+  s->flags = flags;
+  for (int b = 0; b < 256; b++) s->next[b] = DFA_UNKNOWN;
+
+  s->is_match = false;
+  for (int i = 0; i < count && !s->is_match; i++) {
+    s->is_match = insts[i] != DFA_MARK && d->prog->code[insts[i]].op == RE_MATCH;
+  }
+
+  // Would resolving pending RE_END assertions reach MATCH?
+  s->match_at_end = s->is_match;
+  re->seen2.count = 0;
+  for (int i = 0; i < count && !s->match_at_end; i++) {
+    if (insts[i] == DFA_MARK || d->prog->code[insts[i]].op != RE_END) continue;
+    int n = 0;
+    int *tmp = re->buf + count;
+    dfa_closure(re, d->prog, &re->seen2, insts[i] + 1,
+                (flags & DFA_AT_BEGIN) != 0, true, tmp, &n);
+    s->match_at_end = dfa_group_matches(d, tmp, 0, n);
+  }
+
+  s->skippable = d->unanchored && flags == 0 && count == re->mid_start_count &&
+                 memcmp(insts, re->mid_start, sizeof(int) * count) == 0;
+
+  int id = d->count++;
+  d->states[id] = s;
+  d->memory += cost;
+
+  // Keep the table at most half full
+  if (d->count * 2 > d->table_capacity) {
+    int *table = (int*)mem_alloc(sizeof(int) * d->table_capacity * 2);
+    mem_free(d->table);
+    d->table = table;
+    d->table_capacity *= 2;
+    for (int i = 0; i < d->table_capacity; i++) d->table[i] = -1;
+    mask = d->table_capacity - 1;
+    for (int j = 0; j < d->count; j++) {
+      int i = d->states[j]->hash & mask;
+      while (d->table[i] != -1) i = (i + 1) & mask;
+      d->table[i] = j;
+    }
+  } else {
+    int i = hash & mask;
+    while (d->table[i] != -1) i = (i + 1) & mask;
+    d->table[i] = id;
+  }
+  return id;
+}
+
+// Close a freshly built buf[0..*n) of groups: drop everything after the
+// first matching group (later starts lose to it) and note the match.
+static u8 dfa_settle(Dfa *d, int *buf, int *n, u8 flags) {
+  if (*n > 0 && buf[*n - 1] == DFA_MARK) (*n)--;
+  int group = 0;
+  for (int i = 0; i <= *n; i++) {
+    if (i < *n && buf[i] != DFA_MARK) continue;
+    if (dfa_group_matches(d, buf, group, i)) {
+      *n = i;
+      if (d->unanchored) flags |= DFA_MATCHED;
+      break;
+    }
+    group = i + 1;
+  }
+  return flags;
+}
+
+static int dfa_start(Regex *re, Dfa *d, bool at_begin) {
+  int cached = d->start[at_begin];
+  if (cached != -1) return cached;
+
+  int n = 0;
+  re->seen.count = 0;
+  dfa_closure(re, d->prog, &re->seen, 0, at_begin, false, re->buf, &n);
+  qsort(re->buf, n, sizeof(int), compare_int);
+  u8 flags = dfa_settle(d, re->buf, &n, at_begin ? DFA_AT_BEGIN : 0);
+
+  int id = dfa_intern(re, d, n, flags);
+  if (id >= 0) d->start[at_begin] = id;
+  return id;
+}
+
+// Compute and cache the transition of state `sid` on `byte`
+static int dfa_step(Regex *re, Dfa *d, int sid, u8 byte) {
+  DfaState *s = d->states[sid];
+  int *buf = re->buf;
+  int n = 0;
+  u8 flags = s->flags & DFA_MATCHED;
+
+  re->seen.count = 0;
+  int i = 0;
+  while (i < s->count) {
+    int group_start = n;
+    for (; i < s->count && s->insts[i] != DFA_MARK; i++) {
+      RegexInst *inst = &d->prog->code[s->insts[i]];
+      if (inst->op == RE_BYTES && SET_HAS(&re->sets[inst->x], byte)) {
+        dfa_closure(re, d->prog, &re->seen, s->insts[i] + 1, false, false, buf, &n);
+      }
+    }
+    i++;  // Skip the mark
+    if (n > group_start) {
+      qsort(buf + group_start, n - group_start, sizeof(int), compare_int);
+      buf[n++] = DFA_MARK;
+    }
+  }
+
+  if (d->unanchored && !(flags & DFA_MATCHED)) {
+    int group_start = n;
+    dfa_closure(re, d->prog, &re->seen, 0, false, false, buf, &n);
+    qsort(buf + group_start, n - group_start, sizeof(int), compare_int);
+  }
+  flags = dfa_settle(d, buf, &n, flags);
+
+  int generation = d->generation;
+  int nid = dfa_intern(re, d, n, flags);
+  if (nid >= 0 && d->generation == generation) s->next[byte] = nid;
+  return nid;
+}
+
+// ============================================================================
+// Searching
+// ============================================================================
+
+// End of the leftmost-longest match at or after `from`, -1 if none
+static int dfa_search_forward(Regex *re, const u8 *text, int length, int from) {
+  Dfa *d = &re->fwd_dfa;
+  d->flushes = 0;
+
+  int pos = from;
+  if (re->anchored && pos > 0) return -1;
+  if (re->prefix_length > 0 && !re->anchored) {
+    pos = prefix_find(re, text, length, pos);
+    if (pos < 0) return -1;
+  }
+
+  int sid = dfa_start(re, d, pos == 0);
+  if (sid < 0) return DFA_GAVE_UP;
+  int last = d->states[sid]->is_match ? pos : -1;
+
+  while (pos < length) {
+    DfaState *s = d->states[sid];
+    if (s->skippable && re->prefix_length > 0) {
+      int next = prefix_find(re, text, length, pos);
+      if (next < 0) return last;
+      pos = next;
+    }
+
+    int nid = s->next[text[pos]];
+    if (nid == DFA_UNKNOWN) {
+      nid = dfa_step(re, d, sid, text[pos]);
+      if (nid < 0) return DFA_GAVE_UP;
+    }
+    pos++;
+    sid = nid;
+
+    s = d->states[sid];
+    if (s->count == 0) return last;  // Dead
+    if (s->is_match) last = pos;
+  }
+
+  if (d->states[sid]->match_at_end) last = length;
+  return last;
+}
+
+// Smallest start in [limit, end] of a match ending at `end`
+static int dfa_search_reverse(Regex *re, const u8 *text, int length, int end,
+                              int limit) {
+  Dfa *d = &re->rev_dfa;
+  d->flushes = 0;
+
+  int sid = dfa_start(re, d, end == length);
+  if (sid < 0) return DFA_GAVE_UP;
+  int last = d->states[sid]->is_match ? end : -1;
+
+  int pos = end;
+  while (pos > limit) {
+    u8 byte = text[pos - 1];
+    int nid = d->states[sid]->next[byte];
+    if (nid == DFA_UNKNOWN) {
+      nid = dfa_step(re, d, sid, byte);
+      if (nid < 0) return DFA_GAVE_UP;
+    }
+    pos--;
+    sid = nid;
+
+    DfaState *s = d->states[sid];
+    if (s->count == 0) return last;
+    if (s->is_match) last = pos;
+  }
+
+  if (pos == 0 && d->states[sid]->match_at_end) last = 0;
+  return last;
+}
+
+// Pike VM: add the closure of pc as threads starting at `start`
+static void nfa_add(Regex *re, SparseSet *seen, int *pcs, int *starts, int *n,
+                    int pc, int start, int pos, int length) {
+  RegexProg *prog = &re->forward;
+  int top = 0;
+  re->stack[top++] = pc;
+  while (top > 0) {
+    pc = re->stack[--top];
+    if (!sparse_insert(seen, pc)) continue;
+    RegexInst *inst = &prog->code[pc];
+    switch (inst->op) {
+      case RE_JMP:
+        re->stack[top++] = inst->x;
+        break;
+      case RE_SPLIT:
+        re->stack[top++] = inst->y;
+        re->stack[top++] = inst->x;
+        break;
+      case RE_BEGIN:
+        if (pos == 0) re->stack[top++] = pc + 1;
+        break;
+      case RE_END:
+        if (pos == length) re->stack[top++] = pc + 1;
+        break;
+      case RE_BYTES:
+      case RE_MATCH:
+        pcs[*n] = pc;
+        starts[*n] = start;
+        (*n)++;
+        break;
+    }
+  }
+}
+
+// Thompson NFA simulation, used when the DFA cache thrashes
+static bool nfa_search(Regex *re, const u8 *text, int length, int from,
+                       int *match_start, int *match_end) {
+  int *pcs = re->thread_pc[0];
+  int *starts = re->thread_start[0];
+  int *next_pcs = re->thread_pc[1];
+  int *next_starts = re->thread_start[1];
+  int n = 0;
+  bool matched = false;
+  re->seen.count = 0;
+
+  for (int pos = from;; pos++) {
+    if (!matched && !(re->anchored && pos > 0)) {
+      nfa_add(re, &re->seen, pcs, starts, &n, 0, pos, pos, length);
+    }
+
+    // Threads are ordered by start; the first match wins and cuts every
+    // thread that started later
+    for (int i = 0; i < n; i++) {
+      if (re->forward.code[pcs[i]].op != RE_MATCH) continue;
+      *match_start = starts[i];
+      *match_end = pos;
+      matched = true;
+      int keep = i + 1;
+      while (keep < n && starts[keep] == starts[i]) keep++;
+      n = keep;
+      break;
+    }
+
+    if (pos >= length || (n == 0 && (matched || re->anchored))) break;
+
+    int next_n = 0;
+    re->seen.count = 0;
+    for (int i = 0; i < n; i++) {
+      RegexInst *inst = &re->forward.code[pcs[i]];
+      if (inst->op == RE_BYTES && SET_HAS(&re->sets[inst->x], text[pos])) {
+        nfa_add(re, &re->seen, next_pcs, next_starts, &next_n, pcs[i] + 1,
+                starts[i], pos + 1, length);
+      }
+    }
+
+    int *tmp = pcs; pcs = next_pcs; next_pcs = tmp;
+    tmp = starts; starts = next_starts; next_starts = tmp;
+    n = next_n;
+  }
+  return matched;
+}
+
+bool regex_search(Regex *re, const char *text, int length, int from,
+                  int *match_start, int *match_end) {
+  const u8 *bytes = (const u8*)text;
+  if (from > length) return false;
+
+  int end = dfa_search_forward(re, bytes, length, from);
+  if (end == DFA_GAVE_UP) {
+    return nfa_search(re, bytes, length, from, match_start, match_end);
+  }
+  if (end < 0) return false;
+
+  int start = dfa_search_reverse(re, bytes, length, end, from);
+  if (start < 0) {
+    return nfa_search(re, bytes, length, from, match_start, match_end);
+  }
+
+  *match_start = start;
+  *match_end = end;
+  return true;
+}
+
+// ============================================================================
+// Compile / free
+// ============================================================================
+
+Regex *regex_compile(const char *pattern, int length, const char **error) {
+  RegexParser p;
+  memset(&p, 0, sizeof(p));
+  p.src = pattern;
+  p.length = length;
+  *error = NULL;
+
+  if (length >= 4 && memcmp(pattern, "(?i)", 4) == 0) {
+    p.fold_case = true;
+    p.pos = 4;
+  }
+
+  int root = parse_alt(&p);
+  if (root >= 0 && p.pos < p.length) {
+    p.error = "unmatched ')'";
+  }
+  if (p.error != NULL) {
+    *error = p.error;
+    mem_free(p.nodes);
+    mem_free(p.sets);
+    return NULL;
+  }
+
+  Regex *re = (Regex*)mem_alloc(sizeof(Regex));
+  memset(re, 0, sizeof(Regex));
+  re->sets = p.sets;
+  re->set_count = p.set_count;
+
+  if (!compile_program(&p, root, &re->forward, false, error) ||
+      !compile_program(&p, root, &re->reverse, true, error)) {
+    mem_free(p.nodes);
+    mem_free(re->forward.code);
+    mem_free(re->reverse.code);
+    mem_free(re->sets);
+    mem_free(re);
+    return NULL;
+  }
+
+  re->anchored = starts_with_bol(&p, root);
+  collect_prefix(&p, root, re);  // Stops at the first non-literal
+  mem_free(p.nodes);
+
+  // Scratch space: a state holds each pc at most once, plus one mark per
+  // group, and the match_at_end check reuses the tail of buf
+  re->max_code = MAX(re->forward.count, re->reverse.count);
+  int n = re->max_code;
+  sparse_init(&re->seen, n);
+  sparse_init(&re->seen2, n);
+  re->stack = (int*)mem_alloc(sizeof(int) * (n * 2 + 2));
+  re->buf = (int*)mem_alloc(sizeof(int) * (n * 3 + 1));
+  for (int i = 0; i < 2; i++) {
+    re->thread_pc[i] = (int*)mem_alloc(sizeof(int) * n);
+    re->thread_start[i] = (int*)mem_alloc(sizeof(int) * n);
+  }
+
+  dfa_init(&re->fwd_dfa, &re->forward, true);
+  dfa_init(&re->rev_dfa, &re->reverse, false);
+
+  // The forward start closure away from offset 0: a state equal to it has
+  // nothing in flight, so the prefilter can skip ahead
+  int count = 0;
+  re->seen.count = 0;
+  dfa_closure(re, &re->forward, &re->seen, 0, false, false, re->buf, &count);
+  qsort(re->buf, count, sizeof(int), compare_int);
+  re->mid_start = (int*)mem_alloc(sizeof(int) * (count > 0 ? count : 1));
+  memcpy(re->mid_start, re->buf, sizeof(int) * count);
+  re->mid_start_count = count;
+
+  re->pattern = (char*)mem_alloc(length + 1);
+  memcpy(re->pattern, pattern, length);
+  re->pattern[length] = '\0';
+  re->pattern_length = length;
+  return re;
+}
+
+void regex_free(Regex *re) {
+  if (re == NULL) return;
+  dfa_free(&re->fwd_dfa);
+  dfa_free(&re->rev_dfa);
+  mem_free(re->forward.code);
+  mem_free(re->reverse.code);
+  mem_free(re->sets);
+  sparse_free(&re->seen);
+  sparse_free(&re->seen2);
+  mem_free(re->stack);
+  mem_free(re->buf);
+  mem_free(re->mid_start);
+  for (int i = 0; i < 2; i++) {
+    mem_free(re->thread_pc[i]);
+    mem_free(re->thread_start[i]);
+  }
+  mem_free(re->pattern);
+  mem_free(re);
+}
+
+// ============================================================================
+// Natives
+// ============================================================================
+
+static void regex_release(void *data) {
+  regex_free((Regex*)data);
+}
+
+static const ForeignType regex_type = {"regex", regex_release, NULL, NULL};
+
+// Shared argument check for (regex, string) natives
+static Regex *regex_args(const char *name, int arg_count, Value *args,
+                         const char **text, int *length) {
+  if (arg_count != 2) {
+    fprintf(stderr, "Error: %s expects 2 arguments, got %d\n", name, arg_count);
+    return NULL;
+  }
+  if (!IS_FOREIGN(args[0], &regex_type)) {
+    fprintf(stderr, "Error: %s expects a compiled regex\n", name);
+    return NULL;
+  }
+  if (!value_get_string(&args[1], text, length)) {
+    fprintf(stderr, "Error: %s expects string argument\n", name);
+    return NULL;
+  }
+  return (Regex*)AS_FOREIGN_DATA(args[0]);
+}
+
+bool regex_value_pattern(Value value, const char **pattern, int *length) {
+  if (!IS_FOREIGN(value, &regex_type)) return false;
+  Regex *re = (Regex*)AS_FOREIGN_DATA(value);
+  *pattern = re->pattern;
+  *length = re->pattern_length;
+  return true;
+}
+
+Value regex_value(const char *pattern, int length, const char **error) {
+  Regex *re = regex_compile(pattern, length, error);
+  if (re == NULL) return value_make_nil();
+  return OBJ_VAL(foreign_make(&regex_type, re));
+}
+
+// regex.compile - Compile a pattern once for reuse
+Value native_regex_compile(int arg_count, Value *args) {
+  const char *pattern;
+  int length;
+  if (arg_count != 1) {
+    fprintf(stderr, "Error: compile expects 1 argument, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  if (!value_get_string(&args[0], &pattern, &length)) {
+    fprintf(stderr, "Error: compile expects string argument\n");
+    return value_make_nil();
+  }
+
+  const char *error;
+  Value re = regex_value(pattern, length, &error);
+  if (IS_NIL(re)) {
+    fprintf(stderr, "Error: invalid regex '%.*s': %s\n", length, pattern, error);
+  }
+  return re;
+}
+
+// regex.is_match - Does the pattern occur anywhere in the text?
+Value native_regex_is_match(int arg_count, Value *args) {
+  const char *text;
+  int length, start, end;
+  Regex *re = regex_args("is_match", arg_count, args, &text, &length);
+  if (re == NULL) return value_make_nil();
+  return value_make_bool(regex_search(re, text, length, 0, &start, &end));
+}
+
+// regex.find - First (leftmost-longest) match, or nil
+Value native_regex_find(int arg_count, Value *args) {
+  const char *text;
+  int length, start, end;
+  Regex *re = regex_args("find", arg_count, args, &text, &length);
+  if (re == NULL || !regex_search(re, text, length, 0, &start, &end)) {
+    return value_make_nil();
+  }
+  return OBJ_VAL(string_copy(text + start, end - start));
+}
+
+// Cursor over non-overlapping matches
+typedef struct {
+  int from;
+  int prev_end;
+} MatchCursor;
+
+// Advance to the next match. An empty match right where the previous match
+// ended is skipped.
+static bool regex_next(Regex *re, const char *text, int length,
+                       MatchCursor *cursor, int *start, int *end) {
+  while (cursor->from <= length &&
+         regex_search(re, text, length, cursor->from, start, end)) {
+    cursor->from = *end == *start ? *end + 1 : *end;
+    if (*start == *end && *start == cursor->prev_end) continue;
+    cursor->prev_end = *end;
+    return true;
+  }
+  return false;
+}
+
+// regex.find_all - Every match, as slices of the input (no copies)
+Value native_regex_find_all(int arg_count, Value *args) {
+  const char *text;
+  int length, start, end;
+  Regex *re = regex_args("find_all", arg_count, args, &text, &length);
+  if (re == NULL) return value_make_nil();
+
+  // Slices borrow from a string object; plain strings are lifted into one
+  // once so every match can point into it
+  ObjString *base = IS_OBJ_STRING(args[1]) ? AS_OBJ_STRING(args[1])
+                                           : string_copy(text, length);
+  ObjArray *matches = array_make(0);
+  MatchCursor cursor = {0, -1};
+  while (regex_next(re, base->chars, length, &cursor, &start, &end)) {
+    array_push(matches, OBJ_VAL(string_slice(base, start, end - start)));
+  }
+  return OBJ_VAL(matches);
+}
+
+// regex.count - Number of non-overlapping matches
+Value native_regex_count(int arg_count, Value *args) {
+  const char *text;
+  int length, start, end;
+  Regex *re = regex_args("count", arg_count, args, &text, &length);
+  if (re == NULL) return value_make_nil();
+
+  i64 count = 0;
+  MatchCursor cursor = {0, -1};
+  while (regex_next(re, text, length, &cursor, &start, &end)) {
+    count++;
+  }
+  return value_make_int(count);
+}
+
+// Module initialization
+void regex_module_init(VM *vm) {
+  module_register_native(vm, "regex.compile", native_regex_compile);
+  module_register_native(vm, "regex.is_match", native_regex_is_match);
+  module_register_native(vm, "regex.find", native_regex_find);
+  module_register_native(vm, "regex.find_all", native_regex_find_all);
+  module_register_native(vm, "regex.count", native_regex_count);
+}
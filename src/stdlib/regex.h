@@ -0,0 +1,37 @@
+// src/stdlib/regex.h - Regular expression module interface
+
+#ifndef SATORI_STDLIB_REGEX_H
+#define SATORI_STDLIB_REGEX_H
+
+#include "core/value.h"
+#include "runtime/vm.h"
+
+// Compiled pattern (opaque)
+typedef struct Regex Regex;
+
+// C API, shared by the natives and by benchmarks/tests.
+// regex_compile returns NULL and sets *error on a bad pattern.
+Regex *regex_compile(const char *pattern, int length, const char **error);
+void regex_free(Regex *re);
+
+// Leftmost-longest match starting at or after `from`
+bool regex_search(Regex *re, const char *text, int length, int from,
+                  int *match_start, int *match_end);
+
+// A compiled regex as a script value (nil with *error set on a bad
+// pattern), and the pattern such a value was compiled from, which is how
+// bundles store one. regex_value_pattern is false for any other value.
+Value regex_value(const char *pattern, int length, const char **error);
+bool regex_value_pattern(Value value, const char **pattern, int *length);
+
+// Module initialization
+void regex_module_init(VM *vm);
+
+// Native functions
+Value native_regex_compile(int arg_count, Value *args);
+Value native_regex_is_match(int arg_count, Value *args);
+Value native_regex_find(int arg_count, Value *args);
+Value native_regex_find_all(int arg_count, Value *args);
+Value native_regex_count(int arg_count, Value *args);
+
+#endif // SATORI_STDLIB_REGEX_H
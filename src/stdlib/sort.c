@@ -0,0 +1,584 @@
+// src/stdlib/sort.c - Sort module implementation
+//
+// Sorting never calls back into the VM. Elements (or keys extracted from
+// them) are turned into plain C keys once, sorted natively, and the result
+// is applied as a permutation:
+//
+//   - Numbers become order-preserving u64 keys and are LSD radix sorted,
+//     one byte per pass. Passes where every key has the same byte are
+//     skipped, so small ranges cost only a few passes. Radix sort is
+//     stable by construction.
+//   - Strings are sorted with pattern-defeating quicksort (pdqsort):
+//     median-of-3 / ninther pivots, insertion sort for small slices, a
+//     cheap check for already-sorted input, and a heapsort fallback after
+//     too many unbalanced partitions. A stable sort breaks ties on the
+//     original index, which makes every key distinct.
+//
+// Packed arrays are sorted in place without any index bookkeeping.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "sort.h"
+#include "runtime/module.h"
+#include "core/memory.h"
+#include "core/object.h"
+#include <stdio.h>
+#include <string.h>
+
+#define RADIX_MIN 64          // Shorter inputs use insertion sort
+#define PDQ_INSERTION 24      // Slices up to this size use insertion sort
+#define PDQ_NINTHER 128       // Larger slices pick the pivot by ninther
+#define PDQ_PARTIAL_LIMIT 8   // Moves allowed before giving up on "sorted"
+
+// ============================================================================
+// Radix sort
+// ============================================================================
+
+typedef struct {
+  u64 key;
+  u32 index;
+} SortPair;
+
+static inline u64 int_key(i64 value) {
+  return (u64)value ^ (1ull << 63);
+}
+
+static inline i64 int_from_key(u64 key) {
+  return (i64)(key ^ (1ull << 63));
+}
+
+// Flip negatives entirely and positives' sign bit, so that unsigned order
+// matches numeric order. All NaNs map to the largest key.
+static inline u64 float_key(f64 value) {
+  if (value != value) return ~0ull;
+  u64 bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits >> 63 ? ~bits : bits | (1ull << 63);
+}
+
+static inline f64 float_from_key(u64 key) {
+  u64 bits = key >> 63 ? key & ~(1ull << 63) : ~key;
+  f64 value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// Byte histograms for all eight passes in one read of the input
+typedef size_t RadixCounts[8][256];
+
+static void radix_offsets(size_t *counts) {
+  size_t total = 0;
+  for (int b = 0; b < 256; b++) {
+    size_t n = counts[b];
+    counts[b] = total;
+    total += n;
+  }
+}
+
+static void radix_sort_keys(u64 *keys, int count) {
+  if (count < RADIX_MIN) {
+    for (int i = 1; i < count; i++) {
+      u64 key = keys[i];
+      int j = i;
+      for (; j > 0 && keys[j - 1] > key; j--) keys[j] = keys[j - 1];
+      keys[j] = key;
+    }
+    return;
+  }
+
+  RadixCounts counts;
+  memset(counts, 0, sizeof(counts));
+  for (int i = 0; i < count; i++) {
+    u64 key = keys[i];
+    for (int pass = 0; pass < 8; pass++) counts[pass][(key >> (8 * pass)) & 0xFF]++;
+  }
+
+  u64 *scratch = mem_alloc(sizeof(u64) * count);
+  u64 *src = keys, *dst = scratch;
+  for (int pass = 0; pass < 8; pass++) {
+    int shift = 8 * pass;
+    if (counts[pass][(src[0] >> shift) & 0xFF] == (size_t)count) continue;
+    radix_offsets(counts[pass]);
+    for (int i = 0; i < count; i++) {
+      dst[counts[pass][(src[i] >> shift) & 0xFF]++] = src[i];
+    }
+    u64 *swap = src;
+    src = dst;
+    dst = swap;
+  }
+  if (src != keys) memcpy(keys, src, sizeof(u64) * count);
+  mem_free(scratch);
+}
+
+static void radix_sort_pairs(SortPair *pairs, int count) {
+  if (count < RADIX_MIN) {
+    for (int i = 1; i < count; i++) {
+      SortPair pair = pairs[i];
+      int j = i;
+      for (; j > 0 && pairs[j - 1].key > pair.key; j--) pairs[j] = pairs[j - 1];
+      pairs[j] = pair;
+    }
+    return;
+  }
+
+  RadixCounts counts;
+  memset(counts, 0, sizeof(counts));
+  for (int i = 0; i < count; i++) {
+    u64 key = pairs[i].key;
+    for (int pass = 0; pass < 8; pass++) counts[pass][(key >> (8 * pass)) & 0xFF]++;
+  }
+
+  SortPair *scratch = mem_alloc(sizeof(SortPair) * count);
+  SortPair *src = pairs, *dst = scratch;
+  for (int pass = 0; pass < 8; pass++) {
+    int shift = 8 * pass;
+    if (counts[pass][(src[0].key >> shift) & 0xFF] == (size_t)count) continue;
+    radix_offsets(counts[pass]);
+    for (int i = 0; i < count; i++) {
+      dst[counts[pass][(src[i].key >> shift) & 0xFF]++] = src[i];
+    }
+    SortPair *swap = src;
+    src = dst;
+    dst = swap;
+  }
+  if (src != pairs) memcpy(pairs, src, sizeof(SortPair) * count);
+  mem_free(scratch);
+}
+
+void sort_ints(i64 *data, int count) {
+  u64 *keys = (u64*)data;
+  for (int i = 0; i < count; i++) keys[i] = int_key(data[i]);
+  radix_sort_keys(keys, count);
+  for (int i = 0; i < count; i++) data[i] = int_from_key(keys[i]);
+}
+
+void sort_floats(f64 *data, int count) {
+  u64 *keys = mem_alloc(sizeof(u64) * (count > 0 ? count : 1));
+  for (int i = 0; i < count; i++) keys[i] = float_key(data[i]);
+  radix_sort_keys(keys, count);
+  for (int i = 0; i < count; i++) data[i] = float_from_key(keys[i]);
+  mem_free(keys);
+}
+
+// ============================================================================
+// Pattern-defeating quicksort (strings)
+// ============================================================================
+
+typedef struct {
+  const char *chars;
+  int length;
+  u32 index;
+} StrKey;
+
+static inline bool str_less(const StrKey *a, const StrKey *b, bool stable) {
+  int n = a->length < b->length ? a->length : b->length;
+  int c = memcmp(a->chars, b->chars, n);
+  if (c != 0) return c < 0;
+  if (a->length != b->length) return a->length < b->length;
+  return stable && a->index < b->index;
+}
+
+static inline void str_swap(StrKey *a, StrKey *b) {
+  StrKey t = *a;
+  *a = *b;
+  *b = t;
+}
+
+static inline void sort2(StrKey *a, StrKey *b, bool stable) {
+  if (str_less(b, a, stable)) str_swap(a, b);
+}
+
+static inline void sort3(StrKey *a, StrKey *b, StrKey *c, bool stable) {
+  sort2(a, b, stable);
+  sort2(b, c, stable);
+  sort2(a, b, stable);
+}
+
+static void insertion_sort(StrKey *begin, StrKey *end, bool stable) {
+  if (begin == end) return;
+  for (StrKey *cur = begin + 1; cur != end; cur++) {
+    if (str_less(cur, cur - 1, stable)) {
+      StrKey tmp = *cur;
+      StrKey *sift = cur;
+      do {
+        *sift = *(sift - 1);
+        sift--;
+      } while (sift != begin && str_less(&tmp, sift - 1, stable));
+      *sift = tmp;
+    }
+  }
+}
+
+// Insertion sort that relies on begin[-1] being no greater than any element
+static void unguarded_insertion_sort(StrKey *begin, StrKey *end, bool stable) {
+  if (begin == end) return;
+  for (StrKey *cur = begin + 1; cur != end; cur++) {
+    if (str_less(cur, cur - 1, stable)) {
+      StrKey tmp = *cur;
+      StrKey *sift = cur;
+      do {
+        *sift = *(sift - 1);
+        sift--;
+      } while (str_less(&tmp, sift - 1, stable));
+      *sift = tmp;
+    }
+  }
+}
+
+// Insertion sort that gives up once it has moved too many elements.
+// Returns true if the slice ended up sorted.
+static bool partial_insertion_sort(StrKey *begin, StrKey *end, bool stable) {
+  if (begin == end) return true;
+  long moved = 0;
+  for (StrKey *cur = begin + 1; cur != end; cur++) {
+    if (str_less(cur, cur - 1, stable)) {
+      StrKey tmp = *cur;
+      StrKey *sift = cur;
+      do {
+        *sift = *(sift - 1);
+        sift--;
+      } while (sift != begin && str_less(&tmp, sift - 1, stable));
+      *sift = tmp;
+      moved += cur - sift;
+      if (moved > PDQ_PARTIAL_LIMIT) return false;
+    }
+  }
+  return true;
+}
+
+static void sift_down(StrKey *heap, long root, long count, bool stable) {
+  for (;;) {
+    long child = 2 * root + 1;
+    if (child >= count) return;
+    if (child + 1 < count && str_less(&heap[child], &heap[child + 1], stable)) child++;
+    if (!str_less(&heap[root], &heap[child], stable)) return;
+    str_swap(&heap[root], &heap[child]);
+    root = child;
+  }
+}
+
+static void heap_sort(StrKey *begin, StrKey *end, bool stable) {
+  long count = end - begin;
+  for (long i = count / 2 - 1; i >= 0; i--) sift_down(begin, i, count, stable);
+  for (long i = count - 1; i > 0; i--) {
+    str_swap(&begin[0], &begin[i]);
+    sift_down(begin, 0, i, stable);
+  }
+}
+
+// Partition around *begin, with elements equal to the pivot going right.
+// Sets *already_partitioned if no swaps were needed.
+static StrKey *partition_right(StrKey *begin, StrKey *end, bool stable,
+                               bool *already_partitioned) {
+  StrKey pivot = *begin;
+  StrKey *first = begin;
+  StrKey *last = end;
+
+  // The median-of-3 guarantees an element >= pivot at the end, and a
+  // non-leftmost slice has one <= pivot before it
+  while (str_less(++first, &pivot, stable));
+  if (first - 1 == begin) {
+    while (first < last && !str_less(--last, &pivot, stable));
+  } else {
+    while (!str_less(--last, &pivot, stable));
+  }
+
+  *already_partitioned = first >= last;
+  while (first < last) {
+    str_swap(first, last);
+    while (str_less(++first, &pivot, stable));
+    while (!str_less(--last, &pivot, stable));
+  }
+
+  StrKey *pivot_pos = first - 1;
+  *begin = *pivot_pos;
+  *pivot_pos = pivot;
+  return pivot_pos;
+}
+
+// Partition with elements equal to the pivot going left. Used when the
+// pivot equals the element before the slice, which puts a whole run of
+// equal keys in place at once.
+static StrKey *partition_left(StrKey *begin, StrKey *end, bool stable) {
+  StrKey pivot = *begin;
+  StrKey *first = begin;
+  StrKey *last = end;
+
+  while (str_less(&pivot, --last, stable));
+  if (last + 1 == end) {
+    while (first < last && !str_less(&pivot, ++first, stable));
+  } else {
+    while (!str_less(&pivot, ++first, stable));
+  }
+
+  while (first < last) {
+    str_swap(first, last);
+    while (str_less(&pivot, --last, stable));
+    while (!str_less(&pivot, ++first, stable));
+  }
+
+  *begin = *last;
+  *last = pivot;
+  return last;
+}
+
+static void pdq_loop(StrKey *begin, StrKey *end, int bad_allowed, bool leftmost, bool stable) {
+  for (;;) {
+    long size = end - begin;
+    if (size < PDQ_INSERTION) {
+      if (leftmost) {
+        insertion_sort(begin, end, stable);
+      } else {
+        unguarded_insertion_sort(begin, end, stable);
+      }
+      return;
+    }
+
+    long half = size / 2;
+    if (size > PDQ_NINTHER) {
+      sort3(begin, begin + half, end - 1, stable);
+      sort3(begin + 1, begin + (half - 1), end - 2, stable);
+      sort3(begin + 2, begin + (half + 1), end - 3, stable);
+      sort3(begin + (half - 1), begin + half, begin + (half + 1), stable);
+      str_swap(begin, begin + half);
+    } else {
+      sort3(begin + half, begin, end - 1, stable);
+    }
+
+    if (!leftmost && !str_less(begin - 1, begin, stable)) {
+      begin = partition_left(begin, end, stable) + 1;
+      continue;
+    }
+
+    bool already_partitioned;
+    StrKey *pivot_pos = partition_right(begin, end, stable, &already_partitioned);
+    long left_size = pivot_pos - begin;
+    long right_size = end - (pivot_pos + 1);
+
+    if (left_size < size / 8 || right_size < size / 8) {
+      // Unbalanced: shuffle a few elements to break up the pattern, and
+      // fall back to heapsort if that keeps happening
+      if (--bad_allowed == 0) {
+        heap_sort(begin, end, stable);
+        return;
+      }
+      if (left_size >= PDQ_INSERTION) {
+        str_swap(begin, begin + left_size / 4);
+        str_swap(pivot_pos - 1, pivot_pos - left_size / 4);
+        if (left_size > PDQ_NINTHER) {
+          str_swap(begin + 1, begin + (left_size / 4 + 1));
+          str_swap(begin + 2, begin + (left_size / 4 + 2));
+          str_swap(pivot_pos - 2, pivot_pos - (left_size / 4 + 1));
+          str_swap(pivot_pos - 3, pivot_pos - (left_size / 4 + 2));
+        }
+      }
+      if (right_size >= PDQ_INSERTION) {
+        str_swap(pivot_pos + 1, pivot_pos + (1 + right_size / 4));
+        str_swap(end - 1, end - right_size / 4);
+        if (right_size > PDQ_NINTHER) {
+          str_swap(pivot_pos + 2, pivot_pos + (2 + right_size / 4));
+          str_swap(pivot_pos + 3, pivot_pos + (3 + right_size / 4));
+          str_swap(end - 2, end - (1 + right_size / 4));
+          str_swap(end - 3, end - (2 + right_size / 4));
+        }
+      }
+    } else if (already_partitioned &&
+               partial_insertion_sort(begin, pivot_pos, stable) &&
+               partial_insertion_sort(pivot_pos + 1, end, stable)) {
+      return;
+    }
+
+    // Recurse into the left part, loop on the right
+    pdq_loop(begin, pivot_pos, bad_allowed, leftmost, stable);
+    begin = pivot_pos + 1;
+    leftmost = false;
+  }
+}
+
+static void pdqsort(StrKey *keys, int count, bool stable) {
+  int log2 = 0;
+  while ((count >> log2) > 1) log2++;
+  pdq_loop(keys, keys + count, log2 + 1, true, stable);
+}
+
+// ============================================================================
+// Sort orders
+// ============================================================================
+
+bool sort_order(const Value *keys, int count, bool stable, u32 *order) {
+  if (count == 0) return true;
+
+  const char *chars;
+  int length;
+  if (IS_NUMBER(keys[0])) {
+    bool all_ints = true;
+    for (int i = 0; i < count; i++) {
+      if (!IS_NUMBER(keys[i])) return false;
+      all_ints = all_ints && IS_INT(keys[i]);
+    }
+
+    // Mixed ints and floats compare as floats
+    SortPair *pairs = mem_alloc(sizeof(SortPair) * count);
+    for (int i = 0; i < count; i++) {
+      pairs[i].key = all_ints ? int_key(AS_INT(keys[i])) : float_key(value_to_float(keys[i]));
+      pairs[i].index = (u32)i;
+    }
+    radix_sort_pairs(pairs, count);
+    for (int i = 0; i < count; i++) order[i] = pairs[i].index;
+    mem_free(pairs);
+    return true;
+  }
+
+  if (!value_get_string(&keys[0], &chars, &length)) return false;
+  StrKey *strs = mem_alloc(sizeof(StrKey) * count);
+  for (int i = 0; i < count; i++) {
+    if (!value_get_string(&keys[i], &strs[i].chars, &strs[i].length)) {
+      mem_free(strs);
+      return false;
+    }
+    strs[i].index = (u32)i;
+  }
+  pdqsort(strs, count, stable);
+  for (int i = 0; i < count; i++) order[i] = strs[i].index;
+  mem_free(strs);
+  return true;
+}
+
+// Reorder an array or packed array so that element i is old element order[i]
+static void apply_order(Object *target, const u32 *order, int count) {
+  if (count == 0) return;
+  if (target->type == OBJ_ARRAY) {
+    ObjArray *array = (ObjArray*)target;
+    Value *items = mem_alloc(sizeof(Value) * count);
+    for (int i = 0; i < count; i++) items[i] = array->items[order[i]];
+    memcpy(array->items, items, sizeof(Value) * count);
+    mem_free(items);
+    return;
+  }
+
+  ObjPacked *packed = (ObjPacked*)target;
+  if (packed->element == PACKED_INT) {
+    i64 *ints = mem_alloc(sizeof(i64) * count);
+    for (int i = 0; i < count; i++) ints[i] = packed->as.ints[order[i]];
+    memcpy(packed->as.ints, ints, sizeof(i64) * count);
+    mem_free(ints);
+  } else {
+    f64 *floats = mem_alloc(sizeof(f64) * count);
+    for (int i = 0; i < count; i++) floats[i] = packed->as.floats[order[i]];
+    memcpy(packed->as.floats, floats, sizeof(f64) * count);
+    mem_free(floats);
+  }
+}
+
+// ============================================================================
+// Natives
+// ============================================================================
+
+// sort.sort - Sort an array in place and return it
+Value native_sort_sort(int arg_count, Value *args) {
+  if (arg_count < 1 || arg_count > 2) {
+    fprintf(stderr, "Error: sort expects 1 or 2 arguments, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  if (arg_count == 2 && !IS_BOOL(args[1])) {
+    fprintf(stderr, "Error: sort expects a bool for 'stable'\n");
+    return value_make_nil();
+  }
+  bool stable = arg_count == 2 && AS_BOOL(args[1]);
+
+  if (IS_OBJ_PACKED(args[0])) {
+    ObjPacked *packed = AS_OBJ_PACKED(args[0]);
+    if (packed->element == PACKED_INT) {
+      sort_ints(packed->as.ints, packed->count);
+    } else {
+      sort_floats(packed->as.floats, packed->count);
+    }
+    return args[0];
+  }
+  if (!IS_OBJ_ARRAY(args[0])) {
+    fprintf(stderr, "Error: sort expects an array\n");
+    return value_make_nil();
+  }
+
+  ObjArray *array = AS_OBJ_ARRAY(args[0]);
+  u32 *order = mem_alloc(sizeof(u32) * (array->count > 0 ? array->count : 1));
+  if (!sort_order(array->items, array->count, stable, order)) {
+    fprintf(stderr, "Error: sort expects all numbers or all strings\n");
+    mem_free(order);
+    return value_make_nil();
+  }
+  apply_order(AS_OBJ(args[0]), order, array->count);
+  mem_free(order);
+  return args[0];
+}
+
+// Keys for sort_by_key: a parallel array, or a column of an array of rows
+static Value *extract_keys(Value array, Value key, int count) {
+  Value *keys = mem_alloc(sizeof(Value) * (count > 0 ? count : 1));
+
+  if (IS_INT(key)) {
+    i64 column = AS_INT(key);
+    ObjArray *rows = IS_OBJ_ARRAY(array) ? AS_OBJ_ARRAY(array) : NULL;
+    for (int i = 0; i < count; i++) {
+      Value row = rows != NULL ? rows->items[i] : value_make_nil();
+      if (!IS_OBJ_ARRAY(row) || column < 0 || column >= AS_OBJ_ARRAY(row)->count) {
+        fprintf(stderr, "Error: sort_by_key: element %d has no column %lld\n", i, (long long)column);
+        mem_free(keys);
+        return NULL;
+      }
+      keys[i] = AS_OBJ_ARRAY(row)->items[column];
+    }
+    return keys;
+  }
+
+  if (IS_OBJ_ARRAY(key) && AS_OBJ_ARRAY(key)->count == count) {
+    memcpy(keys, AS_OBJ_ARRAY(key)->items, sizeof(Value) * count);
+    return keys;
+  }
+  if (IS_OBJ_PACKED(key) && AS_OBJ_PACKED(key)->count == count) {
+    ObjPacked *packed = AS_OBJ_PACKED(key);
+    for (int i = 0; i < count; i++) {
+      keys[i] = packed->element == PACKED_INT ? value_make_int(packed->as.ints[i])
+                                              : value_make_float(packed->as.floats[i]);
+    }
+    return keys;
+  }
+
+  fprintf(stderr, "Error: sort_by_key expects a column index or one key per element\n");
+  mem_free(keys);
+  return NULL;
+}
+
+// sort.sort_by_key - Stable sort of an array by precomputed keys
+Value native_sort_sort_by_key(int arg_count, Value *args) {
+  if (arg_count != 2) {
+    fprintf(stderr, "Error: sort_by_key expects 2 arguments, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  if (!IS_OBJ_ARRAY(args[0]) && !IS_OBJ_PACKED(args[0])) {
+    fprintf(stderr, "Error: sort_by_key expects an array\n");
+    return value_make_nil();
+  }
+
+  int count = IS_OBJ_ARRAY(args[0]) ? AS_OBJ_ARRAY(args[0])->count
+                                    : AS_OBJ_PACKED(args[0])->count;
+  Value *keys = extract_keys(args[0], args[1], count);
+  if (keys == NULL) return value_make_nil();
+
+  u32 *order = mem_alloc(sizeof(u32) * (count > 0 ? count : 1));
+  bool ok = sort_order(keys, count, true, order);
+  if (ok) {
+    apply_order(AS_OBJ(args[0]), order, count);
+  } else {
+    fprintf(stderr, "Error: sort_by_key expects all numbers or all strings as keys\n");
+  }
+  mem_free(order);
+  mem_free(keys);
+  return ok ? args[0] : value_make_nil();
+}
+
+// Module initialization
+void sort_module_init(VM *vm) {
+  module_register_native(vm, "sort.sort", native_sort_sort);
+  module_register_native(vm, "sort.sort_by_key", native_sort_sort_by_key);
+}
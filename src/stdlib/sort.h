@@ -0,0 +1,26 @@
+// src/stdlib/sort.h - Sort module interface
+
+#ifndef SATORI_STDLIB_SORT_H
+#define SATORI_STDLIB_SORT_H
+
+#include "core/value.h"
+#include "runtime/vm.h"
+
+// C API. Numbers are radix sorted (NaNs last); strings use pattern-defeating
+// quicksort on their bytes.
+void sort_ints(i64 *data, int count);
+void sort_floats(f64 *data, int count);
+
+// Fill order[0..count) with the indices of `keys` in ascending order. Keys
+// must be all numbers or all strings; returns false otherwise. Numbers
+// always sort stably; strings only if `stable` is set.
+bool sort_order(const Value *keys, int count, bool stable, u32 *order);
+
+// Module initialization
+void sort_module_init(VM *vm);
+
+// Native functions
+Value native_sort_sort(int arg_count, Value *args);
+Value native_sort_sort_by_key(int arg_count, Value *args);
+
+#endif // SATORI_STDLIB_SORT_H
@@ -6,12 +6,28 @@
 
 #include "string.h"
 #include "runtime/module.h"
+#include "core/memory.h"
+#include "core/object.h"
+#include "core/utf8.h"
 #include "core/value.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
 
+// Case-converted copy: short results stay inside the Value, longer ones
+// become a string object the collector tracks, as built strings do
+static Value convert_case(const char *input, int length, int (*convert)(int)) {
+  char short_buffer[VALUE_SHORT_MAX + 1];
+  char *buffer = length <= VALUE_SHORT_MAX ? short_buffer : mem_alloc(length + 1);
+  for (int i = 0; i < length; i++) {
+    buffer[i] = (char)convert((unsigned char)input[i]);
+  }
+  buffer[length] = '\0';
+  return buffer == short_buffer ? value_copy_string(buffer, length)
+                                : OBJ_VAL(string_take(buffer, length));
+}
+
 // string.to_upper - Convert string to uppercase
 Value native_string_to_upper(int arg_count, Value *args) {
   if (arg_count != 1) {
@@ -19,24 +35,14 @@ Value native_string_to_upper(int arg_count, Value *args) {
     return value_make_nil();
   }
   
-  if (!IS_STRING(args[0])) {
+  const char *input;
+  int length;
+  if (!value_get_string(&args[0], &input, &length)) {
     fprintf(stderr, "Error: to_upper expects string argument\n");
     return value_make_nil();
   }
   
-  const char *input = AS_STRING(args[0]);
-  int len = strlen(input);
-  char *result = malloc(len + 1);
-  
-  for (int i = 0; i < len; i++) {
-    result[i] = toupper((unsigned char)input[i]);
-  }
-  result[len] = '\0';
-  
-  Value str_val = value_make_string(result);
-  free(result);  // value_make_string does strdup
-  
-  return str_val;
+  return convert_case(input, length, toupper);
 }
 
 // string.to_lower - Convert string to lowercase
@@ -46,28 +52,118 @@ Value native_string_to_lower(int arg_count, Value *args) {
     return value_make_nil();
   }
   
-  if (!IS_STRING(args[0])) {
+  const char *input;
+  int length;
+  if (!value_get_string(&args[0], &input, &length)) {
     fprintf(stderr, "Error: to_lower expects string argument\n");
     return value_make_nil();
   }
   
-  const char *input = AS_STRING(args[0]);
-  int len = strlen(input);
-  char *result = malloc(len + 1);
-  
-  for (int i = 0; i < len; i++) {
-    result[i] = tolower((unsigned char)input[i]);
+  return convert_case(input, length, tolower);
+}
+
+// String argument as a string object, so its code-point index is cached
+// across calls. Long literals are objects already; short strings, and long
+// ones borrowed from a bundle, are lifted into a new object.
+static ObjString *string_object_arg(const char *name, Value arg) {
+  const char *chars;
+  int length;
+  if (!value_get_string(&arg, &chars, &length)) {
+    fprintf(stderr, "Error: %s expects string argument\n", name);
+    return NULL;
   }
-  result[len] = '\0';
-  
-  Value str_val = value_make_string(result);
-  free(result);
-  
-  return str_val;
+  return IS_OBJ_STRING(arg) ? AS_OBJ_STRING(arg) : string_copy(chars, length);
+}
+
+// string.is_utf8 - Check that bytes are well-formed UTF-8
+Value native_string_is_utf8(int arg_count, Value *args) {
+  const char *chars;
+  int length;
+  if (arg_count != 1) {
+    fprintf(stderr, "Error: is_utf8 expects 1 argument, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  if (!value_get_string(&args[0], &chars, &length)) {
+    fprintf(stderr, "Error: is_utf8 expects string argument\n");
+    return value_make_nil();
+  }
+  return value_make_bool(utf8_validate(chars, length));
+}
+
+// string.from_bytes - Accept raw bytes as text if they are valid UTF-8
+Value native_string_from_bytes(int arg_count, Value *args) {
+  const char *chars;
+  int length;
+  if (arg_count != 1) {
+    fprintf(stderr, "Error: from_bytes expects 1 argument, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  if (!value_get_string(&args[0], &chars, &length)) {
+    fprintf(stderr, "Error: from_bytes expects string argument\n");
+    return value_make_nil();
+  }
+  if (!utf8_validate(chars, length)) {
+    fprintf(stderr, "Error: from_bytes: invalid UTF-8\n");
+    return value_make_nil();
+  }
+  return args[0];
+}
+
+// string.char_count - Number of code points
+Value native_string_char_count(int arg_count, Value *args) {
+  if (arg_count != 1) {
+    fprintf(stderr, "Error: char_count expects 1 argument, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  ObjString *str = string_object_arg("char_count", args[0]);
+  if (str == NULL) return value_make_nil();
+  return value_make_int(string_char_count(str));
+}
+
+// string.slice - Code points [start, end) as a zero-copy slice
+Value native_string_slice(int arg_count, Value *args) {
+  if (arg_count != 3) {
+    fprintf(stderr, "Error: slice expects 3 arguments, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  ObjString *str = string_object_arg("slice", args[0]);
+  if (str == NULL) return value_make_nil();
+  if (!IS_INT(args[1]) || !IS_INT(args[2])) {
+    fprintf(stderr, "Error: slice expects int bounds\n");
+    return value_make_nil();
+  }
+
+  i64 start = AS_INT(args[1]);
+  i64 end = AS_INT(args[2]);
+  int count = string_char_count(str);
+  if (start < 0 || start > end || end > count) {
+    fprintf(stderr, "Error: slice [%lld, %lld) out of range for %d characters\n",
+            (long long)start, (long long)end, count);
+    return value_make_nil();
+  }
+  int from = string_char_offset(str, (int)start);
+  int to = string_char_offset(str, (int)end);
+  return OBJ_VAL(string_slice(str, from, to - from));
+}
+
+// string.char_at - Code point at an index, as a one-character string
+Value native_string_char_at(int arg_count, Value *args) {
+  if (arg_count != 2) {
+    fprintf(stderr, "Error: char_at expects 2 arguments, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  Value slice_args[3] = {args[0], args[1], value_make_nil()};
+  if (IS_INT(args[1])) slice_args[2] = value_make_int(AS_INT(args[1]) + 1);
+  return native_string_slice(3, slice_args);
 }
 
 // Module initialization
 void string_module_init(VM *vm) {
   module_register_native(vm, "string.to_upper", native_string_to_upper);
   module_register_native(vm, "string.to_lower", native_string_to_lower);
+  module_register_native(vm, "string.is_utf8", native_string_is_utf8);
+  module_register_native(vm, "string.from_bytes", native_string_from_bytes);
+  module_register_native(vm, "string.char_count", native_string_char_count);
+  module_register_native(vm, "string.char_at", native_string_char_at);
+  module_register_native(vm, "string.slice", native_string_slice);
 }
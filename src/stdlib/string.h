@@ -12,5 +12,10 @@ void string_module_init(VM *vm);
 // Native functions
 Value native_string_to_upper(int arg_count, Value *args);
 Value native_string_to_lower(int arg_count, Value *args);
+Value native_string_is_utf8(int arg_count, Value *args);
+Value native_string_from_bytes(int arg_count, Value *args);
+Value native_string_char_count(int arg_count, Value *args);
+Value native_string_char_at(int arg_count, Value *args);
+Value native_string_slice(int arg_count, Value *args);
 
 #endif // SATORI_STDLIB_STRING_H
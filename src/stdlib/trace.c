@@ -0,0 +1,526 @@
+// src/stdlib/trace.c - Tracing spans module implementation
+//
+// Recording a span has to be cheap enough to leave in production scripts,
+// so a recording thread never locks, allocates (past its first event) or
+// touches the file:
+//
+//   TraceRing   one per recording thread. The thread is its only
+//               producer and the writer thread its only consumer.
+//   writer      a thread that drains every ring into the file and hands
+//               the slots back, sleeping up to TRACE_FLUSH_MS when all
+//               are empty
+//
+// An event is 64 bytes: a CLOCK_MONOTONIC timestamp, begin or end, and the
+// span name, copied since the script's string may be gone by the time the
+// writer gets to it. The producer fills a slot and publishes it by moving
+// `tail` (release); the writer reads up to the tail it loads (acquire) and
+// then moves `head`. A sleeping writer raises `asleep`; a producer looks
+// at it every quarter ring and wakes the writer, so a busy thread's ring
+// is drained long before it fills without any wake-ups while none sleeps.
+//
+// A full ring drops events rather than making the script wait, but never
+// an end whose begin it kept: a begin is only taken while there is room
+// left for the ends of every open span, its own included. A begin that is
+// dropped takes every event up to its end with it. Whatever is written
+// therefore still nests.
+//
+// Chrome events are written as they come. An OTLP span needs both ends, so
+// the writer keeps a stack of open spans per ring and writes each span at
+// its end; spans still open at trace_stop are not written.
+//
+// With tracing off, span_begin and span_end test one flag and return.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "trace.h"
+#include "runtime/module.h"
+#include "core/memory.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TRACE_LINE 64
+#define TRACE_OPEN_MAX 128    // Nesting the OTLP writer follows
+
+typedef enum {
+  TRACE_BEGIN = 1,
+  TRACE_END = 2,
+} TraceKind;
+
+typedef struct {
+  u64 time;
+  u8 kind;
+  u8 length;
+  char name[TRACE_NAME_MAX];
+} TraceEvent;
+
+// A span the OTLP writer has seen begin but not end
+typedef struct {
+  u64 id;
+  u64 start;
+  u8 length;
+  char name[TRACE_NAME_MAX];
+} TraceOpen;
+
+typedef struct TraceRing {
+  TraceEvent events[TRACE_RING_EVENTS];
+
+  u64 tail;                // Producer
+  u64 cached_head;         // Last head the producer loaded
+  u64 dropped;
+  u32 depth;               // Begins taken whose ends are still to come
+  u32 skip_depth;          // Begins dropped whose ends are still to come
+  u8 pad0[TRACE_LINE - 32];
+
+  u64 head;                // Writer
+  u8 pad1[TRACE_LINE - 8];
+
+  // Writer only
+  int thread;              // Numbered from 1 in the order threads traced
+  TraceOpen open[TRACE_OPEN_MAX];
+  int open_count;
+  int open_skipped;        // Begins past TRACE_OPEN_MAX
+  struct TraceRing *next;
+} TraceRing;
+
+static struct {
+  bool on;                 // Read without the lock by recording threads
+  bool running;            // The writer loops while set
+  u32 generation;          // Bumped by trace_start
+  TraceFormat format;
+  FILE *file;
+  bool written;            // An event is in the file, so the next needs a comma
+  int pid;
+  pthread_t writer;
+  pthread_mutex_t lock;    // Guards the ring list
+  pthread_mutex_t wake_lock;
+  pthread_cond_t wake;     // Signalled to wake the writer early
+  bool asleep;             // The writer is waiting on `wake`
+  TraceRing *rings;
+  int ring_count;
+  u64 origin;              // Monotonic time of trace_start
+  u64 epoch;               // Wall clock minus monotonic clock
+  u64 next_span;
+  char trace_id[33];
+} tracer = {.lock = PTHREAD_MUTEX_INITIALIZER, .wake_lock = PTHREAD_MUTEX_INITIALIZER,
+            .wake = PTHREAD_COND_INITIALIZER};
+
+// The calling thread's ring, valid while its generation is current
+#ifdef __GNUC__
+static __thread TraceRing *local_ring = NULL;
+static __thread u32 local_generation = 0;
+#else
+static TraceRing *local_ring = NULL;
+static u32 local_generation = 0;
+#endif
+
+static inline bool tracing(void) {
+  return __atomic_load_n(&tracer.on, __ATOMIC_ACQUIRE);
+}
+
+static u64 clock_ns(clockid_t clock) {
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+static void wake_writer(void) {
+  pthread_mutex_lock(&tracer.wake_lock);
+  pthread_cond_signal(&tracer.wake);
+  pthread_mutex_unlock(&tracer.wake_lock);
+}
+
+static TraceRing *thread_ring(void) {
+  if (local_ring != NULL && local_generation == tracer.generation) return local_ring;
+
+  TraceRing *ring = mem_alloc(sizeof(TraceRing));
+  memset(ring, 0, sizeof(TraceRing));
+  pthread_mutex_lock(&tracer.lock);
+  ring->thread = ++tracer.ring_count;
+  ring->next = tracer.rings;
+  tracer.rings = ring;
+  pthread_mutex_unlock(&tracer.lock);
+  local_ring = ring;
+  local_generation = tracer.generation;
+  return ring;
+}
+
+static void record(TraceKind kind, const char *name, int length) {
+  TraceRing *ring = thread_ring();
+  u64 used = ring->tail - ring->cached_head;
+
+  if (kind == TRACE_BEGIN) {
+    u64 need = ring->depth + 2;  // Itself, its end and the open spans' ends
+    if (ring->skip_depth == 0 && TRACE_RING_EVENTS - used < need) {
+      ring->cached_head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+      used = ring->tail - ring->cached_head;
+    }
+    if (ring->skip_depth > 0 || TRACE_RING_EVENTS - used < need) {
+      ring->skip_depth++;
+      ring->dropped++;
+      return;
+    }
+    ring->depth++;
+  } else {
+    if (ring->skip_depth > 0) {
+      ring->skip_depth--;
+      ring->dropped++;
+      return;
+    }
+    if (ring->depth == 0) return;  // No span to end
+    if (used == TRACE_RING_EVENTS) {
+      ring->cached_head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    }
+    ring->depth--;
+  }
+
+  TraceEvent *event = &ring->events[ring->tail & (TRACE_RING_EVENTS - 1)];
+  event->time = clock_ns(CLOCK_MONOTONIC);
+  event->kind = (u8)kind;
+  if (length > TRACE_NAME_MAX) {
+    // Cut on a character boundary
+    length = TRACE_NAME_MAX;
+    while (length > 0 && ((u8)name[length] & 0xC0) == 0x80) length--;
+  }
+  if (length > 0) memcpy(event->name, name, length);
+  event->length = (u8)length;
+  __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+
+  if ((ring->tail & (TRACE_RING_EVENTS / 4 - 1)) == 0 &&
+      __atomic_load_n(&tracer.asleep, __ATOMIC_SEQ_CST)) {
+    wake_writer();
+  }
+}
+
+void trace_begin(const char *name, int length) {
+  if (tracing()) record(TRACE_BEGIN, name, length);
+}
+
+void trace_end(void) {
+  if (tracing()) record(TRACE_END, NULL, 0);
+}
+
+// ============================================================================
+// Writer
+// ============================================================================
+
+// Writers for the formats build each event in a buffer and write it out
+// whole, as the writer thread has to keep up with every recording thread
+
+static char *put_u64(char *out, u64 n) {
+  char digits[20];
+  int count = 0;
+  do {
+    digits[count++] = (char)('0' + n % 10);
+    n /= 10;
+  } while (n > 0);
+  while (count > 0) *out++ = digits[--count];
+  return out;
+}
+
+static char *put_text(char *out, const char *text) {
+  while (*text != '\0') *out++ = *text++;
+  return out;
+}
+
+// A JSON string; needs up to 6 bytes per byte of name, plus 2
+static char *put_name(char *out, const char *name, int length) {
+  *out++ = '"';
+  for (int i = 0; i < length; i++) {
+    u8 c = (u8)name[i];
+    if (c == '"' || c == '\\') {
+      *out++ = '\\';
+      *out++ = (char)c;
+    } else if (c < 0x20) {
+      out += sprintf(out, "\\u%04x", c);
+    } else {
+      *out++ = (char)c;
+    }
+  }
+  *out++ = '"';
+  return out;
+}
+
+static char *put_separator(char *out) {
+  if (tracer.written) *out++ = ',';
+  *out++ = '\n';
+  tracer.written = true;
+  return out;
+}
+
+static void write_chrome(TraceRing *ring, const TraceEvent *event) {
+  char line[TRACE_NAME_MAX * 6 + 128];
+  char *out = put_separator(line);
+  *out++ = '{';
+  if (event->kind == TRACE_BEGIN) {
+    out = put_text(out, "\"name\":");
+    out = put_name(out, event->name, event->length);
+    out = put_text(out, ",\"ph\":\"B\",\"ts\":");
+  } else {
+    out = put_text(out, "\"ph\":\"E\",\"ts\":");
+  }
+  // Microseconds, to the nanosecond
+  u64 elapsed = event->time - tracer.origin;
+  out = put_u64(out, elapsed / 1000);
+  *out++ = '.';
+  *out++ = (char)('0' + elapsed / 100 % 10);
+  *out++ = (char)('0' + elapsed / 10 % 10);
+  *out++ = (char)('0' + elapsed % 10);
+  out = put_text(out, ",\"pid\":");
+  out = put_u64(out, (u64)tracer.pid);
+  out = put_text(out, ",\"tid\":");
+  out = put_u64(out, (u64)ring->thread);
+  *out++ = '}';
+  fwrite(line, 1, out - line, tracer.file);
+}
+
+static void write_otlp(TraceRing *ring, const TraceEvent *event) {
+  if (event->kind == TRACE_BEGIN) {
+    if (ring->open_count == TRACE_OPEN_MAX) {
+      ring->open_skipped++;
+      return;
+    }
+    TraceOpen *open = &ring->open[ring->open_count++];
+    open->id = ++tracer.next_span;
+    open->start = event->time;
+    open->length = event->length;
+    memcpy(open->name, event->name, event->length);
+    return;
+  }
+  if (ring->open_skipped > 0) {
+    ring->open_skipped--;
+    return;
+  }
+  if (ring->open_count == 0) return;
+
+  TraceOpen *open = &ring->open[--ring->open_count];
+  char line[TRACE_NAME_MAX * 6 + 384];
+  char *out = put_separator(line);
+  out += sprintf(out, "{\"traceId\":\"%s\",\"spanId\":\"%016llx\",", tracer.trace_id,
+                 (unsigned long long)open->id);
+  if (ring->open_count > 0) {
+    out += sprintf(out, "\"parentSpanId\":\"%016llx\",",
+                   (unsigned long long)ring->open[ring->open_count - 1].id);
+  }
+  out = put_text(out, "\"name\":");
+  out = put_name(out, open->name, open->length);
+  out += sprintf(out,
+                 ",\"kind\":1,\"startTimeUnixNano\":\"%llu\",\"endTimeUnixNano\":\"%llu\","
+                 "\"attributes\":[{\"key\":\"thread.id\",\"value\":{\"intValue\":\"%d\"}}]}",
+                 (unsigned long long)(open->start + tracer.epoch),
+                 (unsigned long long)(event->time + tracer.epoch), ring->thread);
+  fwrite(line, 1, out - line, tracer.file);
+}
+
+static u64 drain(TraceRing *ring) {
+  u64 head = ring->head;
+  u64 tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+  for (u64 at = head; at < tail; at++) {
+    const TraceEvent *event = &ring->events[at & (TRACE_RING_EVENTS - 1)];
+    if (tracer.format == TRACE_CHROME) {
+      write_chrome(ring, event);
+    } else {
+      write_otlp(ring, event);
+    }
+    if ((at + 1) % (TRACE_RING_EVENTS / 8) == 0) {
+      __atomic_store_n(&ring->head, at + 1, __ATOMIC_RELEASE);
+    }
+  }
+  __atomic_store_n(&ring->head, tail, __ATOMIC_RELEASE);
+  return tail - head;
+}
+
+static u64 drain_all(void) {
+  u64 drained = 0;
+  pthread_mutex_lock(&tracer.lock);
+  for (TraceRing *ring = tracer.rings; ring != NULL; ring = ring->next) drained += drain(ring);
+  pthread_mutex_unlock(&tracer.lock);
+  fflush(tracer.file);
+  return drained;
+}
+
+// Drain until a pass finds nothing, then sleep until woken or the flush
+// interval is up
+static void *trace_writer(void *arg) {
+  (void)arg;
+  while (__atomic_load_n(&tracer.running, __ATOMIC_ACQUIRE)) {
+    if (drain_all() > 0) continue;
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += TRACE_FLUSH_MS * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000L;
+    }
+    pthread_mutex_lock(&tracer.wake_lock);
+    __atomic_store_n(&tracer.asleep, true, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&tracer.running, __ATOMIC_ACQUIRE)) {
+      pthread_cond_timedwait(&tracer.wake, &tracer.wake_lock, &deadline);
+    }
+    __atomic_store_n(&tracer.asleep, false, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&tracer.wake_lock);
+  }
+  return NULL;
+}
+
+static void stop_at_exit(void) {
+  trace_stop();
+}
+
+bool trace_start(const char *path, TraceFormat format, const char **error) {
+  if (tracing()) {
+    *error = "tracing is already on";
+    return false;
+  }
+  FILE *file = fopen(path, "w");
+  if (file == NULL) {
+    *error = strerror(errno);
+    return false;
+  }
+
+  tracer.format = format;
+  tracer.file = file;
+  tracer.written = false;
+  tracer.pid = (int)getpid();
+  tracer.next_span = 0;
+  tracer.origin = clock_ns(CLOCK_MONOTONIC);
+  tracer.epoch = clock_ns(CLOCK_REALTIME) - tracer.origin;
+  snprintf(tracer.trace_id, sizeof(tracer.trace_id), "%016llx%016llx",
+           (unsigned long long)(tracer.origin + tracer.epoch),
+           (unsigned long long)tracer.pid << 32 | (tracer.generation + 1));
+  if (format == TRACE_CHROME) {
+    fputs("{\"traceEvents\":[", file);
+  } else {
+    fprintf(file,
+            "{\"resourceSpans\":[{\"resource\":{\"attributes\":["
+            "{\"key\":\"service.name\",\"value\":{\"stringValue\":\"satori\"}},"
+            "{\"key\":\"process.pid\",\"value\":{\"intValue\":\"%d\"}}]},"
+            "\"scopeSpans\":[{\"scope\":{\"name\":\"satori.trace\"},\"spans\":[",
+            tracer.pid);
+  }
+
+  tracer.running = true;
+  if (pthread_create(&tracer.writer, NULL, trace_writer, NULL) != 0) {
+    fclose(file);
+    tracer.file = NULL;
+    *error = "could not start the writer thread";
+    return false;
+  }
+
+  static bool exit_hook = false;
+  if (!exit_hook) {
+    atexit(stop_at_exit);
+    exit_hook = true;
+  }
+  tracer.generation++;
+  __atomic_store_n(&tracer.on, true, __ATOMIC_RELEASE);
+  return true;
+}
+
+u64 trace_stop(void) {
+  if (!tracing()) return 0;
+  __atomic_store_n(&tracer.on, false, __ATOMIC_RELEASE);
+  __atomic_store_n(&tracer.running, false, __ATOMIC_RELEASE);
+  wake_writer();
+  pthread_join(tracer.writer, NULL);
+  drain_all();
+
+  fputs(tracer.format == TRACE_CHROME ? "\n]}\n" : "\n]}]}]}\n", tracer.file);
+  fclose(tracer.file);
+  tracer.file = NULL;
+
+  u64 dropped = 0;
+  TraceRing *ring = tracer.rings;
+  while (ring != NULL) {
+    TraceRing *next = ring->next;
+    dropped += ring->dropped;
+    mem_free(ring);
+    ring = next;
+  }
+  tracer.rings = NULL;
+  tracer.ring_count = 0;
+  return dropped;
+}
+
+// ============================================================================
+// Natives
+// ============================================================================
+
+// trace.start - Record spans into a file, as "chrome" (the default) or
+// "otlp" JSON
+Value native_trace_start(int arg_count, Value *args) {
+  const char *path, *format_name = "chrome";
+  int length, format_length = 6;
+  if (arg_count < 1 || arg_count > 2) {
+    fprintf(stderr, "Error: start expects 1 or 2 arguments, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  if (!value_get_string(&args[0], &path, &length)) {
+    fprintf(stderr, "Error: start expects a string path\n");
+    return value_make_nil();
+  }
+  if (arg_count == 2 && !value_get_string(&args[1], &format_name, &format_length)) {
+    fprintf(stderr, "Error: start expects format \"chrome\" or \"otlp\"\n");
+    return value_make_nil();
+  }
+  TraceFormat format;
+  if (format_length == 6 && memcmp(format_name, "chrome", 6) == 0) {
+    format = TRACE_CHROME;
+  } else if (format_length == 4 && memcmp(format_name, "otlp", 4) == 0) {
+    format = TRACE_OTLP;
+  } else {
+    fprintf(stderr, "Error: start expects format \"chrome\" or \"otlp\"\n");
+    return value_make_nil();
+  }
+
+  const char *error = NULL;
+  if (!trace_start(path, format, &error)) {
+    fprintf(stderr, "Error: Could not start tracing to '%s': %s\n", path, error);
+    return value_make_nil();
+  }
+  return value_make_bool(true);
+}
+
+// trace.stop - Write out the remaining events; returns how many were dropped
+Value native_trace_stop(int arg_count, Value *args) {
+  (void)args;
+  if (arg_count != 0) {
+    fprintf(stderr, "Error: stop expects no arguments, got %d\n", arg_count);
+    return value_make_nil();
+  }
+  return value_make_int((i64)trace_stop());
+}
+
+// trace.span_begin - Open a span with the given name
+Value native_trace_span_begin(int arg_count, Value *args) {
+  if (!tracing()) return value_make_nil();
+  const char *name;
+  int length;
+  if (arg_count != 1 || !value_get_string(&args[0], &name, &length)) {
+    fprintf(stderr, "Error: span_begin expects a string name\n");
+    return value_make_nil();
+  }
+  record(TRACE_BEGIN, name, length);
+  return value_make_nil();
+}
+
+// trace.span_end - Close the innermost open span
+Value native_trace_span_end(int arg_count, Value *args) {
+  (void)arg_count;
+  (void)args;
+  if (tracing()) record(TRACE_END, NULL, 0);
+  return value_make_nil();
+}
+
+// Module initialization
+void trace_module_init(VM *vm) {
+  module_register_native(vm, "trace.start", native_trace_start);
+  module_register_native(vm, "trace.stop", native_trace_stop);
+  module_register_native(vm, "trace.span_begin", native_trace_span_begin);
+  module_register_native(vm, "trace.span_end", native_trace_span_end);
+}
@@ -0,0 +1,45 @@
+// src/stdlib/trace.h - Tracing spans module interface
+
+#ifndef SATORI_STDLIB_TRACE_H
+#define SATORI_STDLIB_TRACE_H
+
+#include "core/value.h"
+#include "runtime/vm.h"
+
+typedef enum {
+  TRACE_CHROME = 1,   // Chrome trace event JSON (chrome://tracing, Perfetto)
+  TRACE_OTLP = 2,     // OpenTelemetry OTLP/JSON spans
+} TraceFormat;
+
+// Events each thread can hold before the writer catches up; later ones
+// are dropped and counted
+#define TRACE_RING_EVENTS 8192
+
+// Longest span name kept; longer names are cut short
+#define TRACE_NAME_MAX 54
+
+// How long the writer thread sleeps once the rings are empty, in milliseconds
+#define TRACE_FLUSH_MS 10
+
+// C API. trace_start fails, leaving a message in *error, when tracing is
+// already on or the file cannot be created. Every thread that records
+// spans must be done before trace_stop, which writes out what is left,
+// closes the file and returns how many events were dropped.
+bool trace_start(const char *path, TraceFormat format, const char **error);
+u64 trace_stop(void);
+
+// Open and close a span on the calling thread. Both return at once when
+// tracing is off.
+void trace_begin(const char *name, int length);
+void trace_end(void);
+
+// Module initialization
+void trace_module_init(VM *vm);
+
+// Native functions
+Value native_trace_start(int arg_count, Value *args);
+Value native_trace_stop(int arg_count, Value *args);
+Value native_trace_span_begin(int arg_count, Value *args);
+Value native_trace_span_end(int arg_count, Value *args);
+
+#endif // SATORI_STDLIB_TRACE_H
@@ -0,0 +1,18 @@
+// tests/support.c - Helpers shared by the C tests
+
+#include "support.h"
+#include "frontend/lexer.h"
+#include "frontend/parser.h"
+#include "backend/codegen.h"
+
+bool compile(Chunk *chunk, const char *source) {
+  Lexer lexer;
+  lexer_init(&lexer, source);
+  Parser parser;
+  parser_init(&parser, &lexer, "<test>");
+  AstNode *ast = parser_parse(&parser);
+  if (ast == NULL) return false;
+  bool ok = codegen_compile(ast, chunk);
+  ast_free(ast);
+  return ok;
+}
@@ -0,0 +1,11 @@
+// tests/support.h - Helpers shared by the C tests
+
+#ifndef SATORI_TEST_SUPPORT_H
+#define SATORI_TEST_SUPPORT_H
+
+#include "runtime/vm.h"
+
+// Parse and compile `source` into `chunk`; false on any error
+bool compile(Chunk *chunk, const char *source);
+
+#endif // SATORI_TEST_SUPPORT_H
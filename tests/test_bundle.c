@@ -0,0 +1,341 @@
+// tests/test_bundle.c - Application bundle test
+//
+// Compiles a script with comptime collections, a comptime regex and match
+// tables, bundles it on its own and appended to another file, and checks
+// that the linked chunk runs as the compiled one does. Also checks that strings are
+// stored once, that damaged archives and bytecode that would break the VM
+// are refused, and that what the program cannot reach is left out.
+
+#include "core/object.h"
+#include "core/table.h"
+#include "runtime/bundle.h"
+#include "runtime/vm.h"
+#include "stdlib/hash.h"
+#include "support.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PATH "/tmp/satori_test_bundle.satb"
+#define EXE_PATH "/tmp/satori_test_bundle_exe"
+#define HOST_PATH "/tmp/satori_test_bundle_host"
+
+static const char *SOURCE =
+    "import persistent\n"
+    "import regex\n"
+    "let squares := comptime 0..8 |> map(it * it)\n"
+    "let config := comptime persistent.map(\"name\", \"satori\", \"retries\", 3)\n"
+    "let banner := comptime \"a banner much longer than a short string\"\n"
+    "let kind := \"pear\"\n"
+    "let count := squares |> persistent.vector() |> persistent.len()\n"
+    "let re := comptime regex.compile(\"(?i)a+b\")\n"
+    "let hits := regex.count(re, \"aab AB xab\")\n"
+    "match kind\n"
+    "    \"apple\": persistent.len(config)\n"
+    "    \"pear\": persistent.len(config)\n"
+    "    _: count\n"
+    "for i in 0..3 then\n"
+    "    let n := persistent.len(config)\n";
+
+static char *read_all(const char *path, long *size) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) return NULL;
+  fseek(file, 0, SEEK_END);
+  *size = ftell(file);
+  rewind(file);
+  char *data = malloc(*size);
+  *size = (long)fread(data, 1, *size, file);
+  fclose(file);
+  return data;
+}
+
+static void write_all(const char *path, const char *data, long size) {
+  FILE *file = fopen(path, "wb");
+  fwrite(data, 1, size, file);
+  fclose(file);
+}
+
+static int occurrences(const char *data, long size, const char *needle) {
+  int n = 0;
+  size_t length = strlen(needle);
+  for (long i = 0; i + (long)length <= size; i++) {
+    if (memcmp(data + i, needle, length) == 0) n++;
+  }
+  return n;
+}
+
+// Constants equal in kind and contents, collections item by item
+static bool same_constant(Value a, Value b) {
+  if (IS_OBJ_ARRAY(a) && IS_OBJ_ARRAY(b)) {
+    if (AS_OBJ_ARRAY(a)->count != AS_OBJ_ARRAY(b)->count) return false;
+    for (int i = 0; i < AS_OBJ_ARRAY(a)->count; i++) {
+      if (!same_constant(AS_OBJ_ARRAY(a)->items[i], AS_OBJ_ARRAY(b)->items[i])) return false;
+    }
+    return true;
+  }
+  if (IS_OBJ(a) && IS_OBJ(b) && OBJ_TYPE(a) == OBJ_TYPE(b) && OBJ_TYPE(a) != OBJ_STRING) {
+    char left[256], right[256];
+    value_format(a, left, sizeof(left));
+    value_format(b, right, sizeof(right));
+    return strcmp(left, right) == 0;
+  }
+  return value_equal(a, b);
+}
+
+// Link the bundle at `path` into a fresh VM; NULL on success, else why not
+static const char *link_bundle(const char *path, VM *vm, Bundle *bundle) {
+  const char *error = NULL;
+  vm_init(vm);
+  if (!bundle_open(bundle, path, &error)) return error != NULL ? error : "not a bundle";
+  if (!bundle_link(bundle, BUNDLE_MAIN, &vm->chunk, &error)) {
+    bundle_close(bundle);
+    return error;
+  }
+  return NULL;
+}
+
+// Overwrite the main module's code with `patch` at `offset`, then fix its
+// checksum so that only the verifier stands in the way
+static void patch_code(char *data, int offset, u8 patch) {
+  BundleHeader *header = (BundleHeader*)data;
+  BundleModule *module = (BundleModule*)(data + header->index_offset);
+  data[module->code_offset + offset] = (char)patch;
+  u32 crc = hash_crc32c(0, data + module->code_offset, module->code_length);
+  crc = hash_crc32c(crc, data + module->constants_offset,
+                    sizeof(BundleConstant) * module->record_count);
+  module->checksum =
+      hash_crc32c(crc, data + module->lines_offset, sizeof(LineStart) * module->line_count);
+}
+
+int main(void) {
+  printf("=== Bundle Test ===\n\n");
+  const char *error = NULL;
+
+  Chunk compiled;
+  chunk_init(&compiled);
+  if (!compile(&compiled, SOURCE)) {
+    printf("Compile FAILED\n");
+    return 1;
+  }
+
+  // Test 1: The linked chunk runs as the compiled one does
+  printf("Test 1: Round trip... ");
+  if (!bundle_write(&compiled, PATH, NULL, &error)) {
+    printf("FAILED (%s)\n", error);
+    return 1;
+  }
+  VM vm, reference;
+  Bundle bundle;
+  vm_init(&reference);
+  const char *problem = link_bundle(PATH, &vm, &bundle);
+  bool same = problem == NULL && compile(&reference.chunk, SOURCE) && vm_run(&reference) &&
+              vm_run(&vm) && vm.local_count == reference.local_count;
+  for (int i = 0; same && i < vm.local_count; i++) {
+    same = same_constant(vm.locals[i], reference.locals[i]);
+  }
+  if (!same || !IS_INT(vm.locals[4]) || AS_INT(vm.locals[4]) != 8 ||
+      !IS_INT(vm.locals[6]) || AS_INT(vm.locals[6]) != 3) {
+    printf("FAILED (%s)\n", problem != NULL ? problem : "runs differ");
+    return 1;
+  }
+  vm_free(&reference);
+  vm_free(&vm);
+  bundle_close(&bundle);
+  printf("SUCCESS\n");
+
+  // Test 2: Each string is stored once however many constants use it
+  printf("Test 2: Interned strings... ");
+  long size = 0;
+  char *data = read_all(PATH, &size);
+  if (data == NULL || occurrences(data, size, "persistent.vector") != 1 ||
+      occurrences(data, size, "a banner much longer than a short string") != 1) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 3: A bundle appended to another file is found from its trailer
+  printf("Test 3: Appended bundle... ");
+  write_all(HOST_PATH, "#!/bin/false\nnot really an interpreter\n", 40);
+  if (!bundle_write(&compiled, EXE_PATH, HOST_PATH, &error) ||
+      (problem = link_bundle(EXE_PATH, &vm, &bundle)) != NULL || !vm_run(&vm)) {
+    printf("FAILED (%s)\n", problem != NULL ? problem : error);
+    return 1;
+  }
+  vm_free(&vm);
+  bundle_close(&bundle);
+  if (bundle_open(&bundle, HOST_PATH, &error) || error != NULL) {
+    printf("FAILED (host taken for a bundle)\n");
+    return 1;
+  }
+  remove(EXE_PATH);
+  remove(HOST_PATH);
+  printf("SUCCESS\n");
+
+  // Test 4: Damage is caught by the checksums
+  printf("Test 4: Damaged archives... ");
+  BundleHeader *header = (BundleHeader*)data;
+  BundleModule *module = (BundleModule*)(data + header->index_offset);
+  int code_length = (int)module->code_length;
+  char *damaged = malloc(size);
+  memcpy(damaged, data, size);
+  damaged[module->code_offset + 1] ^= 0x40;
+  write_all(PATH, damaged, size);
+  problem = link_bundle(PATH, &vm, &bundle);
+  vm_free(&vm);
+  memcpy(damaged, data, size);
+  damaged[size - 3] ^= 0x40;   // In the string pool
+  write_all(PATH, damaged, size);
+  const char *pool_problem = link_bundle(PATH, &vm, &bundle);
+  vm_free(&vm);
+  memcpy(damaged, data, size);
+  ((BundleHeader*)damaged)->version = BUNDLE_VERSION + 1;
+  write_all(PATH, damaged, size);
+  const char *version_problem = link_bundle(PATH, &vm, &bundle);
+  vm_free(&vm);
+  if (problem == NULL || strstr(problem, "checksum") == NULL || pool_problem == NULL ||
+      strstr(pool_problem, "checksum") == NULL || version_problem == NULL) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 5: Bytecode that would break the VM is refused
+  printf("Test 5: Verifier... ");
+  const struct {
+    int offset;
+    u8 patch;
+  } breaks[] = {
+      {0, OP_BREAKPOINT},          // Not an opcode a bundle holds
+      {0, OP_POP},                 // Pops an empty stack
+      {1, 200},                    // Imports constant 200 of far fewer
+      {code_length - 1, OP_POP}    // Runs off the end
+  };
+  for (size_t i = 0; i < sizeof(breaks) / sizeof(breaks[0]); i++) {
+    memcpy(damaged, data, size);
+    patch_code(damaged, breaks[i].offset, breaks[i].patch);
+    write_all(PATH, damaged, size);
+    problem = link_bundle(PATH, &vm, &bundle);
+    vm_free(&vm);
+    if (problem == NULL || strstr(problem, "checksum") != NULL) {
+      printf("FAILED (patch %zu: %s)\n", i, problem != NULL ? problem : "accepted");
+      return 1;
+    }
+  }
+  Chunk jump;                  // Jumps into the operand of OP_CONSTANT
+  chunk_init(&jump);
+  u8 code[] = {OP_JUMP, 0, 1, OP_CONSTANT, 0, OP_POP, OP_HALT};
+  for (size_t i = 0; i < sizeof(code); i++) chunk_write(&jump, code[i]);
+  chunk_add_constant(&jump, value_make_int(1));
+  if (bundle_write(&jump, PATH, NULL, &error)) {
+    printf("FAILED (jump bundled)\n");
+    return 1;
+  }
+  chunk_free(&jump);
+  memcpy(damaged, data, size);
+  patch_code(damaged, 0, (u8)compiled.code[0]);   // Unchanged: still links
+  write_all(PATH, damaged, size);
+  if ((problem = link_bundle(PATH, &vm, &bundle)) != NULL) {
+    printf("FAILED (%s)\n", problem);
+    return 1;
+  }
+  vm_free(&vm);
+  bundle_close(&bundle);
+  free(damaged);
+  free(data);
+  remove(PATH);
+  printf("SUCCESS\n");
+
+  // Test 6: Constants a bundle cannot hold
+  printf("Test 6: Unbundlable constants... ");
+  Chunk native;
+  chunk_init(&native);
+  chunk_add_constant(&native, value_make_native_fn(NULL));
+  chunk_write(&native, OP_CONSTANT);
+  chunk_write(&native, 0);
+  chunk_write(&native, OP_POP);
+  chunk_write(&native, OP_HALT);
+  if (bundle_write(&native, PATH, NULL, &error) || error == NULL) {
+    printf("FAILED\n");
+    return 1;
+  }
+  chunk_free(&native);
+  printf("SUCCESS\n");
+
+  // Test 7: Unreachable code, unused imports and constants are left out
+  printf("Test 7: Pruning... ");
+  Chunk dead;
+  chunk_init(&dead);
+  const struct {
+    int line;
+    u8 bytes[3];
+    int length;
+  } lines[] = {
+      {1, {OP_IMPORT, 0}, 2},      // Module nothing calls into
+      {2, {OP_CONSTANT, 1}, 2},
+      {2, {OP_POP}, 1},
+      {3, {OP_JUMP, 0, 3}, 3},
+      {4, {OP_CONSTANT, 2}, 2},    // Jumped over
+      {4, {OP_POP}, 1},
+      {5, {OP_CONSTANT, 3}, 2},    // The same as constant 1
+      {5, {OP_POP}, 1},
+      {5, {OP_HALT}, 1},
+  };
+  for (size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); i++) {
+    dead.line = lines[i].line;
+    for (int b = 0; b < lines[i].length; b++) chunk_write(&dead, lines[i].bytes[b]);
+  }
+  chunk_add_constant(&dead, value_make_string("regex"));
+  chunk_add_constant(&dead, value_make_int(7));
+  chunk_add_constant(&dead, value_make_int(8));
+  chunk_add_constant(&dead, value_make_int(7));
+  const u8 kept[] = {OP_CONSTANT, 0, OP_POP, OP_JUMP, 0, 0, OP_CONSTANT, 0, OP_POP, OP_HALT};
+  const LineStart kept_lines[] = {{0, 2}, {3, 3}, {6, 5}};
+  if (!bundle_write(&dead, PATH, NULL, &error) ||
+      (problem = link_bundle(PATH, &vm, &bundle)) != NULL) {
+    printf("FAILED (%s)\n", problem != NULL ? problem : error);
+    return 1;
+  }
+  if (bundle.header->module_count != 1 || vm.chunk.count != (int)sizeof(kept) ||
+      memcmp(vm.chunk.code, kept, sizeof(kept)) != 0 || vm.chunk.constant_count != 1 ||
+      !IS_INT(vm.chunk.constants[0]) || AS_INT(vm.chunk.constants[0]) != 7 ||
+      vm.chunk.line_count != 3 || memcmp(vm.chunk.lines, kept_lines, sizeof(kept_lines)) != 0 ||
+      !vm_run(&vm)) {
+    printf("FAILED\n");
+    return 1;
+  }
+  vm_free(&vm);
+  bundle_close(&bundle);
+  chunk_free(&dead);
+  printf("SUCCESS\n");
+
+  // Test 8: Only natives the program names are registered
+  printf("Test 8: Natives... ");
+  bundle_write(&compiled, PATH, NULL, &error);
+  Table natives;
+  table_init(&natives);
+  Value unused;
+  if ((problem = link_bundle(PATH, &vm, &bundle)) != NULL) {
+    printf("FAILED (%s)\n", problem);
+    return 1;
+  }
+  bundle_natives(&vm.chunk, &natives);
+  vm.natives = &natives;
+  if (bundle.header->module_count != 3 || !vm_run(&vm) ||
+      !table_get(&vm.globals, "persistent.len", &unused) ||
+      table_get(&vm.globals, "persistent.get", &unused) ||
+      !table_get(&vm.globals, "regex.count", &unused) ||
+      table_get(&vm.globals, "regex.compile", &unused)) {
+    printf("FAILED\n");
+    return 1;
+  }
+  vm_free(&vm);
+  bundle_close(&bundle);
+  table_free(&natives);
+  chunk_free(&compiled);
+  remove(PATH);
+  printf("SUCCESS\n");
+
+  printf("\n=== All tests passed! ===\n");
+  return 0;
+}
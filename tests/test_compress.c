@@ -0,0 +1,146 @@
+// tests/test_compress.c - LZ4 compression module test
+//
+// Round-trips data through the frame encoder and decoder (whole and in
+// pieces), decodes a frame written by the reference lz4 library, and checks
+// that corrupt or truncated input is rejected.
+
+#include "stdlib/compress.h"
+#include "core/object.h"
+#include "core/value.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// "satori satori satori satori satori satori!\n" from liblz4 1.9.4 with
+// linked blocks, block and content checksums, and the content size
+static const u8 reference_frame[] = {
+  0x04, 0x22, 0x4d, 0x18, 0x7c, 0x40, 0x2b, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0xa9, 0x11, 0x00, 0x00, 0x00, 0x7f, 0x73, 0x61, 0x74, 0x6f,
+  0x72, 0x69, 0x20, 0x07, 0x00, 0x0c, 0x50, 0x6f, 0x72, 0x69, 0x21, 0x0a,
+  0x75, 0x3d, 0xa5, 0x10, 0x00, 0x00, 0x00, 0x00, 0x65, 0x49, 0x74, 0x2d,
+};
+
+static bool round_trip(const u8 *data, size_t length, size_t piece, ByteBuffer *frame) {
+  Lz4Encoder *encoder = lz4_encoder_new();
+  frame->count = 0;
+  for (size_t pos = 0; pos < length; pos += piece) {
+    lz4_encoder_write(encoder, data + pos, length - pos < piece ? length - pos : piece, frame);
+  }
+  lz4_encoder_finish(encoder, frame);
+  lz4_encoder_free(encoder);
+
+  ByteBuffer out = {NULL, 0, 0};
+  Lz4Decoder *decoder = lz4_decoder_new();
+  bool ok = true;
+  for (size_t pos = 0; ok && pos < frame->count; pos += piece) {
+    size_t n = frame->count - pos < piece ? frame->count - pos : piece;
+    ok = lz4_decoder_write(decoder, frame->data + pos, n, &out);
+  }
+  ok = ok && lz4_decoder_finish(decoder) && out.count == length &&
+       (length == 0 || memcmp(out.data, data, length) == 0);
+  lz4_decoder_free(decoder);
+  free(out.data);
+  return ok;
+}
+
+int main(void) {
+  printf("=== Compress Test ===\n\n");
+
+  size_t length = 300000;
+  u8 *text = malloc(length);
+  u8 *noise = malloc(length);
+  const char *words[] = {"INFO ", "request ", "served ", "in ", "12ms\n", "ERROR "};
+  unsigned seed = 1;
+  for (size_t i = 0; i < length;) {
+    seed = seed * 1103515245 + 12345;
+    const char *word = words[(seed >> 16) % 6];
+    for (size_t k = 0; word[k] != '\0' && i < length; k++) text[i++] = (u8)word[k];
+  }
+  for (size_t i = 0; i < length; i++) {
+    seed = seed * 1103515245 + 12345;
+    noise[i] = (u8)(seed >> 16);
+  }
+  ByteBuffer frame = {NULL, 0, 0};
+
+  // Test 1: Round trips, whole and in odd-sized pieces
+  printf("Test 1: Round trips... ");
+  static const size_t sizes[] = {0, 1, 12, 13, 100, 65536, 65537, 300000};
+  static const size_t pieces[] = {1, 999, 300000};
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    for (size_t p = 0; p < 3; p++) {
+      if (sizes[s] > 70000 && pieces[p] == 1) continue;
+      if (!round_trip(text, sizes[s], pieces[p], &frame) ||
+          !round_trip(noise, sizes[s], pieces[p], &frame)) {
+        printf("FAILED\n  %zu bytes in pieces of %zu\n", sizes[s], pieces[p]);
+        return 1;
+      }
+    }
+  }
+  printf("SUCCESS\n");
+
+  // Test 2: Text shrinks, noise is stored without growing much
+  printf("Test 2: Compression ratio... ");
+  round_trip(text, length, length, &frame);
+  size_t text_size = frame.count;
+  round_trip(noise, length, length, &frame);
+  if (text_size > length / 2 || frame.count > length + 64) {
+    printf("FAILED (text %zu, noise %zu)\n", text_size, frame.count);
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 3: Frame from the reference implementation
+  printf("Test 3: Reference frame... ");
+  const char *expected = "satori satori satori satori satori satori!\n";
+  ByteBuffer out = {NULL, 0, 0};
+  Lz4Decoder *decoder = lz4_decoder_new();
+  if (!lz4_decoder_write(decoder, reference_frame, sizeof(reference_frame), &out) ||
+      !lz4_decoder_finish(decoder) || out.count != strlen(expected) ||
+      memcmp(out.data, expected, out.count) != 0) {
+    printf("FAILED\n");
+    return 1;
+  }
+  lz4_decoder_free(decoder);
+  printf("SUCCESS\n");
+
+  // Test 4: Corrupt and truncated frames are rejected
+  printf("Test 4: Rejecting bad frames... ");
+  u8 corrupt[sizeof(reference_frame)];
+  memcpy(corrupt, reference_frame, sizeof(corrupt));
+  corrupt[25] ^= 0x01;  // Literal byte, caught by the block checksum
+  out.count = 0;
+  decoder = lz4_decoder_new();
+  if (lz4_decoder_write(decoder, corrupt, sizeof(corrupt), &out)) {
+    printf("FAILED\n  corrupt block accepted\n");
+    return 1;
+  }
+  lz4_decoder_free(decoder);
+
+  decoder = lz4_decoder_new();
+  if (!lz4_decoder_write(decoder, reference_frame, sizeof(reference_frame) - 3, &out) ||
+      lz4_decoder_finish(decoder)) {
+    printf("FAILED\n  truncated frame accepted\n");
+    return 1;
+  }
+  lz4_decoder_free(decoder);
+  printf("SUCCESS\n");
+
+  // Test 5: Natives carry binary data in string objects
+  printf("Test 5: compress/decompress natives... ");
+  Value original = OBJ_VAL(string_copy("a\0b\0c\0a\0b\0c\0a\0b\0c\0", 18));
+  Value packed = native_compress_compress(1, &original);
+  Value unpacked = native_compress_decompress(1, &packed);
+  if (!IS_OBJ_STRING(unpacked) || AS_OBJ_STRING(unpacked)->length != 18 ||
+      memcmp(AS_OBJ_STRING(unpacked)->chars, "a\0b\0c\0a\0b\0c\0a\0b\0c\0", 18) != 0) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  free(out.data);
+  free(frame.data);
+  free(text);
+  free(noise);
+  printf("\n=== All tests passed! ===\n");
+  return 0;
+}
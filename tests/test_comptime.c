@@ -0,0 +1,81 @@
+// tests/test_comptime.c - Compile-time evaluation test
+//
+// Checks that comptime expressions may call only natives without effects:
+// output, files, key-value stores, queues and metrics are compile errors
+// and never run, while pure natives compile and their values, long strings
+// included, outlive the VM that computed them.
+
+#include "runtime/vm.h"
+#include "support.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define KV_PATH "/tmp/satori_test_comptime.kv"
+
+int main(void) {
+  printf("=== Comptime Test ===\n\n");
+
+  // Test 1: Natives with effects are compile errors, in calls and stages
+  printf("Test 1: Effects refused... ");
+  unlink(KV_PATH);
+  const char *effects[] = {
+      "import io\nlet x := comptime io.println(\"compiled\")\n",
+      "import kv\nlet x := comptime kv.open(\"" KV_PATH "\")\n",
+      "import hash\nlet x := comptime hash.file(\"/etc/hostname\")\n",
+      "import csv\nlet x := comptime csv.open(\"/etc/hostname\")\n",
+      "import metrics\nlet x := comptime metrics.counter(\"comptime_calls\")\n",
+      "import io\nlet x := comptime 0..3 |> io.println()\n",
+  };
+  for (size_t i = 0; i < sizeof(effects) / sizeof(effects[0]); i++) {
+    Chunk chunk;
+    chunk_init(&chunk);
+    if (compile(&chunk, effects[i])) {
+      printf("FAILED\n  compiled: %s", effects[i]);
+      return 1;
+    }
+    chunk_free(&chunk);
+  }
+  if (access(KV_PATH, F_OK) == 0) {
+    printf("FAILED (kv.open ran)\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 2: Pure natives run, and their value is the script's constant
+  printf("Test 2: Pure natives... ");
+  VM vm;
+  vm_init(&vm);
+  if (!compile(&vm.chunk,
+               "import persistent\nimport hash\n"
+               "let s := comptime persistent.map(1, \"a string longer than fourteen bytes\")"
+               " |> persistent.get(1)\n"
+               "let h := comptime hash.hex(hash.xxh3(\"satori\"))\n")) {
+    printf("FAILED\n  compile\n");
+    return 1;
+  }
+  const char *chars;
+  int length;
+  if (!vm_run(&vm) || !value_get_string(&vm.locals[0], &chars, &length) ||
+      length != 35 || memcmp(chars, "a string longer than fourteen bytes", 35) != 0 ||
+      !value_get_string(&vm.locals[1], &chars, &length) || length != 16) {
+    printf("FAILED\n");
+    return 1;
+  }
+  vm_free(&vm);
+  printf("SUCCESS\n");
+
+  // Test 3: Foreign data holding values of the compile-time VM is refused
+  printf("Test 3: Values that cannot be constants... ");
+  Chunk chunk;
+  chunk_init(&chunk);
+  if (compile(&chunk, "import csv\nlet rows := comptime csv.reader(\"a,b\\n1,2\\n\")\n")) {
+    printf("FAILED\n");
+    return 1;
+  }
+  chunk_free(&chunk);
+  printf("SUCCESS\n");
+
+  printf("\n=== All tests passed! ===\n");
+  return 0;
+}
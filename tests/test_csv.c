@@ -0,0 +1,141 @@
+// tests/test_csv.c - CSV module test
+//
+// Splits rows with quoted fields, embedded delimiters and newlines, escaped
+// quotes and CRLF endings, including quotes that straddle the scanner's
+// 64-byte blocks, and extracts numeric columns into packed arrays.
+
+#include "stdlib/csv.h"
+#include "core/object.h"
+#include "core/value.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Fields of one row joined with '|', for comparison
+static void row_text(Value row, char *out) {
+  ObjArray *array = (ObjArray*)AS_OBJ(row);
+  out[0] = '\0';
+  for (int i = 0; i < array->count; i++) {
+    ObjString *field = AS_OBJ_STRING(array->items[i]);
+    if (i > 0) strcat(out, "|");
+    strncat(out, field->chars, field->length);
+  }
+}
+
+// Read every row of `text` and compare with `expected` (rows separated by '\n')
+static bool rows_match(const char *text, char delimiter, const char *expected) {
+  char delim[2] = {delimiter, '\0'};
+  Value args[2] = {OBJ_VAL(string_copy(text, (int)strlen(text))),
+                   OBJ_VAL(string_copy(delim, 1))};
+  Value reader = native_csv_reader(2, args);
+
+  char actual[4096] = "";
+  char row[1024];
+  Value next;
+  while (!IS_NIL(next = native_csv_next(1, &reader))) {
+    row_text(next, row);
+    strcat(actual, row);
+    strcat(actual, "\n");
+  }
+  if (strcmp(actual, expected) != 0) {
+    printf("FAILED\n  input:    %s\n  expected: %s\n  actual:   %s\n", text, expected, actual);
+    return false;
+  }
+  return true;
+}
+
+int main(void) {
+  printf("=== CSV Test ===\n\n");
+
+  // Test 1: Plain rows, CRLF, blank lines, missing final newline
+  printf("Test 1: Plain rows... ");
+  if (!rows_match("a,b,c\n1,2,3\n", ',', "a|b|c\n1|2|3\n") ||
+      !rows_match("a,b\r\n\r\n,\r\nx,", ',', "a|b\n|\nx|\n") ||
+      !rows_match("one\n\n\ntwo", ',', "one\ntwo\n") ||
+      !rows_match("a\tb,c\td", '\t', "a|b,c|d\n") ||
+      !rows_match("", ',', "")) {
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 2: Quoted fields with delimiters, newlines and doubled quotes
+  printf("Test 2: Quoted fields... ");
+  if (!rows_match("\"a,b\",\"line\nbreak\",\"say \"\"hi\"\"\"\n", ',',
+                  "a,b|line\nbreak|say \"hi\"\n") ||
+      !rows_match("\"\",\"\"\"\"\n\"open", ',', "|\"\nopen\n")) {
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 3: Quoted fields crossing 64-byte scan blocks
+  printf("Test 3: Block boundaries... ");
+  for (int pad = 0; pad < 130; pad++) {
+    char text[512], expected[512];
+    memset(text, 'x', pad);
+    strcpy(text + pad, ",\"q,\n\"\"q\",end\nlast\n");
+    memset(expected, 'x', pad);
+    strcpy(expected + pad, "|q,\n\"q|end\nlast\n");
+    if (!rows_match(text, ',', expected)) return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 4: Unescaped fields are slices of the input
+  printf("Test 4: Zero-copy fields... ");
+  Value text = OBJ_VAL(string_copy("id,\"name\",\"a\"\"b\"\n", 18));
+  Value reader = native_csv_reader(1, &text);
+  ObjArray *row = (ObjArray*)AS_OBJ(native_csv_next(1, &reader));
+  ObjString *source = AS_OBJ_STRING(text);
+  ObjString *name = AS_OBJ_STRING(row->items[1]);
+  ObjString *quoted = AS_OBJ_STRING(row->items[2]);
+  if (row->count != 3 || name->chars != source->chars + 4 || name->length != 4 ||
+      (quoted->chars >= source->chars && quoted->chars < source->chars + source->length) ||
+      strcmp(quoted->chars, "a\"b") != 0) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 5: Packed int and float columns
+  printf("Test 5: Packed columns... ");
+  const char *table = "id,price\n1,2.50\n-42,\"1e3\"\n9223372036854775807, 0.1 \n7,\n";
+  Value args[2] = {OBJ_VAL(string_copy(table, (int)strlen(table))), value_make_int(0)};
+  args[0] = native_csv_reader(1, args);
+  native_csv_next(1, args);  // Header
+  Value ints = native_csv_column_int(2, args);
+  args[0] = OBJ_VAL(string_copy(table, (int)strlen(table)));
+  args[0] = native_csv_reader(1, args);
+  native_csv_next(1, args);
+  args[1] = value_make_int(1);
+  Value floats = native_csv_column_float(2, args);
+  if (!IS_OBJ_PACKED(ints) || !IS_OBJ_PACKED(floats)) {
+    printf("FAILED\n  columns not extracted\n");
+    return 1;
+  }
+  ObjPacked *id = AS_OBJ_PACKED(ints);
+  ObjPacked *price = AS_OBJ_PACKED(floats);
+  if (id->count != 4 || id->as.ints[0] != 1 || id->as.ints[1] != -42 ||
+      id->as.ints[2] != INT64_MAX || id->as.ints[3] != 7 ||
+      price->count != 4 || price->as.floats[0] != 2.5 || price->as.floats[1] != 1000.0 ||
+      price->as.floats[2] != 0.1 || !isnan(price->as.floats[3])) {
+    printf("FAILED\n  wrong values\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 6: Non-numeric fields and short rows are errors
+  printf("Test 6: Column errors... ");
+  const char *bad[] = {"1\nx\n", "1\n99999999999999999999\n", "1,2\n3\n"};
+  for (int i = 0; i < 3; i++) {
+    Value bad_args[2] = {OBJ_VAL(string_copy(bad[i], (int)strlen(bad[i]))), value_make_int(i == 2 ? 1 : 0)};
+    bad_args[0] = native_csv_reader(1, bad_args);
+    if (!IS_NIL(native_csv_column_int(2, bad_args))) {
+      printf("FAILED\n  accepted %s\n", bad[i]);
+      return 1;
+    }
+  }
+  printf("SUCCESS\n");
+
+  printf("\n=== All tests passed! ===\n");
+  return 0;
+}
@@ -0,0 +1,153 @@
+// tests/test_debugger.c - Breakpoint debugger test
+//
+// Checks the line table codegen records, that breakpoints stop on every
+// pass over their line and step from line to line, that instructions
+// which rewrite themselves under a breakpoint keep working, and that
+// detaching leaves the code as a run without the debugger would.
+
+#include "runtime/debug.h"
+#include "runtime/vm.h"
+#include "support.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *SOURCE =
+    "import persistent\n"
+    "let v := persistent.vector()\n"
+    "for i in 0..5 then\n"
+    "    let n := persistent.len(v)\n"
+    "\n"
+    "let done := 1\n";
+
+typedef struct {
+  int lines[64];
+  int count;
+  DebugAction action;
+  int stop_after;   // Hits before answering DEBUG_STOP; 0 for never
+} Log;
+
+static DebugAction record(Debugger *debugger, VM *vm, int line) {
+  (void)vm;
+  Log *log = debugger->context;
+  if (log->count < 64) log->lines[log->count] = line;
+  log->count++;
+  return log->count == log->stop_after ? DEBUG_STOP : log->action;
+}
+
+static bool logged(Log *log, const int *lines, int count) {
+  if (log->count != count) return false;
+  for (int i = 0; i < count; i++) {
+    if (log->lines[i] != lines[i]) return false;
+  }
+  return true;
+}
+
+int main(void) {
+  printf("=== Debugger Test ===\n\n");
+
+  // Test 1: Every line with code has an entry, in order of offset
+  printf("Test 1: Line table... ");
+  VM vm;
+  vm_init(&vm);
+  if (!compile(&vm.chunk, SOURCE) || vm.chunk.line_count < 4 || chunk_line(&vm.chunk, 0) != 1) {
+    printf("FAILED (compile)\n");
+    return 1;
+  }
+  bool seen[7] = {false};
+  for (int i = 0; i < vm.chunk.line_count; i++) {
+    if (i > 0 && vm.chunk.lines[i].offset <= vm.chunk.lines[i - 1].offset) {
+      printf("FAILED (unsorted)\n");
+      return 1;
+    }
+    if (vm.chunk.lines[i].line < 7) seen[vm.chunk.lines[i].line] = true;
+  }
+  if (!seen[1] || !seen[2] || !seen[3] || !seen[4] || seen[5] || !seen[6]) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // A run without the debugger, to compare code and results against
+  if (!vm_run(&vm)) {
+    printf("FAILED (run)\n");
+    return 1;
+  }
+  u8 *resolved = malloc(vm.chunk.count);
+  memcpy(resolved, vm.chunk.code, vm.chunk.count);
+  vm_free(&vm);
+
+  // Test 2: A breakpoint stops on each pass, and its line's global
+  // lookup still resolves and caches under it
+  printf("Test 2: Breakpoints... ");
+  vm_init(&vm);
+  compile(&vm.chunk, SOURCE);
+  Debugger debugger;
+  Log log = {{0}, 0, DEBUG_CONTINUE, 0};
+  debug_attach(&debugger, &vm, record, &log);
+  if (!debug_break_at(&debugger, &vm, 4) || debug_break_at(&debugger, &vm, 5) ||
+      !debug_break_at(&debugger, &vm, 6)) {
+    printf("FAILED (setting)\n");
+    return 1;
+  }
+  static const int hits[] = {4, 4, 4, 4, 4, 6};
+  if (!vm_run(&vm) || !logged(&log, hits, 6) || !IS_INT(vm.locals[vm.local_count - 1])) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 3: Clearing a breakpoint, then detaching, restores the code
+  printf("Test 3: Clearing and detaching... ");
+  if (!debug_clear(&debugger, &vm, 4) || debug_clear(&debugger, &vm, 4) ||
+      debugger.count != 1) {
+    printf("FAILED (clearing)\n");
+    return 1;
+  }
+  debug_detach(&debugger, &vm);
+  if (vm.debugger != NULL || memcmp(vm.chunk.code, resolved, vm.chunk.count) != 0) {
+    printf("FAILED\n");
+    return 1;
+  }
+  vm_free(&vm);
+  printf("SUCCESS\n");
+
+  // Test 4: Stepping from the start visits each line as it runs
+  printf("Test 4: Stepping... ");
+  vm_init(&vm);
+  compile(&vm.chunk, SOURCE);
+  log = (Log){{0}, 0, DEBUG_STEP, 0};
+  debug_attach(&debugger, &vm, record, &log);
+  debug_step(&debugger, &vm, 0);
+  static const int steps[] = {1, 2, 3, 4, 3, 4, 3, 4, 3, 4, 3, 4, 3, 6};
+  if (!vm_run(&vm) || !logged(&log, steps, 14)) {
+    printf("FAILED\n");
+    return 1;
+  }
+  debug_detach(&debugger, &vm);
+  if (memcmp(vm.chunk.code, resolved, vm.chunk.count) != 0) {
+    printf("FAILED (code changed)\n");
+    return 1;
+  }
+  vm_free(&vm);
+  printf("SUCCESS\n");
+
+  // Test 5: The handler can stop the script
+  printf("Test 5: Stopping... ");
+  vm_init(&vm);
+  compile(&vm.chunk, SOURCE);
+  log = (Log){{0}, 0, DEBUG_CONTINUE, 3};
+  debug_attach(&debugger, &vm, record, &log);
+  debug_break_at(&debugger, &vm, 4);
+  if (vm_run(&vm) || log.count != 3) {
+    printf("FAILED\n");
+    return 1;
+  }
+  debug_detach(&debugger, &vm);
+  vm_free(&vm);
+  free(resolved);
+  printf("SUCCESS\n");
+
+  printf("\n=== All tests passed! ===\n");
+  return 0;
+}
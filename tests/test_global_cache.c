@@ -0,0 +1,68 @@
+// tests/test_global_cache.c - Inline cache for global lookups test
+//
+// Checks that an OP_GET_GLOBAL site turns into a cached one after its
+// first lookup, and that registering a global invalidates every cache so
+// the next run sees the new value.
+
+#include "core/vector.h"
+#include "runtime/module.h"
+#include "runtime/vm.h"
+#include "support.h"
+#include <stdio.h>
+
+static int replaced_calls = 0;
+
+static Value replaced_vector(int arg_count, Value *args) {
+  (void)arg_count;
+  (void)args;
+  replaced_calls++;
+  return value_make_int(7);
+}
+
+int main(void) {
+  printf("=== Global Cache Test ===\n\n");
+
+  // `import persistent` is 2 bytes, so the site's opcode is at offset 2
+  VM vm;
+  vm_init(&vm);
+  if (!compile(&vm.chunk, "import persistent\nlet v := persistent.vector()\n") ||
+      vm.chunk.code[2] != OP_GET_GLOBAL) {
+    printf("FAILED (compile)\n");
+    return 1;
+  }
+
+  // Test 1: The first run resolves the name and caches it at the site
+  printf("Test 1: Site cached after first lookup... ");
+  int constant = vm.chunk.code[3];
+  if (!vm_run(&vm) || vm.chunk.code[2] != OP_GET_GLOBAL_CACHED ||
+      vm.global_caches[constant].version != vm.globals_version ||
+      !IS_VECTOR(vm.locals[0])) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 2: A cached site runs again without a lookup
+  printf("Test 2: Cached rerun... ");
+  if (!vm_run(&vm) || vm.chunk.code[2] != OP_GET_GLOBAL_CACHED || !IS_VECTOR(vm.locals[0])) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 3: Replacing the global invalidates the cache
+  printf("Test 3: Invalidation... ");
+  u32 version = vm.globals_version;
+  module_register_native(&vm, "persistent.vector", replaced_vector);
+  if (vm.globals_version == version || !vm_run(&vm) || replaced_calls != 1 ||
+      !IS_INT(vm.locals[0]) || AS_INT(vm.locals[0]) != 7 ||
+      vm.global_caches[constant].version != vm.globals_version) {
+    printf("FAILED\n");
+    return 1;
+  }
+  vm_free(&vm);
+  printf("SUCCESS\n");
+
+  printf("\n=== All tests passed! ===\n");
+  return 0;
+}
@@ -0,0 +1,134 @@
+// tests/test_hash.c - Hash and checksum module test
+//
+// Checks XXH3-64 against reference xxHash digests at every length class,
+// streaming against one-shot, wyhash against its published vectors,
+// CRC-32C against the standard check value, and XXH32.
+
+#include "stdlib/hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  size_t length;
+  u64 unseeded;
+  u64 seed_42;
+} Xxh3Case;
+
+// Input byte i is (i * 31 + 7) & 0xff
+static const Xxh3Case xxh3_cases[] = {
+  {0, 0x2d06800538d394c2ull, 0xb029411ff43d84d2ull},
+  {1, 0x4c5cca45d0f4811full, 0xc72384329881f542ull},
+  {3, 0x15f7093b173d005cull, 0x0322c472f9dd3c8aull},
+  {4, 0xdca012f95811b6b9ull, 0x859b7ff8d1723aa1ull},
+  {8, 0xdec6a9a43575982eull, 0xb18293e9a9982b58ull},
+  {9, 0xcbe393399f17ffbdull, 0x0131443739131d68ull},
+  {16, 0x7e484c18d74895d0ull, 0x0126fe5707ca8f2bull},
+  {17, 0x208bde5ee2bed407ull, 0x7c41a57ae29003daull},
+  {128, 0xf92b70eaa21a6288ull, 0x9a3b44e5f1d705d8ull},
+  {129, 0xf8f76713f2bb60faull, 0xb672f12eed8cd6b0ull},
+  {240, 0xccc7375172c41f03ull, 0x4b05be6354f2e1c7ull},
+  {241, 0x0b3b630948ce4a00ull, 0x015f3bb61c188b1aull},
+  {1024, 0x23bc880ebf0d29c6ull, 0x7123704382c38bc0ull},
+  {1025, 0xc09fdfbc398c7d82ull, 0x094359ff0bf72151ull},
+  {4096, 0xa3c19f8174cde0bbull, 0x334b260cacb92ca4ull},
+  {10000, 0x441f01d9711bebedull, 0x60cfc7d9a6069ab8ull},
+};
+
+int main(void) {
+  printf("=== Hash Test ===\n\n");
+
+  u8 data[10000];
+  for (int i = 0; i < 10000; i++) {
+    data[i] = (u8)(i * 31 + 7);
+  }
+  size_t case_count = sizeof(xxh3_cases) / sizeof(xxh3_cases[0]);
+
+  // Test 1: One-shot XXH3
+  printf("Test 1: XXH3 reference digests... ");
+  for (size_t i = 0; i < case_count; i++) {
+    const Xxh3Case *c = &xxh3_cases[i];
+    if (hash_xxh3(data, c->length, 0) != c->unseeded ||
+        hash_xxh3(data, c->length, 42) != c->seed_42) {
+      printf("FAILED\n  length %zu\n", c->length);
+      return 1;
+    }
+  }
+  printf("SUCCESS\n");
+
+  // Test 2: Streaming XXH3 in uneven chunks
+  printf("Test 2: Streaming XXH3... ");
+  static const size_t chunks[] = {1, 7, 63, 64, 65, 256, 257, 3000};
+  for (size_t i = 0; i < case_count; i++) {
+    const Xxh3Case *c = &xxh3_cases[i];
+    for (size_t k = 0; k < sizeof(chunks) / sizeof(chunks[0]); k++) {
+      Xxh3State state;
+      hash_xxh3_init(&state, 42);
+      for (size_t pos = 0; pos < c->length; pos += chunks[k]) {
+        size_t n = c->length - pos < chunks[k] ? c->length - pos : chunks[k];
+        hash_xxh3_update(&state, data + pos, n);
+      }
+      if (hash_xxh3_digest(&state) != c->seed_42) {
+        printf("FAILED\n  length %zu in chunks of %zu\n", c->length, chunks[k]);
+        return 1;
+      }
+    }
+  }
+  printf("SUCCESS\n");
+
+  // Test 3: wyhash published vectors (seed = vector index)
+  printf("Test 3: wyhash vectors... ");
+  static const char *wy_inputs[] = {
+    "", "a", "abc", "message digest", "abcdefghijklmnopqrstuvwxyz",
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789",
+  };
+  static const u64 wy_expected[] = {
+    0x93228a4de0eec5a2ull, 0xc5bac3db178713c4ull, 0xa97f2f7b1d9b3314ull,
+    0x786d1f1df3801df4ull, 0xdca5a8138ad37c87ull, 0xb9e734f117cfaf70ull,
+  };
+  for (int i = 0; i < 6; i++) {
+    if (hash_wyhash(wy_inputs[i], strlen(wy_inputs[i]), (u64)i) != wy_expected[i]) {
+      printf("FAILED\n  '%s'\n", wy_inputs[i]);
+      return 1;
+    }
+  }
+  printf("SUCCESS\n");
+
+  // Test 4: CRC-32C check value, whole and continued
+  printf("Test 4: CRC-32C... ");
+  u32 whole = hash_crc32c(0, "123456789", 9);
+  u32 continued = hash_crc32c(hash_crc32c(0, "1234", 4), "56789", 5);
+  if (whole != 0xE3069283u || continued != whole) {
+    printf("FAILED (got %08x, %08x)\n", whole, continued);
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 5: XXH32, one-shot and byte-at-a-time
+  printf("Test 5: XXH32... ");
+  static const size_t xxh32_lengths[] = {0, 1, 4, 15, 16, 17, 100, 1000};
+  static const u32 xxh32_expected[] = {
+    0x02cc5d05u, 0x002e0d32u, 0x073faa82u, 0x9f29f87bu,
+    0x3f6c9665u, 0xe048ecdbu, 0x75936eb8u, 0xa793e7c7u,
+  };
+  for (int i = 0; i < 8; i++) {
+    Xxh32State state;
+    hash_xxh32_init(&state, 0);
+    for (size_t pos = 0; pos < xxh32_lengths[i]; pos++) {
+      hash_xxh32_update(&state, data + pos, 1);
+    }
+    if (hash_xxh32(data, xxh32_lengths[i], 0) != xxh32_expected[i] ||
+        hash_xxh32_digest(&state) != xxh32_expected[i]) {
+      printf("FAILED\n  length %zu\n", xxh32_lengths[i]);
+      return 1;
+    }
+  }
+  if (hash_xxh32(data, 1000, 42) != 0x41160d9au) {
+    printf("FAILED\n  seeded\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  printf("\n=== All tests passed! ===\n");
+  return 0;
+}
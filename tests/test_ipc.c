@@ -0,0 +1,147 @@
+// tests/test_ipc.c - Shared-memory channel test
+//
+// Forks producer processes that send numbered messages of varying sizes
+// through SPSC and MPSC channels, and checks in the parent that every
+// message arrives intact and in order per producer, across many wraps of
+// a small ring. Also checks timeouts and the error cases.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "stdlib/ipc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MESSAGES 20000
+
+// Message `seq` of producer `id`: a header, then a deterministic fill
+static int make_message(char *buffer, int id, int seq) {
+  int length = snprintf(buffer, 64, "%d:%d:", id, seq);
+  int fill = (seq * 37 + id * 11) % 300;
+  for (int i = 0; i < fill; i++) buffer[length + i] = (char)('a' + (seq + i) % 26);
+  return length + fill;
+}
+
+static void produce(const char *name, int id) {
+  const char *error = NULL;
+  IpcRing *ring = ipc_open(name, &error);
+  if (ring == NULL) _exit(2);
+  char buffer[512];
+  for (int seq = 0; seq < MESSAGES; seq++) {
+    int length = make_message(buffer, id, seq);
+    if (!ipc_send(ring, buffer, length, -1)) _exit(3);
+  }
+  ipc_close(ring);
+  _exit(0);
+}
+
+// Receive `producers` * MESSAGES messages and check each against the next
+// one expected from its producer
+static bool consume(IpcRing *ring, int producers) {
+  int next[8] = {0};
+  char expected[512];
+  for (int received = 0; received < producers * MESSAGES; received++) {
+    const u8 *data;
+    int length, id, seq;
+    if (!ipc_recv(ring, &data, &length, 5000)) {
+      printf("FAILED\n  timed out after %d messages\n", received);
+      return false;
+    }
+    if (sscanf((const char*)data, "%d:%d:", &id, &seq) != 2 || id < 0 || id >= producers ||
+        seq != next[id] || make_message(expected, id, seq) != length ||
+        memcmp(expected, data, length) != 0) {
+      printf("FAILED\n  bad message %d\n", received);
+      return false;
+    }
+    next[id]++;
+    ipc_release(ring);
+  }
+  return true;
+}
+
+static bool run(const char *name, IpcMode mode, int producers) {
+  const char *error = NULL;
+  ipc_remove(name, &error);
+  error = NULL;
+  IpcRing *ring = ipc_create(name, 4096, mode, &error);
+  if (ring == NULL) {
+    printf("FAILED\n  create: %s\n", error);
+    return false;
+  }
+  for (int id = 0; id < producers; id++) {
+    if (fork() == 0) produce(name, id);
+  }
+  bool ok = consume(ring, producers);
+  for (int id = 0; id < producers; id++) {
+    int status;
+    wait(&status);
+    ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+  }
+  ipc_close(ring);
+  ipc_remove(name, &error);
+  return ok;
+}
+
+int main(void) {
+  printf("=== IPC Channel Test ===\n\n");
+
+  // Test 1: One producer, one consumer
+  printf("Test 1: SPSC... ");
+  if (!run("test_ipc_spsc", IPC_SPSC, 1)) return 1;
+  printf("SUCCESS\n");
+
+  // Test 2: Several producers
+  printf("Test 2: MPSC... ");
+  if (!run("test_ipc_mpsc", IPC_MPSC, 4)) return 1;
+  printf("SUCCESS\n");
+
+  // Test 3: Timeouts on an empty and on a full channel
+  printf("Test 3: Timeouts... ");
+  const char *error = NULL;
+  ipc_remove("test_ipc_timeout", &error);
+  IpcRing *ring = ipc_create("test_ipc_timeout", 4096, IPC_SPSC, &error);
+  const u8 *data;
+  int length;
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  bool got = ipc_recv(ring, &data, &length, 20);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double waited = (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6;
+  char block[1000] = {0};
+  int sent = 0;
+  while (ipc_send(ring, block, sizeof(block), 0)) sent++;
+  if (ring == NULL || got || waited < 15 || sent != 4 ||
+      !ipc_recv(ring, &data, &length, 0) || length != (int)sizeof(block)) {
+    printf("FAILED\n");
+    return 1;
+  }
+  ipc_release(ring);
+  if (!ipc_send(ring, block, sizeof(block), 0)) {
+    printf("FAILED\n  no space after release\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 4: Errors
+  printf("Test 4: Errors... ");
+  IpcRing *again = ipc_create("test_ipc_timeout", 4096, IPC_SPSC, &error);
+  IpcRing *missing = ipc_open("test_ipc_missing", &error);
+  IpcRing *bad_name = ipc_open("a/b", &error);
+  if (again != NULL || missing != NULL || bad_name != NULL ||
+      ipc_send(ring, block, ipc_max_message(ring->capacity) + 1, 0)) {
+    printf("FAILED\n");
+    return 1;
+  }
+  ipc_close(ring);
+  if (!ipc_remove("test_ipc_timeout", &error) || ipc_remove("test_ipc_timeout", &error)) {
+    printf("FAILED\n  remove\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  printf("\n=== All tests passed! ===\n");
+  return 0;
+}
@@ -0,0 +1,173 @@
+// tests/test_kv.c - Key-value store test
+//
+// Exercises the C API of the kv module against a log in /tmp: basic
+// operations, rebuilding the index on reopen, recovery from a torn last
+// record, and compaction running while writes continue.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "stdlib/kv.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TEST_PATH "/tmp/satori_test_kv.log"
+
+static bool put_int(KvStore *kv, const char *key, i64 x) {
+  u8 bytes[8];
+  for (int i = 0; i < 8; i++) bytes[i] = (u8)((u64)x >> (8 * i));
+  const char *error = NULL;
+  return kv_put(kv, key, (int)strlen(key), KV_INT, bytes, 8, &error);
+}
+
+static bool put_string(KvStore *kv, const char *key, const char *text) {
+  const char *error = NULL;
+  return kv_put(kv, key, (int)strlen(key), KV_STRING, text, (int)strlen(text), &error);
+}
+
+static bool has_string(KvStore *kv, const char *key, const char *text) {
+  KvValue value;
+  return kv_get(kv, key, (int)strlen(key), &value) && value.tag == KV_STRING &&
+         value.length == (int)strlen(text) && memcmp(value.bytes, text, value.length) == 0;
+}
+
+static bool has_int(KvStore *kv, const char *key, i64 x) {
+  KvValue value;
+  return kv_get(kv, key, (int)strlen(key), &value) && value.tag == KV_INT &&
+         kv_value_int(value) == x;
+}
+
+static off_t file_size(const char *path) {
+  struct stat st;
+  return stat(path, &st) == 0 ? st.st_size : -1;
+}
+
+int main(void) {
+  printf("=== KV Store Test ===\n\n");
+  unlink(TEST_PATH);
+  const char *error = NULL;
+
+  // Test 1: Put, overwrite, get and delete
+  printf("Test 1: Basic operations... ");
+  KvStore *kv = kv_open(TEST_PATH, &error);
+  bool existed, missing_existed;
+  if (kv == NULL || !put_string(kv, "name", "satori") || !put_int(kv, "n", 1) ||
+      !put_int(kv, "n", 2) || !put_string(kv, "gone", "x") ||
+      !kv_delete(kv, "gone", 4, &existed, &error) ||
+      !kv_delete(kv, "never", 5, &missing_existed, &error) ||
+      !existed || missing_existed || kv->count != 2 ||
+      !has_string(kv, "name", "satori") || !has_int(kv, "n", 2)) {
+    printf("FAILED\n");
+    return 1;
+  }
+  KvValue value;
+  if (kv_get(kv, "gone", 4, &value)) {
+    printf("FAILED\n  deleted key still present\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 2: Reopening replays the log
+  printf("Test 2: Reopen... ");
+  char key[32], text[32];
+  for (int i = 0; i < 5000; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    snprintf(text, sizeof(text), "value%d", i * 7);
+    if (!put_string(kv, key, text)) {
+      printf("FAILED\n  put %d\n", i);
+      return 1;
+    }
+  }
+  for (int i = 0; i < 5000; i += 2) {
+    snprintf(key, sizeof(key), "key%d", i);
+    kv_delete(kv, key, (int)strlen(key), &existed, &error);
+  }
+  if (!kv_close(kv, &error) || (kv = kv_open(TEST_PATH, &error)) == NULL ||
+      kv->count != 2 + 2500 || !has_string(kv, "name", "satori") || !has_int(kv, "n", 2)) {
+    printf("FAILED\n");
+    return 1;
+  }
+  for (int i = 0; i < 5000; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    snprintf(text, sizeof(text), "value%d", i * 7);
+    if (has_string(kv, key, text) != (i % 2 == 1)) {
+      printf("FAILED\n  key%d\n", i);
+      return 1;
+    }
+  }
+  printf("SUCCESS\n");
+
+  // Test 3: A torn last record is dropped on open
+  printf("Test 3: Torn tail... ");
+  put_string(kv, "last", "complete");
+  kv_close(kv, &error);
+  off_t size = file_size(TEST_PATH);
+  if (truncate(TEST_PATH, size - 3) != 0 || (kv = kv_open(TEST_PATH, &error)) == NULL ||
+      kv_get(kv, "last", 4, &value) || !has_int(kv, "n", 2) ||
+      file_size(TEST_PATH) >= size - 3) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 4: Compaction shrinks the log while writes go on
+  printf("Test 4: Compaction... ");
+  for (int round = 0; round < 20; round++) {
+    for (int i = 0; i < 1000; i++) {
+      snprintf(key, sizeof(key), "counter%d", i);
+      put_int(kv, key, round * 1000 + i);
+    }
+  }
+  if (!kv_commit(kv, &error)) {
+    printf("FAILED\n  commit: %s\n", error);
+    return 1;
+  }
+  off_t before = file_size(TEST_PATH);
+  if (!kv_compact(kv, &error)) {
+    printf("FAILED\n  compact: %s\n", error);
+    return 1;
+  }
+  for (int i = 0; i < 1000; i++) {
+    snprintf(key, sizeof(key), "counter%d", i);
+    put_int(kv, key, -i);
+  }
+  put_string(kv, "name", "renamed");
+  if (!kv_finish_compaction(kv, &error) || kv->compaction != NULL ||
+      file_size(TEST_PATH) >= before / 2) {
+    printf("FAILED\n  %s\n", error != NULL ? error : "log did not shrink");
+    return 1;
+  }
+  for (int i = 0; i < 1000; i++) {
+    snprintf(key, sizeof(key), "counter%d", i);
+    if (!has_int(kv, key, -i)) {
+      printf("FAILED\n  counter%d\n", i);
+      return 1;
+    }
+  }
+  if (!has_string(kv, "name", "renamed") || !kv_close(kv, &error) ||
+      (kv = kv_open(TEST_PATH, &error)) == NULL || !has_int(kv, "counter999", -999) ||
+      !has_string(kv, "name", "renamed") || !has_string(kv, "key1", "value7") ||
+      kv->count != 2 + 2500 + 1000) {
+    printf("FAILED\n  after reopen\n");
+    return 1;
+  }
+  kv_close(kv, &error);
+  printf("SUCCESS\n");
+
+  // Test 5: Files that are not stores are refused
+  printf("Test 5: Bad magic... ");
+  FILE *file = fopen(TEST_PATH, "wb");
+  fputs("not a store at all", file);
+  fclose(file);
+  error = NULL;
+  if (kv_open(TEST_PATH, &error) != NULL || error == NULL) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  unlink(TEST_PATH);
+  printf("\n=== All tests passed! ===\n");
+  return 0;
+}
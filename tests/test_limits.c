@@ -0,0 +1,168 @@
+// tests/test_limits.c - Instruction budget and heap quota test
+//
+// Runs scripts that never finish under each limit and checks that vm_run
+// returns with the limit recorded instead of spinning or exiting, that the
+// heap never grows past its quota, that natives hitting it finish their
+// call first, that garbage, natives' results included, is collected rather
+// than counted against it, and that a script within its limits is
+// unaffected.
+
+#include "runtime/vm.h"
+#include "support.h"
+#include <stdio.h>
+
+int main(void) {
+  printf("=== Execution Limits Test ===\n\n");
+
+  // Test 1: An endless loop stops once its budget is spent
+  printf("Test 1: Instruction budget... ");
+  VM vm;
+  vm_init(&vm);
+  if (!compile(&vm.chunk, "let n := 1\nloop\n    let m := n + 1\n")) {
+    printf("FAILED\n  compile\n");
+    return 1;
+  }
+  vm_set_limits(&vm, 100000, 0);
+  if (vm_run(&vm) || vm.limit_hit != VM_LIMIT_INSTRUCTIONS || vm.budget > 0) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 2: The same VM runs again with a fresh budget
+  printf("Test 2: Rerun after a limit... ");
+  vm_set_limits(&vm, 1000, 0);
+  if (vm_run(&vm) || vm.limit_hit != VM_LIMIT_INSTRUCTIONS) {
+    printf("FAILED\n");
+    return 1;
+  }
+  vm_free(&vm);
+  printf("SUCCESS\n");
+
+  // Test 3: A loop that keeps what it allocates stops at its heap quota
+  printf("Test 3: Heap quota... ");
+  vm_init(&vm);
+  if (!compile(&vm.chunk, "import persistent\n"
+                    "let xs := 0..100000000 |> map(persistent.map(\"n\", it)) |> collect()\n")) {
+    printf("FAILED\n  compile\n");
+    return 1;
+  }
+  vm_set_limits(&vm, 0, 64 * 1024);
+  if (vm_run(&vm) || vm.limit_hit != VM_LIMIT_HEAP || vm.heap.used > 64 * 1024) {
+    printf("FAILED (%lld bytes used)\n", (long long)vm.heap.used);
+    return 1;
+  }
+  vm_free(&vm);
+  printf("SUCCESS\n");
+
+  // Test 4: One allocation past the quota is refused before it is made,
+  // not noticed at the next safepoint
+  printf("Test 4: Oversized allocation... ");
+  vm_init(&vm);
+  if (!compile(&vm.chunk, "let xs := 0..100000000 |> collect()\n")) {
+    printf("FAILED\n  compile\n");
+    return 1;
+  }
+  vm_set_limits(&vm, 0, 64 * 1024);
+  if (vm_run(&vm) || vm.limit_hit != VM_LIMIT_HEAP || vm.heap.used > 64 * 1024) {
+    printf("FAILED (%lld bytes used)\n", (long long)vm.heap.used);
+    return 1;
+  }
+  vm_free(&vm);
+  printf("SUCCESS\n");
+
+  // Test 5: Whatever quota a native runs into, it finishes its call and
+  // the limit is taken at the next safepoint, leaving nothing half built
+  printf("Test 5: Quota hit inside natives... ");
+  for (i64 quota = 16 * 1024; quota <= 1024 * 1024; quota *= 2) {
+    vm_init(&vm);
+    if (!compile(&vm.chunk, "import regex\nimport string\n"
+                      "let re := regex.compile(\"(a|b)*c[0-9]+\")\n"
+                      "let xs := 0..100000000 |> map(regex.count(re, "
+                      "string.to_upper(\"abc1 bac22 abababc333 {it}\"))) |> collect()\n")) {
+      printf("FAILED\n  compile\n");
+      return 1;
+    }
+    vm_set_limits(&vm, 0, quota);
+    if (vm_run(&vm) || vm.limit_hit != VM_LIMIT_HEAP) {
+      printf("FAILED (quota %lld)\n", (long long)quota);
+      return 1;
+    }
+    vm_free(&vm);
+  }
+  printf("SUCCESS\n");
+
+  // Test 6: A loop that drops what it allocates is collected and never
+  // reaches the quota, however much it allocates in all
+  printf("Test 6: Garbage under a quota... ");
+  vm_init(&vm);
+  if (!compile(&vm.chunk, "for i in 0..100000 then\n    let xs := 0..8 |> collect()\n")) {
+    printf("FAILED\n  compile\n");
+    return 1;
+  }
+  vm_set_limits(&vm, 0, 256 * 1024);
+  if (!vm_run(&vm) || vm.limit_hit != VM_LIMIT_NONE || vm.gc.freed < 90000) {
+    printf("FAILED (%zu freed)\n", vm.gc.freed);
+    return 1;
+  }
+  vm_free(&vm);
+  printf("SUCCESS\n");
+
+  // Test 7: Strings a native converts are garbage like any other
+  printf("Test 7: Converted strings under a quota... ");
+  vm_init(&vm);
+  if (!compile(&vm.chunk, "import string\n"
+                    "for i in 0..100000 then\n"
+                    "    let s := string.to_upper(\"a line longer than fourteen bytes\")\n")) {
+    printf("FAILED\n  compile\n");
+    return 1;
+  }
+  vm_set_limits(&vm, 0, 256 * 1024);
+  if (!vm_run(&vm) || vm.limit_hit != VM_LIMIT_NONE || vm.gc.freed < 90000) {
+    printf("FAILED (%zu freed)\n", vm.gc.freed);
+    return 1;
+  }
+  vm_free(&vm);
+  printf("SUCCESS\n");
+
+  // Test 8: Versions of vectors and maps are garbage with their nodes, so
+  // making millions of them fits a small quota
+  printf("Test 8: Persistent churn under a quota... ");
+  vm_init(&vm);
+  if (!compile(&vm.chunk,
+               "import persistent\n"
+               "let v := 0..2000000 |> "
+               "map(persistent.len(persistent.push(persistent.vector(), it))) |> sum()\n"
+               "let m := 0..2000000 |> "
+               "map(persistent.len(persistent.set(persistent.map(\"k\", 1), it, it)))"
+               " |> sum()\n")) {
+    printf("FAILED\n  compile\n");
+    return 1;
+  }
+  vm_set_limits(&vm, 0, 4 * 1024 * 1024);
+  if (!vm_run(&vm) || vm.limit_hit != VM_LIMIT_NONE || !IS_INT(vm.locals[0]) ||
+      AS_INT(vm.locals[0]) != 2000000 || !IS_INT(vm.locals[1]) || AS_INT(vm.locals[1]) != 4000000) {
+    printf("FAILED (%lld bytes used)\n", (long long)vm.heap.used);
+    return 1;
+  }
+  vm_free(&vm);
+  printf("SUCCESS\n");
+
+  // Test 9: Scripts within their limits run to the end
+  printf("Test 9: Within limits... ");
+  vm_init(&vm);
+  if (!compile(&vm.chunk, "import hash\nlet s := hash.hex(42) + 1\n")) {
+    printf("FAILED\n  compile\n");
+    return 1;
+  }
+  vm_set_limits(&vm, 10, 64 * 1024);
+  if (!vm_run(&vm) || vm.limit_hit != VM_LIMIT_NONE) {
+    printf("FAILED\n");
+    return 1;
+  }
+  vm_free(&vm);
+  printf("SUCCESS\n");
+
+  printf("\n=== All tests passed! ===\n");
+  return 0;
+}
@@ -0,0 +1,191 @@
+// tests/test_metrics.c - Metrics test
+//
+// Checks the histogram bucket layout, that counters, gauges and histograms
+// lose no updates when several threads record at once, and that exports
+// reach a file and a Unix socket in the Prometheus text format.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "stdlib/metrics.h"
+#include "core/memory.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define FILE_PATH "/tmp/satori_test_metrics.prom"
+#define SOCKET_PATH "/tmp/satori_test_metrics.sock"
+#define THREADS 4
+#define UPDATES 200000
+
+static Metric *requests;
+static Metric *in_flight;
+static Metric *latency;
+
+static char *read_all(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) return NULL;
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  rewind(file);
+  char *text = malloc(size + 1);
+  text[fread(text, 1, size, file)] = '\0';
+  fclose(file);
+  return text;
+}
+
+static void *record(void *arg) {
+  (void)arg;
+  for (int i = 0; i < UPDATES; i++) {
+    metrics_inc(requests, 1);
+    metrics_add(in_flight, 0.5);
+    metrics_observe(latency, (i % 1000) + 1);
+  }
+  return NULL;
+}
+
+int main(void) {
+  printf("=== Metrics Test ===\n\n");
+  const char *error = NULL;
+
+  // Test 1: Each value lands in the bucket whose bounds hold it
+  printf("Test 1: Bucket layout... ");
+  for (int i = 1; i < METRICS_BUCKETS - 1; i++) {
+    f64 lower = metrics_bucket_upper(i - 1), upper = metrics_bucket_upper(i);
+    f64 inside = (lower + upper) / 2;
+    if (upper <= lower || (upper - lower) / lower > 1.0 / 8 + 1e-12 ||
+        metrics_bucket(inside) != i || metrics_bucket(upper) != i ||
+        metrics_bucket(nextafter(lower, INFINITY)) != i) {
+      printf("FAILED (bucket %d)\n", i);
+      return 1;
+    }
+  }
+  if (metrics_bucket(0) != 0 || metrics_bucket(-1) != 0 || metrics_bucket(NAN) != 0 ||
+      metrics_bucket(1e-300) != 0 || metrics_bucket(INFINITY) != METRICS_BUCKETS - 1 ||
+      metrics_bucket(1e20) != METRICS_BUCKETS - 1) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 2: Registering a name twice gives the same metric
+  printf("Test 2: Registry... ");
+  requests = metrics_register(METRIC_COUNTER, "requests_total", "Requests handled", &error);
+  in_flight = metrics_register(METRIC_GAUGE, "in_flight", NULL, &error);
+  latency = metrics_register(METRIC_HISTOGRAM, "latency_ms", "Latency\\in \nms", &error);
+  if (requests == NULL || in_flight == NULL || latency == NULL ||
+      metrics_register(METRIC_COUNTER, "requests_total", "", &error) != requests ||
+      metrics_register(METRIC_GAUGE, "requests_total", "", &error) != NULL ||
+      metrics_register(METRIC_GAUGE, "9lives", "", &error) != NULL ||
+      metrics_register(METRIC_GAUGE, "bad-name", "", &error) != NULL ||
+      metrics_kind(latency) != METRIC_HISTOGRAM) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 3: Threads recording at once lose no updates
+  printf("Test 3: Threads... ");
+  pthread_t threads[THREADS];
+  for (int i = 0; i < THREADS; i++) pthread_create(&threads[i], NULL, record, NULL);
+  for (int i = 0; i < THREADS; i++) pthread_join(threads[i], NULL);
+  u64 total = (u64)THREADS * UPDATES;
+  f64 sum = (f64)THREADS * (UPDATES / 1000) * (1000 * 1001 / 2);
+  if (metrics_count(requests) != total || metrics_value(in_flight) != total * 0.5 ||
+      metrics_count(latency) != total || metrics_value(latency) != sum) {
+    printf("FAILED\n");
+    return 1;
+  }
+  metrics_set(in_flight, 3);
+  if (metrics_value(in_flight) != 3) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 4: Quantiles fall within a bucket's width of the true value
+  printf("Test 4: Quantiles... ");
+  f64 median = metrics_quantile(latency, 0.5), p99 = metrics_quantile(latency, 0.99);
+  Metric *empty = metrics_register(METRIC_HISTOGRAM, "empty", "", &error);
+  if (fabs(median - 500) > 500.0 / 8 || fabs(p99 - 990) > 990.0 / 8 ||
+      fabs(metrics_quantile(latency, 0) - 1) > 1.0 / 8 ||
+      !isnan(metrics_quantile(empty, 0.5))) {
+    printf("FAILED (median %g, p99 %g)\n", median, p99);
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 5: Prometheus text, with cumulative buckets
+  printf("Test 5: Export... ");
+  int length;
+  char *text = metrics_export(&length);
+  char expected[64];
+  snprintf(expected, sizeof(expected), "requests_total %llu\n", (unsigned long long)total);
+  u64 last = 0;
+  bool ascending = true;
+  for (const char *at = strstr(text, "latency_ms_bucket{"); at != NULL;
+       at = strstr(at + 1, "latency_ms_bucket{")) {
+    u64 count = strtoull(strchr(at, '}') + 2, NULL, 10);
+    ascending = ascending && count >= last;
+    last = count;
+  }
+  if ((int)strlen(text) != length || strstr(text, expected) == NULL || !ascending ||
+      last != total || strstr(text, "# HELP requests_total Requests handled\n") == NULL ||
+      strstr(text, "# TYPE requests_total counter\n") == NULL ||
+      strstr(text, "# HELP in_flight") != NULL || strstr(text, "in_flight 3\n") == NULL ||
+      strstr(text, "# HELP latency_ms Latency\\\\in \\nms\n") == NULL ||
+      strstr(text, "# TYPE latency_ms histogram\n") == NULL ||
+      strstr(text, "latency_ms_bucket{le=\"1\"} ") == NULL ||
+      strstr(text, "latency_ms_bucket{le=\"+Inf\"}") == NULL ||
+      strstr(text, "latency_ms_count ") == NULL || strstr(text, "empty_count 0\n") == NULL) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 6: Writing to a file and to a listening socket
+  printf("Test 6: Write... ");
+  bool written = metrics_write(FILE_PATH, &error);
+  char *file_text = read_all(FILE_PATH);
+  if (!written || file_text == NULL || strcmp(file_text, text) != 0 ||
+      metrics_write("/nonexistent/dir/metrics.prom", &error)) {
+    printf("FAILED\n");
+    return 1;
+  }
+  free(file_text);
+  remove(FILE_PATH);
+
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, SOCKET_PATH);
+  unlink(SOCKET_PATH);
+  int server = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (bind(server, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(server, 1) != 0 ||
+      !metrics_write(SOCKET_PATH, &error)) {
+    printf("FAILED\n");
+    return 1;
+  }
+  int client = accept(server, NULL, NULL);
+  char *received = malloc(length + 1);
+  int got = 0;
+  ssize_t n;
+  while (got < length + 1 && (n = read(client, received + got, length + 1 - got)) > 0) got += (int)n;
+  close(client);
+  close(server);
+  unlink(SOCKET_PATH);
+  if (got != length || memcmp(received, text, length) != 0) {
+    printf("FAILED (%d of %d bytes)\n", got, length);
+    return 1;
+  }
+  free(received);
+  mem_free(text);
+  printf("SUCCESS\n");
+
+  printf("\n=== All tests passed! ===\n");
+  return 0;
+}
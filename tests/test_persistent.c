@@ -0,0 +1,217 @@
+// tests/test_persistent.c - Persistent vector and map test
+//
+// Checks that updates leave every earlier version intact, that transients
+// build the same collections as persistent updates, that trie levels are
+// added and removed correctly around the 32-item boundaries, that keys
+// with equal hashes are kept apart, and that cursors walk maps in order.
+
+#include "core/hamt.h"
+#include "core/memory.h"
+#include "core/vector.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ITEMS 100000
+
+static bool vector_holds_range(ObjVector *vector, int count, i64 offset) {
+  if (vector->count != count) return false;
+  for (int i = 0; i < count; i++) {
+    Value item = vector_get(vector, i);
+    if (!IS_INT(item) || AS_INT(item) != i + offset) return false;
+  }
+  return true;
+}
+
+static bool map_holds(ObjMap *map, i64 key, i64 value) {
+  Value found;
+  return map_get(map, value_make_int(key), &found) && IS_INT(found) && AS_INT(found) == value;
+}
+
+static bool map_lacks(ObjMap *map, i64 key) {
+  Value found;
+  return !map_get(map, value_make_int(key), &found);
+}
+
+typedef struct {
+  ObjMap *map;
+  u64 cursor;
+  bool in_step;
+} Walk;
+
+// map_each and map_next must agree entry for entry
+static bool check_next(Value key, Value value, void *context) {
+  Walk *walk = context;
+  Value next_key, next_value;
+  walk->in_step = walk->in_step && map_next(walk->map, &walk->cursor, &next_key, &next_value) &&
+                  value_equal(key, next_key) && value_equal(value, next_value);
+  return walk->in_step;
+}
+
+static bool count_entry(Value key, Value value, void *context) {
+  (void)key;
+  (void)value;
+  (*(int*)context)++;
+  return true;
+}
+
+int main(void) {
+  printf("=== Persistent Collections Test ===\n\n");
+
+  // Test 1: Every pushed version keeps its items, across trie growth
+  printf("Test 1: Vector push keeps old versions... ");
+  static const int marks[] = {0, 1, 31, 32, 33, 64, 1024, 1056, 1057, 32800, ITEMS};
+  int mark_count = (int)(sizeof(marks) / sizeof(marks[0]));
+  ObjVector *versions[sizeof(marks) / sizeof(marks[0])];
+  ObjVector *vector = vector_make();
+  for (int i = 0, m = 0; i <= ITEMS; i++) {
+    if (m < mark_count && marks[m] == i) versions[m++] = vector;
+    if (i < ITEMS) vector = vector_push(vector, value_make_int(i));
+  }
+  for (int m = 0; m < mark_count; m++) {
+    if (!vector_holds_range(versions[m], marks[m], 0)) {
+      printf("FAILED (version of %d items)\n", marks[m]);
+      return 1;
+    }
+  }
+  printf("SUCCESS\n");
+
+  // Test 2: Set and pop copy the path and leave the original alone
+  printf("Test 2: Vector set and pop... ");
+  ObjVector *full = versions[mark_count - 1];
+  ObjVector *changed = full;
+  for (int i = 0; i < ITEMS; i += 7) changed = vector_set(changed, i, value_make_int(-i));
+  bool ok = vector_holds_range(full, ITEMS, 0);
+  for (int i = 0; i < ITEMS && ok; i++) {
+    ok = AS_INT(vector_get(changed, i)) == (i % 7 == 0 ? -i : i);
+  }
+  ObjVector *popped = full;
+  for (int n = ITEMS; n > 0 && ok; n--) {
+    popped = vector_pop(popped);
+    if (n - 1 == 1057 || n - 1 == 1056 || n - 1 == 32 || n - 1 == 0) {
+      ok = vector_holds_range(popped, n - 1, 0);
+    }
+  }
+  if (!ok || popped->count != 0 || !vector_holds_range(full, ITEMS, 0) ||
+      !vector_holds_range(vector_push(popped, value_make_int(0)), 1, 0)) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 3: A transient builds the same vector and never touches its source
+  printf("Test 3: Vector transients... ");
+  ObjVector *transient = vector_transient(versions[6]);
+  for (int i = 1024; i < ITEMS; i++) {
+    if (vector_push(transient, value_make_int(i)) != transient) {
+      printf("FAILED (push returned a new vector)\n");
+      return 1;
+    }
+  }
+  for (int i = 0; i < ITEMS; i++) vector_set(transient, i, value_make_int(i + 1));
+  for (int i = 0; i < 500; i++) vector_pop(transient);
+  ObjVector *frozen = vector_freeze(transient);
+  if (!vector_holds_range(frozen, ITEMS - 500, 1) || !vector_holds_range(versions[6], 1024, 0) ||
+      !vector_holds_range(full, ITEMS, 0)) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 4: Map put, get and remove on many keys, old versions intact
+  printf("Test 4: Map operations... ");
+  ObjMap *empty = map_make();
+  ObjMap *map = empty;
+  for (int i = 0; i < ITEMS; i++) map = map_put(map, value_make_int(i), value_make_int(i * 2));
+  ObjMap *filled = map;
+  for (int i = 0; i < ITEMS; i += 2) map = map_remove(map, value_make_int(i));
+  map = map_put(map, value_make_int(1), value_make_int(-1));
+  map = map_put(map, value_make_string("name"), value_make_int(7));
+  ok = filled->count == ITEMS && map->count == ITEMS / 2 + 1 && empty->count == 0 &&
+       map_lacks(empty, 0) && map_remove(map, value_make_int(-5)) == map;
+  for (int i = 0; i < ITEMS && ok; i++) {
+    ok = map_holds(filled, i, i * 2) &&
+         (i % 2 == 0 ? map_lacks(map, i) : map_holds(map, i, i == 1 ? -1 : i * 2));
+  }
+  Value found;
+  ObjString *name = string_copy("name", 4);
+  int visited = 0;
+  map_each(map, count_entry, &visited);
+  if (!ok || !map_get(map, OBJ_VAL(name), &found) || AS_INT(found) != 7 ||
+      visited != map->count) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 5: Transient maps, emptied again key by key
+  printf("Test 5: Map transients... ");
+  ObjMap *building = map_transient(filled);
+  for (int i = ITEMS; i < 2 * ITEMS; i++) map_put(building, value_make_int(i), value_make_int(i * 2));
+  for (int i = 0; i < 2 * ITEMS; i++) {
+    if (map_remove(building, value_make_int(i)) != building) {
+      printf("FAILED (remove returned a new map)\n");
+      return 1;
+    }
+  }
+  map_freeze(building);
+  ok = building->count == 0 && building->root == NULL && filled->count == ITEMS;
+  for (int i = 0; i < ITEMS && ok; i++) ok = map_holds(filled, i, i * 2);
+  if (!ok) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 6: Keys whose 32-bit hashes are equal
+  printf("Test 6: Hash collisions... ");
+  enum { SLOTS = 1 << 20 };
+  i64 *seen = malloc(sizeof(i64) * SLOTS);
+  for (int i = 0; i < SLOTS; i++) seen[i] = -1;
+  i64 first = -1, second = -1;
+  for (i64 key = 0; first < 0; key++) {
+    u32 hash = map_key_hash(value_make_int(key));
+    for (u32 slot = hash & (SLOTS - 1);; slot = (slot + 1) & (SLOTS - 1)) {
+      if (seen[slot] < 0) {
+        seen[slot] = key;
+        break;
+      }
+      if (map_key_hash(value_make_int(seen[slot])) == hash) {
+        first = seen[slot];
+        second = key;
+        break;
+      }
+    }
+  }
+  free(seen);
+  ObjMap *pair = map_put(map_put(map_make(), value_make_int(first), value_make_int(1)),
+                         value_make_int(second), value_make_int(2));
+  ObjMap *both = map_put(pair, value_make_int(second), value_make_int(3));
+  ObjMap *one = map_remove(both, value_make_int(first));
+  if (pair->count != 2 || !map_holds(pair, first, 1) || !map_holds(pair, second, 2) ||
+      both->count != 2 || !map_holds(both, second, 3) || !map_holds(both, first, 1) ||
+      one->count != 1 || !map_lacks(one, first) || !map_holds(one, second, 3) ||
+      map_remove(map_remove(one, value_make_int(second)), value_make_int(first))->count != 0) {
+    printf("FAILED (keys %lld and %lld)\n", (long long)first, (long long)second);
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 7: Cursor iteration visits what map_each does, in the same order
+  printf("Test 7: Map cursors... ");
+  ObjMap *mixed = map_put(map_put(filled, value_make_int(first), value_make_int(1)),
+                          value_make_int(second), value_make_int(2));
+  mixed = map_put(mixed, value_make_string("key"), value_make_bool(true));
+  Walk walk = {mixed, 0, true};
+  Value last_key, last_value;
+  u64 empty_cursor = 0;
+  if (!map_each(mixed, check_next, &walk) ||
+      map_next(mixed, &walk.cursor, &last_key, &last_value) ||
+      map_next(empty, &empty_cursor, &last_key, &last_value)) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  printf("\n=== All tests passed! ===\n");
+  return 0;
+}
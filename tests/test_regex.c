@@ -0,0 +1,154 @@
+// tests/test_regex.c - Regex engine and module test
+//
+// Checks leftmost-longest match positions, anchors, pattern errors, the
+// NFA fallback under DFA cache pressure, and the find_all native.
+
+#include "stdlib/regex.h"
+#include "core/object.h"
+#include "core/value.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  const char *pattern;
+  const char *text;
+  int start;  // -1 = no match
+  int end;
+} MatchCase;
+
+static const MatchCase cases[] = {
+  {"abc", "xxabcxx", 2, 5},
+  {"a+", "baaac", 1, 4},
+  {"ab|bcdef", "abcdef", 0, 2},       // Leftmost beats longer-later
+  {"abcd|bc", "abcd", 0, 4},
+  {"a|ab", "ab", 0, 2},               // Longest at the same start
+  {"^ab", "xab", -1, -1},
+  {"^ab", "abx", 0, 2},
+  {"ab$", "abab", 2, 4},
+  {"x*", "abc", 0, 0},
+  {"[^0-9]+", "12ab3", 2, 4},
+  {"(?i)error", "An ERROR", 3, 8},
+  {"a{2,3}", "aaaa", 0, 3},
+  {"\\d{3}-\\d{4}", "call 555-1234 now", 5, 13},
+  {"ERROR [a-z]+", "INFO ok ERROR disk full", 8, 18},
+  {"colou?r", "the color red", 4, 9},
+  {"[a-c-]+", "x-abc-y", 1, 6},
+  {"\\x41\\.", "zA.", 1, 3},
+  {"(a|b)*c", "ababx", -1, -1},
+};
+
+static const char *bad_patterns[] = {
+  "a(b", "*a", "[z-a]", "a{3,2}", "a+?", "ab)", "[abc", "\\q",
+};
+
+int main(void) {
+  printf("=== Regex Test ===\n\n");
+
+  // Test 1: Match positions
+  printf("Test 1: Match positions... ");
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    const MatchCase *c = &cases[i];
+    const char *error;
+    Regex *re = regex_compile(c->pattern, (int)strlen(c->pattern), &error);
+    if (re == NULL) {
+      printf("FAILED\n  '%s' did not compile: %s\n", c->pattern, error);
+      return 1;
+    }
+    int start = -1, end = -1;
+    if (!regex_search(re, c->text, (int)strlen(c->text), 0, &start, &end)) {
+      start = end = -1;
+    }
+    if (start != c->start || end != c->end) {
+      printf("FAILED\n  '%s' on '%s': got [%d,%d), expected [%d,%d)\n",
+             c->pattern, c->text, start, end, c->start, c->end);
+      return 1;
+    }
+    regex_free(re);
+  }
+  printf("SUCCESS\n");
+
+  // Test 2: Bad patterns are rejected
+  printf("Test 2: Rejecting bad patterns... ");
+  for (size_t i = 0; i < sizeof(bad_patterns) / sizeof(bad_patterns[0]); i++) {
+    const char *error = NULL;
+    Regex *re = regex_compile(bad_patterns[i], (int)strlen(bad_patterns[i]), &error);
+    if (re != NULL || error == NULL) {
+      printf("FAILED\n  '%s' compiled\n", bad_patterns[i]);
+      return 1;
+    }
+  }
+  printf("SUCCESS\n");
+
+  // Test 3: No catastrophic backtracking
+  printf("Test 3: (a|aa)*b on 100k a's... ");
+  int n = 100000;
+  char *as = malloc(n + 1);
+  memset(as, 'a', n);
+  as[n] = '\0';
+  const char *error;
+  Regex *re = regex_compile("(a|aa)*b", 8, &error);
+  int start, end;
+  if (regex_search(re, as, n, 0, &start, &end)) {
+    printf("FAILED\n");
+    return 1;
+  }
+  regex_free(re);
+  free(as);
+  printf("SUCCESS\n");
+
+  // Test 4: DFA blowup falls back to the NFA and still answers correctly.
+  // (a|b)*a(a|b){14} ends 15 bytes after the last usable 'a'.
+  printf("Test 4: NFA fallback under cache pressure... ");
+  n = 20000;
+  char *ab = malloc(n + 1);
+  unsigned seed = 12345;
+  for (int i = 0; i < n; i++) {
+    seed = seed * 1103515245 + 12345;
+    ab[i] = (seed >> 16) & 1 ? 'a' : 'b';
+  }
+  ab[n] = '\0';
+  int last_a = -1;
+  for (int i = 0; i <= n - 15; i++) {
+    if (ab[i] == 'a') last_a = i;
+  }
+  re = regex_compile("(a|b)*a(a|b){14}", 16, &error);
+  if (!regex_search(re, ab, n, 0, &start, &end) || start != 0 ||
+      end != last_a + 15) {
+    printf("FAILED\n");
+    return 1;
+  }
+  regex_free(re);
+  free(ab);
+  printf("SUCCESS\n");
+
+  // Test 5: find_all returns slices of the input
+  printf("Test 5: find_all slices... ");
+  Value args[2];
+  args[0] = native_regex_compile(1, (Value[]){value_make_string("a*b")});
+  args[1] = value_make_string("aabab");
+  Value result = native_regex_find_all(2, args);
+  ObjArray *matches = AS_OBJ_ARRAY(result);
+  if (matches->count != 2 ||
+      AS_OBJ_STRING(matches->items[0])->length != 3 ||
+      AS_OBJ_STRING(matches->items[1])->length != 2 ||
+      AS_OBJ_STRING(matches->items[1])->base != AS_OBJ_STRING(matches->items[0])->base) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 6: Empty matches do not repeat at the previous end
+  printf("Test 6: count of a* in 'baaac'... ");
+  args[0] = native_regex_compile(1, (Value[]){value_make_string("a*")});
+  args[1] = value_make_string("baaac");
+  result = native_regex_count(2, args);
+  if (AS_INT(result) != 3) {
+    printf("FAILED (got %lld)\n", (long long)AS_INT(result));
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  printf("\n=== All tests passed! ===\n");
+  return 0;
+}
@@ -0,0 +1,83 @@
+// tests/test_short_string.c - Small-string optimization test
+//
+// Checks that strings up to VALUE_SHORT_MAX bytes are held inside the
+// Value, that longer ones still go to the heap, and that printing,
+// equality, hashing and the string natives treat both forms alike.
+
+#include "core/value.h"
+#include "core/object.h"
+#include "stdlib/hash.h"
+#include "stdlib/string.h"
+#include <stdio.h>
+#include <string.h>
+
+int main(void) {
+  printf("=== Short String Test ===\n\n");
+
+  // Test 1: Representation at and around the limit
+  printf("Test 1: Inline up to %d bytes... ", VALUE_SHORT_MAX);
+  char text[32];
+  for (int length = 0; length <= 20; length++) {
+    for (int i = 0; i < length; i++) text[i] = (char)('a' + i);
+    text[length] = '\0';
+    Value value = value_make_string(text);
+    const char *chars;
+    int got;
+    bool inline_expected = length <= VALUE_SHORT_MAX;
+    if (IS_SHORT_STRING(value) != inline_expected || !IS_STRING(value) ||
+        !value_get_string(&value, &chars, &got) || got != length ||
+        strcmp(AS_STRING(value), text) != 0) {
+      printf("FAILED\n  length %d\n", length);
+      return 1;
+    }
+    if (!inline_expected && chars == (const char*)&value) {
+      printf("FAILED\n  length %d is inline\n", length);
+      return 1;
+    }
+    value_free(value);
+  }
+  if (sizeof(Value) != 16) {
+    printf("FAILED\n  Value is %zu bytes\n", sizeof(Value));
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 2: Equality and formatting across representations
+  printf("Test 2: Equality and formatting... ");
+  Value short_value = value_make_string("status");
+  Value object_value = OBJ_VAL(string_copy("status", 6));
+  Value long_value = value_make_string("Content-Type: text/plain");
+  char buffer[64];
+  if (!value_equal(short_value, object_value) ||
+      value_equal(short_value, value_make_string("statue")) ||
+      value_equal(short_value, long_value) ||
+      value_format(short_value, buffer, sizeof(buffer)) != 6 || strcmp(buffer, "status") != 0 ||
+      value_format(short_value, buffer, 4) != 6 || strcmp(buffer, "sta") != 0) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 3: Natives see the same bytes in both forms
+  printf("Test 3: Natives... ");
+  Value hash_short = native_hash_xxh3(1, &short_value);
+  Value hash_object = native_hash_xxh3(1, &object_value);
+  Value upper = native_string_to_upper(1, &short_value);
+  Value upper_long = native_string_to_upper(1, &long_value);
+  Value count = native_string_char_count(1, &short_value);
+  if (!IS_INT(hash_short) || !IS_INT(hash_object) ||
+      AS_INT(hash_short) != AS_INT(hash_object) ||
+      !IS_SHORT_STRING(upper) || strcmp(AS_STRING(upper), "STATUS") != 0 ||
+      !IS_OBJ_STRING(upper_long) ||
+      strcmp(AS_OBJ_STRING(upper_long)->chars, "CONTENT-TYPE: TEXT/PLAIN") != 0 ||
+      !IS_INT(count) || AS_INT(count) != 6) {
+    printf("FAILED\n");
+    return 1;
+  }
+  value_free(long_value);
+  object_free(AS_OBJ(upper_long));
+  printf("SUCCESS\n");
+
+  printf("\n=== All tests passed! ===\n");
+  return 0;
+}
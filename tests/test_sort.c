@@ -0,0 +1,180 @@
+// tests/test_sort.c - Sort module test
+//
+// Checks radix-sorted numbers and pdqsorted strings against qsort on
+// random and patterned inputs (sorted, reversed, equal, sawtooth), and
+// checks that stable sorts and sort_by_key keep equal keys in order.
+
+#include "stdlib/sort.h"
+#include "core/object.h"
+#include "core/value.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static u64 rng = 88172645463325252ull;
+
+static u64 next_random(void) {
+  rng ^= rng << 13;
+  rng ^= rng >> 7;
+  rng ^= rng << 17;
+  return rng;
+}
+
+static int compare_ints(const void *a, const void *b) {
+  i64 x = *(const i64*)a, y = *(const i64*)b;
+  return (x > y) - (x < y);
+}
+
+static int compare_strings(const void *a, const void *b) {
+  return strcmp((const char*)a, (const char*)b);
+}
+
+// Element i of an input of the given pattern
+static i64 pattern_value(int pattern, int i, int count) {
+  switch (pattern) {
+    case 0: return (i64)next_random();
+    case 1: return i;
+    case 2: return count - i;
+    case 3: return 7;
+    case 4: return i % 100;
+    default: return (i64)(next_random() % 16) - 8;
+  }
+}
+
+int main(void) {
+  printf("=== Sort Test ===\n\n");
+  static const int sizes[] = {0, 1, 2, 63, 64, 65, 1000, 100000};
+
+  // Test 1: Ints match qsort
+  printf("Test 1: Radix sort ints... ");
+  i64 *data = malloc(sizeof(i64) * 100000);
+  i64 *expected = malloc(sizeof(i64) * 100000);
+  for (int s = 0; s < 8; s++) {
+    for (int pattern = 0; pattern < 6; pattern++) {
+      int count = sizes[s];
+      for (int i = 0; i < count; i++) data[i] = expected[i] = pattern_value(pattern, i, count);
+      sort_ints(data, count);
+      qsort(expected, count, sizeof(i64), compare_ints);
+      if (count > 0 && memcmp(data, expected, sizeof(i64) * count) != 0) {
+        printf("FAILED\n  %d elements, pattern %d\n", count, pattern);
+        return 1;
+      }
+    }
+  }
+  printf("SUCCESS\n");
+
+  // Test 2: Floats, including signed zeros, infinities and NaN
+  printf("Test 2: Radix sort floats... ");
+  f64 floats[] = {3.5, -0.0, NAN, -INFINITY, 0.0, 1e-300, -2.25, INFINITY, -1e300, 0.5};
+  sort_floats(floats, 10);
+  f64 sorted[] = {-INFINITY, -1e300, -2.25, -0.0, 0.0, 1e-300, 0.5, 3.5, INFINITY};
+  for (int i = 0; i < 9; i++) {
+    if (floats[i] != sorted[i] || signbit(floats[i]) != signbit(sorted[i])) {
+      printf("FAILED\n  position %d: %g\n", i, floats[i]);
+      return 1;
+    }
+  }
+  if (!isnan(floats[9])) {
+    printf("FAILED\n  NaN not last\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 3: Strings match qsort
+  printf("Test 3: pdqsort strings... ");
+  char (*strings)[24] = malloc(sizeof(*strings) * 100000);
+  for (int s = 0; s < 8; s++) {
+    for (int pattern = 0; pattern < 6; pattern++) {
+      int count = sizes[s];
+      ObjArray *array = array_make(count);
+      for (int i = 0; i < count; i++) {
+        sprintf(strings[i], "k%lld", (long long)pattern_value(pattern, i, count));
+        array_push(array, OBJ_VAL(string_copy(strings[i], (int)strlen(strings[i]))));
+      }
+      Value arg = OBJ_VAL(array);
+      native_sort_sort(1, &arg);
+      qsort(strings, count, sizeof(*strings), compare_strings);
+      for (int i = 0; i < count; i++) {
+        if (strcmp(AS_OBJ_STRING(array->items[i])->chars, strings[i]) != 0) {
+          printf("FAILED\n  %d elements, pattern %d, position %d\n", count, pattern, i);
+          return 1;
+        }
+      }
+    }
+  }
+  printf("SUCCESS\n");
+
+  // Test 4: Stable sorts keep equal keys in their original order
+  printf("Test 4: Stable sort_by_key... ");
+  int count = 5000;
+  ObjArray *rows = array_make(count);
+  for (int i = 0; i < count; i++) {
+    ObjArray *row = array_make(2);
+    char name[16];
+    sprintf(name, "n%02d", (int)(next_random() % 40));
+    array_push(row, OBJ_VAL(string_copy(name, (int)strlen(name))));
+    array_push(row, value_make_int(i));
+    array_push(rows, OBJ_VAL(row));
+  }
+  Value args[2] = {OBJ_VAL(rows), value_make_int(0)};
+  native_sort_sort_by_key(2, args);
+  for (int i = 1; i < count; i++) {
+    ObjArray *a = AS_OBJ_ARRAY(rows->items[i - 1]);
+    ObjArray *b = AS_OBJ_ARRAY(rows->items[i]);
+    int c = strcmp(AS_OBJ_STRING(a->items[0])->chars, AS_OBJ_STRING(b->items[0])->chars);
+    if (c > 0 || (c == 0 && AS_INT(a->items[1]) > AS_INT(b->items[1]))) {
+      printf("FAILED\n  rows %d and %d out of order\n", i - 1, i);
+      return 1;
+    }
+  }
+
+  // Numbers with equal value (1 and 1.0) also keep their order
+  ObjArray *numbers = array_make(4);
+  array_push(numbers, value_make_float(1.0));
+  array_push(numbers, value_make_int(0));
+  array_push(numbers, value_make_int(1));
+  array_push(numbers, value_make_float(-0.5));
+  Value number_arg = OBJ_VAL(numbers);
+  native_sort_sort(1, &number_arg);
+  if (!IS_FLOAT(numbers->items[0]) || !IS_INT(numbers->items[1]) ||
+      !IS_FLOAT(numbers->items[2]) || !IS_INT(numbers->items[3])) {
+    printf("FAILED\n  mixed numbers reordered\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 5: Packed arrays sorted by packed keys; mixed keys rejected
+  printf("Test 5: Packed keys... ");
+  ObjPacked *ids = packed_make(PACKED_INT, 0);
+  ObjPacked *scores = packed_make(PACKED_FLOAT, 0);
+  for (int i = 0; i < 300; i++) {
+    packed_push_int(ids, i);
+    packed_push_float(scores, (f64)(next_random() % 50) / 4);
+  }
+  Value packed_args[2] = {OBJ_VAL(ids), OBJ_VAL(scores)};
+  native_sort_sort_by_key(2, packed_args);
+  for (int i = 1; i < 300; i++) {
+    f64 a = scores->as.floats[ids->as.ints[i - 1]];
+    f64 b = scores->as.floats[ids->as.ints[i]];
+    if (a > b || (a == b && ids->as.ints[i - 1] > ids->as.ints[i])) {
+      printf("FAILED\n  ids %d and %d out of order\n", i - 1, i);
+      return 1;
+    }
+  }
+  ObjArray *mixed = array_make(2);
+  array_push(mixed, value_make_int(1));
+  array_push(mixed, OBJ_VAL(string_copy("a", 1)));
+  Value mixed_arg = OBJ_VAL(mixed);
+  if (!IS_NIL(native_sort_sort(1, &mixed_arg))) {
+    printf("FAILED\n  mixed array accepted\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  free(data);
+  free(expected);
+  free(strings);
+  printf("\n=== All tests passed! ===\n");
+  return 0;
+}
@@ -0,0 +1,130 @@
+// tests/test_string_build.c - String interpolation and concatenation test
+//
+// Compiles snippets through the full pipeline, checks that each string
+// expression becomes a single OP_BUILD_STRING with no OP_ADD, and runs
+// them to check the text.
+
+#include "frontend/lexer.h"
+#include "frontend/parser.h"
+#include "backend/codegen.h"
+#include "runtime/vm.h"
+#include "core/object.h"
+#include "core/value.h"
+#include <stdio.h>
+#include <string.h>
+
+// Number of times `op` appears, stepping over operands
+static int count_op(Chunk *chunk, u8 op) {
+  int count = 0;
+  for (int i = 0; i < chunk->count; i++) {
+    u8 instruction = chunk->code[i];
+    if (instruction == op) count++;
+    switch (instruction) {
+      case OP_CONSTANT: case OP_GET_LOCAL: case OP_SET_LOCAL: case OP_GET_GLOBAL:
+      case OP_CALL_NATIVE: case OP_IMPORT: case OP_BUILD_STRING: case OP_PRINT:
+        i += 1;
+        break;
+      case OP_JUMP: case OP_JUMP_IF_FALSE: case OP_LOOP:
+        i += 2;
+        break;
+      default:
+        break;
+    }
+  }
+  return count;
+}
+
+// Compile and run `source`, then compare local `slot` with `expected`
+static bool check(const char *source, int slot, const char *expected, int builds, int adds) {
+  Lexer lexer;
+  lexer_init(&lexer, source);
+  Parser parser;
+  parser_init(&parser, &lexer, "<test>");
+  AstNode *ast = parser_parse(&parser);
+  if (ast == NULL) {
+    printf("FAILED\n  parse error in: %s\n", source);
+    return false;
+  }
+
+  VM vm;
+  vm_init(&vm);
+  bool ok = codegen_compile(ast, &vm.chunk);
+  ast_free(ast);
+  if (!ok || count_op(&vm.chunk, OP_BUILD_STRING) != builds ||
+      count_op(&vm.chunk, OP_ADD) + count_op(&vm.chunk, OP_ADD_INT) != adds) {
+    printf("FAILED\n  bytecode for: %s\n", source);
+    vm_free(&vm);
+    return false;
+  }
+
+  const char *chars;
+  int length;
+  ok = vm_run(&vm) && value_get_string(&vm.locals[slot], &chars, &length) &&
+       length == (int)strlen(expected) && memcmp(chars, expected, length) == 0;
+  if (!ok) printf("FAILED\n  result of: %s\n", source);
+  vm_free(&vm);
+  return ok;
+}
+
+int main(void) {
+  printf("=== String Build Test ===\n\n");
+
+  // Test 1: Interpolation
+  printf("Test 1: Interpolation... ");
+  if (!check("let name := \"satori\"\n"
+             "let n := 41\n"
+             "let s := \"hi {name}, {n + 1} {{x}} {}\"\n",
+             2, "hi satori, 42 {x} {}", 1, 1) ||
+      !check("let n := 7\nlet s := \"{n}\"\n", 1, "7", 1, 0) ||
+      !check("let s := \"a {\"b\" + \"c\"} d\"\n", 0, "a bc d", 1, 0)) {
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 2: A chain of + builds once, and literals merge
+  printf("Test 2: Concatenation chains... ");
+  if (!check("let a := \"x\"\n"
+             "let s := a + \"HTTP/1.0 \" + \"200 OK\" + a + 1.5 + a\n",
+             1, "xHTTP/1.0 200 OKx1.5x", 1, 0) ||
+      !check("let s := \"\" + \"\"\n", 0, "", 1, 0)) {
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 3: Numbers before the first string still add
+  printf("Test 3: Numeric prefix... ");
+  if (!check("let n := 2\nlet s := 1 + n + \"x\" + n + 1\n", 1, "3x21", 1, 1) ||
+      !check("let n := 2\nlet s := n + \"x\"\n", 1, "2x", 1, 0)) {
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 4: OP_ADD on strings built at runtime, and chains longer than
+  // one OP_BUILD_STRING takes
+  printf("Test 4: Long chains... ");
+  char source[2048] = "let a := \"ab\"\nlet s := \"\"";
+  char expected[256] = "";
+  for (int i = 0; i < 100; i++) {
+    strcat(source, " + a");
+    strcat(expected, "ab");
+  }
+  strcat(source, "\n");
+  if (!check(source, 1, expected, 2, 0) ||
+      !check("let a := \"{1}\"\nlet s := a + a\n", 1, "11", 1, 1)) {
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 5: String equality across literal and built strings
+  printf("Test 5: Equality... ");
+  Value built = OBJ_VAL(string_copy("abc", 3));
+  if (!value_equal(built, value_make_string("abc")) ||
+      value_equal(built, value_make_string("abd"))) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  printf("\n=== All tests passed! ===\n");
+  return 0;
+}
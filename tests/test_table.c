@@ -0,0 +1,113 @@
+// tests/test_table.c - Hash table test
+//
+// Checks Table through growth, overwrites and deletions that land inside
+// probe runs, that entries cache their keys' hashes, and that tables,
+// heap strings and map keys all hash a string the same way.
+
+#include "core/hamt.h"
+#include "core/hash.h"
+#include "core/object.h"
+#include "core/table.h"
+#include <stdio.h>
+#include <string.h>
+
+#define KEYS 20000
+
+static void key_name(char *buffer, int i) {
+  snprintf(buffer, 32, "key:%d", i);
+}
+
+int main(void) {
+  printf("=== Table Test ===\n\n");
+  char key[32];
+  Value value;
+
+  // Test 1: Every key survives growth, and overwrites keep the count
+  printf("Test 1: Growth... ");
+  Table table;
+  table_init(&table);
+  for (int i = 0; i < KEYS; i++) {
+    key_name(key, i);
+    table_set(&table, key, value_make_int(i));
+  }
+  for (int i = 0; i < KEYS; i += 2) {
+    key_name(key, i);
+    if (table_set(&table, key, value_make_int(-i))) {
+      printf("FAILED (overwrite made a new key)\n");
+      return 1;
+    }
+  }
+  for (int i = 0; i < KEYS; i++) {
+    key_name(key, i);
+    if (!table_get(&table, key, &value) || AS_INT(value) != (i % 2 == 0 ? -i : i)) {
+      printf("FAILED (%s)\n", key);
+      return 1;
+    }
+  }
+  if (table.count != KEYS || (table.capacity & (table.capacity - 1)) != 0) {
+    printf("FAILED (count %d, capacity %d)\n", table.count, table.capacity);
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 2: Deleting from the middle of probe runs strands nothing
+  printf("Test 2: Deletion... ");
+  for (int i = 0; i < KEYS; i += 3) {
+    key_name(key, i);
+    if (!table_delete(&table, key) || table_delete(&table, key)) {
+      printf("FAILED (delete %s)\n", key);
+      return 1;
+    }
+  }
+  for (int i = 0; i < KEYS; i++) {
+    key_name(key, i);
+    if (table_get(&table, key, &value) != (i % 3 != 0)) {
+      printf("FAILED (%s)\n", key);
+      return 1;
+    }
+  }
+  for (int i = 0; i < KEYS; i += 3) {
+    key_name(key, i);
+    table_set(&table, key, value_make_int(i));
+  }
+  if (table.count != KEYS) {
+    printf("FAILED (count %d)\n", table.count);
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 3: Entries hold their keys' hashes
+  printf("Test 3: Cached hashes... ");
+  for (int i = 0; i < table.capacity; i++) {
+    Entry *entry = &table.entries[i];
+    if (entry->key != NULL && entry->hash != hash_key(entry->key, strlen(entry->key))) {
+      printf("FAILED (%s)\n", entry->key);
+      return 1;
+    }
+  }
+  table_free(&table);
+  printf("SUCCESS\n");
+
+  // Test 4: One hash for a string, whatever holds it
+  printf("Test 4: Shared hash... ");
+  const char *texts[] = {"", "a", "short", "exactly 14 chr", "a string long enough for the heap",
+                         "a string longer than sixteen bytes and forty-eight bytes as well"};
+  for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++) {
+    size_t length = strlen(texts[i]);
+    u32 hash = hash_key(texts[i], length);
+    ObjString *str = string_copy(texts[i], (int)length);
+    ObjString *slice = string_slice(string_copy(texts[i], (int)length), 0, (int)length);
+    Value inline_key = value_make_string(texts[i]);
+    if (hash != hash_key(texts[i], length) || string_hash(str) != hash ||
+        string_hash(slice) != hash || map_key_hash(OBJ_VAL(str)) != hash ||
+        map_key_hash(inline_key) != hash) {
+      printf("FAILED (\"%s\")\n", texts[i]);
+      return 1;
+    }
+    value_free(inline_key);
+  }
+  printf("SUCCESS\n");
+
+  printf("\n=== All tests passed! ===\n");
+  return 0;
+}
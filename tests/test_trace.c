@@ -0,0 +1,169 @@
+// tests/test_trace.c - Tracing spans test
+//
+// Records nested spans from one thread and from several at once, and
+// checks the Chrome and OTLP files they produce: every event is written
+// or counted as dropped, each thread's spans nest, and OTLP spans point
+// at their parents. Also checks that a stopped tracer records nothing.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "stdlib/trace.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PATH "/tmp/satori_test_trace.json"
+#define THREADS 4
+#define SPANS 50000
+
+static char *read_all(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) return NULL;
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  rewind(file);
+  char *text = malloc(size + 1);
+  text[fread(text, 1, size, file)] = '\0';
+  fclose(file);
+  return text;
+}
+
+static int count(const char *text, const char *needle) {
+  int n = 0;
+  for (const char *at = strstr(text, needle); at != NULL; at = strstr(at + 1, needle)) n++;
+  return n;
+}
+
+// Each thread's Chrome events must nest: never more ends than begins, and
+// as many of each in the end. Returns the number of events, or -1.
+static int check_nesting(const char *text) {
+  int depth[THREADS + 2] = {0};
+  int events = 0;
+  for (const char *line = strstr(text, "\n{\""); line != NULL; line = strstr(line + 1, "\n{\"")) {
+    const char *tid = strstr(line, "\"tid\":");
+    const char *phase = strstr(line, "\"ph\":\"");
+    if (tid == NULL || phase == NULL) break;
+    int thread = atoi(tid + 6);
+    if (thread < 1 || thread > THREADS + 1) return -1;
+    depth[thread] += phase[6] == 'B' ? 1 : -1;
+    if (depth[thread] < 0) return -1;
+    events++;
+  }
+  for (int i = 0; i < THREADS + 2; i++) {
+    if (depth[i] != 0) return -1;
+  }
+  return events;
+}
+
+static void *record_spans(void *arg) {
+  (void)arg;
+  for (int i = 0; i < SPANS; i++) {
+    trace_begin("request", 7);
+    trace_begin("query", 5);
+    trace_end();
+    trace_end();
+  }
+  return NULL;
+}
+
+int main(void) {
+  printf("=== Trace Test ===\n\n");
+  const char *error = NULL;
+
+  // Test 1: Nothing is recorded while tracing is off
+  printf("Test 1: Disabled tracer... ");
+  trace_begin("early", 5);
+  trace_end();
+  if (trace_stop() != 0) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 2: Nested spans as Chrome events, in order
+  printf("Test 2: Chrome events... ");
+  if (!trace_start(PATH, TRACE_CHROME, &error)) {
+    printf("FAILED (%s)\n", error);
+    return 1;
+  }
+  trace_end();  // Ends no span, so is ignored
+  trace_begin("outer", 5);
+  trace_begin("in \"quotes\"", 11);
+  trace_end();
+  trace_begin("a name far longer than the fifty-four bytes a span keeps", 56);
+  trace_end();
+  trace_end();
+  u64 dropped = trace_stop();
+  char *text = read_all(PATH);
+  const char *outer = text ? strstr(text, "\"name\":\"outer\"") : NULL;
+  const char *quoted = text ? strstr(text, "\"name\":\"in \\\"quotes\\\"\"") : NULL;
+  if (dropped != 0 || outer == NULL || quoted == NULL || quoted < outer ||
+      strncmp(text, "{\"traceEvents\":[", 16) != 0 || strstr(text, "\n]}\n") == NULL ||
+      strstr(text, "\"a name far longer than the fifty-four bytes a span kee\"") == NULL ||
+      check_nesting(text) != 6) {
+    printf("FAILED\n");
+    return 1;
+  }
+  free(text);
+  printf("SUCCESS\n");
+
+  // Test 3: Threads recording at once each get their own ring
+  printf("Test 3: Threads... ");
+  if (!trace_start(PATH, TRACE_CHROME, &error)) {
+    printf("FAILED (%s)\n", error);
+    return 1;
+  }
+  pthread_t threads[THREADS];
+  for (int i = 0; i < THREADS; i++) pthread_create(&threads[i], NULL, record_spans, NULL);
+  for (int i = 0; i < THREADS; i++) pthread_join(threads[i], NULL);
+  dropped = trace_stop();
+  text = read_all(PATH);
+  int written = text ? check_nesting(text) : -1;
+  if (written < 0 || (u64)written + dropped != (u64)THREADS * SPANS * 4 ||
+      count(text, "\"tid\":4}") == 0) {
+    printf("FAILED (%d written, %llu dropped)\n", written, (unsigned long long)dropped);
+    return 1;
+  }
+  free(text);
+  printf("SUCCESS\n");
+
+  // Test 4: OTLP spans name their parents
+  printf("Test 4: OTLP spans... ");
+  if (!trace_start(PATH, TRACE_OTLP, &error)) {
+    printf("FAILED (%s)\n", error);
+    return 1;
+  }
+  trace_begin("parent", 6);
+  trace_begin("child", 5);
+  trace_end();
+  trace_end();
+  trace_begin("unfinished", 10);
+  trace_stop();
+  text = read_all(PATH);
+  const char *child = text ? strstr(text, "\"name\":\"child\"") : NULL;
+  const char *parent = text ? strstr(text, "\"name\":\"parent\"") : NULL;
+  if (child == NULL || parent == NULL || child > parent || count(text, "\"spanId\"") != 2 ||
+      count(text, "\"parentSpanId\":\"0000000000000001\"") != 1 ||
+      strstr(text, "unfinished") != NULL || strstr(text, "\n]}]}]}\n") == NULL) {
+    printf("FAILED\n");
+    return 1;
+  }
+  free(text);
+  printf("SUCCESS\n");
+
+  // Test 5: Errors
+  printf("Test 5: Errors... ");
+  bool started = trace_start(PATH, TRACE_CHROME, &error);
+  bool again = trace_start(PATH, TRACE_CHROME, &error);
+  trace_stop();
+  if (!started || again || trace_start("/nonexistent/dir/trace.json", TRACE_CHROME, &error)) {
+    printf("FAILED\n");
+    return 1;
+  }
+  remove(PATH);
+  printf("SUCCESS\n");
+
+  printf("\n=== All tests passed! ===\n");
+  return 0;
+}
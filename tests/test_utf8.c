@@ -0,0 +1,132 @@
+// tests/test_utf8.c - UTF-8 validation and code-point indexing test
+//
+// Runs the validator over well-formed and malformed sequences (overlong
+// forms, surrogates, out-of-range and truncated sequences) at every
+// alignment, and checks code-point offsets against a byte-by-byte scan.
+
+#include "core/utf8.h"
+#include "core/object.h"
+#include "core/value.h"
+#include "stdlib/string.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+  const char *bytes;
+  bool valid;
+} Case;
+
+static const Case cases[] = {
+  {"plain ascii", true},
+  {"caf\xc3\xa9", true},                  // U+00E9
+  {"\xe2\x82\xac", true},                  // U+20AC
+  {"\xef\xbf\xbf", true},                  // U+FFFF
+  {"\xf0\x9f\x98\x80", true},              // U+1F600
+  {"\xf4\x8f\xbf\xbf", true},              // U+10FFFF
+  {"\x80", false},                         // Stray continuation
+  {"\xc0\xaf", false},                     // Overlong '/'
+  {"\xc1\xbf", false},                     // Overlong
+  {"\xe0\x80\xaf", false},                 // Overlong 3-byte
+  {"\xf0\x80\x80\xaf", false},             // Overlong 4-byte
+  {"\xed\xa0\x80", false},                 // Surrogate U+D800
+  {"\xf4\x90\x80\x80", false},             // U+110000
+  {"\xf5\x80\x80\x80", false},             // Invalid lead
+  {"\xff", false},
+  {"\xc3", false},                         // Truncated
+  {"\xe2\x82", false},
+  {"\xf0\x9f\x98", false},
+  {"\xc3\x28", false},                     // Bad continuation
+};
+
+// Byte offset of code point `index`, found by scanning from the start
+static int naive_offset(const char *chars, int length, int index) {
+  int seen = 0;
+  for (int i = 0; i < length; i++) {
+    if (i == 0 || !utf8_is_continuation((u8)chars[i])) {
+      if (seen == index) return i;
+      seen++;
+    }
+  }
+  return length;
+}
+
+int main(void) {
+  printf("=== UTF-8 Test ===\n\n");
+
+  // Test 1: Each case at every offset within a 64-byte ASCII run, so it
+  // falls on both sides of the vector fast path
+  printf("Test 1: Validation... ");
+  for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+    for (int pad = 0; pad < 40; pad++) {
+      char buffer[128];
+      int n = (int)strlen(cases[c].bytes);
+      memset(buffer, 'a', sizeof(buffer));
+      memcpy(buffer + pad, cases[c].bytes, n);
+      if (utf8_validate(buffer, pad + n) != cases[c].valid ||
+          utf8_validate(buffer, 100) != cases[c].valid) {
+        printf("FAILED\n  case %zu at offset %d\n", c, pad);
+        return 1;
+      }
+    }
+  }
+  printf("SUCCESS\n");
+
+  // Test 2: ASCII detection and counting
+  printf("Test 2: ASCII flag and counts... ");
+  char text[1000];
+  int length = 0;
+  for (int i = 0; length < 990; i++) {
+    const char *piece = i % 7 == 0 ? "\xe2\x82\xac" : i % 5 == 0 ? "\xc3\xa9" : "x";
+    memcpy(text + length, piece, strlen(piece));
+    length += (int)strlen(piece);
+  }
+  ObjString *ascii = string_copy("hello world, this is plain text", 31);
+  ObjString *mixed = string_copy(text, length);
+  if (!ascii->is_ascii || mixed->is_ascii || string_char_count(ascii) != 31 ||
+      string_char_count(mixed) != utf8_count(text, length) ||
+      ascii->index != NULL || mixed->index == NULL) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 3: Offsets from the breadcrumb index match a full scan
+  printf("Test 3: Code-point offsets... ");
+  int count = string_char_count(mixed);
+  for (int i = 0; i <= count + 1; i++) {
+    if (string_char_offset(mixed, i) != naive_offset(text, length, i)) {
+      printf("FAILED\n  code point %d\n", i);
+      return 1;
+    }
+  }
+
+  // Invalid bytes still index: a leading continuation starts code point 0
+  ObjString *broken = string_copy("\x80\x80" "a\xc3\xa9\xff", 6);
+  if (string_char_count(broken) != 4 || string_char_offset(broken, 1) != 2 ||
+      string_char_offset(broken, 3) != 5) {
+    printf("FAILED\n  invalid input\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  // Test 4: Slicing by code point returns slices of the original
+  printf("Test 4: slice and char_at... ");
+  Value str = OBJ_VAL(string_copy("na\xc3\xafve caf\xc3\xa9", 12));
+  Value args[3] = {str, value_make_int(6), value_make_int(10)};
+  Value cafe = native_string_slice(3, args);
+  Value char_args[2] = {str, value_make_int(2)};
+  Value i_diaeresis = native_string_char_at(2, char_args);
+  args[2] = value_make_int(11);
+  if (!IS_OBJ_STRING(cafe) || AS_OBJ_STRING(cafe)->length != 5 ||
+      memcmp(AS_OBJ_STRING(cafe)->chars, "caf\xc3\xa9", 5) != 0 ||
+      AS_OBJ_STRING(cafe)->chars != AS_OBJ_STRING(str)->chars + 7 ||
+      !IS_OBJ_STRING(i_diaeresis) || AS_OBJ_STRING(i_diaeresis)->length != 2 ||
+      !IS_NIL(native_string_slice(3, args))) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("SUCCESS\n");
+
+  printf("\n=== All tests passed! ===\n");
+  return 0;
+}